@@ -0,0 +1,329 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <atomic>
+#include <cmath>
+#include <limits>
+#include <omp.h>
+
+#include <triqs/utility/exceptions.hpp>
+
+#include "batched_linalg.hpp"
+
+namespace triqs_tprf {
+
+  namespace {
+
+    using scalar_t = std::complex<double>;
+
+    using scalar_f_t = std::complex<float>;
+
+    // Precision of the factorizations in batched_rpa_solve
+    std::atomic<bool> rpa_mixed_precision = false;
+
+    // -- Single matrix kernels, N > 0 fixes the size at compile time
+
+    template <int N> inline long size_of(long n) { return (N > 0) ? N : n; }
+
+    // LU factorization with partial pivoting of the row major n x n matrix m
+    template <int N, typename T> bool lu_factor(T *m, int *piv, long n_rt) {
+      const long n = size_of<N>(n_rt);
+      for (long j = 0; j < n; j++) {
+        long p    = j;
+        auto amax = std::abs(m[j * n + j]);
+        for (long i = j + 1; i < n; i++) {
+          auto a = std::abs(m[i * n + j]);
+          if (a > amax) {
+            amax = a;
+            p    = i;
+          }
+        }
+        piv[j] = p;
+        if (amax == 0) return false;
+        if (p != j)
+          for (long c = 0; c < n; c++) std::swap(m[j * n + c], m[p * n + c]);
+
+        T inv = T(1) / m[j * n + j];
+        for (long i = j + 1; i < n; i++) {
+          T l = (m[i * n + j] *= inv);
+          for (long c = j + 1; c < n; c++) m[i * n + c] -= l * m[j * n + c];
+        }
+      }
+      return true;
+    }
+
+    // Solve m x = b for the n x n_rhs right hand side x, in place, from the LU factors of m
+    template <int N, typename T> void lu_solve(T const *m, int const *piv, T *x, long n_rt, long n_rhs) {
+      const long n = size_of<N>(n_rt);
+
+      for (long j = 0; j < n; j++)
+        if (piv[j] != j)
+          for (long c = 0; c < n_rhs; c++) std::swap(x[j * n_rhs + c], x[piv[j] * n_rhs + c]);
+
+      for (long i = 1; i < n; i++)
+        for (long j = 0; j < i; j++) {
+          T l = m[i * n + j];
+          for (long c = 0; c < n_rhs; c++) x[i * n_rhs + c] -= l * x[j * n_rhs + c];
+        }
+
+      for (long i = n - 1; i >= 0; i--) {
+        for (long j = i + 1; j < n; j++) {
+          T u = m[i * n + j];
+          for (long c = 0; c < n_rhs; c++) x[i * n_rhs + c] -= u * x[j * n_rhs + c];
+        }
+        T inv = T(1) / m[i * n + i];
+        for (long c = 0; c < n_rhs; c++) x[i * n_rhs + c] *= inv;
+      }
+    }
+
+    template <int N> void gemm(scalar_t alpha, scalar_t const *a, scalar_t const *b, scalar_t beta, scalar_t *c, long n_rt) {
+      const long n = size_of<N>(n_rt);
+      for (long i = 0; i < n; i++)
+        for (long j = 0; j < n; j++) {
+          scalar_t s = 0;
+          for (long l = 0; l < n; l++) s += a[i * n + l] * b[l * n + j];
+          c[i * n + j] = alpha * s + (beta == 0. ? scalar_t{0} : beta * c[i * n + j]);
+        }
+    }
+
+    template <int N> double max_abs(scalar_t const *a, long n_rt) {
+      const long n = size_of<N>(n_rt);
+      double r     = 0;
+      for (long i = 0; i < n * n; i++) r = std::max(r, std::abs(a[i]));
+      return r;
+    }
+
+    // Per thread scratch space of the RPA solves
+    struct rpa_scratch_t {
+      std::vector<scalar_t> m, x0, r;
+      std::vector<scalar_f_t> m_f, d_f;
+      std::vector<int> piv;
+      rpa_scratch_t(long n, bool mixed) : m(n * n), piv(n) {
+        if (!mixed) return;
+        x0.resize(n * n);
+        r.resize(n * n);
+        m_f.resize(n * n);
+        d_f.resize(n * n);
+      }
+    };
+
+    // x <- [1 - x b]^{-1} x
+    template <int N> bool rpa_solve(scalar_t *x, scalar_t const *b, rpa_scratch_t &w, long n_rt) {
+      const long n = size_of<N>(n_rt);
+      auto *m      = w.m.data();
+      gemm<N>(-1., x, b, 0., m, n);
+      for (long i = 0; i < n; i++) m[i * n + i] += 1.;
+      if (!lu_factor<N>(m, w.piv.data(), n)) return false;
+      lu_solve<N>(m, w.piv.data(), x, n, n);
+      return true;
+    }
+
+    // x <- [1 - x b]^{-1} x, single precision LU with double precision iterative refinement.
+    // Falls back to the double precision solve when the refinement does not converge.
+    template <int N> bool rpa_solve_mixed(scalar_t *x, scalar_t const *b, rpa_scratch_t &w, long n_rt) {
+      const long n = size_of<N>(n_rt), nn = n * n;
+      auto *m = w.m.data(), *x0 = w.x0.data(), *r = w.r.data();
+      auto *m_f = w.m_f.data(), *d_f = w.d_f.data();
+      auto *piv = w.piv.data();
+
+      std::copy(x, x + nn, x0);
+      gemm<N>(-1., x0, b, 0., m, n);
+      for (long i = 0; i < n; i++) m[i * n + i] += 1.;
+
+      for (long i = 0; i < nn; i++) m_f[i] = scalar_f_t(m[i]);
+      if (lu_factor<N>(m_f, piv, n)) {
+
+        for (long i = 0; i < nn; i++) d_f[i] = scalar_f_t(x0[i]);
+        lu_solve<N>(m_f, piv, d_f, n, n);
+        for (long i = 0; i < nn; i++) x[i] = scalar_t(d_f[i]);
+
+        constexpr int max_iter = 10;
+        double m_norm = max_abs<N>(m, n), r_prev = std::numeric_limits<double>::max();
+
+        for (int iter = 0; iter < max_iter; iter++) {
+          // r = x0 - m x
+          gemm<N>(-1., m, x, 0., r, n);
+          for (long i = 0; i < nn; i++) r[i] += x0[i];
+
+          double r_norm = max_abs<N>(r, n);
+          if (r_norm <= 4 * n * std::numeric_limits<double>::epsilon() * m_norm * max_abs<N>(x, n)) return true;
+          if (r_norm > 0.5 * r_prev) break; // Stagnation, m is too ill conditioned for single precision
+          r_prev = r_norm;
+
+          for (long i = 0; i < nn; i++) d_f[i] = scalar_f_t(r[i]);
+          lu_solve<N>(m_f, piv, d_f, n, n);
+          for (long i = 0; i < nn; i++) x[i] += scalar_t(d_f[i]);
+        }
+      }
+
+      std::copy(x0, x0 + nn, x);
+      if (!lu_factor<N>(m, piv, n)) return false;
+      lu_solve<N>(m, piv, x, n, n);
+      return true;
+    }
+
+    // -- Batch loops
+
+    template <int N> bool batched_getrf_impl(scalar_t *A, int *ipiv, long n_batch, long n) {
+      bool ok = true;
+#pragma omp parallel for reduction(&& : ok)
+      for (long i = 0; i < n_batch; i++) ok = lu_factor<N>(A + i * n * n, ipiv + i * n, n) && ok;
+      return ok;
+    }
+
+    template <int N> void batched_getrs_impl(scalar_t const *LU, int const *ipiv, scalar_t *B, long n_batch, long n, long n_rhs) {
+#pragma omp parallel for
+      for (long i = 0; i < n_batch; i++) lu_solve<N>(LU + i * n * n, ipiv + i * n, B + i * n * n_rhs, n, n_rhs);
+    }
+
+    template <int N>
+    void batched_gemm_impl(scalar_t alpha, scalar_t const *A, long a_step, scalar_t const *B, long b_step, scalar_t beta, scalar_t *C, long n_batch,
+                           long n) {
+#pragma omp parallel for
+      for (long i = 0; i < n_batch; i++) gemm<N>(alpha, A + i * a_step, B + i * b_step, beta, C + i * n * n, n);
+    }
+
+    template <int N> bool batched_rpa_solve_impl(scalar_t *X, scalar_t const *B, long b_step, long n_batch, long n, bool mixed) {
+      bool ok = true;
+#pragma omp parallel
+      {
+        // Scratch space is allocated once per thread
+        rpa_scratch_t w(n, mixed);
+#pragma omp for reduction(&& : ok)
+        for (long i = 0; i < n_batch; i++) {
+          if (mixed)
+            ok = rpa_solve_mixed<N>(X + i * n * n, B + i * b_step, w, n) && ok;
+          else
+            ok = rpa_solve<N>(X + i * n * n, B + i * b_step, w, n) && ok;
+        }
+      }
+      return ok;
+    }
+
+    // Calls f with the fixed size kernel tag matching n, or the generic one
+    template <typename F> auto dispatch(long n, F &&f) {
+      switch (n) {
+        case 1: return f(std::integral_constant<int, 1>{});
+        case 4: return f(std::integral_constant<int, 4>{});
+        case 9: return f(std::integral_constant<int, 9>{});
+        case 16: return f(std::integral_constant<int, 16>{});
+        default: return f(std::integral_constant<int, 0>{});
+      }
+    }
+
+    void check_square(nda::array<scalar_t, 3> const &A, const char *name) {
+      if (A.shape()[1] != A.shape()[2]) TRIQS_RUNTIME_ERROR << name << ": the matrices must be square.";
+    }
+
+    // Stride between the matrices of an operand, zero for a single broadcasted matrix
+    long batch_step(nda::array<scalar_t, 3> const &B, long n_batch, long n, const char *name) {
+      if (B.shape()[1] != n || B.shape()[2] != n) TRIQS_RUNTIME_ERROR << name << ": incompatible matrix shapes.";
+      if (B.shape()[0] == n_batch) return n * n;
+      if (B.shape()[0] == 1) return 0;
+      TRIQS_RUNTIME_ERROR << name << ": the batch sizes do not match.";
+    }
+
+  } // namespace
+
+  // ----------------------------------------------------
+
+  void batched_getrf(nda::array<scalar_t, 3> &A, nda::array<int, 2> &ipiv) {
+    check_square(A, "batched_getrf");
+    long n_batch = A.shape()[0], n = A.shape()[1];
+    if (ipiv.shape() != std::array<long, 2>{n_batch, n}) ipiv.resize(n_batch, n);
+
+    bool ok = dispatch(n, [&](auto N) { return batched_getrf_impl<decltype(N)::value>(A.data(), ipiv.data(), n_batch, n); });
+    if (!ok) TRIQS_RUNTIME_ERROR << "batched_getrf: singular matrix in batch.";
+  }
+
+  void batched_getrs(nda::array<scalar_t, 3> const &LU, nda::array<int, 2> const &ipiv, nda::array<scalar_t, 3> &B) {
+    check_square(LU, "batched_getrs");
+    long n_batch = LU.shape()[0], n = LU.shape()[1], n_rhs = B.shape()[2];
+    if (B.shape()[0] != n_batch || B.shape()[1] != n) TRIQS_RUNTIME_ERROR << "batched_getrs: incompatible shapes.";
+
+    dispatch(n, [&](auto N) { batched_getrs_impl<decltype(N)::value>(LU.data(), ipiv.data(), B.data(), n_batch, n, n_rhs); });
+  }
+
+  void batched_gemm(scalar_t alpha, nda::array<scalar_t, 3> const &A, nda::array<scalar_t, 3> const &B, scalar_t beta, nda::array<scalar_t, 3> &C) {
+    check_square(C, "batched_gemm");
+    long n_batch = C.shape()[0], n = C.shape()[1];
+    long a_step = batch_step(A, n_batch, n, "batched_gemm");
+    long b_step = batch_step(B, n_batch, n, "batched_gemm");
+
+    dispatch(n, [&](auto N) { batched_gemm_impl<decltype(N)::value>(alpha, A.data(), a_step, B.data(), b_step, beta, C.data(), n_batch, n); });
+  }
+
+  void batched_rpa_solve(nda::array<scalar_t, 3> &X, nda::array<scalar_t, 3> const &B) {
+    check_square(X, "batched_rpa_solve");
+    long n_batch = X.shape()[0], n = X.shape()[1];
+    long b_step  = batch_step(B, n_batch, n, "batched_rpa_solve");
+
+    bool mixed = rpa_mixed_precision;
+    bool ok    = dispatch(n, [&](auto N) { return batched_rpa_solve_impl<decltype(N)::value>(X.data(), B.data(), b_step, n_batch, n, mixed); });
+    if (!ok) TRIQS_RUNTIME_ERROR << "batched_rpa_solve: singular matrix 1 - X B in batch.";
+  }
+
+  void set_rpa_solve_precision(std::string const &precision) {
+    if (precision == "double")
+      rpa_mixed_precision = false;
+    else if (precision == "mixed")
+      rpa_mixed_precision = true;
+    else
+      TRIQS_RUNTIME_ERROR << "set_rpa_solve_precision: unknown precision " << precision << ", use 'double' or 'mixed'.";
+  }
+
+  std::string get_rpa_solve_precision() { return rpa_mixed_precision ? "mixed" : "double"; }
+
+  // ----------------------------------------------------
+
+  nda::array<scalar_t, 3> pack_PH(nda::array_const_view<scalar_t, 5> x, std::vector<long> const &idx) {
+    long nb = x.shape()[1], n_batch = idx.size();
+    nda::array<scalar_t, 3> m(n_batch, nb * nb, nb * nb);
+
+#pragma omp parallel for
+    for (long j = 0; j < n_batch; j++)
+      for (long a = 0; a < nb; a++)
+        for (long b = 0; b < nb; b++)
+          for (long c = 0; c < nb; c++)
+            for (long d = 0; d < nb; d++) m(j, a * nb + b, c * nb + d) = x(idx[j], a, b, c, d);
+
+    return m;
+  }
+
+  nda::array<scalar_t, 3> pack_PH(nda::array_const_view<scalar_t, 5> x, long j0, long j1) {
+    std::vector<long> idx(j1 - j0);
+    for (long j = j0; j < j1; j++) idx[j - j0] = j;
+    return pack_PH(x, idx);
+  }
+
+  void unpack_PH(nda::array<scalar_t, 3> const &m, nda::array_view<scalar_t, 5> x, long j0) {
+    long nb = x.shape()[1], n_batch = m.shape()[0];
+
+#pragma omp parallel for
+    for (long j = 0; j < n_batch; j++)
+      for (long a = 0; a < nb; a++)
+        for (long b = 0; b < nb; b++)
+          for (long c = 0; c < nb; c++)
+            for (long d = 0; d < nb; d++) x(j0 + j, a, b, c, d) = m(j, a * nb + b, c * nb + d);
+  }
+
+} // namespace triqs_tprf
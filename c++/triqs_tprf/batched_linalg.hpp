@@ -0,0 +1,106 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <complex>
+#include <string>
+#include <vector>
+
+#include <nda/nda.hpp>
+#include <triqs/utility/exceptions.hpp>
+
+namespace triqs_tprf {
+
+  /** Batched small-matrix linear algebra
+
+   The routines below act on batches of small square matrices stored
+   contiguously with shape (n_batch, n, n), row major. The matrices are
+   processed in an OpenMP parallel loop with one scratch buffer per thread,
+   and specialized fixed-size kernels are used for n = 1, 4, 9 and 16
+   (the PH grouped two-particle quantities of one to four orbitals).
+
+   A second operand with leading dimension one is used for every element of
+   the batch.
+  */
+
+  /// Batched LU factorization with partial pivoting, in place, pivots ipiv has shape (n_batch, n)
+  void batched_getrf(nda::array<std::complex<double>, 3> &A, nda::array<int, 2> &ipiv);
+
+  /// Batched solve of A_i X_i = B_i from the factorization of batched_getrf, B has shape (n_batch, n, n_rhs) and B_i is overwritten with X_i
+  void batched_getrs(nda::array<std::complex<double>, 3> const &LU, nda::array<int, 2> const &ipiv, nda::array<std::complex<double>, 3> &B);
+
+  /// Batched product C_i = alpha A_i B_i + beta C_i
+  void batched_gemm(std::complex<double> alpha, nda::array<std::complex<double>, 3> const &A, nda::array<std::complex<double>, 3> const &B,
+                    std::complex<double> beta, nda::array<std::complex<double>, 3> &C);
+
+  /** Batched RPA type solve X_i <- [1 - X_i B_i]^{-1} X_i
+
+   The matrix 1 - X_i B_i is LU factorized in a per-thread scratch buffer and
+   the result is formed by back substitution, the inverse is never formed.
+   The precision of the factorization is set with set_rpa_solve_precision.
+
+   @param X batch of matrices, overwritten with the solution
+   @param B batch of matrices, or a single matrix with shape (1, n, n)
+  */
+  void batched_rpa_solve(nda::array<std::complex<double>, 3> &X, nda::array<std::complex<double>, 3> const &B);
+
+  /** Set the precision of the factorizations in the batched RPA solves
+
+   Used by solve_rpa_PH and dynamical_screened_interaction_W. In "mixed" precision
+   the matrices are LU factorized in single precision and the solution is brought
+   to double precision accuracy by iterative refinement with double precision
+   residuals. Points where the refinement stagnates, close to an RPA instability,
+   are solved again with a double precision factorization.
+
+   @param precision "double" (default) or "mixed"
+   */
+  void set_rpa_solve_precision(std::string const &precision);
+
+  /// Precision of the factorizations in the batched RPA solves, "double" or "mixed"
+  std::string get_rpa_solve_precision();
+
+  /** Pack two-particle quantities to matrices in the particle-hole grouping
+
+   The points idx of a (points, a, b, c, d) array are cast to the matrices
+   :math:`X_{\{ab\},\{cd\}}` with shape (idx.size(), nb^2, nb^2), the same
+   matrices as group_indices_view(x, idx_group<0, 1>, idx_group<3, 2>) of a
+   C ordered target.
+  */
+  nda::array<std::complex<double>, 3> pack_PH(nda::array_const_view<std::complex<double>, 5> x, std::vector<long> const &idx);
+
+  /// Pack the points [j0, j1) of a (points, a, b, c, d) array to PH grouped matrices
+  nda::array<std::complex<double>, 3> pack_PH(nda::array_const_view<std::complex<double>, 5> x, long j0, long j1);
+
+  /// Unpack PH grouped matrices to the points [j0, j0 + n_batch) of a (points, a, b, c, d) array
+  void unpack_PH(nda::array<std::complex<double>, 3> const &m, nda::array_view<std::complex<double>, 5> x, long j0);
+
+  /// View of a contiguous (mesh..., a, b, c, d) array as (points, a, b, c, d)
+  template <typename A> auto ph_batch_view(A &&a) {
+    using value_t     = std::remove_reference_t<decltype(*a.data())>;
+    constexpr int R   = std::decay_t<A>::rank;
+    auto const &shape = a.shape();
+    long nb           = shape[R - 1];
+    if (!a.indexmap().is_contiguous()) TRIQS_RUNTIME_ERROR << "ph_batch_view: the array must be contiguous.";
+    return nda::array_view<value_t, 5>(std::array<long, 5>{long(a.size()) / (nb * nb * nb * nb), nb, nb, nb, nb}, a.data());
+  }
+
+} // namespace triqs_tprf
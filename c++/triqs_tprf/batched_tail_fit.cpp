@@ -0,0 +1,143 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <cmath>
+
+#include <nda/lapack.hpp>
+#include <nda/blas.hpp>
+#include <triqs/utility/exceptions.hpp>
+
+#include "batched_tail_fit.hpp"
+
+namespace triqs_tprf {
+
+  batched_tail_fitter::batched_tail_fitter(triqs::mesh::imfreq const &mesh, int order, double tail_fraction, int n_tail_max)
+     : _mesh(mesh), _order(order) {
+
+    if (order < 0) TRIQS_RUNTIME_ERROR << "batched_tail_fitter: negative expansion order " << order << ".";
+    if (tail_fraction <= 0. || tail_fraction > 1.) TRIQS_RUNTIME_ERROR << "batched_tail_fitter: tail_fraction has to be in (0, 1].";
+
+    // Number of non-zero frequencies on the positive side, the bosonic zero frequency is never sampled
+    int s       = (mesh.statistic() == triqs::mesh::Fermion) ? 1 : 0;
+    long N      = mesh.size();
+    long n_zero = 1 - s;
+    long n_pos  = mesh.positive_only() ? N - n_zero : (N - n_zero) / 2;
+    long n_win  = std::min(std::max(long(tail_fraction * n_pos), long(order + 1)), n_pos);
+    long n_pts  = std::min(n_win, long(n_tail_max));
+    if (n_pts < 1) TRIQS_RUNTIME_ERROR << "batched_tail_fitter: the mesh has no non-zero frequencies to fit.";
+
+    // Evenly spaced sample points in the outermost n_win frequencies of each side
+    for (long j = 0; j < n_pts; j++) {
+      long o = (n_pts == 1) ? 0 : (j * (n_win - 1)) / (n_pts - 1);
+      _rows.push_back(N - 1 - o);
+      if (!mesh.positive_only()) _rows.push_back(o);
+    }
+
+    // On small meshes the order is lowered to the number of sampled frequencies
+    _order      = std::min(order, int(_rows.size()) - 1);
+    long n_rows = _rows.size(), nm = _order + 1;
+
+    auto iw_of = [&](long i) { return scalar_t{0., M_PI * (2 * (mesh.first_index() + i) + s) / mesh.beta()}; };
+    double w_max = std::abs(iw_of(N - 1));
+
+    // Design matrix in z = w_max / (i w), |z| <= 1 on the tail
+    nda::matrix<scalar_t, nda::F_layout> A(n_rows, nm);
+    for (long i = 0; i < n_rows; i++) {
+      scalar_t z = w_max / iw_of(_rows[i]), zk = 1.;
+      for (long k = 0; k < nm; k++, zk *= z) A(i, k) = zk;
+    }
+
+    long ns = std::min(n_rows, nm);
+    nda::vector<double> sv(ns);
+    nda::matrix<scalar_t, nda::F_layout> U(n_rows, n_rows), VH(nm, nm);
+    int info = nda::lapack::gesvd(A, sv, U, VH);
+    if (info != 0) TRIQS_RUNTIME_ERROR << "batched_tail_fitter: gesvd failed, info = " << info;
+
+    // P = V S^-1 U^dagger, with row k scaled by w_max^k to give the moments
+    _P = nda::matrix<scalar_t>(nm, n_rows);
+    _P = 0;
+    for (long k = 0; k < nm; k++) {
+      double scale = std::pow(w_max, k);
+      for (long l = 0; l < ns; l++) {
+        if (sv(l) <= 1e-14 * sv(0)) continue;
+        scalar_t vkl = std::conj(VH(l, k)) * scale / sv(l);
+        for (long i = 0; i < n_rows; i++) _P(k, i) += vkl * std::conj(U(i, l));
+      }
+    }
+
+    _s.fill(0.);
+    if (s == 1)
+      for (long i = 0; i < N; i++) {
+        scalar_t x = 1. / iw_of(i), xk = 1.;
+        for (long k = 0; k < 4; k++, xk *= x) _s[k] += xk;
+      }
+  }
+
+  // ----------------------------------------------------
+
+  nda::array<batched_tail_fitter::scalar_t, 2> batched_tail_fitter::moments(nda::array_const_view<scalar_t, 2> data) const {
+    long n_cols = data.shape()[1];
+    nda::matrix<scalar_t> Y(_rows.size(), n_cols), M(_order + 1, n_cols);
+    moments(data, Y(), M());
+    return nda::array<scalar_t, 2>(M);
+  }
+
+  // ----------------------------------------------------
+
+  void batched_tail_fitter::moments(nda::array_const_view<scalar_t, 2> data, nda::matrix_view<scalar_t> tail, nda::matrix_view<scalar_t> m) const {
+
+    if (data.shape()[0] != long(_mesh.size()))
+      TRIQS_RUNTIME_ERROR << "batched_tail_fitter: the data has " << data.shape()[0] << " frequencies, the mesh " << _mesh.size() << ".";
+
+    long n_rows = _rows.size(), n_cols = data.shape()[1];
+    if (tail.shape() != std::array<long, 2>{n_rows, n_cols} || m.shape() != std::array<long, 2>{_order + 1, n_cols})
+      TRIQS_RUNTIME_ERROR << "batched_tail_fitter: the work arrays do not match the data.";
+
+    for (long i = 0; i < n_rows; i++) tail(i, nda::range::all) = data(_rows[i], nda::range::all);
+    nda::blas::gemm(1., _P, tail, 0., m);
+  }
+
+  // ----------------------------------------------------
+
+  nda::array<batched_tail_fitter::scalar_t, 1> batched_tail_fitter::density(nda::array_const_view<scalar_t, 2> data) const {
+
+    if (_mesh.statistic() != triqs::mesh::Fermion || _mesh.positive_only())
+      TRIQS_RUNTIME_ERROR << "batched_tail_fitter: density requires a full fermionic mesh.";
+
+    auto m      = moments(data);
+    double beta = _mesh.beta();
+    long n_cols = data.shape()[1];
+
+    nda::array<scalar_t, 1> res(n_cols);
+    res = 0;
+    for (long i = 0; i < data.shape()[0]; i++) res += data(i, nda::range::all);
+
+    // Subtract the 1/(i nu)^k tail on the mesh and add its analytic sum with e^{i nu 0^+},
+    // the moments beyond a lowered order are zero
+    auto m_k = [&](long k, long j) { return (k <= _order) ? m(k, j) : scalar_t{0.}; };
+    for (long j = 0; j < n_cols; j++)
+      res(j) = (res(j) - m_k(1, j) * _s[1] - m_k(2, j) * _s[2] - m_k(3, j) * _s[3]) / beta + m_k(1, j) / 2. - m_k(2, j) * beta / 4.;
+
+    return res;
+  }
+
+} // namespace triqs_tprf
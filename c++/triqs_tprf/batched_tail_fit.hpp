@@ -0,0 +1,102 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <array>
+#include <complex>
+#include <vector>
+
+#include <nda/nda.hpp>
+#include <triqs/mesh.hpp>
+
+namespace triqs_tprf {
+
+  /** Batched high frequency tail fit on a Matsubara mesh
+
+   The tail :math:`f(i\omega) \approx \sum_{k=0}^{K} m_k / (i\omega)^k` is a
+   linear least squares problem whose design matrix only depends on the mesh.
+   The pseudo inverse of the design matrix is computed once on construction,
+   with the moments rescaled by the largest frequency of the mesh for
+   conditioning, and the fit of any number of columns is a single matrix
+   product with the tail rows of the data.
+
+   The tail is sampled at (at most) n_tail_max evenly spaced frequencies in
+   the outermost fraction tail_fraction of the positive and the negative
+   frequencies. In contrast to fit_tail the expansion order is not chosen from the
+   data, but it is lowered to one less than the number of sampled frequencies on
+   meshes too small for the requested order.
+  */
+  class batched_tail_fitter {
+
+    public:
+    using scalar_t = std::complex<double>;
+
+    /**
+     @param mesh Matsubara mesh of the data
+     @param order expansion order K of the tail
+     @param tail_fraction fraction of the positive (and negative) frequencies used for the fit
+     @param n_tail_max maximal number of frequencies sampled on each side
+     */
+    batched_tail_fitter(triqs::mesh::imfreq const &mesh, int order = 6, double tail_fraction = 0.2, int n_tail_max = 30);
+
+    /// Expansion order of the tail, lowered on small meshes
+    int order() const { return _order; }
+
+    /// Data indices of the frequencies sampled by the fit
+    std::vector<long> const &tail_indices() const { return _rows; }
+
+    /** High frequency moments of all columns
+
+     @param data values with shape (mesh.size(), n_cols)
+     @return moments :math:`m_k` with shape (order + 1, n_cols)
+     */
+    nda::array<scalar_t, 2> moments(nda::array_const_view<scalar_t, 2> data) const;
+
+    /** High frequency moments of all columns into preallocated arrays
+
+     @param data values with shape (mesh.size(), n_cols)
+     @param tail work array with shape (tail_indices().size(), n_cols)
+     @param m moments :math:`m_k` with shape (order + 1, n_cols)
+     */
+    void moments(nda::array_const_view<scalar_t, 2> data, nda::matrix_view<scalar_t> tail, nda::matrix_view<scalar_t> m) const;
+
+    /** Tail corrected density of all columns
+
+     :math:`\frac{1}{\beta} \sum_n f(i\nu_n) e^{i\nu_n 0^+}` with the tail beyond
+     the mesh summed analytically, as the density function of TRIQS. Fermionic
+     meshes only, the constant moment is assumed to vanish and moments beyond
+     the (lowered) order are taken as zero.
+
+     @param data values with shape (mesh.size(), n_cols)
+     @return density with shape (n_cols)
+     */
+    nda::array<scalar_t, 1> density(nda::array_const_view<scalar_t, 2> data) const;
+
+    private:
+    triqs::mesh::imfreq _mesh;
+    int _order;
+    std::vector<long> _rows;
+    nda::matrix<scalar_t> _P; // (order + 1, _rows.size()) pseudo inverse, rows scaled to the moments
+    std::array<scalar_t, 4> _s; // sum_n (i nu_n)^-k on the mesh, k = 0, ..., 3
+  };
+
+} // namespace triqs_tprf
@@ -0,0 +1,355 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <vector>
+
+#include "types.hpp"
+#include "mpi.hpp"
+
+namespace triqs_tprf {
+
+  /// Row range [first, last) of rank in a chunking of n_rows rows, same as mpi_view
+  inline std::pair<long, long> mpi_row_range(long n_rows, mpi::communicator c) {
+    auto r = itertools::chunk_range(0, n_rows, c.size(), c.rank());
+    return {long(r.first), long(r.second)};
+  }
+
+  /** Redistribute a row-distributed array to a column-distributed array
+
+   The global array has shape (n_rows, n_cols, block) where each element of
+   the (row, col) grid is a contiguous block of `block` scalars. On input
+   each rank holds the rows mpi_row_range(n_rows) and on output the columns
+   mpi_row_range(n_cols), with all rows, using a single MPI_Alltoallv.
+
+   @param local Local rows, shape (n_local_rows, n_cols, block)
+   @param n_rows Total number of rows
+   @return Local columns, shape (n_rows, n_local_cols, block)
+  */
+  template <typename T>
+  nda::array<T, 3> mpi_rows_to_cols(nda::array_const_view<T, 3> local, long n_rows, mpi::communicator c = {}) {
+
+    long n_cols = local.shape()[1];
+    long block  = local.shape()[2];
+
+    auto [c0, c1] = mpi_row_range(n_cols, c);
+    nda::array<T, 3> out(n_rows, c1 - c0, block);
+
+    if (c.size() < 2) {
+      out = local;
+      return out;
+    }
+
+    int n_ranks = c.size();
+    long n_local_rows = local.shape()[0];
+
+    // Pack the send buffer rank by rank, each rank receiving all local rows of its columns
+    nda::array<T, 1> send(local.size());
+    std::vector<int> send_counts(n_ranks), send_displs(n_ranks), recv_counts(n_ranks), recv_displs(n_ranks);
+
+    long offset = 0;
+    for (int p = 0; p < n_ranks; p++) {
+      auto [pc0, pc1] = itertools::chunk_range(0, n_cols, n_ranks, p);
+      auto [pr0, pr1] = itertools::chunk_range(0, n_rows, n_ranks, p);
+      send_displs[p]  = int(offset);
+      send_counts[p]  = int(n_local_rows * (pc1 - pc0));
+      recv_displs[p]  = int(pr0 * (c1 - c0));
+      recv_counts[p]  = int((pr1 - pr0) * (c1 - c0));
+      for (long i = 0; i < n_local_rows; i++)
+        for (long j = pc0; j < pc1; j++, offset++)
+          for (long b = 0; b < block; b++) send(offset * block + b) = local(i, j, b);
+    }
+
+    MPI_Datatype block_t;
+    MPI_Type_contiguous(int(block), mpi::mpi_type<T>::get(), &block_t);
+    MPI_Type_commit(&block_t);
+    MPI_Alltoallv(send.data(), send_counts.data(), send_displs.data(), block_t, out.data(), recv_counts.data(), recv_displs.data(), block_t,
+                  c.get());
+    MPI_Type_free(&block_t);
+
+    return out;
+  }
+
+  /** Redistribute a column-distributed array to a row-distributed array
+
+   Inverse of mpi_rows_to_cols.
+
+   @param local Local columns, shape (n_rows, n_local_cols, block)
+   @param n_cols Total number of columns
+   @return Local rows, shape (n_local_rows, n_cols, block)
+  */
+  template <typename T>
+  nda::array<T, 3> mpi_cols_to_rows(nda::array_const_view<T, 3> local, long n_cols, mpi::communicator c = {}) {
+
+    long n_rows = local.shape()[0];
+    long block  = local.shape()[2];
+
+    auto [r0, r1] = mpi_row_range(n_rows, c);
+    nda::array<T, 3> out(r1 - r0, n_cols, block);
+
+    if (c.size() < 2) {
+      out = local;
+      return out;
+    }
+
+    int n_ranks = c.size();
+    long n_local_cols = local.shape()[1];
+
+    // The local columns are contiguous row blocks in the input, send them directly
+    std::vector<int> send_counts(n_ranks), send_displs(n_ranks), recv_counts(n_ranks), recv_displs(n_ranks);
+    for (int p = 0; p < n_ranks; p++) {
+      auto [pc0, pc1] = itertools::chunk_range(0, n_cols, n_ranks, p);
+      auto [pr0, pr1] = itertools::chunk_range(0, n_rows, n_ranks, p);
+      send_displs[p]  = int(pr0 * n_local_cols);
+      send_counts[p]  = int((pr1 - pr0) * n_local_cols);
+      recv_displs[p]  = int((r1 - r0) * pc0);
+      recv_counts[p]  = int((r1 - r0) * (pc1 - pc0));
+    }
+
+    nda::array<T, 1> recv(out.size());
+
+    MPI_Datatype block_t;
+    MPI_Type_contiguous(int(block), mpi::mpi_type<T>::get(), &block_t);
+    MPI_Type_commit(&block_t);
+    MPI_Alltoallv(local.data(), send_counts.data(), send_displs.data(), block_t, recv.data(), recv_counts.data(), recv_displs.data(), block_t,
+                  c.get());
+    MPI_Type_free(&block_t);
+
+    // Unpack, data from rank p holds (local rows, columns of p)
+    long offset = 0;
+    for (int p = 0; p < n_ranks; p++) {
+      auto [pc0, pc1] = itertools::chunk_range(0, n_cols, n_ranks, p);
+      for (long i = 0; i < r1 - r0; i++)
+        for (long j = pc0; j < pc1; j++, offset++)
+          for (long b = 0; b < block; b++) out(i, j, b) = recv(offset * block + b);
+    }
+
+    return out;
+  }
+
+  /** Sum partial rows over all ranks and distribute the result by rows
+
+   Each rank contributes the rows [first, first + partial.shape()[0]) of a
+   (n_rows, row_size) array, rows outside this range are zero. The sum is
+   returned with the rows mpi_row_range(n_rows) on each rank, using one
+   reduction per destination rank over its block of rows.
+  */
+  template <typename T>
+  nda::array<T, 2> mpi_reduce_rows(nda::array_const_view<T, 2> partial, long first, long n_rows, mpi::communicator c = {}) {
+
+    long row_size = partial.shape()[1];
+    long last     = first + partial.shape()[0];
+    auto [r0, r1] = mpi_row_range(n_rows, c);
+
+    nda::array<T, 2> out(r1 - r0, row_size);
+    out() = 0;
+
+    if (c.size() < 2) {
+      for (long i = 0; i < partial.shape()[0]; i++) out(first + i, nda::range::all) = partial(i, nda::range::all);
+      return out;
+    }
+
+    // Send buffer for the rows of one destination rank, zero outside of the local partial rows
+    long max_rows = itertools::chunk_range(0, n_rows, c.size(), 0).second;
+    nda::array<T, 2> send(max_rows, row_size);
+
+    for (int owner = 0; owner < c.size(); owner++) {
+      auto [p0, p1] = itertools::chunk_range(0, n_rows, c.size(), owner);
+      if (p1 == p0) continue;
+
+      send() = 0;
+      for (long j = std::max<long>(p0, first); j < std::min<long>(p1, last); j++) send(j - p0, nda::range::all) = partial(j - first, nda::range::all);
+
+      T *recv = (owner == c.rank()) ? out.data() : nullptr;
+      MPI_Reduce(send.data(), recv, int((p1 - p0) * row_size), mpi::mpi_type<T>::get(), MPI_SUM, owner, c.get());
+    }
+
+    return out;
+  }
+
+  /// Product of the leading (non lattice) meshes of a product mesh with N meshes
+  template <int N, typename M> auto make_row_mesh(M const &mesh) {
+    if constexpr (N == 2)
+      return std::get<0>(mesh);
+    else
+      return prod{std::get<0>(mesh), std::get<1>(mesh)};
+  }
+
+  /** Green's function distributed over MPI ranks
+
+   Holds only the local part of a Green's function on a product mesh whose
+   last mesh is a lattice mesh (brzone or cyclat). The leading meshes
+   (e.g. the bosonic and fermionic frequencies of chi_wnk) are flattened
+   into rows and the rows are split over the ranks with the same chunking
+   as mpi_view, while each rank holds complete lattice slices. Hence
+   transforms in the lattice mesh are local, and the local data is the
+   contiguous block of rows of the data of the full Green's function.
+
+   The full object is only formed when asked for with all_gather.
+  */
+  template <typename Gf> class distributed_gf {
+
+    public:
+    using gf_t     = Gf;
+    using mesh_t   = typename Gf::mesh_t;
+    using target_t = typename Gf::target_t;
+    using scalar_t = typename Gf::scalar_t;
+
+    static constexpr int target_rank = target_t::rank;
+    static constexpr int data_rank   = std::decay_t<decltype(std::declval<Gf>().data())>::rank;
+    static constexpr int n_meshes    = data_rank - target_rank;
+
+    static_assert(n_meshes == 2 or n_meshes == 3, "distributed_gf: only product meshes of two or three meshes are supported.");
+
+    using lattice_mesh_t = std::decay_t<decltype(std::get<n_meshes - 1>(std::declval<mesh_t>()))>;
+    using row_mesh_t     = decltype(make_row_mesh<n_meshes>(std::declval<mesh_t>()));
+    using lattice_gf_t   = gf<lattice_mesh_t, target_t>;
+    using data_t         = nda::array<scalar_t, 2 + target_rank>;
+
+    private:
+    mesh_t _mesh;
+    row_mesh_t _row_mesh;
+    std::array<long, target_rank> _target_shape;
+    mpi::communicator _comm;
+    long _first_row = 0, _last_row = 0;
+    data_t _data;
+
+    public:
+    /// Construct a zero initialized distributed Green's function
+    distributed_gf(mesh_t const &mesh, std::array<long, target_rank> const &target_shape, mpi::communicator c = {})
+       : _mesh(mesh), _row_mesh(make_row_mesh<n_meshes>(mesh)), _target_shape(target_shape), _comm(c) {
+      std::tie(_first_row, _last_row) = mpi_row_range(n_rows(), _comm);
+      auto shape = nda::stdutil::join(std::array<long, 2>{_last_row - _first_row, n_cols()}, _target_shape);
+      _data      = data_t(shape);
+      _data()    = 0;
+    }
+
+    /// Keep the local part of a replicated Green's function (no communication)
+    explicit distributed_gf(typename Gf::const_view_type g, mpi::communicator c = {})
+       : distributed_gf(g.mesh(), target_shape_of(g), c) {
+      if (g.data().indexmap().is_contiguous()) {
+        std::copy_n(g.data().data() + _first_row * row_size(), _data.size(), _data.data());
+      } else {
+        auto g_dat = make_regular(g.data());
+        std::copy_n(g_dat.data() + _first_row * row_size(), _data.size(), _data.data());
+      }
+    }
+
+    /// Full mesh
+    mesh_t const &mesh() const { return _mesh; }
+
+    /// Lattice (last) mesh
+    lattice_mesh_t const &lattice_mesh() const { return std::get<n_meshes - 1>(_mesh); }
+
+    /// Mesh of the distributed (leading) dimensions
+    row_mesh_t const &row_mesh() const { return _row_mesh; }
+
+    /// Mesh points of the local rows
+    auto local_points() const { return mpi_view(row_mesh(), _comm); }
+
+    std::array<long, target_rank> const &target_shape() const { return _target_shape; }
+    mpi::communicator communicator() const { return _comm; }
+
+    long n_rows() const { return row_mesh().size(); }
+    long n_cols() const { return lattice_mesh().size(); }
+    long first_row() const { return _first_row; }
+    long n_local_rows() const { return _last_row - _first_row; }
+
+    /// Number of scalars in one lattice point
+    long target_size() const {
+      long size = 1;
+      for (auto s : _target_shape) size *= s;
+      return size;
+    }
+
+    /// Number of scalars in one row
+    long row_size() const { return n_cols() * target_size(); }
+
+    /// Local data, shape (n_local_rows, lattice mesh size, target shape...)
+    data_t &data() { return _data; }
+    data_t const &data() const { return _data; }
+
+    /// Local data as an array of (row, lattice point, flattened target)
+    auto data_3d() { return nda::array_view<scalar_t, 3>(std::array<long, 3>{n_local_rows(), n_cols(), target_size()}, _data.data()); }
+    auto data_3d() const {
+      return nda::array_const_view<scalar_t, 3>(std::array<long, 3>{n_local_rows(), n_cols(), target_size()}, _data.data());
+    }
+
+    /// Copy of the lattice slice of local row i
+    lattice_gf_t lattice_slice(long i) const {
+      lattice_gf_t g{lattice_mesh(), _target_shape};
+      g.data() = _data(i, nda::ellipsis{});
+      return g;
+    }
+
+    /// Assign the lattice slice of local row i
+    void set_lattice_slice(long i, typename lattice_gf_t::const_view_type g) { _data(i, nda::ellipsis{}) = g.data(); }
+
+    /// Gather the full Green's function on all ranks
+    Gf all_gather() const {
+
+      Gf g{_mesh, _target_shape};
+      auto &g_dat = g.data();
+
+      if (_comm.size() < 2) {
+        std::copy_n(_data.data(), _data.size(), g_dat.data());
+        return g;
+      }
+
+      int n_ranks = _comm.size();
+      std::vector<int> counts(n_ranks), displs(n_ranks);
+      for (int p = 0; p < n_ranks; p++) {
+        auto [r0, r1] = itertools::chunk_range(0, n_rows(), n_ranks, p);
+        displs[p]     = int(r0);
+        counts[p]     = int(r1 - r0);
+      }
+
+      MPI_Datatype row_t;
+      MPI_Type_contiguous(int(row_size()), mpi::mpi_type<scalar_t>::get(), &row_t);
+      MPI_Type_commit(&row_t);
+      MPI_Allgatherv(_data.data(), int(n_local_rows()), row_t, g_dat.data(), counts.data(), displs.data(), row_t, _comm.get());
+      MPI_Type_free(&row_t);
+
+      return g;
+    }
+
+    private:
+    static std::array<long, target_rank> target_shape_of(typename Gf::const_view_type g) {
+      std::array<long, target_rank> shape;
+      for (int i = 0; i < target_rank; i++) shape[i] = g.target_shape()[i];
+      return shape;
+    }
+  };
+
+  typedef distributed_gf<g_wk_t> g_wk_dist_t;
+  typedef distributed_gf<g_wr_t> g_wr_dist_t;
+  typedef distributed_gf<g_tr_t> g_tr_dist_t;
+
+  typedef distributed_gf<chi_wk_t> chi_wk_dist_t;
+  typedef distributed_gf<chi_wr_t> chi_wr_dist_t;
+  typedef distributed_gf<chi_tr_t> chi_tr_dist_t;
+
+  typedef distributed_gf<chi_wnk_t> chi_wnk_dist_t;
+  typedef distributed_gf<chi_wnr_t> chi_wnr_dist_t;
+
+} // namespace triqs_tprf
@@ -0,0 +1,63 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2023, The Simons Foundation
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <string>
+
+namespace triqs_tprf {
+
+  /** Set the FFTW planner effort used for new Fourier transform plans
+
+   All FFTW plans are cached for the lifetime of the process, so the planning cost
+   is only paid once per transform geometry. Higher effort gives faster transforms
+   at the price of a longer first call, and is best combined with wisdom files.
+
+   @param effort planner effort, one of "estimate" (default), "measure" or "patient"
+   */
+  void fourier_set_plan_effort(std::string const &effort);
+
+  /** Destroy all cached FFTW plans
+
+   Must not be called while a Fourier transform is running.
+   */
+  void fourier_clear_plan_cache();
+
+  /** Number of FFTW plans in the process wide plan cache
+
+   @return number of cached plans
+   */
+  long fourier_plan_cache_size();
+
+  /** Load FFTW wisdom from file
+
+   @param filename path of a wisdom file written by fourier_export_wisdom
+   @return true if the wisdom was read successfully
+   */
+  bool fourier_import_wisdom(std::string const &filename);
+
+  /** Save the accumulated FFTW wisdom to file (written by MPI rank 0 only)
+
+   @param filename path of the wisdom file
+   @return true if the wisdom was written successfully
+   */
+  bool fourier_export_wisdom(std::string const &filename);
+
+} // namespace triqs_tprf
@@ -42,17 +42,39 @@ namespace triqs_tprf::fourier {
   template <typename V> using gf_vec_cvt = gf_const_view<V, tensor_valued<1>>;
 
   // matsubara
+  // 2nd and 3rd moments of gt from its derivatives at 0 and beta, as used by the direct transform without moments
+  array<dcomplex, 2> fit_derivatives(gf_vec_cvt<imtime> gt);
   gf_vec_t<imfreq> _fourier_impl(mesh::imfreq const &iw_mesh, gf_vec_cvt<imtime> gt, fourier_plan &p, array_const_view<dcomplex, 2> mom_23 = {});
   gf_vec_t<imtime> _fourier_impl(mesh::imtime const &tau_mesh, gf_vec_cvt<imfreq> gw, fourier_plan &p, array_const_view<dcomplex, 2> mom_123 = {});
   fourier_plan _fourier_plan(mesh::imfreq const &iw_mesh, gf_vec_cvt<imtime> gt);
   fourier_plan _fourier_plan(mesh::imtime const &tau_mesh, gf_vec_cvt<imfreq> gw);
 
+  // matsubara, into gw or gt with the FFT input and output in preallocated work arrays, with L = tau mesh size - 1
+  // the shapes are (L + 1, n) and (L, n) for the direct and (L, n) and (L + 1, n) for the inverse transform
+  void _fourier_impl(gf_vec_vt<imfreq> gw, gf_vec_cvt<imtime> gt, fourier_plan &p, array_view<dcomplex, 2> fft_in, array_view<dcomplex, 2> fft_out,
+                     array_const_view<dcomplex, 2> mom_23 = {});
+  void _fourier_impl(gf_vec_vt<imtime> gt, gf_vec_cvt<imfreq> gw, fourier_plan &p, array_view<dcomplex, 2> fft_in, array_view<dcomplex, 2> fft_out,
+                     array_const_view<dcomplex, 2> mom_123 = {});
+
   // lattice
   gf_vec_t<cyclat> _fourier_impl(mesh::cyclat const &r_mesh, gf_vec_cvt<brzone> gk, fourier_plan &p);
   gf_vec_t<brzone> _fourier_impl(mesh::brzone const &k_mesh, gf_vec_cvt<cyclat> gr, fourier_plan &p);
   fourier_plan _fourier_plan(mesh::cyclat const &r_mesh, gf_vec_cvt<brzone> gk);
   fourier_plan _fourier_plan(mesh::brzone const &k_mesh, gf_vec_cvt<cyclat> gr);
 
+  // lattice, batched (batch, lattice, others) data split over the lattice points
+  void _fourier_lattice_split(mesh::cyclat const &r_mesh, array_const_view<dcomplex, 3> gk, array_view<dcomplex, 3> gr, mpi::communicator c = {});
+  void _fourier_lattice_split(mesh::brzone const &k_mesh, array_const_view<dcomplex, 3> gr, array_view<dcomplex, 3> gk, mpi::communicator c = {});
+
+  // lattice, batched (batch, lattice, others) data split over the batch, with one FFTW plan per block of batch entries
+  void _fourier_lattice_batched(mesh::cyclat const &r_mesh, array_const_view<dcomplex, 3> gk, array_view<dcomplex, 3> gr, mpi::communicator c = {});
+  void _fourier_lattice_batched(mesh::brzone const &k_mesh, array_const_view<dcomplex, 3> gr, array_view<dcomplex, 3> gk, mpi::communicator c = {});
+
+  // lattice, (lattice, others) data that is real in r-space, using r2c/c2r transforms on the half k-mesh
+  void _fourier_lattice_real(mesh::cyclat const &r_mesh, array_const_view<dcomplex, 2> gk, array_view<dcomplex, 2> gr);
+  void _fourier_lattice_real(mesh::brzone const &k_mesh, array_const_view<dcomplex, 2> gr, array_view<dcomplex, 2> gk);
+  bool _is_real_in_r(mesh::brzone const &k_mesh, array_const_view<dcomplex, 2> gk, double tol);
+
   /*------------------------------------------------------------------------------------------------------
    *
    * The general Fourier function
@@ -18,31 +18,167 @@
 // Authors: Hugo Strand, Michel Ferrero, Nils Wentzell
 
 #include "./fourier_common.hpp"
+#include "./fftw_plans.hpp"
+
+#include <map>
+#include <mutex>
+#include <tuple>
+#include <vector>
+
+#include <mpi/mpi.hpp>
 
 #include <fftw3.h>
 
 namespace triqs_tprf::fourier {
 
+  // ------------------------ PLAN CACHE --------------------------------------------
+
+  namespace {
+
+    // Plans are executed with fftw_execute_dft on other arrays than the ones used for planning,
+    // which is valid as long as the kind, the geometry, the in-place property and the alignment match.
+    enum class plan_kind_t { c2c, r2c, c2r, c2c_batched };
+    using plan_key_t = std::tuple<plan_kind_t, std::vector<int>, int, int, int, int, int, int, bool, int, int, unsigned, int>;
+
+    struct plan_cache_t {
+      std::mutex mutex;
+      std::map<plan_key_t, fftw_plan> plans;
+      unsigned effort = FFTW_ESTIMATE;
+
+      ~plan_cache_t() {
+        for (auto &[key, p] : plans) fftw_destroy_plan(p);
+      }
+    };
+
+    plan_cache_t &plan_cache() {
+      static plan_cache_t cache;
+      return cache;
+    }
+
+  } // namespace
+
+  void *_fourier_cached_plan(int rank, int const *dims, int howmany, dcomplex const *in, int istride, int idist, dcomplex const *out, int ostride,
+                             int odist, int fftw_backward_forward, bool unaligned) {
+
+    auto in_fft  = reinterpret_cast<fftw_complex *>(const_cast<dcomplex *>(in));
+    auto out_fft = reinterpret_cast<fftw_complex *>(const_cast<dcomplex *>(out));
+
+    bool in_place = (in == out);
+    int in_align  = unaligned ? -1 : fftw_alignment_of(reinterpret_cast<double *>(in_fft));
+    int out_align = unaligned ? -1 : fftw_alignment_of(reinterpret_cast<double *>(out_fft));
+
+    auto &cache = plan_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto key = plan_key_t{plan_kind_t::c2c, std::vector<int>(dims, dims + rank), howmany, istride, idist, ostride, odist, fftw_backward_forward, in_place, in_align, out_align, cache.effort, 1};
+    if (auto it = cache.plans.find(key); it != cache.plans.end()) return it->second;
+
+    // Plan on scratch buffers, the measuring planners overwrite the arrays
+    long n = 1;
+    for (int d = 0; d < rank; d++) n *= dims[d];
+    long in_extent  = (n - 1) * istride + (howmany - 1) * long(idist) + 1;
+    long out_extent = (n - 1) * ostride + (howmany - 1) * long(odist) + 1;
+
+    auto in_tmp  = fftw_alloc_complex(in_place ? std::max(in_extent, out_extent) : in_extent);
+    auto out_tmp = in_place ? in_tmp : fftw_alloc_complex(out_extent);
+
+    unsigned flags = cache.effort;
+    if (in_align != 0 || out_align != 0) flags |= FFTW_UNALIGNED;
+
+    auto p = fftw_plan_many_dft(rank, dims, howmany, in_tmp, NULL, istride, idist, out_tmp, NULL, ostride, odist, fftw_backward_forward, flags);
+
+    fftw_free(in_tmp);
+    if (!in_place) fftw_free(out_tmp);
+
+    if (p == NULL) TRIQS_RUNTIME_ERROR << "fourier: FFTW could not create a plan.";
+
+    cache.plans.emplace(key, p);
+    return p;
+  }
+
+  void *_fourier_cached_plan_real(int rank, int const *dims, int howmany, void const *in, void const *out, int real_stride, int real_dist,
+                                  int cplx_stride, bool r2c) {
+
+    bool in_place = (in == out);
+    int in_align  = fftw_alignment_of(reinterpret_cast<double *>(const_cast<void *>(in)));
+    int out_align = fftw_alignment_of(reinterpret_cast<double *>(const_cast<void *>(out)));
+
+    auto &cache = plan_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto kind = r2c ? plan_kind_t::r2c : plan_kind_t::c2r;
+    auto key  = r2c ? plan_key_t{kind, std::vector<int>(dims, dims + rank), howmany, real_stride, real_dist, cplx_stride, 1, 0, in_place, in_align, out_align, cache.effort, 1} :
+                      plan_key_t{kind, std::vector<int>(dims, dims + rank), howmany, cplx_stride, 1, real_stride, real_dist, 0, in_place, in_align, out_align, cache.effort, 1};
+    if (auto it = cache.plans.find(key); it != cache.plans.end()) return it->second;
+
+    // Real side has the full dimensions, the complex side half of the last one
+    long n_real = 1;
+    for (int d = 0; d < rank; d++) n_real *= dims[d];
+    long n_cplx = n_real / dims[rank - 1] * (dims[rank - 1] / 2 + 1);
+
+    long real_extent = (n_real - 1) * real_stride + (howmany - 1) * long(real_dist) + 1;
+    long cplx_extent = (n_cplx - 1) * cplx_stride + howmany;
+
+    auto real_tmp = fftw_alloc_real(in_place ? std::max(real_extent, 2 * cplx_extent) : real_extent);
+    auto cplx_tmp = in_place ? reinterpret_cast<fftw_complex *>(real_tmp) : fftw_alloc_complex(cplx_extent);
+
+    unsigned flags = cache.effort;
+    if (in_align != 0 || out_align != 0) flags |= FFTW_UNALIGNED;
+
+    auto p = r2c ? fftw_plan_many_dft_r2c(rank, dims, howmany, real_tmp, NULL, real_stride, real_dist, cplx_tmp, NULL, cplx_stride, 1, flags) :
+                   fftw_plan_many_dft_c2r(rank, dims, howmany, cplx_tmp, NULL, cplx_stride, 1, real_tmp, NULL, real_stride, real_dist, flags);
+
+    fftw_free(real_tmp);
+    if (!in_place) fftw_free(cplx_tmp);
+
+    if (p == NULL) TRIQS_RUNTIME_ERROR << "fourier: FFTW could not create a plan.";
+
+    cache.plans.emplace(key, p);
+    return p;
+  }
+
+  void *_fourier_cached_plan_batched(int rank, int const *dims, int n_batch, int howmany, int fftw_backward_forward) {
+
+    auto &cache = plan_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+
+    auto key = plan_key_t{plan_kind_t::c2c_batched, std::vector<int>(dims, dims + rank), howmany, howmany, 1, howmany, 1, fftw_backward_forward, false, -1, -1, cache.effort, n_batch};
+    if (auto it = cache.plans.find(key); it != cache.plans.end()) return it->second;
+
+    // Transform dimensions of the (lattice, howmany) block, and the two loops over the
+    // batch and over the interleaved transforms of a block
+    std::vector<fftw_iodim64> t_dims(rank);
+    long n = howmany;
+    for (int d = rank - 1; d >= 0; d--) {
+      t_dims[d] = fftw_iodim64{dims[d], n, n};
+      n *= dims[d];
+    }
+    fftw_iodim64 h_dims[2] = {{n_batch, n, n}, {howmany, 1, 1}};
+
+    auto in_tmp  = fftw_alloc_complex(n_batch * n);
+    auto out_tmp = fftw_alloc_complex(n_batch * n);
+
+    auto p = fftw_plan_guru64_dft(rank, t_dims.data(), 2, h_dims, in_tmp, out_tmp, fftw_backward_forward, cache.effort | FFTW_UNALIGNED);
+
+    fftw_free(in_tmp);
+    fftw_free(out_tmp);
+
+    if (p == NULL) TRIQS_RUNTIME_ERROR << "fourier: FFTW could not create a plan.";
+
+    cache.plans.emplace(key, p);
+    return p;
+  }
+
+  // ------------------------ BASE TRANSFORM --------------------------------------------
+
+  // The plan is owned by the cache, the returned handle does not destroy it.
   fourier_plan _fourier_base_plan(array_const_view<dcomplex, 2> in, array_const_view<dcomplex, 2> out, int rank, int *dims, int fftw_count,
                                   int fftw_backward_forward) {
 
-    auto in_fft  = reinterpret_cast<fftw_complex *>(const_cast<dcomplex *>(in.data()));
-    auto out_fft = reinterpret_cast<fftw_complex *>(const_cast<dcomplex *>(out.data()));
-
-    auto p = fftw_plan_many_dft(rank,                        // rank
-                                dims,                        // the dimension
-                                fftw_count,                  // how many FFT : here 1
-                                in_fft,                      // in data
-                                NULL,                        // embed : unused. Doc unclear ?
-                                in.indexmap().strides()[0],  // stride of the in data
-                                1,                           // in : shift for multi fft.
-                                out_fft,                     // out data
-                                NULL,                        // embed : unused. Doc unclear ?
-                                out.indexmap().strides()[0], // stride of the out data
-                                1,                           // out : shift for multi fft.
-                                fftw_backward_forward, FFTW_ESTIMATE);
+    auto p = _fourier_cached_plan(rank, dims, fftw_count, in.data(), in.indexmap().strides()[0], 1, out.data(), out.indexmap().strides()[0], 1,
+                                  fftw_backward_forward);
 
-    return {(void *)p, [](void *p) { fftw_destroy_plan((fftw_plan)p); }};
+    return {p, [](void *) {}};
   }
 
   void _fourier_base(array_const_view<dcomplex, 2> in, array_view<dcomplex, 2> out, fourier_plan &plan) {
@@ -54,3 +190,50 @@ namespace triqs_tprf::fourier {
   }
 
 } // namespace triqs_tprf::fourier
+
+namespace triqs_tprf {
+
+  void fourier_set_plan_effort(std::string const &effort) {
+    unsigned flags = 0;
+    if (effort == "estimate")
+      flags = FFTW_ESTIMATE;
+    else if (effort == "measure")
+      flags = FFTW_MEASURE;
+    else if (effort == "patient")
+      flags = FFTW_PATIENT;
+    else
+      TRIQS_RUNTIME_ERROR << "fourier_set_plan_effort: unknown effort " << effort << ", use estimate, measure or patient.";
+
+    auto &cache = fourier::plan_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    cache.effort = flags;
+  }
+
+  void fourier_clear_plan_cache() {
+    auto &cache = fourier::plan_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    for (auto &[key, p] : cache.plans) fftw_destroy_plan(p);
+    cache.plans.clear();
+  }
+
+  long fourier_plan_cache_size() {
+    auto &cache = fourier::plan_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return cache.plans.size();
+  }
+
+  bool fourier_import_wisdom(std::string const &filename) {
+    auto &cache = fourier::plan_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return fftw_import_wisdom_from_filename(filename.c_str()) != 0;
+  }
+
+  bool fourier_export_wisdom(std::string const &filename) {
+    mpi::communicator c;
+    if (c.rank() != 0) return true;
+    auto &cache = fourier::plan_cache();
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    return fftw_export_wisdom_to_filename(filename.c_str()) != 0;
+  }
+
+} // namespace triqs_tprf
@@ -33,4 +33,18 @@ namespace triqs_tprf::fourier {
 
   void _fourier_base(nda::array_const_view<dcomplex, 2> in, nda::array_view<dcomplex, 2> out, fourier_plan &p);
 
+  // FFTW many-plan from the process wide plan cache (returned as fftw_plan), the cache keeps ownership.
+  // Use unaligned = true for plans executed on arrays with other alignments than in/out.
+  void *_fourier_cached_plan(int rank, int const *dims, int howmany, dcomplex const *in, int istride, int idist, dcomplex const *out, int ostride,
+                             int odist, int fftw_backward_forward, bool unaligned = false);
+
+  // Batched many-plan for n_batch contiguous (lattice, howmany) blocks with the howmany transforms interleaved,
+  // for unaligned out of place execution, from the plan cache.
+  void *_fourier_cached_plan_batched(int rank, int const *dims, int n_batch, int howmany, int fftw_backward_forward);
+
+  // Real to half-complex (r2c = true) or half-complex to real many-plan, from the plan cache. The batches are interleaved,
+  // with stride and distance real_stride and real_dist on the real side and stride cplx_stride and distance 1 on the complex side.
+  void *_fourier_cached_plan_real(int rank, int const *dims, int howmany, void const *in, void const *out, int real_stride, int real_dist,
+                                  int cplx_stride, bool r2c);
+
 } // namespace triqs_tprf::fourier
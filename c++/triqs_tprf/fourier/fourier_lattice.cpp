@@ -18,9 +18,11 @@
 // Authors: Michel Ferrero, Olivier Parcollet, Nils Wentzell, tayral
 
 #include "./fourier_common.hpp"
+#include "../mpi.hpp"
 #include <itertools/itertools.hpp>
 
 #include <fftw3.h>
+#include <omp.h>
 
 namespace triqs_tprf::fourier {
 
@@ -58,4 +60,264 @@ namespace triqs_tprf::fourier {
     return gk;
   }
 
+  // ------------------------ SPLIT LATTICE TRANSFORM --------------------------------------------
+
+  // Slab/pencil decomposition of a batch of 3D lattice transforms. The data has
+  // shape (n_batch, n0 * n1 * n2, n_others). First the 2D (n1, n2) transforms of all
+  // (batch, i0) slabs are computed, then the 1D n0 transforms of all (batch, i1, i2)
+  // pencils. Both sets of independent transforms are split over MPI ranks and
+  // OpenMP threads, so the work is distributed even for a small batch size.
+  // After each stage the ranks only exchange the slabs and pencils they own.
+
+  namespace {
+
+    // In place all-gather of n_items contiguous items of block scalars, rank p owning chunk_range(0, n_items) p
+    void all_gather_chunks(dcomplex *data, long n_items, long block, mpi::communicator c) {
+
+      int n_ranks = c.size();
+      std::vector<int> counts(n_ranks), displs(n_ranks);
+      for (int p = 0; p < n_ranks; p++) {
+        auto [first, last] = itertools::chunk_range(0, n_items, n_ranks, p);
+        counts[p]          = int(last - first);
+        displs[p]          = int(first);
+      }
+
+      MPI_Datatype block_t;
+      MPI_Type_contiguous(int(block), mpi::mpi_type<dcomplex>::get(), &block_t);
+      MPI_Type_commit(&block_t);
+      MPI_Allgatherv(MPI_IN_PLACE, 0, MPI_DATATYPE_NULL, data, counts.data(), displs.data(), block_t, c.get());
+      MPI_Type_free(&block_t);
+    }
+
+  } // namespace
+
+  void __impl_split(int fftw_backward_forward, array_const_view<dcomplex, 3> in, array_view<dcomplex, 3> out, std::array<long, 3> dims,
+                    mpi::communicator c) {
+
+    long n_batch  = in.shape()[0];
+    long n_k      = in.shape()[1];
+    long n_others = in.shape()[2];
+
+    if (n_k != dims[0] * dims[1] * dims[2]) TRIQS_RUNTIME_ERROR << "_fourier_lattice_split: lattice size does not match the mesh dimensions.";
+    if (!in.indexmap().is_contiguous() || !out.indexmap().is_contiguous())
+      TRIQS_RUNTIME_ERROR << "_fourier_lattice_split: only contiguous data is supported.";
+
+    long n_plane = dims[1] * dims[2];
+    int slab_dims[2]{int(dims[1]), int(dims[2])};
+    int pencil_dims[1]{int(dims[0])};
+    bool distributed = c.size() > 1;
+
+    auto tmp = nda::array<dcomplex, 3>(in.shape());
+
+    auto in_fft  = reinterpret_cast<fftw_complex *>(const_cast<dcomplex *>(in.data()));
+    auto tmp_fft = reinterpret_cast<fftw_complex *>(tmp.data());
+    auto out_fft = reinterpret_cast<fftw_complex *>(out.data());
+
+    // The plans are executed on different slices with the new-array interface,
+    // so they are created for unaligned data
+    auto slab_plan =
+       (fftw_plan)_fourier_cached_plan(2, slab_dims, n_others, in.data(), n_others, 1, tmp.data(), n_others, 1, fftw_backward_forward, true);
+
+    // 2D transforms of the (batch, i0) slabs, the slabs of a rank are contiguous
+    {
+      auto [first, last] = itertools::chunk_range(0, n_batch * dims[0], c.size(), c.rank());
+#pragma omp parallel for
+      for (long idx = first; idx < last; idx++) {
+        long offset = idx * n_plane * n_others;
+        fftw_execute_dft(slab_plan, in_fft + offset, tmp_fft + offset);
+      }
+    }
+    if (distributed) all_gather_chunks(tmp.data(), n_batch * dims[0], n_plane * n_others, c);
+
+    // 1D transforms of the (batch, i1, i2) pencils. On several ranks the pencils of a
+    // rank are written packed as (pencil, i0, others), gathered and unpacked into out.
+    auto [first, last] = itertools::chunk_range(0, n_batch * n_plane, c.size(), c.rank());
+
+    if (!distributed) {
+      auto pencil_plan = (fftw_plan)_fourier_cached_plan(1, pencil_dims, n_others, tmp.data(), n_plane * n_others, 1, out.data(),
+                                                         n_plane * n_others, 1, fftw_backward_forward, true);
+#pragma omp parallel for
+      for (long idx = first; idx < last; idx++) {
+        long offset = ((idx / n_plane) * n_k + idx % n_plane) * n_others;
+        fftw_execute_dft(pencil_plan, tmp_fft + offset, out_fft + offset);
+      }
+      return;
+    }
+
+    long pencil_size = dims[0] * n_others;
+    auto packed      = nda::array<dcomplex, 1>(n_batch * n_plane * pencil_size);
+    auto packed_fft  = reinterpret_cast<fftw_complex *>(packed.data());
+    auto pencil_plan = (fftw_plan)_fourier_cached_plan(1, pencil_dims, n_others, tmp.data(), n_plane * n_others, 1, packed.data(), n_others, 1,
+                                                       fftw_backward_forward, true);
+#pragma omp parallel for
+    for (long idx = first; idx < last; idx++) {
+      long offset = ((idx / n_plane) * n_k + idx % n_plane) * n_others;
+      fftw_execute_dft(pencil_plan, tmp_fft + offset, packed_fft + idx * pencil_size);
+    }
+
+    all_gather_chunks(packed.data(), n_batch * n_plane, pencil_size, c);
+
+#pragma omp parallel for
+    for (long idx = 0; idx < n_batch * n_plane; idx++) {
+      long b = idx / n_plane, p = idx % n_plane;
+      for (long i0 = 0; i0 < dims[0]; i0++)
+        for (long o = 0; o < n_others; o++) out(b, i0 * n_plane + p, o) = packed(idx * pencil_size + i0 * n_others + o);
+    }
+  }
+
+  void _fourier_lattice_split(mesh::cyclat const &r_mesh, array_const_view<dcomplex, 3> gk, array_view<dcomplex, 3> gr, mpi::communicator c) {
+    __impl_split(FFTW_FORWARD, gk, gr, r_mesh.dims(), c);
+    gr /= r_mesh.size();
+  }
+
+  void _fourier_lattice_split(mesh::brzone const &k_mesh, array_const_view<dcomplex, 3> gr, array_view<dcomplex, 3> gk, mpi::communicator c) {
+    __impl_split(FFTW_BACKWARD, gr, gk, k_mesh.dims(), c);
+  }
+
+  // ------------------------ BATCHED LATTICE TRANSFORM --------------------------------------------
+
+  // The batch entries of a rank are split in one contiguous block per thread, and each
+  // block is transformed with a single plan over all its entries and target components.
+  // The result is complete on all ranks.
+
+  void __impl_batched(int fftw_backward_forward, array_const_view<dcomplex, 3> in, array_view<dcomplex, 3> out, std::array<long, 3> dims,
+                      double scale, mpi::communicator c) {
+
+    long n_batch  = in.shape()[0];
+    long n_k      = in.shape()[1];
+    long n_others = in.shape()[2];
+
+    if (n_k != dims[0] * dims[1] * dims[2]) TRIQS_RUNTIME_ERROR << "_fourier_lattice_batched: lattice size does not match the mesh dimensions.";
+    if (!in.indexmap().is_contiguous() || !out.indexmap().is_contiguous())
+      TRIQS_RUNTIME_ERROR << "_fourier_lattice_batched: only contiguous data is supported.";
+
+    auto dims_int = stdutil::make_std_array<int>(dims);
+    long block    = n_k * n_others;
+
+    auto in_fft  = reinterpret_cast<fftw_complex *>(const_cast<dcomplex *>(in.data()));
+    auto out_fft = reinterpret_cast<fftw_complex *>(out.data());
+
+    auto [b0, b1] = itertools::chunk_range(0, n_batch, c.size(), c.rank());
+    if (c.size() > 1) out() = 0;
+
+#pragma omp parallel
+    {
+      auto [t0, t1] = itertools::chunk_range(b0, b1, omp_get_num_threads(), omp_get_thread_num());
+      if (t1 > t0) {
+        auto p = (fftw_plan)_fourier_cached_plan_batched(3, dims_int.data(), int(t1 - t0), int(n_others), fftw_backward_forward);
+        fftw_execute_dft(p, in_fft + t0 * block, out_fft + t0 * block);
+        if (scale != 1.0)
+          for (long b = t0; b < t1; b++) out(b, range::all, range::all) *= scale;
+      }
+    }
+
+    if (c.size() > 1) mpi_all_reduce_in_place(out.data(), out.size(), c);
+  }
+
+  void _fourier_lattice_batched(mesh::cyclat const &r_mesh, array_const_view<dcomplex, 3> gk, array_view<dcomplex, 3> gr, mpi::communicator c) {
+    __impl_batched(FFTW_FORWARD, gk, gr, r_mesh.dims(), 1. / r_mesh.size(), c);
+  }
+
+  void _fourier_lattice_batched(mesh::brzone const &k_mesh, array_const_view<dcomplex, 3> gr, array_view<dcomplex, 3> gk, mpi::communicator c) {
+    __impl_batched(FFTW_BACKWARD, gr, gk, k_mesh.dims(), 1., c);
+  }
+
+  // ------------------------ REAL LATTICE TRANSFORM --------------------------------------------
+
+  // For data that is real in r-space, g(-k) = conj(g(k)), and only the half of the
+  // k-mesh with i2 <= n2 / 2 is independent. The transforms use c2r/r2c FFTs on
+  // half size complex buffers, the sign conventions of the complex transforms are
+  // recovered through complex conjugation of the half spectrum.
+
+  namespace {
+
+    struct half_mesh_t {
+      long n0, n1, n2, nh;
+      half_mesh_t(std::array<long, 3> dims) : n0(dims[0]), n1(dims[1]), n2(dims[2]), nh(dims[2] / 2 + 1) {}
+      long size() const { return n0 * n1 * nh; }
+      long full_index(long i0, long i1, long i2) const { return (i0 * n1 + i1) * n2 + i2; }
+      long half_index(long i0, long i1, long i2) const { return (i0 * n1 + i1) * nh + i2; }
+    };
+
+  } // namespace
+
+  void _fourier_lattice_real(mesh::cyclat const &r_mesh, array_const_view<dcomplex, 2> gk, array_view<dcomplex, 2> gr) {
+
+    auto dims     = r_mesh.dims();
+    auto m        = half_mesh_t{dims};
+    long n_others = gk.shape()[1];
+    auto _        = range::all;
+
+    if (!gr.indexmap().is_contiguous()) TRIQS_RUNTIME_ERROR << "_fourier_lattice_real: only contiguous output data is supported.";
+
+    auto half = nda::array<dcomplex, 2>(m.size(), n_others);
+    for (long i0 = 0; i0 < m.n0; i0++)
+      for (long i1 = 0; i1 < m.n1; i1++)
+        for (long i2 = 0; i2 < m.nh; i2++) half(m.half_index(i0, i1, i2), _) = nda::conj(gk(m.full_index(i0, i1, i2), _));
+
+    // The real result is written into the first half of the storage of gr and spread to complex
+    // values from the end, so that no value is overwritten before it is read
+    auto real = reinterpret_cast<double *>(gr.data());
+
+    auto dims_int = stdutil::make_std_array<int>(dims);
+    auto p        = (fftw_plan)_fourier_cached_plan_real(3, dims_int.data(), n_others, half.data(), real, n_others, 1, n_others, false);
+    fftw_execute_dft_c2r(p, reinterpret_cast<fftw_complex *>(half.data()), real);
+
+    double scale = 1. / r_mesh.size();
+    auto out     = gr.data();
+    for (long j = gr.size() - 1; j >= 0; j--) out[j] = dcomplex(scale * real[j], 0.);
+  }
+
+  void _fourier_lattice_real(mesh::brzone const &k_mesh, array_const_view<dcomplex, 2> gr, array_view<dcomplex, 2> gk) {
+
+    auto dims     = k_mesh.dims();
+    auto m        = half_mesh_t{dims};
+    long n_others = gr.shape()[1];
+
+    if (!gr.indexmap().is_contiguous() || !gk.indexmap().is_contiguous())
+      TRIQS_RUNTIME_ERROR << "_fourier_lattice_real: only contiguous data is supported.";
+
+    // r2c from the real parts of gr, read with stride two, into the first m.size() rows of gk
+    auto real = reinterpret_cast<double *>(const_cast<dcomplex *>(gr.data()));
+    auto out  = gk.data();
+
+    auto dims_int = stdutil::make_std_array<int>(dims);
+    auto p        = (fftw_plan)_fourier_cached_plan_real(3, dims_int.data(), n_others, real, out, 2 * n_others, 2, n_others, true);
+    fftw_execute_dft_r2c(p, real, reinterpret_cast<fftw_complex *>(out));
+
+    // Independent half from the r2c transform, moved in place to its full index in decreasing order,
+    // a full index is never below its half index
+    for (long i0 = m.n0 - 1; i0 >= 0; i0--)
+      for (long i1 = m.n1 - 1; i1 >= 0; i1--)
+        for (long i2 = m.nh - 1; i2 >= 0; i2--) {
+          auto to   = out + m.full_index(i0, i1, i2) * n_others;
+          auto from = out + m.half_index(i0, i1, i2) * n_others;
+          for (long c = 0; c < n_others; c++) to[c] = std::conj(from[c]);
+        }
+
+    // The rest from g(k) = conj(g(-k))
+    for (long i0 = 0; i0 < m.n0; i0++)
+      for (long i1 = 0; i1 < m.n1; i1++)
+        for (long i2 = m.nh; i2 < m.n2; i2++) {
+          auto to   = out + m.full_index(i0, i1, i2) * n_others;
+          auto from = out + m.full_index((m.n0 - i0) % m.n0, (m.n1 - i1) % m.n1, m.n2 - i2) * n_others;
+          for (long c = 0; c < n_others; c++) to[c] = std::conj(from[c]);
+        }
+  }
+
+  bool _is_real_in_r(mesh::brzone const &k_mesh, array_const_view<dcomplex, 2> gk, double tol) {
+
+    auto dims = k_mesh.dims();
+    auto m    = half_mesh_t{dims};
+
+    for (long i0 = 0; i0 < m.n0; i0++)
+      for (long i1 = 0; i1 < m.n1; i1++)
+        for (long i2 = 0; i2 < m.n2; i2++) {
+          long k  = m.full_index(i0, i1, i2);
+          long mk = m.full_index((m.n0 - i0) % m.n0, (m.n1 - i1) % m.n1, (m.n2 - i2) % m.n2);
+          if (max_element(abs(gk(k, range::all) - nda::conj(gk(mk, range::all)))) > tol) return false;
+        }
+    return true;
+  }
+
 } // namespace triqs_tprf::fourier
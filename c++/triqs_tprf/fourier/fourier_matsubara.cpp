@@ -120,22 +120,22 @@ namespace triqs_tprf::fourier {
     return plan;
   }
 
-  gf_vec_t<imfreq> _fourier_impl(mesh::imfreq const &iw_mesh, gf_vec_cvt<imtime> gt, fourier_plan &p, arrays::array_const_view<dcomplex, 2> mom_23) {
-    if (mom_23.is_empty()) return _fourier_impl(iw_mesh, gt, p, fit_derivatives(gt));
+  void _fourier_impl(gf_vec_vt<imfreq> gw, gf_vec_cvt<imtime> gt, fourier_plan &p, array_view<dcomplex, 2> _gin, array_view<dcomplex, 2> _gout,
+                     arrays::array_const_view<dcomplex, 2> mom_23) {
+    if (mom_23.is_empty()) return _fourier_impl(gw, gt, p, _gin, _gout, fit_derivatives(gt));
 
-    double beta = gt.mesh().beta();
-    auto L      = gt.mesh().size() - 1;
+    auto const &iw_mesh = gw.mesh();
+    double beta         = gt.mesh().beta();
+    long L              = gt.mesh().size() - 1;
     if (L < 2 * (iw_mesh.last_index() + 1))
       TRIQS_RUNTIME_ERROR << "Fourier: The time mesh mush be at least twice as long as the "
                              "number of positive frequencies :\n gt.mesh().size() =  "
                           << gt.mesh().size() << " gw.mesh().last_index()" << iw_mesh.last_index();
 
-    int n_others = gt.data().shape()[1];
-
-    array<dcomplex, 2> _gout(L,
-                             n_others); // FIXME Why do we need this dimension to
-                                        // be one less than gt.mesh().size() ?
-    array<dcomplex, 2> _gin(L + 1, n_others);
+    long n_others = gt.data().shape()[1];
+    if (_gin.shape() != std::array<long, 2>{L + 1, n_others} || _gout.shape() != std::array<long, 2>{L, n_others}
+        || gw.data().shape()[1] != n_others)
+      TRIQS_RUNTIME_ERROR << "Fourier: the work arrays do not match the meshes.";
 
     bool is_fermion = (iw_mesh.statistic() == Fermion);
     double fact     = beta / L;
@@ -175,11 +175,26 @@ namespace triqs_tprf::fourier {
     //_fourier_base(_gin, _gout, 1, dims, n_others, FFTW_BACKWARD);
     _fourier_base(_gin, _gout, p);
 
-    auto gw = gf_vec_t<imfreq>{iw_mesh, {int(n_others)}};
-
-    // FIXME Avoid copy, by doing proper in-place operation
     for (auto w : iw_mesh) gw[w] = _gout((w.index() + L) % L, _) + a1 / (w - b1) + a2 / (w - b2) + a3 / (w - b3);
+  }
+
+  gf_vec_t<imfreq> _fourier_impl(mesh::imfreq const &iw_mesh, gf_vec_cvt<imtime> gt, fourier_plan &p, arrays::array_const_view<dcomplex, 2> mom_23) {
+
+    auto L = gt.mesh().size() - 1;
+    if (L < 2 * (iw_mesh.last_index() + 1))
+      TRIQS_RUNTIME_ERROR << "Fourier: The time mesh mush be at least twice as long as the "
+                             "number of positive frequencies :\n gt.mesh().size() =  "
+                          << gt.mesh().size() << " gw.mesh().last_index()" << iw_mesh.last_index();
+
+    int n_others = gt.data().shape()[1];
+
+    array<dcomplex, 2> _gout(L,
+                             n_others); // FIXME Why do we need this dimension to
+                                        // be one less than gt.mesh().size() ?
+    array<dcomplex, 2> _gin(L + 1, n_others);
 
+    auto gw = gf_vec_t<imfreq>{iw_mesh, {int(n_others)}};
+    _fourier_impl(gw(), gt, p, _gin(), _gout(), mom_23);
     return gw;
   }
 
@@ -215,8 +230,10 @@ namespace triqs_tprf::fourier {
     return plan;
   }
 
-  gf_vec_t<imtime> _fourier_impl(mesh::imtime const &tau_mesh, gf_vec_cvt<imfreq> gw, fourier_plan &p,
-                                 arrays::array_const_view<dcomplex, 2> mom_123) {
+  void _fourier_impl(gf_vec_vt<imtime> gt, gf_vec_cvt<imfreq> gw, fourier_plan &p, array_view<dcomplex, 2> _gin, array_view<dcomplex, 2> _gout,
+                     arrays::array_const_view<dcomplex, 2> mom_123) {
+
+    auto const &tau_mesh = gt.mesh();
 
     TRIQS_ASSERT2(!gw.mesh().positive_only(),
                   "Fourier is only implemented for g(i omega_n) with full mesh "
@@ -243,7 +260,7 @@ namespace triqs_tprf::fourier {
                     "0th moment\n  error is :" +
                         std::to_string(_abs_tail0));
       */
-      return _fourier_impl(tau_mesh, gw, p, tail(range(1, 4), range::all));
+      return _fourier_impl(gt, gw, p, _gin, _gout, tail(range(1, 4), range::all));
     }
 
     double beta = tau_mesh.beta();
@@ -253,12 +270,10 @@ namespace triqs_tprf::fourier {
                              "the freq mesh :\n gt.mesh().size() =  "
                           << tau_mesh.size() << " gw.mesh().last_index()" << gw.mesh().last_index();
 
-    int n_others = gw.data().shape()[1];
-
-    array<dcomplex, 2> _gin(L,
-                            n_others); // FIXME Why do we need this dimension to
-                                       // be one less than gt.mesh().size() ?
-    array<dcomplex, 2> _gout(L + 1, n_others);
+    long n_others = gw.data().shape()[1];
+    if (_gin.shape() != std::array<long, 2>{L, n_others} || _gout.shape() != std::array<long, 2>{L + 1, n_others}
+        || gt.data().shape()[1] != n_others)
+      TRIQS_RUNTIME_ERROR << "Inverse Fourier: the work arrays do not match the meshes.";
 
     bool is_fermion = (gw.mesh().statistic() == Fermion);
     double fact     = 1.0 / beta;
@@ -287,14 +302,14 @@ namespace triqs_tprf::fourier {
       a3 = m1 / 6 + m2 / 2 + m3 / 3;
     }
 
+    // The frequencies beyond the mesh of gw are zero
+    _gin() = 0;
     for (auto w : gw.mesh()) _gin((w.index() + L) % L, _) = fact * (gw[w] - (a1 / (w - b1) + a2 / (w - b2) + a3 / (w - b3)));
 
     // int dims[] = {int(L)};
     //_fourier_base(_gin, _gout, 1, dims, n_others, FFTW_FORWARD);
     _fourier_base(_gin, _gout, p);
 
-    auto gt = gf_vec_t<imtime>{tau_mesh, {int(n_others)}};
-
     if (is_fermion)
       for (auto t : tau_mesh)
         gt[t] = _gout(t.index(), _) * exp(-iomega * t) + oneFermion(a1, b1, t, beta) + oneFermion(a2, b2, t, beta) + oneFermion(a3, b3, t, beta);
@@ -303,7 +318,26 @@ namespace triqs_tprf::fourier {
 
     double pm = (is_fermion ? -1 : 1);
     gt[L]     = pm * (gt[0] + m1);
+  }
 
+  gf_vec_t<imtime> _fourier_impl(mesh::imtime const &tau_mesh, gf_vec_cvt<imfreq> gw, fourier_plan &p,
+                                 arrays::array_const_view<dcomplex, 2> mom_123) {
+
+    long L = tau_mesh.size() - 1;
+    if (L < 2 * (gw.mesh().last_index() + 1))
+      TRIQS_RUNTIME_ERROR << "Inverse Fourier: The time mesh mush be at least twice as long as "
+                             "the freq mesh :\n gt.mesh().size() =  "
+                          << tau_mesh.size() << " gw.mesh().last_index()" << gw.mesh().last_index();
+
+    int n_others = gw.data().shape()[1];
+
+    array<dcomplex, 2> _gin(L,
+                            n_others); // FIXME Why do we need this dimension to
+                                       // be one less than gt.mesh().size() ?
+    array<dcomplex, 2> _gout(L + 1, n_others);
+
+    auto gt = gf_vec_t<imtime>{tau_mesh, {int(n_others)}};
+    _fourier_impl(gt(), gw, p, _gin(), _gout(), mom_123);
     return gt;
   }
 
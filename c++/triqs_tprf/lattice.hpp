@@ -23,17 +23,25 @@
 #include "types.hpp"
 
 #include "./lattice/gf.hpp"
+#include "./lattice/ibz.hpp"
+#include "./lattice/band_structure.hpp"
 #include "./lattice/lindhard_chi00.hpp"
 #include "./lattice/rpa.hpp"
 #include "./lattice/lattice_utility.hpp"
 #include "./lattice/gw.hpp"
 #include "./lattice/dynamical_screened_interaction.hpp"
 #include "./lattice/eliashberg.hpp"
+#include "./lattice/eliashberg_block_solver.hpp"
 #include "./lattice/fourier_interpolation.hpp"
 
 #include "./lattice/chi_retime.hpp"
 #include "./lattice/chi_imtime.hpp"
 #include "./lattice/chi_imfreq.hpp"
+#include "./lattice/bse_solver.hpp"
+#include "./lattice/compressed_vertex.hpp"
 
 #include "./lattice/gw_realspace.hpp"
+#include "./fourier/fftw_plans.hpp"
+#include "./batched_linalg.hpp"
+#include "./batched_tail_fit.hpp"
 
@@ -0,0 +1,57 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <nda/linalg/eigenelements.hpp>
+
+#include "band_structure.hpp"
+#include "lattice_utility.hpp"
+
+namespace triqs_tprf {
+
+  band_structure::band_structure(e_k_cvt e_k, double mu, double beta)
+     : _kmesh(e_k.mesh()), _mu(mu), _beta(beta) {
+
+    long n_k = _kmesh.size();
+    long nb  = e_k.target_shape()[0];
+
+    _eps = nda::array<double, 2>(n_k, nb);
+    _occ = nda::array<double, 2>(n_k, nb);
+    _U.resize(n_k);
+
+    auto _ = all_t{};
+
+#pragma omp parallel for
+    for (long k = 0; k < n_k; k++) {
+      matrix<std::complex<double>> e_k_mat(e_k.data()(k, _, _));
+      for (long a = 0; a < nb; a++) e_k_mat(a, a) -= mu;
+
+      auto [ek, Uk] = linalg::eigenelements(e_k_mat);
+
+      _U[k] = Uk;
+      for (long n = 0; n < nb; n++) {
+        _eps(k, n) = ek(n);
+        _occ(k, n) = fermi(beta * ek(n));
+      }
+    }
+  }
+
+} // namespace triqs_tprf
@@ -0,0 +1,70 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <vector>
+
+#include "../types.hpp"
+
+namespace triqs_tprf {
+
+  /** Band structure of a single particle dispersion on its k-mesh
+
+   Diagonalizes :math:`\epsilon(\mathbf{k}) - \mu` once at every k-point,
+   in an OpenMP parallel loop, and stores the eigenvalues :math:`\xi_n(\mathbf{k})`,
+   the eigenvectors :math:`U_{an}(\mathbf{k})` (column :math:`n` is band :math:`n`)
+   and the Fermi occupations :math:`f(\beta \xi_n(\mathbf{k}))`.
+
+   The cache is read only after construction and can be shared between threads.
+  */
+  class band_structure {
+
+    public:
+    /**
+     @param e_k Dispersion :math:`\epsilon_{ab}(\mathbf{k})`
+     @param mu Chemical potential :math:`\mu`
+     @param beta Inverse temperature :math:`\beta`
+     */
+    band_structure(e_k_cvt e_k, double mu, double beta);
+
+    mesh::brzone const &mesh() const { return _kmesh; }
+    long n_bands() const { return _eps.shape()[1]; }
+    double mu() const { return _mu; }
+    double beta() const { return _beta; }
+
+    /// Eigenvalues :math:`\xi_n(\mathbf{k}) = \epsilon_n(\mathbf{k}) - \mu` at k-mesh data index k
+    nda::array_const_view<double, 1> eps(long k) const { return _eps(k, nda::range::all); }
+
+    /// Eigenvectors :math:`U_{an}(\mathbf{k})` at k-mesh data index k
+    nda::matrix<std::complex<double>> const &U(long k) const { return _U[k]; }
+
+    /// Fermi occupations :math:`f(\beta \xi_n(\mathbf{k}))` at k-mesh data index k
+    nda::array_const_view<double, 1> occ(long k) const { return _occ(k, nda::range::all); }
+
+    private:
+    mesh::brzone _kmesh;
+    double _mu, _beta;
+    nda::array<double, 2> _eps, _occ;
+    std::vector<nda::matrix<std::complex<double>>> _U;
+  };
+
+} // namespace triqs_tprf
@@ -0,0 +1,165 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <filesystem>
+
+#include <h5/h5.hpp>
+#include <nda/h5.hpp>
+#include <triqs/utility/exceptions.hpp>
+
+#include "bse_checkpoint.hpp"
+
+namespace triqs_tprf {
+
+  bse_checkpoint::bse_checkpoint(std::string prefix, long n_points, long nb, double beta, std::vector<long> mesh_sizes, double interval,
+                                 mpi::communicator c)
+     : _prefix(std::move(prefix)),
+       _interval(interval),
+       _beta(beta),
+       _mesh_sizes(std::move(mesh_sizes)),
+       _c(c),
+       _done(n_points, false),
+       _last_write(std::chrono::steady_clock::now()) {
+
+    if (!enabled()) return;
+
+    _values = nda::array<scalar_t, 5>(n_points, nb, nb, nb, nb);
+    _values = 0;
+
+    // Read the files of all ranks of a previous run
+    for (auto const &[r, name] : previous_files()) {
+      h5::file f(name, 'r');
+
+      long n = 0, nb_f = 0;
+      double beta_f = 0;
+      std::vector<long> mesh_sizes_f;
+      h5::read(f, "n_points", n);
+      h5::read(f, "nb", nb_f);
+      h5::read(f, "beta", beta_f);
+      h5::read(f, "mesh_sizes", mesh_sizes_f);
+      if (n != n_points) TRIQS_RUNTIME_ERROR << "bse_checkpoint: " << name << " has " << n << " points, expected " << n_points << ".";
+      if (nb_f != nb || beta_f != _beta || mesh_sizes_f != _mesh_sizes)
+        TRIQS_RUNTIME_ERROR << "bse_checkpoint: " << name << " was written for a different beta, mesh or target dimension.";
+
+      nda::array<long, 1> points;
+      nda::array<scalar_t, 5> values;
+      h5::read(f, "points", points);
+      h5::read(f, "values", values);
+
+      for (long i = 0; i < points.size(); i++) {
+        long p = points(i);
+        if (p < 0 || p >= n_points) TRIQS_RUNTIME_ERROR << "bse_checkpoint: " << name << " has the invalid point " << p << ".";
+        _done[p] = true;
+        _values(p, nda::range::all, nda::range::all, nda::range::all, nda::range::all) =
+           values(i, nda::range::all, nda::range::all, nda::range::all, nda::range::all);
+        if (r == _c.rank()) _own.push_back(p);
+      }
+    }
+
+    // No rank may write its file before all ranks have read it
+    _c.barrier();
+  }
+
+  // The files <prefix>.rank<r>.h5 and their ranks r, a run on fewer ranks or a preempted rank leaves gaps in r
+
+  std::vector<std::pair<int, std::string>> bse_checkpoint::previous_files() const {
+
+    std::filesystem::path path(_prefix);
+    auto dir  = path.has_parent_path() ? path.parent_path() : std::filesystem::path(".");
+    auto head = path.filename().string() + ".rank", tail = std::string(".h5");
+
+    std::vector<std::pair<int, std::string>> files;
+    if (!std::filesystem::is_directory(dir)) return files;
+
+    for (auto const &entry : std::filesystem::directory_iterator(dir)) {
+      auto name = entry.path().filename().string();
+      if (name.size() <= head.size() + tail.size() || name.compare(0, head.size(), head) != 0
+          || name.compare(name.size() - tail.size(), tail.size(), tail) != 0)
+        continue;
+      auto digits = name.substr(head.size(), name.size() - head.size() - tail.size());
+      if (digits.find_first_not_of("0123456789") != std::string::npos || digits.size() > 9) continue;
+      files.emplace_back(std::stoi(digits), entry.path().string());
+    }
+
+    std::sort(files.begin(), files.end());
+    return files;
+  }
+
+  std::vector<long> bse_checkpoint::remaining() const {
+    std::vector<long> points;
+    for (long p = 0; p < long(_done.size()); p++)
+      if (!_done[p]) points.push_back(p);
+    return points;
+  }
+
+  void bse_checkpoint::store(long p, nda::array_const_view<scalar_t, 4> v) {
+    if (!enabled()) return;
+
+#pragma omp critical(bse_checkpoint)
+    {
+      _done[p] = true;
+      _values(p, nda::range::all, nda::range::all, nda::range::all, nda::range::all) = v;
+      _own.push_back(p);
+
+      std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _last_write;
+      if (elapsed.count() >= _interval) write();
+    }
+  }
+
+  void bse_checkpoint::flush() {
+    if (!enabled()) return;
+
+#pragma omp critical(bse_checkpoint)
+    write();
+  }
+
+  void bse_checkpoint::write() {
+
+    long n  = _own.size();
+    long nb = _values.shape()[1];
+
+    nda::array<long, 1> points(n);
+    nda::array<scalar_t, 5> values(n, nb, nb, nb, nb);
+    for (long i = 0; i < n; i++) {
+      points(i) = _own[i];
+      values(i, nda::range::all, nda::range::all, nda::range::all, nda::range::all) =
+         _values(_own[i], nda::range::all, nda::range::all, nda::range::all, nda::range::all);
+    }
+
+    auto name = file_name(_c.rank());
+    auto tmp  = name + ".tmp";
+    {
+      h5::file f(tmp, 'w');
+      h5::write(f, "n_points", long(_done.size()));
+      h5::write(f, "nb", nb);
+      h5::write(f, "beta", _beta);
+      h5::write(f, "mesh_sizes", _mesh_sizes);
+      h5::write(f, "points", points);
+      h5::write(f, "values", values);
+    }
+    std::filesystem::rename(tmp, name);
+
+    _last_write = std::chrono::steady_clock::now();
+  }
+
+} // namespace triqs_tprf
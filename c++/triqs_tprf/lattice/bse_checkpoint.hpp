@@ -0,0 +1,100 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <chrono>
+#include <complex>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <mpi/mpi.hpp>
+#include <nda/nda.hpp>
+
+namespace triqs_tprf {
+
+  /** Resumable checkpoint of the points of a lattice BSE sweep
+
+   Every rank writes the points it has solved to its own file
+   ``<prefix>.rank<r>.h5``, with the point indices and the (nb, nb, nb, nb)
+   results. The file is written to a temporary and renamed, so a preempted
+   run always leaves a complete file behind.
+
+   On construction all files ``<prefix>.rank*.h5`` of a previous run are read,
+   the number of ranks may differ between the runs and files may be missing.
+   The points found there are marked as done and their results are kept, and
+   each rank keeps the points of its own previous file in its new file. The
+   files also store the inverse temperature, the mesh sizes and the target
+   dimension of the sweep, a file of a different sweep is an error.
+
+   An empty prefix disables the checkpoint.
+  */
+  class bse_checkpoint {
+
+    public:
+    using scalar_t = std::complex<double>;
+
+    /**
+     @param prefix file name prefix, empty to disable
+     @param n_points total number of points of the sweep
+     @param nb target space dimension
+     @param beta inverse temperature
+     @param mesh_sizes sizes of the meshes of the sweep, checked on restore
+     @param interval minimal time in seconds between two writes of the file
+     */
+    bse_checkpoint(std::string prefix, long n_points, long nb, double beta, std::vector<long> mesh_sizes, double interval = 60.0,
+                   mpi::communicator c = {});
+
+    bool enabled() const { return !_prefix.empty(); }
+
+    /// Whether point p is done
+    bool done(long p) const { return _done[p]; }
+
+    /// Result of the done point p
+    nda::array_const_view<scalar_t, 4> value(long p) const { return _values(p, nda::range::all, nda::range::all, nda::range::all, nda::range::all); }
+
+    /// The points that are not done, in increasing order
+    std::vector<long> remaining() const;
+
+    /// Store the result of point p of this rank, thread safe, and write the file if the interval has passed
+    void store(long p, nda::array_const_view<scalar_t, 4> v);
+
+    /// Write the file of this rank
+    void flush();
+
+    private:
+    std::string _prefix;
+    double _interval;
+    double _beta;
+    std::vector<long> _mesh_sizes;
+    mpi::communicator _c;
+    std::vector<bool> _done;
+    nda::array<scalar_t, 5> _values;
+    std::vector<long> _own;
+    std::chrono::steady_clock::time_point _last_write;
+
+    std::string file_name(int rank) const { return _prefix + ".rank" + std::to_string(rank) + ".h5"; }
+    std::vector<std::pair<int, std::string>> previous_files() const;
+    void write();
+  };
+
+} // namespace triqs_tprf
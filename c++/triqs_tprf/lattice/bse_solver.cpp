@@ -0,0 +1,204 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <atomic>
+#include <cmath>
+
+#include <triqs/utility/exceptions.hpp>
+
+#include "../batched_linalg.hpp"
+#include "bse_solver.hpp"
+
+namespace triqs_tprf {
+
+  namespace {
+
+    using scalar_t = std::complex<double>;
+
+    // Solver settings, changed only between BSE solves
+    std::atomic<bool> bse_use_gmres = false;
+    double bse_tol                  = 1e-10;
+    int bse_restart                 = 60;
+    int bse_max_iter                = 2000;
+
+    double norm2(nda::vector<scalar_t> const &v) {
+      double s = 0;
+      for (auto const &x : v) s += std::norm(x);
+      return std::sqrt(s);
+    }
+
+  } // namespace
+
+  // ----------------------------------------------------
+
+  bse_kernel::bse_kernel(nda::array<scalar_t, 3> C, nda::matrix_const_view<scalar_t> G)
+     : _nf(C.shape()[0]), _m(C.shape()[1]), _N(_nf * _m), _C(std::move(C)), _G(G) {
+
+    if (_C.shape()[2] != _m || _G.shape() != std::array<long, 2>{_N, _N}) TRIQS_RUNTIME_ERROR << "bse_kernel: incompatible shapes.";
+
+    // Frequency diagonal blocks D_n = 1 - C_n G_nn
+    _D_LU = nda::array<scalar_t, 3>(_nf, _m, _m);
+    for (long n = 0; n < _nf; n++)
+      for (long x = 0; x < _m; x++)
+        for (long z = 0; z < _m; z++) {
+          scalar_t v = (x == z) ? 1. : 0.;
+          for (long y = 0; y < _m; y++) v -= _C(n, x, y) * _G(n * _m + y, n * _m + z);
+          _D_LU(n, x, z) = v;
+        }
+
+    batched_getrf(_D_LU, _D_piv);
+  }
+
+  nda::vector<scalar_t> bse_kernel::apply(nda::vector<scalar_t> const &v) const {
+    nda::vector<scalar_t> t = _G * v;
+    nda::vector<scalar_t> r = v;
+    for (long n = 0; n < _nf; n++)
+      for (long x = 0; x < _m; x++) {
+        scalar_t s = 0;
+        for (long y = 0; y < _m; y++) s += _C(n, x, y) * t(n * _m + y);
+        r(n * _m + x) -= s;
+      }
+    return r;
+  }
+
+  void bse_kernel::precondition(nda::vector<scalar_t> &v) const {
+    nda::array<scalar_t, 3> B(_nf, _m, 1);
+    for (long i = 0; i < _N; i++) B.data()[i] = v(i);
+    batched_getrs(_D_LU, _D_piv, B);
+    for (long i = 0; i < _N; i++) v(i) = B.data()[i];
+  }
+
+  nda::matrix<scalar_t, nda::F_layout> bse_kernel::dense() const {
+    nda::matrix<scalar_t, nda::F_layout> A(_N, _N);
+    for (long n1 = 0; n1 < _nf; n1++)
+      for (long x = 0; x < _m; x++)
+        for (long j = 0; j < _N; j++) {
+          scalar_t v = 0;
+          for (long y = 0; y < _m; y++) v -= _C(n1, x, y) * _G(n1 * _m + y, j);
+          A(n1 * _m + x, j) = v;
+        }
+    for (long i = 0; i < _N; i++) A(i, i) += 1.;
+    return A;
+  }
+
+  // ----------------------------------------------------
+
+  bool bse_gmres(bse_kernel const &A, nda::vector<scalar_t> const &b, nda::vector<scalar_t> &x) {
+
+    long N = A.size(), k = bse_restart;
+
+    double b_norm = norm2(b);
+    if (b_norm == 0.) {
+      x() = 0.;
+      return true;
+    }
+
+    nda::matrix<scalar_t, nda::F_layout> V(N, k + 1), H(k + 1, k);
+    nda::vector<scalar_t> g(k + 1), sn(k), y(k);
+    nda::vector<double> cs(k);
+
+    long iter = 0;
+    while (iter < bse_max_iter) {
+
+      nda::vector<scalar_t> r = b - A.apply(x);
+      double beta = norm2(r);
+      if (beta <= bse_tol * b_norm) return true;
+
+      V(nda::range::all, 0) = r / beta;
+      H() = 0.;
+      g() = 0.;
+      g(0) = beta;
+
+      long j = 0;
+      bool converged = false;
+      while (j < k && iter < bse_max_iter && !converged) {
+
+        // Arnoldi step with the right preconditioned kernel A D^{-1}
+        nda::vector<scalar_t> z = V(nda::range::all, j);
+        A.precondition(z);
+        auto w = A.apply(z);
+
+        for (long i = 0; i <= j; i++) {
+          scalar_t h = 0;
+          for (long l = 0; l < N; l++) h += std::conj(V(l, i)) * w(l);
+          H(i, j) = h;
+          for (long l = 0; l < N; l++) w(l) -= h * V(l, i);
+        }
+        double h_next = norm2(w);
+        if (h_next > 0.) V(nda::range::all, j + 1) = w / h_next;
+
+        // Apply the previous rotations and eliminate the subdiagonal element
+        for (long i = 0; i < j; i++) {
+          scalar_t t  = cs(i) * H(i, j) + sn(i) * H(i + 1, j);
+          H(i + 1, j) = -std::conj(sn(i)) * H(i, j) + cs(i) * H(i + 1, j);
+          H(i, j)     = t;
+        }
+
+        double a_abs = std::abs(H(j, j)), rho = std::hypot(a_abs, h_next);
+        if (a_abs == 0.) {
+          cs(j) = 0.;
+          sn(j) = 1.;
+        } else {
+          cs(j) = a_abs / rho;
+          sn(j) = (H(j, j) / a_abs) * h_next / rho;
+        }
+        H(j, j)  = cs(j) * H(j, j) + sn(j) * h_next;
+        g(j + 1) = -std::conj(sn(j)) * g(j);
+        g(j)     = cs(j) * g(j);
+
+        converged = std::abs(g(j + 1)) <= bse_tol * b_norm || h_next == 0.;
+        j++;
+        iter++;
+      }
+
+      // Least squares solution in the Krylov subspace, x += D^{-1} V y
+      for (long i = j - 1; i >= 0; i--) {
+        scalar_t s = g(i);
+        for (long l = i + 1; l < j; l++) s -= H(i, l) * y(l);
+        y(i) = s / H(i, i);
+      }
+
+      nda::vector<scalar_t> u(N);
+      u() = 0.;
+      for (long i = 0; i < j; i++)
+        for (long l = 0; l < N; l++) u(l) += V(l, i) * y(i);
+      A.precondition(u);
+      x += u;
+    }
+
+    return norm2(b - A.apply(x)) <= bse_tol * b_norm;
+  }
+
+  // ----------------------------------------------------
+
+  void set_bse_solver(std::string const &solver, double tol, int restart, int max_iter) {
+    if (solver != "dense" && solver != "gmres") TRIQS_RUNTIME_ERROR << "set_bse_solver: solver must be 'dense' or 'gmres', got '" << solver << "'.";
+    if (tol <= 0. || restart < 1 || max_iter < 1) TRIQS_RUNTIME_ERROR << "set_bse_solver: tol, restart and max_iter must be positive.";
+    bse_tol       = tol;
+    bse_restart   = restart;
+    bse_max_iter  = max_iter;
+    bse_use_gmres = (solver == "gmres");
+  }
+
+  std::string get_bse_solver() { return bse_use_gmres ? "gmres" : "dense"; }
+
+} // namespace triqs_tprf
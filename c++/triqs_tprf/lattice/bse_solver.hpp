@@ -0,0 +1,109 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <complex>
+#include <string>
+
+#include <nda/nda.hpp>
+
+namespace triqs_tprf {
+
+  /** Lattice Bethe-Salpeter kernel at one (w, k) point in the particle-hole channel
+
+   The PH grouped kernel :math:`A = 1 - \chi^{(0)} \Gamma` acting on vectors with
+   the block index :math:`\{\nu, \alpha\}`, where :math:`\alpha` runs over the nb^2
+   PH grouped orbital pairs. The bare bubble is diagonal in frequency and stored as
+   the blocks C(n, x, y), the vertex as the dense (nf nb^2) x (nf nb^2) matrix G.
+   The vertex is not copied, it must outlive the kernel and is shared by the kernels
+   of all k-points at one bosonic frequency.
+
+   The kernel matrix itself is never formed, a product with A is one product with
+   the vertex and nf small products with the bubble blocks. Since the vertex is
+   dense a product costs O(N^2), N = nf nb^2. The preconditioner is the frequency
+   diagonal part :math:`D_\nu = 1 - \chi^{(0)}_\nu \Gamma_{\nu\nu}`, LU factorized
+   with batched_getrf.
+  */
+  class bse_kernel {
+
+    public:
+    using scalar_t = std::complex<double>;
+
+    /**
+     @param C bare bubble blocks with shape (nf, nb^2, nb^2)
+     @param G vertex matrix with shape (nf nb^2, nf nb^2), not copied
+     */
+    bse_kernel(nda::array<scalar_t, 3> C, nda::matrix_const_view<scalar_t> G);
+
+    long size() const { return _N; }
+    long block_size() const { return _m; }
+
+    /// Product with the kernel, :math:`A v`
+    nda::vector<scalar_t> apply(nda::vector<scalar_t> const &v) const;
+
+    /// Apply the inverse of the preconditioner in place, :math:`v \leftarrow D^{-1} v`
+    void precondition(nda::vector<scalar_t> &v) const;
+
+    /// Dense kernel matrix :math:`1 - \chi^{(0)} \Gamma`
+    nda::matrix<scalar_t, nda::F_layout> dense() const;
+
+    private:
+    long _nf, _m, _N;
+    nda::array<scalar_t, 3> _C;
+    nda::matrix_const_view<scalar_t> _G;
+    nda::array<scalar_t, 3> _D_LU;
+    nda::array<int, 2> _D_piv;
+  };
+
+  /** Restarted GMRES solve of the lattice Bethe-Salpeter equation
+
+   Solves :math:`A x = b` with right preconditioning by the frequency diagonal
+   part of the kernel, using modified Gram-Schmidt and Givens rotations.
+   The parameters are those set with set_bse_solver.
+
+   @param A Bethe-Salpeter kernel
+   @param b right hand side
+   @param x initial guess, overwritten with the solution
+   @return true if the relative residual reached the tolerance
+   */
+  bool bse_gmres(bse_kernel const &A, nda::vector<std::complex<double>> const &b, nda::vector<std::complex<double>> &x);
+
+  /** Set the solver of the lattice Bethe-Salpeter equation
+
+   Used by chiq_sum_nu_from_chi0q_and_gamma_PH. With "dense" the kernel
+   :math:`1 - \chi^{(0)} \Gamma` is built and LU factorized at every (w, k) point.
+   With "gmres" the equation is solved iteratively with products with the dense
+   vertex, O((nf nb^2)^2) each, preconditioned by the frequency diagonal part of the kernel and started from
+   the solution at the previous k-point. Points where GMRES does not converge
+   are solved with the dense solver.
+
+   @param solver "dense" (default) or "gmres"
+   @param tol relative residual tolerance of the iterative solver
+   @param restart Krylov subspace dimension before restart
+   @param max_iter maximal number of iterations per right hand side
+   */
+  void set_bse_solver(std::string const &solver, double tol = 1e-10, int restart = 60, int max_iter = 2000);
+
+  /// Solver of the lattice Bethe-Salpeter equation, "dense" or "gmres"
+  std::string get_bse_solver();
+
+} // namespace triqs_tprf
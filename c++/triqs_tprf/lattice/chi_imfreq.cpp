@@ -24,12 +24,20 @@
 #include <triqs/utility/timer.hpp>
 #include <triqs/utility/timestamp.hpp>
 #include <omp.h>
+#include <nda/lapack.hpp>
 
 #include "../fourier/fourier.hpp"
 #include "../linalg.hpp"
 #include "../mpi.hpp"
+#include "../batched_tail_fit.hpp"
 
 #include "chi_imfreq.hpp"
+#include "bse_solver.hpp"
+#include "compressed_vertex.hpp"
+#include "bse_checkpoint.hpp"
+#include "mesh_index_tables.hpp"
+#include "gf.hpp"
+#include "fourier.hpp"
 #include "common.hpp"
 
 namespace triqs_tprf {
@@ -60,6 +68,177 @@ return chi0r;
 }
 */
 
+namespace {
+
+// Particle-hole bubble at a single lattice point r
+//
+//   chi0_r(w, n)(a, b, c, d) = -beta * g_pr(n)(d, a) * g_mr(n + w)(b, c)
+//
+// working directly on (strided) views of the gf data, g_pr = g_nr[_, r] and
+// g_mr = g_nr[_, -r]. The (w, n) frequency pairs are the rows of chi_r, given
+// as pairs of Matsubara indices that are mapped onto the data index of the
+// fermionic mesh of g_nr. Frequencies outside this mesh give zero
+// contribution, and the output slice has to be zero on entry.
+//
+// The transposed and scaled g_pr(n) is reused as long as n is unchanged, and
+// the inner loop over d is a unit stride scaled copy that the compiler can
+// vectorize.
+
+using wn_idx_t = std::vector<std::pair<long, long>>;
+
+template <typename CHI_V, typename G_V>
+void chi0_PH_bubble_r_point(CHI_V &&chi_r, G_V const &g_pr, G_V const &g_mr, wn_idx_t const &wn_idx, long g_first_idx, double beta) {
+
+  long nb = g_pr.shape()[1];
+  long nf = g_pr.shape()[0];
+
+  nda::matrix<std::complex<double>> g_ad(nb, nb);
+  long n_dat_prev = -1;
+
+  for (long row = 0; row < long(wn_idx.size()); row++) {
+    auto [w_idx, n_idx] = wn_idx[row];
+
+    long n_dat  = n_idx - g_first_idx;
+    long nw_dat = n_idx + w_idx - g_first_idx;
+    if (n_dat < 0 || n_dat >= nf || nw_dat < 0 || nw_dat >= nf) continue;
+
+    if (n_dat != n_dat_prev) {
+      for (long a_ = 0; a_ < nb; a_++)
+        for (long d_ = 0; d_ < nb; d_++) g_ad(a_, d_) = -beta * g_pr(n_dat, d_, a_);
+      n_dat_prev = n_dat;
+    }
+
+    for (long a_ = 0; a_ < nb; a_++) {
+      std::complex<double> const *g_a = &g_ad(a_, 0);
+      for (long b_ = 0; b_ < nb; b_++)
+        for (long c_ = 0; c_ < nb; c_++) {
+          std::complex<double> g_bc   = g_mr(nw_dat, b_, c_);
+          std::complex<double> *chi_p = &chi_r(row, a_, b_, c_, 0);
+#pragma omp simd
+          for (long d_ = 0; d_ < nb; d_++) chi_p[d_] = g_bc * g_a[d_];
+        }
+    }
+  }
+}
+
+// Matsubara index pairs of all (w, n) in wmesh x nmesh, ordered as the gf data
+wn_idx_t wn_indices(mesh::imfreq const &wmesh, mesh::imfreq const &nmesh) {
+  wn_idx_t idx;
+  idx.reserve(wmesh.size() * nmesh.size());
+  for (auto const &w : wmesh)
+    for (auto const &n : nmesh) idx.emplace_back(w.index(), n.index());
+  return idx;
+}
+
+// Loop over the lattice points in r_arr, each thread writes the disjoint r-slice
+// of the chi data (row, r, a, b, c, d), so no synchronization is needed.
+
+template <typename R_ARR>
+void chi0_PH_bubble_r_loop(array_view<std::complex<double>, 6> chi_dat, g_wr_cvt g_nr, R_ARR const &r_arr, wn_idx_t const &wn_idx) {
+
+  auto _ = all_t{};
+
+  TRIQS_ASSERT2(!std::get<0>(g_nr.mesh()).positive_only(), "chi0 bubble: positive_only fermionic meshes are not supported.");
+
+  double beta      = std::get<0>(g_nr.mesh()).beta();
+  long g_first_idx = std::get<0>(g_nr.mesh()).first_index();
+  auto g_dat       = g_nr.data();
+  auto minus_r     = minus_x_index_table(std::get<1>(g_nr.mesh()));
+
+#pragma omp parallel for schedule(dynamic)
+  for (unsigned int idx = 0; idx < r_arr.size(); idx++) {
+    auto const &r = r_arr[idx];
+
+    auto g_pr  = g_dat(_, r.data_index(), _, _);
+    auto g_mr  = g_dat(_, minus_r[r.data_index()], _, _);
+    auto chi_r = chi_dat(_, r.data_index(), _, _, _, _);
+
+    chi0_PH_bubble_r_point(chi_r, g_pr, g_mr, wn_idx, g_first_idx, beta);
+  }
+}
+
+// Bare PH bubble at one (w, q) point from the data of g_wk, for the frequencies of fmesh
+//
+//   chi0_n(nu)(a, b, c, d) = -beta/Nk sum_k G_da(nu, k) G_bc(nu + w, k - q)
+//
+// kmq are the data indices of k - q. Frequencies outside the mesh of g_wk give zero contribution.
+
+array<std::complex<double>, 5> chi0_n_from_g_wk_data_PH(array_const_view<std::complex<double>, 4> g_dat, long g_first_idx, long w_idx,
+                                                        std::vector<long> const &kmq, mesh::imfreq const &fmesh) {
+
+  auto _ = all_t{};
+
+  long nb = g_dat.shape()[2], nk = kmq.size(), nf_g = g_dat.shape()[0];
+
+  array<std::complex<double>, 5> chi0_n(fmesh.size(), nb, nb, nb, nb);
+  chi0_n() = 0;
+
+  for (auto const &n : fmesh) {
+    long n_dat = n.index() - g_first_idx, nw_dat = n.index() + w_idx - g_first_idx;
+    if (n_dat < 0 || n_dat >= nf_g || nw_dat < 0 || nw_dat >= nf_g) continue;
+
+    auto chi = chi0_n(n.data_index(), _, _, _, _);
+    for (long k = 0; k < nk; k++) {
+      auto g_da = g_dat(n_dat, k, _, _);
+      auto g_bc = g_dat(nw_dat, kmq[k], _, _);
+      for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb)) chi(a, b, c, d) -= g_da(d, a) * g_bc(b, c);
+    }
+  }
+
+  chi0_n *= fmesh.beta() / nk;
+  return chi0_n;
+}
+
+// Bare PH bubble at one (w, q) point from the dispersion and the local self energy, as
+// chi0_n_from_g_wk_data_PH with the Green's functions
+//
+//   G(nu, k) = [(nu + mu) 1 - e(k) - Sigma(nu)]^{-1}
+//
+// computed on the fly at the frequencies nu and nu + w only, so that the lattice Green's
+// function is never stored. Frequencies outside the mesh of sigma_w give zero contribution.
+
+array<std::complex<double>, 5> chi0_n_from_e_k_sigma_w_data_PH(double mu, array_const_view<std::complex<double>, 3> e_dat,
+                                                               array_const_view<std::complex<double>, 3> sigma_dat, long sigma_first_idx,
+                                                               long w_idx, std::vector<long> const &kmq, mesh::imfreq const &fmesh) {
+
+  long nb = e_dat.shape()[1], nk = kmq.size(), nf_s = sigma_dat.shape()[0];
+  double beta = fmesh.beta();
+
+  array<std::complex<double>, 5> chi0_n(fmesh.size(), nb, nb, nb, nb);
+  chi0_n() = 0;
+
+  // Dyson equation at the fermionic Matsubara index n and the k-mesh data index k
+  auto dyson = [&](long n, long k, nda::matrix<std::complex<double>> &g) {
+    long n_dat = n - sigma_first_idx;
+    if (n_dat < 0 || n_dat >= nf_s) return false;
+    std::complex<double> iw_mu(mu, M_PI * (2 * n + 1) / beta);
+    for (auto [a, b] : itertools::product_range(nb, nb)) g(a, b) = ((a == b) ? iw_mu : 0.) - e_dat(k, a, b) - sigma_dat(n_dat, a, b);
+    g = inverse(g);
+    return true;
+  };
+
+  nda::matrix<std::complex<double>> g_da(nb, nb), g_bc(nb, nb);
+
+  for (long k = 0; k < nk; k++)
+    for (auto const &n : fmesh) {
+      if (!dyson(n.index(), k, g_da) || !dyson(n.index() + w_idx, kmq[k], g_bc)) continue;
+      auto chi = chi0_n(n.data_index(), _, _, _, _);
+      for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb)) chi(a, b, c, d) -= g_da(d, a) * g_bc(b, c);
+    }
+
+  chi0_n *= beta / nk;
+  return chi0_n;
+}
+
+// View of the data of a chi_wnr_t or chi_nr_t as (row, r, a, b, c, d)
+template <typename CHI_T> array_view<std::complex<double>, 6> chi_rows_view(CHI_T &chi, long n_rows) {
+  long nr = std::get<CHI_T::arity - 1>(chi.mesh()).size();
+  long nb = chi.target_shape()[0];
+  return array_view<std::complex<double>, 6>(std::array<long, 6>{n_rows, nr, nb, nb, nb, nb}, chi.data().data());
+}
+
+} // namespace
+
 chi_wnr_t chi0r_from_gr_PH(int nw, int nn, g_wr_cvt g_nr) {
 
   mpi::communicator comm;
@@ -80,9 +259,6 @@ chi_wnr_t chi0r_from_gr_PH(int nw, int nn, g_wr_cvt g_nr) {
   chi0r_t chi0_wnr{{wmesh, nmesh, rmesh}, {nb, nb, nb, nb}};
   chi0_wnr *= 0.;
   t_alloc.stop();
-  
-  auto chi_target = chi0_wnr.target();
-  auto g_target = g_nr.target();
 
   auto arr = mpi_view(rmesh);
 
@@ -90,44 +266,14 @@ chi_wnr_t chi0r_from_gr_PH(int nw, int nn, g_wr_cvt g_nr) {
 	    << arr.size() << " of " << rmesh.size() << std::endl;
 
   t_calc.start();
-#pragma omp parallel for
-  for (unsigned int idx = 0; idx < arr.size(); idx++) {
-    auto &r = arr[idx];
-
-    auto chi0_wn =
-      make_gf<prod<imfreq, imfreq>>({wmesh, nmesh}, chi_target);
-    auto g_pr_n = make_gf<imfreq>(nmesh, g_target);
-    auto g_mr_n = make_gf<imfreq>(nmesh, g_target);
-    
-#pragma omp critical
-    {
-      g_pr_n = g_nr[_, r];
-      g_mr_n = g_nr(_, -r);
-    }
-
-    for (auto w : wmesh)
-      for (auto n : nmesh) chi0_wn[w, n](a, b, c, d) << -beta * g_pr_n(n)(d, a) * g_mr_n(n + w)(b, c);
-
-#pragma omp critical
-    chi0_wnr[_, _, r] = chi0_wn;
-
-    // chi0r(iw, inu, r)(a, b, c, d) << -beta * gr(inu, r)(d, a) * gr(inu + iw,
-    // -r)(b, c);
-  }
+  chi0_PH_bubble_r_loop(chi_rows_view(chi0_wnr, nw * nn), g_nr, arr, wn_indices(wmesh, nmesh));
   t_calc.stop();
 
   t_mpi_all_reduce.start();
 
-  // This (surprisingly gives incorrect results, for sufficiently large arguments...
-  //chi0_wnr = mpi::all_reduce(chi0_wnr);
-
-  /* // Does not give correct result either...
-  for (auto w : wmesh )
-    chi0_wnr[w, _, _] = mpi::all_reduce(chi0_wnr[w, _, _]);
-  */
-
-  for (auto w : wmesh)
-    for (auto n : nmesh) chi0_wnr[w, n, _] = mpi::all_reduce(chi0_wnr[w, n, _]);
+  // A single mpi::all_reduce(chi0_wnr) overflows the MPI int count for large
+  // arguments, reduce in bounded chunks instead.
+  mpi_all_reduce_in_place(chi0_wnr);
 
   t_mpi_all_reduce.stop();
 
@@ -146,37 +292,18 @@ chi_nr_t chi0_nr_from_gr_PH_at_specific_w(int nw_index, int nn, g_wr_cvt g_nr) {
   auto &rmesh = std::get<1>(g_nr.mesh());
 
   double beta = std::get<0>(g_nr.mesh()).beta();
-  auto w = matsubara_freq{nw_index, beta, Boson};
 
   auto nmesh = mesh::imfreq{beta, Fermion, nn};
   chi_nr_t chi0_nr{{nmesh, rmesh}, {nb, nb, nb, nb}};
   chi0_nr *= 0.;
-  
-  auto chi_target = chi0_nr.target();
-  auto g_target = g_nr.target();
 
-  auto arr = mpi_view(rmesh);
-#pragma omp parallel for
-  for (unsigned int idx = 0; idx < arr.size(); idx++) {
-    auto &r = arr[idx];
+  wn_idx_t wn_idx;
+  for (auto const &n : nmesh) wn_idx.emplace_back(nw_index, n.index());
 
-    auto chi0_n = make_gf<imfreq>(nmesh, chi_target);
-    auto g_pr_n = make_gf<imfreq>(nmesh, g_target);
-    auto g_mr_n = make_gf<imfreq>(nmesh, g_target);
-    
-#pragma omp critical
-    {
-      g_pr_n = g_nr[_, r];
-      g_mr_n = g_nr(_, -r);
-    }
-
-    for (auto n : nmesh) chi0_n[n](a, b, c, d) << -beta * g_pr_n(n)(d, a) * g_mr_n(n + w)(b, c);
-
-#pragma omp critical
-    chi0_nr[_, r] = chi0_n;
-  }
+  auto arr = mpi_view(rmesh);
+  chi0_PH_bubble_r_loop(chi_rows_view(chi0_nr, nn), g_nr, arr, wn_idx);
 
-  for (auto n : nmesh) chi0_nr[n, _] = mpi::all_reduce(chi0_nr[n, _]);
+  mpi_all_reduce_in_place(chi0_nr);
 
   return chi0_nr;
 }
@@ -203,36 +330,11 @@ chi_wnr_t chi0r_from_gr_PH_nompi(int nw, int nn, g_wr_cvt g_nr) {
   chi0r_t chi0_wnr{{wmesh, nmesh, rmesh}, {nb, nb, nb, nb}};
   chi0_wnr *= 0.;
   t_alloc.stop();
-  
-  auto chi_target = chi0_wnr.target();
-  auto g_target = g_nr.target();
 
   t_calc.start();
-
-#pragma omp parallel for 
-  for (unsigned int idx = 0; idx < rmesh.size(); idx++) {
-    auto r = *std::next(rmesh.begin(), idx);
-
-    auto chi0_wn =
-      make_gf<prod<imfreq, imfreq>>({wmesh, nmesh}, chi_target);
-    auto g_pr_n = make_gf<imfreq>(nmesh, g_target);
-    auto g_mr_n = make_gf<imfreq>(nmesh, g_target);
-    
-#pragma omp critical
-    {
-      g_pr_n = g_nr[_, r];
-      g_mr_n = g_nr(_, -r);
-    }
-
-    for (auto w : wmesh)
-      for (auto n : nmesh) chi0_wn[w, n](a, b, c, d) << -beta * g_pr_n(n)(d, a) * g_mr_n(n + w)(b, c);
-
-#pragma omp critical
-    chi0_wnr[_, _, r] = chi0_wn;
-
-    // chi0r(iw, inu, r)(a, b, c, d) << -beta * gr(inu, r)(d, a) * gr(inu + iw,
-    // -r)(b, c);
-  }
+  std::vector<mesh::cyclat::mesh_point_t> arr;
+  for (auto const &r : rmesh) arr.push_back(r);
+  chi0_PH_bubble_r_loop(chi_rows_view(chi0_wnr, nw * nn), g_nr, arr, wn_indices(wmesh, nmesh));
   t_calc.stop();
 
   t_mpi_all_reduce.start();
@@ -246,6 +348,33 @@ chi_wnr_t chi0r_from_gr_PH_nompi(int nw, int nn, g_wr_cvt g_nr) {
   return chi0_wnr;
 }
   
+// ---
+
+chi_wnr_dist_t chi0r_from_gr_PH_distributed(int nw, int nn, g_wr_cvt g_nr) {
+
+  int nb = g_nr.target().shape()[0];
+  auto const &rmesh = std::get<1>(g_nr.mesh());
+
+  double beta = std::get<0>(g_nr.mesh()).beta();
+
+  auto wmesh = mesh::imfreq{beta, Boson, nw};
+  auto nmesh = mesh::imfreq{beta, Fermion, nn};
+
+  chi_wnr_dist_t chi0_wnr({wmesh, nmesh, rmesh}, {nb, nb, nb, nb});
+
+  wn_idx_t wn_idx;
+  for (auto const &[w, n] : chi0_wnr.local_points()) wn_idx.emplace_back(w.index(), n.index());
+
+  std::vector<mesh::cyclat::mesh_point_t> arr;
+  for (auto const &r : rmesh) arr.push_back(r);
+
+  auto chi_dat = array_view<std::complex<double>, 6>(std::array<long, 6>{chi0_wnr.n_local_rows(), long(rmesh.size()), nb, nb, nb, nb},
+                                                     chi0_wnr.data().data());
+  chi0_PH_bubble_r_loop(chi_dat, g_nr, arr, wn_idx);
+
+  return chi0_wnr;
+}
+
 // ----------------------------------------------------
 
 // Helper function compiting chi0 for fixed bosonic frequency w and momentum q.
@@ -256,27 +385,14 @@ gf<imfreq, tensor_valued<4>> chi0_n_from_g_wk_PH(mesh::imfreq::mesh_point_t w, m
   int nb = g_wk.target().shape()[0];
   auto const &kmesh = std::get<1>(g_wk.mesh());
 
-  double beta = fmesh.beta();
-
   gf<imfreq, tensor_valued<4>> chi0_n{fmesh, {nb, nb, nb, nb}};
 
   // 100x times slower
   // chi0_n(inu)(a, b, c, d) << -beta/kmesh.size() * sum(g_wk(inu, k)(d, a) *
   // g_wk(inu + w, k - q)(b, c), k=kmesh);
 
-  for (auto n : fmesh) {
-    for (auto k : kmesh) {
-      auto g_da = g_wk[n.value(), k.index()];
-      auto g_bc = g_wk(n + w, k - q);
-      for (auto a : range(nb))
-        for (auto b : range(nb))
-          for (auto c : range(nb))
-            for (auto d : range(nb))
-              chi0_n[n](a, b, c, d) -= g_da(d, a) * g_bc(b, c);
-    }
-  }
-
-  chi0_n *= beta / kmesh.size();
+  auto kmq      = x_minus_q_index_table(kmesh, q.data_index());
+  chi0_n.data() = chi0_n_from_g_wk_data_PH(g_wk.data(), std::get<0>(g_wk.mesh()).first_index(), w.index(), kmq, fmesh);
 
   return chi0_n;
 }
@@ -302,11 +418,15 @@ gf<imfreq, tensor_valued<4>> chi0_n_from_e_k_sigma_w_PH(mesh::imfreq::mesh_point
 
   gf<imfreq, tensor_valued<4>> chi0_n{fmesh, {nb, nb, nb, nb}};
 
+  auto _   = all_t{};
+  auto kmq = x_minus_q_index_table(kmesh, q.data_index());
+
   for (auto k : kmesh) {
+    auto e_kmq = e_k.data()(kmq[k.data_index()], _, _);
     for (auto n : fmesh) {
 
       auto g_da = inverse((n + mu) * I - e_k[k] - sigma_w[matsubara_freq(n)]);
-      auto g_bc = inverse((n + mu) * I - e_k[k - q] - sigma_w[n + w]);
+      auto g_bc = inverse((std::complex<double>(n + w) + mu) * I - e_kmq - sigma_w[n + w]);
 
       for (auto a : range(nb))
         for (auto b : range(nb))
@@ -356,7 +476,7 @@ auto chi0_wnr =
 auto _ = all_t{};
 for (auto [w, n] : mpi_view(prod{bmesh, fmesh}))
   chi0_wnr[w, n, _] = fourier(chi0_wnk[w, n, _]);
-chi0_wnr = mpi::all_reduce(chi0_wnr);
+mpi_all_reduce_in_place(chi0_wnr);
 
 return chi0_wnr;
 }
@@ -397,11 +517,7 @@ chi_wnr_t chi0r_from_chi0q(chi_wnk_cvt chi_wnk) {
     chi_wnr[w, n, _] = chi_r;
   }
 
-  //chi_wnr = mpi::all_reduce(chi_wnr); // Incorrect results for large args!!
-
-  // Workaround.. :P
-  for (auto w : bmesh)
-    for (auto n : fmesh) chi_wnr[w, n, _] = mpi::all_reduce(chi_wnr[w, n, _]);
+  mpi_all_reduce_in_place(chi_wnr);
 
   return chi_wnr;
 }
@@ -419,7 +535,7 @@ auto chi0_wnk =
 auto _ = all_t{};
 for (auto [w, n] : mpi_view(prod{bmesh, fmesh}))
   chi0_wnk[w, n, _] = triqs::gfs::fourier(chi0_wnr[w, n, _]);
-chi0_wnk = mpi::all_reduce(chi0_wnk);
+mpi_all_reduce_in_place(chi0_wnk);
 
 return chi0_wnk;
 }
@@ -469,11 +585,7 @@ chi_wnk_t chi0q_from_chi0r(chi_wnr_cvt chi_wnr) {
   t_calc.stop();
   t_mpi_all_reduce.start();
 
-  //chi_wnk = mpi::all_reduce(chi_wnk); // Incorrect results for large args!!
-
-  // Workaround.. :P
-  for (auto w : bmesh)
-    for (auto n : fmesh) chi_wnk[w, n, _] = mpi::all_reduce(chi_wnk[w, n, _]);
+  mpi_all_reduce_in_place(chi_wnk);
 
   t_mpi_all_reduce.stop();
 
@@ -509,7 +621,51 @@ chi_wk_t chi0q_sum_nu(chi_wnk_cvt chi_wnk) {
 
   //chi_wk(iw, k) << sum(chi_wnk(iw, inu, k), inu = mesh) / (beta * beta);
 
-  chi_wk = mpi::all_reduce(chi_wk);
+  mpi_all_reduce_in_place(chi_wk);
+  return chi_wk;
+}
+
+chi_wnr_dist_t chi0r_from_chi0q(chi_wnk_dist_t const &chi_wnk) { return fourier_lattice_distributed<chi_wnr_t>(chi_wnk); }
+
+chi_wnk_dist_t chi0q_from_chi0r(chi_wnr_dist_t const &chi_wnr) { return fourier_lattice_distributed<chi_wnk_t>(chi_wnr); }
+
+chi_wk_dist_t chi0q_sum_nu(chi_wnk_dist_t const &chi_wnk) {
+
+  auto &wmesh = std::get<0>(chi_wnk.mesh());
+  auto &kmesh = std::get<2>(chi_wnk.mesh());
+  auto c      = chi_wnk.communicator();
+
+  double beta = wmesh.beta();
+
+  // Partial sums over the local fermionic frequencies, for the range of
+  // bosonic frequencies touched by the local (w, n) rows.
+  auto wn_arr = chi_wnk.local_points();
+  long row_size = chi_wnk.row_size();
+
+  std::vector<long> w_idx;
+  for (auto const &[w, n] : wn_arr) w_idx.push_back(w.data_index());
+
+  long w_first   = w_idx.empty() ? 0 : w_idx.front();
+  long n_w_local = w_idx.empty() ? 0 : w_idx.back() - w_first + 1;
+
+  array<std::complex<double>, 2> partial(n_w_local, row_size);
+  partial() = 0.;
+
+  auto chi_dat = array_const_view<std::complex<double>, 2>(std::array<long, 2>{chi_wnk.n_local_rows(), row_size}, chi_wnk.data().data());
+
+  // Threading over the row elements, to avoid races in the accumulation over n.
+#pragma omp parallel for
+  for (long j = 0; j < row_size; j++) {
+    for (long idx = 0; idx < long(w_idx.size()); idx++) {
+      partial(w_idx[idx] - w_first, j) += chi_dat(idx, j) / (beta * beta);
+    }
+  }
+
+  chi_wk_dist_t chi_wk({wmesh, kmesh}, chi_wnk.target_shape(), c);
+
+  auto chi_wk_dat = array_view<std::complex<double>, 2>(std::array<long, 2>{chi_wk.n_local_rows(), row_size}, chi_wk.data().data());
+  chi_wk_dat      = mpi_reduce_rows<std::complex<double>>(partial, w_first, wmesh.size(), c);
+
   return chi_wk;
 }
 
@@ -519,49 +675,36 @@ chi_wk_t chi0q_sum_nu_tail_corr_PH(chi_wnk_cvt chi_wnk) {
 
   auto _ = all_t{};
 
-  //auto &[wmesh, nmesh, qmesh] = chi_wnk.mesh();
   auto &wmesh = std::get<0>(chi_wnk.mesh());
   auto &nmesh = std::get<1>(chi_wnk.mesh());
   auto &qmesh = std::get<2>(chi_wnk.mesh());
 
   chi_wk_t chi_wk({wmesh, qmesh}, chi_wnk.target_shape());
+  chi_wk.data() = 0;
 
-  int nb = chi_wnk.target_shape()[0];
+  long nb = chi_wnk.target_shape()[0], nn = nmesh.size(), nw = wmesh.size(), nq = qmesh.size();
+  long n_cols = nb * nb * nb * nb;
   double beta = wmesh.beta();
 
-  auto chi_target = chi_wnk.target();
+  // The tail fit of the fermionic mesh is shared by all (w, q) points and components
+  batched_tail_fitter fitter(nmesh);
 
-  // for (auto w : wmesh) {
-  //  for (auto q : qmesh) {
+  // The (w, q) points are split over MPI ranks and OpenMP threads
+  mpi::communicator c;
+  auto slice = itertools::chunk_range(0, nw * nq, c.size(), c.rank());
 
-  auto arr = mpi_view(chi_wk.mesh()); // FIXME Use library implementation
 #pragma omp parallel for
-  for (unsigned int idx = 0; idx < arr.size(); idx++) {
-    auto &[w, q] = arr[idx];
-
-    auto chi = make_gf<imfreq>(nmesh, chi_target);
-    array<std::complex<double>, 4> dens(nb, nb, nb, nb);
+  for (long j = slice.first; j < slice.second; j++) {
+    long wi = j / nq, qi = j % nq;
 
-#pragma omp critical
-    chi = chi_wnk[w, _, q];
-
-    for (auto a : range(nb)) {
-      for (auto b : range(nb)) {
-        for (auto c : range(nb)) {
-          for (auto d : range(nb)) {
-            auto chi_abcd = slice_target_to_scalar(chi, a, b, c, d);
-            // chi0q_w[w, q](a, b, c, d) = density(chi_abcd) / beta;
-            dens(a, b, c, d) = density(chi_abcd) / beta;
-          }
-        }
-      }
-    }
+    array<std::complex<double>, 5> chi_n = chi_wnk.data()(wi, _, qi, _, _, _, _);
+    auto dens = fitter.density(array_const_view<std::complex<double>, 2>(std::array<long, 2>{nn, n_cols}, chi_n.data()));
 
-#pragma omp critical
-    chi_wk[w, q] = dens;
+    chi_wk.data()(wi, qi, _, _, _, _) = array_view<std::complex<double>, 4>(std::array<long, 4>{nb, nb, nb, nb}, dens.data());
+    chi_wk.data()(wi, qi, _, _, _, _) /= beta;
   }
 
-  chi_wk = mpi::all_reduce(chi_wk);
+  mpi_all_reduce_in_place(chi_wk);
   return chi_wk;
 }
 
@@ -630,26 +773,32 @@ chi_kwnn_t chiq_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_
 
   chi_kwnn_t chi_kwnn({mbz, mb, mf, mf}, chi0_wnk.target_shape());
 
+  // the vertex is reordered to the PH channel layout once per bosonic frequency
+  std::vector<g2_nn_channel<Channel_t::PH>> gamma_ch;
+  gamma_ch.reserve(mb.size());
+  for (auto w : mb) gamma_ch.emplace_back(gamma_ph_wnn[w, _, _]);
+
 #pragma omp parallel for
   for (unsigned int idx = 0; idx < mbz.size(); idx++) {
     auto k = *std::next(mbz.begin(), idx);
 
-    auto chi0 = make_gf<g2_nn_t::mesh_t>({mf, mf}, chi0_wnk.target());
-    auto I = identity<Channel_t::PH>(chi0);
+    g2_nn_channel<Channel_t::PH> chi0(mf, chi0_wnk.target_shape());
+    g2_nn_channel<Channel_t::PH> denom(mf, chi0_wnk.target_shape());
+    g2_nn_channel<Channel_t::PH> chi(mf, chi0_wnk.target_shape());
 
     for (auto w : mb) {
 
-      chi0 *= 0.;
-      for (auto n : mf) { chi0[n, n] = chi0_wnk[w, n, k]; }
+      for (long n = 0; n < long(mf.size()); n++) chi0.data()(n, n, _, _, _, _) = chi0_wnk.data()(w.data_index(), n, k.data_index(), _, _, _, _);
 
-      // this step could be optimized, using the diagonality of chi0 and I
-      auto denom = chi_nn_t{I - product<Channel_t::PH>(chi0, gamma_ph_wnn[w, _, _])};
+      // denom = I - chi0 * gamma
+      set_identity(denom);
+      product(chi0, gamma_ch[w.data_index()], denom, -1.0, 1.0);
 
-      // also the last product here
-      chi_nn_t chi = product<Channel_t::PH>(inverse<Channel_t::PH>(denom), chi0);
+      inverse_in_place(denom);
+      product(denom, chi0, chi);
 
 #pragma omp critical
-      chi_kwnn[k, w, _, _] = chi;
+      chi.copy_to(chi_kwnn[k, w, _, _]);
     }
   }
 
@@ -700,28 +849,30 @@ chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH(chi_wnk_cvt chi0_wnk, chi_
     // ----------------------------------------------------
     //t_chi0_nn.start();
 
-    chi_nn_t chi0_nn({fmesh, fmesh}, target_shape);
-    chi0_nn *= 0.;
-
-    for (auto n : fmesh) chi0_nn[n, n] = chi0_n[n];
+    g2_nn_channel<Channel_t::PH> chi0_nn(fmesh, target_shape);
+    for (long n = 0; n < long(fmesh.size()); n++) chi0_nn.data()(n, n, _, _, _, _) = chi0_n.data()(n, _, _, _, _);
 
     //t_chi0_nn.stop();
     //std::cout << "BSE: chi0_nn " << double(t_chi0_nn) << " s" << std::endl;
     // ----------------------------------------------------
     //t_bse.start();
 
-    auto I = identity<Channel_t::PH>(chi0_nn);
-
     chi_nn_t gamma_nn({fmesh, fmesh}, target_shape);
 
 #pragma omp critical
     gamma_nn = gamma_ph_wnn[w, _, _];
-    
-    // this step could be optimized, using the diagonality of chi0 and I
-    auto denom = chi_nn_t{I - product<Channel_t::PH>(chi0_nn, gamma_nn)};
 
-    // also the last product here
-    auto chi = chi_nn_t{product<Channel_t::PH>(inverse<Channel_t::PH>(denom), chi0_nn)};
+    auto gamma_ch = g2_nn_channel<Channel_t::PH>{gamma_nn};
+
+    // denom = I - chi0 * gamma, inverted in place
+    g2_nn_channel<Channel_t::PH> denom(fmesh, target_shape);
+    set_identity(denom);
+    product(chi0_nn, gamma_ch, denom, -1.0, 1.0);
+    inverse_in_place(denom);
+
+    // the vertex storage is reused for the result
+    product(denom, chi0_nn, gamma_ch);
+    auto chi = gamma_ch.to_gf();
 
     //t_bse.stop();
     //std::cout << "BSE: bse inv " << double(t_bse) << " s" << std::endl;
@@ -790,7 +941,7 @@ chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH(chi_wnk_cvt chi0_wnk, chi_
         
   }
 
-  chi_kw = mpi::all_reduce(chi_kw);
+  mpi_all_reduce_in_place(chi_kw);
 
   t.stop();
   if(comm.rank() == 0 )
@@ -800,370 +951,500 @@ chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH(chi_wnk_cvt chi0_wnk, chi_
 }
 
 // ----------------------------------------------------
-  
-chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn) {
-
-  auto _ = all_t{};
-
-  mpi::communicator c;
-  
-  auto target_shape = chi0_wnk.target_shape();
-  // auto &[bmesh, fmesh, kmesh] = chi0_wnk.mesh();
-  auto &bmesh = std::get<0>(chi0_wnk.mesh());
-  auto &fmesh = std::get<1>(chi0_wnk.mesh());
-  auto &kmesh = std::get<2>(chi0_wnk.mesh());
-
-  double beta = fmesh.beta();
 
-  chi_kw_t chi_kw({kmesh, bmesh}, target_shape);
+namespace {
 
-  auto arr = mpi_view(chi_kw.mesh()); // FIXME Use library implementation
-  std::cout << "BSE rank " << c.rank() << " of " << c.size() << " has "
-	    << arr.size() << " jobs." << std::endl;
+// PH grouped frequency blocks chi0_{nu, {a b}, {d c}} of the lattice bubble at one (w, k) point
 
-  triqs::utility::timer t;
-  t.start();
-  
-#pragma omp parallel for
-  for (unsigned int idx = 0; idx < arr.size(); idx++) {
-    auto &[k, w] = arr[idx];
+template <typename W, typename K> array<std::complex<double>, 3> bubble_blocks_PH(chi_wnk_cvt chi0_wnk, W const &w, K const &k) {
 
-    //triqs::utility::timer t_copy_1, t_chi0_nn, t_bse, t_chi_tr, t_copy_2;
+  auto _ = all_t{};
 
-    // ----------------------------------------------------
-    //t_copy_1.start();
+  long nb = chi0_wnk.target_shape()[0], m = nb * nb, nf = std::get<1>(chi0_wnk.mesh()).size();
 
-    chi_w_t chi0_n(fmesh, target_shape);
+  array<std::complex<double>, 5> chi0_n(nf, nb, nb, nb, nb);
 
-#pragma omp critical
-    chi0_n = chi0_wnk[w, _, k];
+  chi0_n = chi0_wnk.data()(w.data_index(), _, k.data_index(), _, _, _, _);
 
-    //t_copy_1.stop();
-    //std::cout << "BSE: copy_1 " << double(t_copy_1) << " s" << std::endl;
-    // ----------------------------------------------------
-    //t_chi0_nn.start();
+  array<std::complex<double>, 3> C(nf, m, m);
+  for (long n = 0; n < nf; n++)
+    for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb)) C(n, a * nb + b, d * nb + c) = chi0_n(n, a, b, c, d);
 
-    chi_nn_t chi0_nn({fmesh, fmesh}, target_shape);
-    chi0_nn *= 0.;
+  return C;
+}
 
-    for (auto n : fmesh) chi0_nn[n, n] = chi0_n[n];
+// Trace over the fermionic frequencies of the nb^2 PH grouped columns Y = chi S
 
-    //t_chi0_nn.stop();
-    //std::cout << "BSE: chi0_nn " << double(t_chi0_nn) << " s" << std::endl;
-    // ----------------------------------------------------
-    //t_bse.start();
+array<std::complex<double>, 4> trace_nu_PH(nda::matrix<std::complex<double>, F_layout> const &Y, long nb, long nf, double beta) {
 
-    auto I = identity<Channel_t::PH>(chi0_nn);
+  long m = nb * nb;
 
-    chi_nn_t gamma_nn({fmesh, fmesh}, target_shape);
+  array<std::complex<double>, 4> tr_chi(nb, nb, nb, nb);
+  tr_chi() = 0.0;
 
-#pragma omp critical
-    gamma_nn = gamma_ph_wnn[w, _, _];
-    
-    // this step could be optimized, using the diagonality of chi0 and I
-    auto denom = chi_nn_t{I - product<Channel_t::PH>(chi0_nn, gamma_nn)};
+  for (long n1 = 0; n1 < nf; n1++)
+    for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb)) tr_chi(a, b, c, d) += Y(n1 * m + a * nb + b, d * nb + c);
 
-    // also the last product here
-    auto chi = chi_nn_t{product<Channel_t::PH>(inverse<Channel_t::PH>(denom), chi0_nn)};
+  tr_chi /= beta * beta;
 
-    //t_bse.stop();
-    //std::cout << "BSE: bse inv " << double(t_bse) << " s" << std::endl;
-    // ----------------------------------------------------
-    //t_chi_tr.start();
+  return tr_chi;
+}
 
-    // trace out fermionic frequencies
-    array<std::complex<double>, 4> tr_chi(target_shape);
-    
-    tr_chi *= 0.0;
-    for (auto n1 : fmesh)
-      for (auto n2 : fmesh) tr_chi += chi[n1, n2];
+// The nb^2 PH grouped columns Y = [1 - chi0 Gamma]^{-1} chi0 S from the bubble blocks C and the
+// vertex gamma_nn (nu, nu', a, b, c, d) at one bosonic frequency
+//
+// By default 1 - chi0 Gamma is built block row by block row from C and gamma_nn and LU factorized.
+// With gmres (the "gmres" solver of set_bse_solver, read once by the caller) the columns are solved
+// iteratively with a bse_kernel, starting from guess, and the solution is returned in guess. The
+// kernel works on the storage of gamma_nn as the vertex matrix with rows {nu, a, b} and columns
+// {nu', c, d}, so the vertex of one bosonic frequency is shared by all k-points and never copied.
+// A product with the kernel is O(N^2), N = nf nb^2, so the iterative solver only pays off when it
+// converges in much fewer than N steps.
 
-    tr_chi /= beta * beta;
+nda::matrix<std::complex<double>, F_layout> bse_PH_columns(array<std::complex<double>, 3> C, array_const_view<std::complex<double>, 6> gamma_nn, bool gmres,
+                                                           nda::matrix<std::complex<double>, F_layout> &guess) {
 
-    //t_chi_tr.stop();
-    //std::cout << "BSE: chi tr " << double(t_chi_tr) << " s" << std::endl;
-    // ----------------------------------------------------
-    //t_copy_2.start();
-
-#pragma omp critical
-    chi_kw[k, w] = tr_chi;
-
-    //t_copy_2.stop();
-    //std::cout << "BSE: copy_2 " << double(t_copy_2) << " s" << std::endl;
-    // ----------------------------------------------------
+  auto _ = all_t{};
 
-    if(c.rank() == 0 && omp_get_thread_num() == 0) {
+  long nf = C.shape()[0], m = C.shape()[1], nb = gamma_nn.shape()[2], N = nf * m;
+
+  // The right hand side chi0 S
+  nda::matrix<std::complex<double>, F_layout> Y(N, m);
+  Y() = 0;
+  for (long n1 = 0; n1 < nf; n1++)
+    for (long x = 0; x < m; x++)
+      for (long y = 0; y < m; y++) Y(n1 * m + x, y) = C(n1, x, y);
+
+  if (gmres) {
+    // The columns {nu', d, c} of the vertex are the columns {nu', c, d} of its storage. With P the
+    // swap of the row orbital pair, P (1 - C Gamma) P = 1 - (P C) Gamma_storage, so the equation is
+    // solved for P Y with the rows of the bubble blocks swapped.
+    auto swap_pair = [nb](long x) { return (x % nb) * nb + x / nb; };
+    auto swap_rows = [&](auto &M) {
+      auto M_in = nda::matrix<std::complex<double>, F_layout>(M);
+      for (long n1 = 0; n1 < nf; n1++)
+        for (long x = 0; x < m; x++) M(n1 * m + swap_pair(x), _) = M_in(n1 * m + x, _);
+    };
+
+    array<std::complex<double>, 3> PC(nf, m, m);
+    for (long n1 = 0; n1 < nf; n1++)
+      for (long x = 0; x < m; x++) PC(n1, swap_pair(x), _) = C(n1, x, _);
+
+    nda::matrix<std::complex<double>> G_copy;
+    bool view = gamma_nn.indexmap().is_contiguous() && gamma_nn.indexmap().is_stride_order_C();
+    if (!view) {
+      G_copy.resize(N, N);
+      for (long n1 = 0; n1 < nf; n1++)
+        for (long n2 = 0; n2 < nf; n2++)
+          for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb)) G_copy(n1 * m + a * nb + b, n2 * m + c * nb + d) = gamma_nn(n1, n2, a, b, c, d);
+    }
+    auto G = view ? nda::matrix_const_view<std::complex<double>>(std::array<long, 2>{N, N}, gamma_nn.data()) :
+                    nda::matrix_const_view<std::complex<double>>(G_copy);
+
+    bse_kernel A(std::move(PC), G);
+
+    swap_rows(Y);
+    bool warm = (guess.shape() == Y.shape());
+    if (warm) swap_rows(guess);
+
+    nda::matrix<std::complex<double>, F_layout> X(N, m);
+    bool solved = true;
+    for (long y = 0; y < m && solved; y++) {
+      nda::vector<std::complex<double>> b = Y(_, y), x = b;
+      if (warm)
+        x = guess(_, y);
+      else
+        A.precondition(x);
+      solved  = bse_gmres(A, b, x);
+      X(_, y) = x;
+    }
 
-      int Nomp = omp_get_num_threads();
-      int N = int(floor(arr.size() / double(Nomp)));
-      
-      //double t_left = double(t) * ( N / (idx + 1) - 1. );
-      int done_percent = (N == 0) ? 100 : int(floor(100 * double(idx + 1) / N));
-      
-      std::cout << "BSE " << triqs::utility::timestamp() << " "
-		<< std::setfill(' ') << std::setw(3) << done_percent << "% "
-		<< "ETA " << triqs::utility::estimate_time_left(N, idx, t)
-		<< " job no "
-		<< std::setfill(' ') << std::setw(5) << int(idx)
-		<< " of approx " << N << " jobs/thread/rank." << std::endl;
+    // Points where GMRES does not converge are solved densely
+    if (solved) {
+      Y = X;
+    } else {
+      auto denom = A.dense();
+      nda::vector<int> ipiv(N);
+      int info = nda::lapack::getrf(denom, ipiv);
+      if (info != 0) TRIQS_RUNTIME_ERROR << "BSE: singular kernel 1 - chi0 Gamma, getrf info = " << info;
+      nda::lapack::getrs(denom, Y, ipiv);
     }
-        
+
+    swap_rows(Y);
+    guess = Y;
+    return Y;
   }
 
-  chi_kw = mpi::all_reduce(chi_kw);
+  // Block row n1 of 1 - chi0 Gamma, chi0 is diagonal in frequency
+  nda::matrix<std::complex<double>, F_layout> denom(N, N);
+  for (long n1 = 0; n1 < nf; n1++)
+    for (long n2 = 0; n2 < nf; n2++)
+      for (auto [c, d] : itertools::product_range(nb, nb))
+        for (long x = 0; x < m; x++) {
+          std::complex<double> v = 0;
+          for (auto [e, f] : itertools::product_range(nb, nb)) v += C(n1, x, e * nb + f) * gamma_nn(n1, n2, e, f, c, d);
+          denom(n1 * m + x, n2 * m + d * nb + c) = -v;
+        }
+  for (long i = 0; i < N; i++) denom(i, i) += 1.;
 
-  t.stop();
-  if(c.rank() == 0 )
-    std::cout << "BSE TIME: " << double(t) << " s" << std::endl;
+  nda::vector<int> ipiv(N);
+  int info = nda::lapack::getrf(denom, ipiv);
+  if (info != 0) TRIQS_RUNTIME_ERROR << "BSE: singular kernel 1 - chi0 Gamma, getrf info = " << info;
+  nda::lapack::getrs(denom, Y, ipiv);
 
-  return chi_kw;
+  return Y;
 }
 
-// ----------------------------------------------------
-
-gf<prod<brzone, imfreq>, tensor_valued<4>>
-chiq_sum_nu_from_g_wk_and_gamma_PH(gk_iw_t g_wk, g2_iw_vt gamma_ph_wnn,
-                                   int tail_corr_nwf) {
+// Lattice BSE in the PH channel at one (w, k) point, traced over the fermionic frequencies
+//
+// With the PH grouped matrices {nu, a, b}, {nu', d, c} the traced susceptibility is
+//
+//   sum_{nu nu'} chi = S^T [1 - chi0 Gamma]^{-1} chi0 S
+//
+// where S sums over the fermionic frequencies. Since chi0 is diagonal in frequency
+// both 1 - chi0 Gamma and the right hand side chi0 S are built block by block, and
+// only the nb^2 columns Y = [1 - chi0 Gamma]^{-1} chi0 S are solved for with one LU
+// factorization, chi itself is never formed.
+//
+// With gmres (the "gmres" solver of set_bse_solver) the nb^2 columns are instead solved
+// iteratively, starting from guess, the solution at a neighbouring k-point. The
+// solution is returned in guess. Columns that do not converge are solved densely.
+
+template <typename W, typename K>
+array<std::complex<double>, 4> bse_sum_nu_PH_point(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn, W const &w, K const &k, bool gmres,
+                                                   nda::matrix<std::complex<double>, F_layout> &guess) {
 
   auto _ = all_t{};
 
-  auto target = gamma_ph_wnn.target();
-  auto const &kmesh = std::get<1>(g_wk.mesh());
-  auto const &bmesh = std::get<0>(gamma_ph_wnn.mesh());
-  auto const &fmesh = std::get<1>(gamma_ph_wnn.mesh());
-
-  double beta = fmesh.beta();
+  auto &fmesh = std::get<1>(chi0_wnk.mesh());
+  long nb = chi0_wnk.target_shape()[0], nf = fmesh.size();
 
-  auto chi_kw = make_gf<prod<brzone, imfreq>>(
-      {kmesh, bmesh}, target);
+  auto Y = bse_PH_columns(bubble_blocks_PH(chi0_wnk, w, k), gamma_ph_wnn.data()(w.data_index(), _, _, _, _, _, _), gmres, guess);
 
-  auto chi0_n = make_gf<imfreq>(fmesh, target);
-  auto chi0_nn = make_gf<g2_nn_t::mesh_t>({fmesh, fmesh}, target);
-  auto I = identity<Channel_t::PH>(chi0_nn);
+  return trace_nu_PH(Y, nb, nf, fmesh.beta());
+}
 
-  int nb = gamma_ph_wnn.target_shape()[0];
+// Lattice BSE at one (w, k) point with the low rank vertex, the nb^2 columns
+// [1 - chi0 P Q^dagger]^{-1} chi0 S are given by the Woodbury identity
 
-  mesh::imfreq fmesh_tail;
-  if (tail_corr_nwf > 0)
-    fmesh_tail = mesh::imfreq{beta, Fermion, tail_corr_nwf};
-  else
-    fmesh_tail = fmesh;
+template <typename W, typename K>
+array<std::complex<double>, 4> bse_sum_nu_PH_point(chi_wnk_cvt chi0_wnk, compressed_vertex_PH const &gamma, W const &w, K const &k) {
 
-  if (fmesh_tail.size() < fmesh.size())
-    TRIQS_RUNTIME_ERROR
-        << "BSE: tail size has to be larger than gamma fermi mesh.\n";
+  auto &fmesh = std::get<1>(chi0_wnk.mesh());
+  long nb = chi0_wnk.target_shape()[0], m = nb * nb, nf = fmesh.size();
 
-  array<std::complex<double>, 4> tr_chi(gamma_ph_wnn.target_shape());
-  array<std::complex<double>, 4> tr_chi0(gamma_ph_wnn.target_shape());
-  array<std::complex<double>, 4> tr_chi0_tail_corr(gamma_ph_wnn.target_shape());
+  nda::matrix<std::complex<double>, F_layout> S(nf * m, m);
+  S() = 0;
+  for (long n = 0; n < nf; n++)
+    for (long x = 0; x < m; x++) S(n * m + x, x) = 1.;
 
-  for (auto [k, w] : mpi::chunk(chi_kw.mesh())) {
+  auto Y = gamma.bse_solve(w.data_index(), bubble_blocks_PH(chi0_wnk, w, k), S);
 
-    triqs::utility::timer t_chi0_n, t_chi0_tr, t_bse_1, t_bse_2, t_bse_3;
+  return trace_nu_PH(Y, nb, nf, fmesh.beta());
+}
 
-    // ----------------------------------------------------
-    // Build the bare bubble at k, w
+// Lattice BSE at one (w, k) point with the low rank vertex, contracted with L_wn
+// on both sides as in scalar_product_PH
 
-    t_chi0_n.start();
-    std::cout << "BSE: chi0_n ";
+template <typename W, typename K>
+array<std::complex<double>, 4> bse_sum_nu_PH_point(chi_wnk_cvt chi0_wnk, compressed_vertex_PH const &gamma, chi_nn_cvt L_wn, W const &w,
+                                                   K const &k) {
 
-    auto chi0_n_tail = chi0_n_from_g_wk_PH(w, k, fmesh_tail, g_wk);
-    for (auto n : fmesh) chi0_n[n] = chi0_n_tail(n);
+  auto _ = all_t{};
 
-    std::cout << double(t_chi0_n) << " s\n";
+  long nb = chi0_wnk.target_shape()[0], m = nb * nb, nf = std::get<1>(chi0_wnk.mesh()).size();
 
-    // ----------------------------------------------------
-    // trace the bare bubble with and without tail corrections
+  array<std::complex<double>, 5> L_n(nf, nb, nb, nb, nb);
 
-    t_chi0_tr.start();
-    std::cout << "BSE: Tr[chi0_n] ";
+  L_n = L_wn.data()(w.data_index(), _, _, _, _, _);
 
-    // tr_chi0_tail_corr(a, b, c, d) << density(slice_target_to_scalar(chi0_n,
-    // a, b, c, d)) / beta; // does not compile
+  // Right vector R_{{nu a b}, {c d}} = L(nu, a, b, c, d)
+  nda::matrix<std::complex<double>, F_layout> R(nf * m, m);
+  for (long n = 0; n < nf; n++)
+    for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb)) R(n * m + a * nb + b, c * nb + d) = L_n(n, a, b, c, d);
 
-    for (auto a : range(nb)) {
-      for (auto b : range(nb)) {
-        for (auto c : range(nb)) {
-          for (auto d : range(nb)) {
-            tr_chi0_tail_corr(a, b, c, d) =
-                density(slice_target_to_scalar(chi0_n_tail, a, b, c, d)) / beta;
-          }
-        }
-      }
-    }
+  auto Y = gamma.bse_solve(w.data_index(), bubble_blocks_PH(chi0_wnk, w, k), R);
 
-    tr_chi0(a, b, c, d) << sum(chi0_n(inu)(a, b, c, d), inu = fmesh) /
-                               (beta * beta);
+  // Left contraction, tr(p, q, r, s) = sum L(nu, a, b, q, p) Y_{{nu a b}, {r s}}
+  array<std::complex<double>, 4> tr_chi(nb, nb, nb, nb);
+  tr_chi() = 0.0;
 
-    std::cout << double(t_chi0_tr) << " s\n";
+  for (long n = 0; n < nf; n++)
+    for (auto [a, b, p, q] : itertools::product_range(nb, nb, nb, nb))
+      for (auto [r, s] : itertools::product_range(nb, nb)) tr_chi(p, q, r, s) += L_n(n, a, b, q, p) * Y(n * m + a * nb + b, r * nb + s);
 
-    // ----------------------------------------------------
-    // Make two frequency object
+  return tr_chi;
+}
 
-    t_bse_1.start();
-    std::cout << "BSE: chi0_nn ";
+// Loop over the (k, w) points of the traced lattice BSE, distributed over MPI ranks and
+// OpenMP threads. Each thread keeps the solution at its previous k-point for every
+// bosonic frequency, passed to point(w, k, guess) as the initial guess.
 
-    for (auto n : fmesh) chi0_nn[n, n] = chi0_n[n];
+template <typename F> chi_kw_t bse_sum_nu_kw_loop(chi_wnk_cvt chi0_wnk, F &&point) {
 
-    std::cout << double(t_bse_1) << " s\n";
+  mpi::communicator c;
+  
+  auto target_shape = chi0_wnk.target_shape();
+  auto &bmesh = std::get<0>(chi0_wnk.mesh());
+  auto &kmesh = std::get<2>(chi0_wnk.mesh());
 
-    // ----------------------------------------------------
+  chi_kw_t chi_kw({kmesh, bmesh}, target_shape);
 
-    t_bse_2.start();
-    std::cout << "BSE: I - chi0 * gamma ";
+  auto arr = mpi_view(chi_kw.mesh()); // FIXME Use library implementation
+  std::cout << "BSE rank " << c.rank() << " of " << c.size() << " has "
+	    << arr.size() << " jobs." << std::endl;
 
-    auto denom = g2_nn_t{I - product<Channel_t::PH>(chi0_nn, gamma_ph_wnn[w, _, _])};
+  triqs::utility::timer t;
+  t.start();
+  
+#pragma omp parallel
+  {
+    std::vector<nda::matrix<std::complex<double>, F_layout>> guess(bmesh.size());
 
-    std::cout << double(t_bse_2) << " s\n";
+#pragma omp for schedule(static)
+    for (unsigned int idx = 0; idx < arr.size(); idx++) {
+      auto &[k, w] = arr[idx];
 
-    t_bse_3.start();
-    std::cout << "BSE: chi = [I - chi0 * gamma]^{-1} chi0 ";
+      auto tr_chi = point(w, k, guess[w.data_index()]);
 
-    auto chi_nn = g2_nn_t{product<Channel_t::PH>(inverse<Channel_t::PH>(denom), chi0_nn)};
+      chi_kw[k, w] = tr_chi;
 
-    std::cout << double(t_bse_3) << " s\n";
+      if(c.rank() == 0 && omp_get_thread_num() == 0) {
 
-    // trace out fermionic frequencies
-    std::cout << "BSE: Tr[chi] \n";
-    tr_chi *= 0.0;
-    for (auto [n1, n2] : chi_nn.mesh()) tr_chi += chi_nn[n1, n2];
-    tr_chi /= beta * beta;
+        int Nomp = omp_get_num_threads();
+        int N = int(floor(arr.size() / double(Nomp)));
 
-    // 0th order high frequency correction using the bare bubble chi0
-    tr_chi += tr_chi0_tail_corr - tr_chi0;
+        int done_percent = (N == 0) ? 100 : int(floor(100 * double(idx + 1) / N));
 
-    chi_kw[k, w] = tr_chi;
+        std::cout << "BSE " << triqs::utility::timestamp() << " "
+		  << std::setfill(' ') << std::setw(3) << done_percent << "% "
+		  << "ETA " << triqs::utility::estimate_time_left(N, idx, t)
+		  << " job no "
+		  << std::setfill(' ') << std::setw(5) << int(idx)
+		  << " of approx " << N << " jobs/thread/rank." << std::endl;
+      }
+    }
   }
 
-  chi_kw = mpi::all_reduce(chi_kw);
+  mpi_all_reduce_in_place(chi_kw);
+
+  t.stop();
+  if(c.rank() == 0 )
+    std::cout << "BSE TIME: " << double(t) << " s" << std::endl;
 
   return chi_kw;
 }
 
-gf<prod<brzone, imfreq>, tensor_valued<4>>
-chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH(double mu, ek_vt e_k, g_iw_vt sigma_w,
-                                          g2_iw_vt gamma_ph_wnn,
-                                          int tail_corr_nwf) {
+void check_compressed_vertex_meshes(chi_wnk_cvt chi0_wnk, compressed_vertex_PH const &gamma) {
+  if (gamma.wmesh() != std::get<0>(chi0_wnk.mesh()) || gamma.fmesh() != std::get<1>(chi0_wnk.mesh()))
+    TRIQS_RUNTIME_ERROR << "chiq_sum_nu_from_chi0q_and_gamma_PH: the frequency meshes of the bubble and the compressed vertex do not match.";
+}
+
+// Traced lattice BSE with the bubble computed at every (k, w) point
+//
+// The bubble is computed with bubble(w_idx, kmq, fmesh_tail) on the (larger) fermionic mesh with
+// tail_corr_nwf frequencies, and the difference between its trace and the trace on the vertex mesh
+// is added as a 0th order high frequency correction. The (k, w) points are distributed over MPI
+// ranks and OpenMP threads, and with a checkpoint prefix the solved points are written to
+// resumable checkpoint files.
+
+template <typename Bubble>
+chi_kw_t bse_sum_nu_from_bubble_PH(mesh::brzone const &kmesh, chi_wnn_cvt gamma_ph_wnn, int tail_corr_nwf, std::string const &checkpoint,
+                                   Bubble const &bubble) {
 
   auto _ = all_t{};
 
-  auto target = gamma_ph_wnn.target();
-  // auto [fmesh_large, kmesh] = g_wk.mesh();
+  mpi::communicator c;
 
-  auto const &kmesh                  = e_k.mesh();
-  auto const &[bmesh, fmesh, f2mesh] = gamma_ph_wnn.mesh();
+  auto const &bmesh = std::get<0>(gamma_ph_wnn.mesh());
+  auto const &fmesh = std::get<1>(gamma_ph_wnn.mesh());
 
   double beta = fmesh.beta();
+  long nb = gamma_ph_wnn.target_shape()[0], nf = fmesh.size(), n_w = bmesh.size();
+
+  long n_tail = (tail_corr_nwf > 0) ? tail_corr_nwf : fmesh.size() / 2;
+  if (2 * n_tail < nf) TRIQS_RUNTIME_ERROR << "BSE: tail size has to be larger than gamma fermi mesh.\n";
+
+  chi_kw_t chi_kw({kmesh, bmesh}, gamma_ph_wnn.target_shape());
+  chi_kw.data() = 0;
+
+  // Points restored from the checkpoint are added by the first rank only
+  auto k_dims = kmesh.dims();
+  bse_checkpoint chk(checkpoint, kmesh.size() * n_w, nb, beta, {k_dims[0], k_dims[1], k_dims[2], n_w, nf, n_tail}, 60.0, c);
+  auto points = chk.remaining();
+  if (chk.enabled() && c.rank() == 0)
+    for (long p = 0; p < long(kmesh.size() * n_w); p++)
+      if (chk.done(p)) chi_kw.data()(p / n_w, p % n_w, _, _, _, _) = chk.value(p);
+
+  auto [j0, j1] = itertools::chunk_range(0, long(points.size()), c.size(), c.rank());
+  std::cout << "BSE rank " << c.rank() << " of " << c.size() << " has " << j1 - j0 << " jobs, "
+            << kmesh.size() * n_w - points.size() << " points restored from checkpoint." << std::endl;
+
+  bool gmres = (get_bse_solver() == "gmres");
+
+  // The tail fit is shared by all threads and applied to all components at once
+  mesh::imfreq fmesh_tail{beta, Fermion, n_tail};
+  long offset = fmesh.first_index() - fmesh_tail.first_index();
+  batched_tail_fitter tail_fitter(fmesh_tail);
+
+#pragma omp parallel
+  {
+    std::vector<nda::matrix<std::complex<double>, F_layout>> guess(n_w);
+    long q_prev = -1;
+    std::vector<long> kmq;
+
+#pragma omp for schedule(static)
+    for (long j = j0; j < j1; j++) {
+      long p = points[j], q = p / n_w, wi = p % n_w;
+
+      // The k - q table is shared by all w at q
+      if (q != q_prev) {
+        kmq    = x_minus_q_index_table(kmesh, q);
+        q_prev = q;
+      }
 
-  auto chi_kw = make_gf<prod<brzone, imfreq>>(
-      {kmesh, bmesh}, target);
+      long w_idx  = bmesh.first_index() + wi;
+      auto chi0_n = bubble(w_idx, kmq, fmesh_tail);
 
-  auto chi0_n = make_gf<imfreq>(fmesh, target);
-  auto chi0_nn = make_gf<g2_nn_t::mesh_t>({fmesh, fmesh}, target);
-  auto I = identity<Channel_t::PH>(chi0_nn);
+      // Trace of the bare bubble with and without tail corrections
+      auto dens = tail_fitter.density(array_const_view<std::complex<double>, 2>(std::array<long, 2>{long(fmesh_tail.size()), nb * nb * nb * nb}, chi0_n.data()));
+      array<std::complex<double>, 4> tr_chi0_tail_corr = array_view<std::complex<double>, 4>(std::array<long, 4>{nb, nb, nb, nb}, dens.data());
+      tr_chi0_tail_corr /= beta;
 
-  int nb = gamma_ph_wnn.target_shape()[0];
+      array<std::complex<double>, 4> tr_chi0(nb, nb, nb, nb);
+      tr_chi0() = 0;
+      for (long n = 0; n < nf; n++) tr_chi0 += chi0_n(offset + n, _, _, _, _);
+      tr_chi0 /= beta * beta;
 
-  mesh::imfreq fmesh_tail;
-  if (tail_corr_nwf > 0)
-    fmesh_tail = mesh::imfreq{beta, Fermion, tail_corr_nwf};
-  else
-    fmesh_tail = fmesh;
+      // PH grouped bubble blocks on the vertex mesh
+      array<std::complex<double>, 3> C(nf, nb * nb, nb * nb);
+      for (long n = 0; n < nf; n++)
+        for (auto [a, b, c_, d] : itertools::product_range(nb, nb, nb, nb)) C(n, a * nb + b, d * nb + c_) = chi0_n(offset + n, a, b, c_, d);
 
-  if (fmesh_tail.size() < fmesh.size())
-    TRIQS_RUNTIME_ERROR
-        << "BSE: tail size has to be larger than gamma fermi mesh.\n";
+      auto Y = bse_PH_columns(std::move(C), gamma_ph_wnn.data()(wi, _, _, _, _, _, _), gmres, guess[wi]);
 
-  array<std::complex<double>, 4> tr_chi(gamma_ph_wnn.target_shape());
-  array<std::complex<double>, 4> tr_chi0(gamma_ph_wnn.target_shape());
-  array<std::complex<double>, 4> tr_chi0_tail_corr(gamma_ph_wnn.target_shape());
+      array<std::complex<double>, 4> tr_chi = trace_nu_PH(Y, nb, nf, beta) + tr_chi0_tail_corr - tr_chi0;
 
-  for (auto [k, w] : mpi_view(chi_kw.mesh())) {
+      chi_kw.data()(q, wi, _, _, _, _) = tr_chi;
+      chk.store(p, tr_chi);
+    }
+  }
 
-    triqs::utility::timer t_chi0_n, t_chi0_tr, t_bse_1, t_bse_2, t_bse_3;
+  chk.flush();
+  mpi_all_reduce_in_place(chi_kw);
 
-    // ----------------------------------------------------
-    // Build the bare bubble at k, w
+  return chi_kw;
+}
 
-    t_chi0_n.start();
-    std::cout << "BSE: chi0_n ";
+chi_kw_t bse_sum_nu_from_g_wk_PH(g_wk_cvt g_wk, chi_wnn_cvt gamma_ph_wnn, int tail_corr_nwf, std::string const &checkpoint) {
+  auto g_dat       = g_wk.data();
+  long g_first_idx = std::get<0>(g_wk.mesh()).first_index();
+  return bse_sum_nu_from_bubble_PH(std::get<1>(g_wk.mesh()), gamma_ph_wnn, tail_corr_nwf, checkpoint,
+                                   [&](long w_idx, std::vector<long> const &kmq, mesh::imfreq const &fmesh) {
+                                     return chi0_n_from_g_wk_data_PH(g_dat, g_first_idx, w_idx, kmq, fmesh);
+                                   });
+}
 
-    // auto chi0_n_tail = chi0_n_from_g_wk_PH(w, k, fmesh_tail, g_wk);
+} // namespace
 
-    auto chi0_n_tail =
-        chi0_n_from_e_k_sigma_w_PH(w, k, fmesh_tail, mu, e_k, sigma_w);
+chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn) {
+  bool gmres = (get_bse_solver() == "gmres");
+  return bse_sum_nu_kw_loop(chi0_wnk, [&](auto const &w, auto const &k, auto &guess) {
+    return bse_sum_nu_PH_point(chi0_wnk, gamma_ph_wnn, w, k, gmres, guess);
+  });
+}
 
-    for (auto n : fmesh) chi0_n[n] = chi0_n_tail(n);
+chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, compressed_vertex_PH const &gamma) {
+  check_compressed_vertex_meshes(chi0_wnk, gamma);
+  return bse_sum_nu_kw_loop(chi0_wnk, [&](auto const &w, auto const &k, auto &) { return bse_sum_nu_PH_point(chi0_wnk, gamma, w, k); });
+}
 
-    std::cout << double(t_chi0_n) << " s\n";
+chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH(chi_wnk_cvt chi0_wnk, compressed_vertex_PH const &gamma, chi_nn_cvt L_wn) {
+  check_compressed_vertex_meshes(chi0_wnk, gamma);
+  return bse_sum_nu_kw_loop(chi0_wnk, [&](auto const &w, auto const &k, auto &) { return bse_sum_nu_PH_point(chi0_wnk, gamma, L_wn, w, k); });
+}
 
-    // ----------------------------------------------------
-    // trace the bare bubble with and without tail corrections
+// ----------------------------------------------------
 
-    t_chi0_tr.start();
-    std::cout << "BSE: Tr[chi0_n] ";
+chi_wk_ibz_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn,
+                                                 std::shared_ptr<ibz_map const> ibz) {
 
-    // tr_chi0_tail_corr(a, b, c, d) << density(slice_target_to_scalar(chi0_n,
-    // a, b, c, d)) / beta; // does not compile
+  auto _ = all_t{};
 
-    for (auto a : range(nb)) {
-      for (auto b : range(nb)) {
-        for (auto c : range(nb)) {
-          for (auto d : range(nb)) {
-            tr_chi0_tail_corr(a, b, c, d) =
-                density(slice_target_to_scalar(chi0_n_tail, a, b, c, d)) / beta;
-          }
-        }
-      }
-    }
+  mpi::communicator c;
 
-    tr_chi0(a, b, c, d) << sum(chi0_n(inu)(a, b, c, d), inu = fmesh) /
-                               (beta * beta);
+  auto &bmesh = std::get<0>(chi0_wnk.mesh());
+  auto &kmesh = std::get<2>(chi0_wnk.mesh());
 
-    std::cout << double(t_chi0_tr) << " s\n";
+  if (kmesh != ibz->mesh())
+    TRIQS_RUNTIME_ERROR << "chiq_sum_nu_from_chi0q_and_gamma_PH: the k-mesh does not match the irreducible zone map.";
 
-    // ----------------------------------------------------
-    // Make two frequency object
+  auto ts = chi0_wnk.target_shape();
+  chi_wk_ibz_t chi_wk({bmesh, kmesh}, ibz, {ts[0], ts[1], ts[2], ts[3]});
 
-    t_bse_1.start();
-    std::cout << "BSE: chi0_nn ";
+  // Only the irreducible k-points are solved, the (w, i) pairs are split over ranks
+  long n_w = bmesh.size(), n_irr = ibz->n_irr();
+  auto [j0, j1] = itertools::chunk_range(0, n_w * n_irr, c.size(), c.rank());
 
-    for (auto n : fmesh) chi0_nn[n, n] = chi0_n[n];
+  bool gmres = (get_bse_solver() == "gmres");
 
-    std::cout << double(t_bse_1) << " s\n";
+#pragma omp parallel
+  {
+    // Solutions at the previous irreducible k-point of this thread, one per bosonic frequency
+    std::vector<nda::matrix<std::complex<double>, F_layout>> guess(n_w);
 
-    // ----------------------------------------------------
+#pragma omp for schedule(static)
+    for (long j = j0; j < j1; j++) {
+      long wi = j / n_irr, i = j % n_irr;
 
-    t_bse_2.start();
-    std::cout << "BSE: I - chi0 * gamma ";
+      auto w = *std::next(bmesh.begin(), wi);
+      auto k = *std::next(kmesh.begin(), ibz->irr_k(i));
 
-    auto denom = g2_nn_t{I - product<Channel_t::PH>(chi0_nn, gamma_ph_wnn[w, _, _])};
+      chi_wk.data()(wi, i, _) = bse_sum_nu_PH_point(chi0_wnk, gamma_ph_wnn, w, k, gmres, guess[wi]);
+    }
+  }
 
-    std::cout << double(t_bse_2) << " s\n";
+  mpi_all_reduce_in_place(chi_wk.data().data(), chi_wk.data().size(), c);
 
-    t_bse_3.start();
-    std::cout << "BSE: chi = [I - chi0 * gamma]^{-1} chi0 ";
+  return chi_wk;
+}
 
-    g2_nn_t chi_nn =
-        product<Channel_t::PH>(inverse<Channel_t::PH>(denom), chi0_nn);
+chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn, std::vector<nda::matrix<long>> const &rotations,
+                                             std::vector<nda::matrix<std::complex<double>>> const &orbital_reps) {
 
-    std::cout << double(t_bse_3) << " s\n";
+  auto &bmesh = std::get<0>(chi0_wnk.mesh());
+  auto &kmesh = std::get<2>(chi0_wnk.mesh());
 
-    // trace out fermionic frequencies
-    std::cout << "BSE: Tr[chi] \n";
-    tr_chi *= 0.0;
-    for (auto [n1, n2] : chi_nn.mesh()) tr_chi += chi_nn[n1, n2];
-    tr_chi /= beta * beta;
+  auto ibz    = std::make_shared<ibz_map const>(kmesh, rotations, orbital_reps);
+  auto chi_wk = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, gamma_ph_wnn, ibz).unfold();
 
-    // 0th order high frequency correction using the bare bubble chi0
-    tr_chi += tr_chi0_tail_corr - tr_chi0;
+  chi_kw_t chi_kw({kmesh, bmesh}, chi0_wnk.target_shape());
+  for (auto [k, w] : chi_kw.mesh()) chi_kw[k, w] = chi_wk[w, k];
 
-    chi_kw[k, w] = tr_chi;
-  }
+  return chi_kw;
+}
 
-  chi_kw = mpi::all_reduce(chi_kw);
+// ----------------------------------------------------
 
-  return chi_kw;
+gf<prod<brzone, imfreq>, tensor_valued<4>>
+chiq_sum_nu_from_g_wk_and_gamma_PH(gk_iw_t g_wk, g2_iw_vt gamma_ph_wnn,
+                                   int tail_corr_nwf, std::string checkpoint) {
+  return bse_sum_nu_from_g_wk_PH(g_wk, gamma_ph_wnn, tail_corr_nwf, checkpoint);
+}
+
+gf<prod<brzone, imfreq>, tensor_valued<4>>
+chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH(double mu, ek_vt e_k, g_iw_vt sigma_w,
+                                          g2_iw_vt gamma_ph_wnn,
+                                          int tail_corr_nwf, std::string checkpoint) {
+
+  // The lattice Green's function is computed on the fly at every (k, w) point, it is never stored
+  auto e_dat           = e_k.data();
+  auto sigma_dat       = sigma_w.data();
+  long sigma_first_idx = sigma_w.mesh().first_index();
+  return bse_sum_nu_from_bubble_PH(e_k.mesh(), gamma_ph_wnn, tail_corr_nwf, checkpoint,
+                                   [&](long w_idx, std::vector<long> const &kmq, mesh::imfreq const &fmesh) {
+                                     return chi0_n_from_e_k_sigma_w_data_PH(mu, e_dat, sigma_dat, sigma_first_idx, w_idx, kmq, fmesh);
+                                   });
 }
 
 gf<prod<brzone, imfreq>, tensor_valued<4>>
@@ -1229,7 +1510,7 @@ chi_wk_t attatch_tri_vert(chi_nn_cvt L_wn, chi_kwnn_cvt chi_kwnn) {
     chi_wk[w, k] = scalar_product_PH(L_wn[w, _], chi_kwnn[k, w, _, _], L_wn[w, _]);
   }
 
-  chi_wk = mpi::all_reduce(chi_wk);
+  mpi_all_reduce_in_place(chi_wk);
 
   return chi_wk;
 }
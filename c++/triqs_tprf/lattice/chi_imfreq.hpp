@@ -23,6 +23,9 @@
 #pragma once
 
 #include "../types.hpp"
+#include "../distributed_gf.hpp"
+#include "ibz.hpp"
+#include "compressed_vertex.hpp"
 
 namespace triqs_tprf {
 
@@ -57,6 +60,18 @@ chi_nr_t chi0_nr_from_gr_PH_at_specific_w(int nw_index, int nn, g_wr_cvt g_nr);
  */
 chi_wnr_t chi0r_from_gr_PH_nompi(int nw, int nn, g_wr_cvt g_nr);
 
+/** Generalized susceptibility bubble in the particle-hole channel, distributed over MPI ranks
+
+  Same as chi0r_from_gr_PH, but each rank only computes and stores the
+  (w, n) frequency pairs of its rows of the distributed result.
+
+  @param nw Number of bosonic Matsubara freqiencies.
+  @param nn Number of fermionic Matsubara freqiencies.
+  @param g_nr Real space fermionic Matsubara frequency Green's function :math:`G_{a\bar{b}}(i\nu_n, \mathbf{r})`.
+  @return Distributed generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{r})`.
+ */
+chi_wnr_dist_t chi0r_from_gr_PH_distributed(int nw, int nn, g_wr_cvt g_nr);
+
 /** Generalized susceptibility bubble in the particle-hole channel :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{q})` with convolution in k-space.
 
   Computes
@@ -87,6 +102,7 @@ chi_wnk_t chi0q_from_g_wk_PH(int nw, int nn, g_wk_cvt g_wk);
   @return Generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{r})` in one bosonic and one fermionic Matsuabara frequency and real space.
  */
 chi_wnr_t chi0r_from_chi0q(chi_wnk_cvt chi_wnk);
+chi_wnr_dist_t chi0r_from_chi0q(chi_wnk_dist_t const &chi_wnk);
 
 /** Fourier transform of the generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{r})` in real space to :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{q})` in momentum space.
 
@@ -102,6 +118,7 @@ chi_wnr_t chi0r_from_chi0q(chi_wnk_cvt chi_wnk);
   @return Generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{q})` in one bosonic and one fermionic Matsuabara frequency and momentum space.
  */
 chi_wnk_t chi0q_from_chi0r(chi_wnr_cvt chi_wnr);
+chi_wnk_dist_t chi0q_from_chi0r(chi_wnr_dist_t const &chi_wnr);
 
 /** Sum over fermionic frequency in the generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`. (NB! without tail corrections)
 
@@ -116,6 +133,16 @@ chi_wnk_t chi0q_from_chi0r(chi_wnr_cvt chi_wnr);
  */
 chi_wk_t chi0q_sum_nu(chi_wnk_cvt chi_wnk);
 
+/** Sum over fermionic frequency of a distributed generalized susceptibility
+
+  The partial sums of the local (w, n) rows are reduced directly onto the
+  ranks owning the bosonic frequencies of the distributed result.
+
+  @param chi_wnk Distributed generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`
+  @return Distributed susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`
+ */
+chi_wk_dist_t chi0q_sum_nu(chi_wnk_dist_t const &chi_wnk);
+
 /** Sum over fermionic frequency in the generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})` using higher order tail corrections when summing to infinity.
 
   Computes
@@ -165,12 +192,54 @@ chi_kwnn_t chiq_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_
      \chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k}) =
      \chi^{(0)} \left[ 1 - \Gamma^{(PH)} \chi^{(0)} \right]^{-1}
 
+  The solver is selected with ``set_bse_solver``, for large fermionic frequency boxes
+  the iterative "gmres" solver avoids the dense factorization at every (w, k) point.
+
   @param chi0_wnk Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
   @param gamma_ph_wnn Local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
   @return Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
  */
 chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn);
 
+/** Lattice Bethe-Salpeter equation solver on the irreducible Brillouin zone
+
+  Solves the lattice Bethe-Salpeter equation summed over fermionic frequencies only at the
+  irreducible k-points of the point group, the full zone result is obtained with ``unfold``.
+  The local vertex :math:`\Gamma^{(PH)}` is assumed to be invariant under the orbital representations.
+
+  @param chi0_wnk Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`.
+  @param gamma_ph_wnn Local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+  @param ibz Irreducible Brillouin zone map of the k-mesh.
+  @return Lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})` at the irreducible k-points.
+ */
+chi_wk_ibz_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn,
+                                                 std::shared_ptr<ibz_map const> ibz);
+
+/** Lattice Bethe-Salpeter equation solver using the point group symmetry
+
+  Builds the irreducible Brillouin zone map of the k-mesh, solves the lattice Bethe-Salpeter
+  equation at the irreducible k-points only and returns the unfolded full zone result.
+
+  @param chi0_wnk Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`.
+  @param gamma_ph_wnn Local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+  @param rotations Point group rotations in reduced reciprocal coordinates, 3x3 integer matrices.
+  @param orbital_reps Orbital representations of the rotations, unitary matrices.
+  @return Lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
+ */
+chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn, std::vector<nda::matrix<long>> const &rotations,
+                                             std::vector<nda::matrix<std::complex<double>>> const &orbital_reps);
+
+/** Lattice Bethe-Salpeter equation solver with a low rank vertex
+
+  The per k-point solve is a rank r Woodbury update, where r is the rank of the
+  truncated singular value decomposition of the vertex, see ``compressed_vertex_PH``.
+
+  @param chi0_wnk Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`.
+  @param gamma Compressed local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+  @return Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
+ */
+chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, compressed_vertex_PH const &gamma);
+
 /** Dual lattice Bethe-Salpeter equation solver for the generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
 
   @param chi0_wnk Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
@@ -179,11 +248,55 @@ chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt g
   @return Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
  */
 chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH(chi_wnk_cvt chi0_wnk, chi_wnn_cvt gamma_ph_wnn, chi_nn_cvt L_wn);
+
+/** Dual lattice Bethe-Salpeter equation solver with a low rank vertex, see ``compressed_vertex_PH``.
+
+  @param chi0_wnk Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`.
+  @param gamma Compressed local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+  @param L_wn Local triangular particle-hole vertex function :math:`L^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu)`.
+  @return Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
+ */
+chi_kw_t chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH(chi_wnk_cvt chi0_wnk, compressed_vertex_PH const &gamma, chi_nn_cvt L_wn);
   
+/** Lattice Bethe-Salpeter equation solver with the bubble computed from the lattice Green's function
+
+  At every (k, w) point the bubble is computed on a fermionic mesh with tail_corr_nwf frequencies,
+  the lattice BSE is solved on the vertex mesh and the difference of the bubble traces on the two
+  meshes is added as a high frequency correction. The points are distributed over MPI ranks and
+  OpenMP threads.
+
+  With a checkpoint prefix every rank writes its solved points to ``<checkpoint>.rank<r>.h5``,
+  at most once a minute and at the end. A rerun with the same prefix only solves the missing points.
+
+  @param g_wk Lattice Green's function :math:`G_{ab}(i\nu, \mathbf{k})`.
+  @param gamma_ph_wnn Local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+  @param tail_corr_nwf Number of fermionic frequencies of the bubble tail correction, the vertex mesh if negative.
+  @param checkpoint File name prefix of the checkpoint files, no checkpointing if empty.
+  @return Lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\mathbf{k}, \omega)`.
+ */
 gf<prod<brzone, imfreq>, tensor_valued<4>>
-chiq_sum_nu_from_g_wk_and_gamma_PH(gk_iw_t g_wk, g2_iw_vt gamma_ph_wnn, int tail_corr_nwf=-1);
+chiq_sum_nu_from_g_wk_and_gamma_PH(gk_iw_t g_wk, g2_iw_vt gamma_ph_wnn, int tail_corr_nwf=-1, std::string checkpoint="");
 
-gf<prod<brzone, imfreq>, tensor_valued<4>> chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH(double mu, ek_vt e_k, g_iw_vt sigma_w, g2_iw_vt gamma_ph_wnn, int tail_corr_nwf=-1);
+/** Lattice Bethe-Salpeter equation solver with the bubble computed from the dispersion and a local self energy
+
+  Same as chiq_sum_nu_from_g_wk_and_gamma_PH, with the lattice Green's function computed from the
+  Dyson equation on the frequency mesh of sigma_w. It is evaluated on the fly at every (k, w) point
+  and never stored, so the memory use does not grow with the k-mesh times the frequency mesh.
+
+  The bubble is built from :math:`G(\nu, \mathbf{k})` and :math:`G(\nu + \omega, \mathbf{k} - \mathbf{q})`
+  with :math:`G(\nu, \mathbf{k}) = [(i\nu + \mu) - \epsilon(\mathbf{k}) - \Sigma(i\nu)]^{-1}`. Versions before
+  this one used :math:`i\nu` instead of :math:`i\nu + i\omega` in the second Green's function, results at
+  finite :math:`\omega` differ from those.
+
+  @param mu Chemical potential :math:`\mu`.
+  @param e_k Dispersion :math:`\epsilon_{ab}(\mathbf{k})`.
+  @param sigma_w Local self energy :math:`\Sigma_{ab}(i\nu)`.
+  @param gamma_ph_wnn Local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+  @param tail_corr_nwf Number of fermionic frequencies of the bubble tail correction, the vertex mesh if negative.
+  @param checkpoint File name prefix of the checkpoint files, no checkpointing if empty.
+  @return Lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\mathbf{k}, \omega)`.
+ */
+gf<prod<brzone, imfreq>, tensor_valued<4>> chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH(double mu, ek_vt e_k, g_iw_vt sigma_w, g2_iw_vt gamma_ph_wnn, int tail_corr_nwf=-1, std::string checkpoint="");
 
 gf<prod<brzone, imfreq>, tensor_valued<4>>
 chiq_sum_nu(chiq_t chiq);
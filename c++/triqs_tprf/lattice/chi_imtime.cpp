@@ -22,6 +22,7 @@
 #include "common.hpp"
 #include "../mpi.hpp"
 #include "chi_imtime.hpp"
+#include "mesh_index_tables.hpp"
 
 #include "../fourier/fourier.hpp"
 #include "fourier.hpp"
@@ -51,7 +52,8 @@ chi_Dtr_t chi0_tr_from_grt_PH(g_Dtr_cvt g_tr) {
   auto g_target = g_tr.target();
   auto chi_target = chi0_tr.target();
   
-  auto arr = mpi_view(rmesh);
+  auto arr     = mpi_view(rmesh);
+  auto minus_r = minus_x_index_table(rmesh);
 
 #pragma omp parallel for 
   for (unsigned int idx = 0; idx < arr.size(); idx++) {
@@ -64,7 +66,7 @@ chi_Dtr_t chi0_tr_from_grt_PH(g_Dtr_cvt g_tr) {
 #pragma omp critical
     {
       g_pr_t = g_tr[_, r];
-      g_mr_t = g_tr(_, -r);
+      g_mr_t.data() = g_tr.data()(_, minus_r[r.data_index()], _, _);
     }
 
     auto g_pr_c = make_gf_dlr(g_pr_t);
@@ -77,7 +79,7 @@ chi_Dtr_t chi0_tr_from_grt_PH(g_Dtr_cvt g_tr) {
     chi0_tr[_, r] = chi0_t;
   }
 
-  chi0_tr = mpi::all_reduce(chi0_tr);
+  mpi_all_reduce_in_place(chi0_tr);
 
   return chi0_tr;
 }
@@ -108,7 +110,8 @@ chi_tr_t chi0_tr_from_grt_PH(g_tr_cvt g_tr) {
 
   //for (auto r : rmesh) {
 
-  auto arr = mpi_view(rmesh);
+  auto arr     = mpi_view(rmesh);
+  auto minus_r = minus_x_index_table(rmesh);
 
 #pragma omp parallel for 
   for (unsigned int idx = 0; idx < arr.size(); idx++) {
@@ -121,7 +124,7 @@ chi_tr_t chi0_tr_from_grt_PH(g_tr_cvt g_tr) {
 #pragma omp critical
     {
       g_pr_t = g_tr[_, r];
-      g_mr_t = g_tr(_, -r);
+      g_mr_t.data() = g_tr.data()(_, minus_r[r.data_index()], _, _);
     }
 
     for (auto t : tmesh) chi0_t[t](a, b, c, d) << g_pr_t(t)(d, a) * g_mr_t(beta - t)(b, c);
@@ -130,7 +133,7 @@ chi_tr_t chi0_tr_from_grt_PH(g_tr_cvt g_tr) {
     chi0_tr[_, r] = chi0_t;
   }
 
-  chi0_tr = mpi::all_reduce(chi0_tr);
+  mpi_all_reduce_in_place(chi0_tr);
 
   return chi0_tr;
 }
@@ -152,7 +155,8 @@ chi_wr_t chi0_wr_from_grt_PH(g_tr_cvt g_tr, int nw=1) {
   auto g_target = g_tr.target();
   auto chi_target = chi0_wr.target();
   
-  auto arr = mpi_view(rmesh);
+  auto arr     = mpi_view(rmesh);
+  auto minus_r = minus_x_index_table(rmesh);
 
 #pragma omp parallel for 
   for (unsigned int idx = 0; idx < arr.size(); idx++) {
@@ -165,7 +169,7 @@ chi_wr_t chi0_wr_from_grt_PH(g_tr_cvt g_tr, int nw=1) {
 #pragma omp critical
     {
       g_pr_t = g_tr[_, r];
-      g_mr_t = g_tr(_, -r);
+      g_mr_t.data() = g_tr.data()(_, minus_r[r.data_index()], _, _);
     }
 
     for (auto t : tmesh) chi0_t[t](a, b, c, d) << g_pr_t(t)(d, a) * g_mr_t(beta - t)(b, c);
@@ -177,7 +181,7 @@ chi_wr_t chi0_wr_from_grt_PH(g_tr_cvt g_tr, int nw=1) {
     }
   }
 
-  chi0_wr = mpi::all_reduce(chi0_wr);
+  mpi_all_reduce_in_place(chi0_wr);
   return chi0_wr;
 }  
 
@@ -199,7 +203,8 @@ chi_wr_t chi0_w0r_from_grt_PH(g_tr_cvt g_tr) {
   auto g_target = g_tr.target();
   auto chi_target = chi0_wr.target();
   
-  auto arr = mpi_view(rmesh);
+  auto arr     = mpi_view(rmesh);
+  auto minus_r = minus_x_index_table(rmesh);
 
 #pragma omp parallel for 
   for (unsigned int idx = 0; idx < arr.size(); idx++) {
@@ -212,7 +217,7 @@ chi_wr_t chi0_w0r_from_grt_PH(g_tr_cvt g_tr) {
 #pragma omp critical
     {
       g_pr_t = g_tr[_, r];
-      g_mr_t = g_tr(_, -r);
+      g_mr_t.data() = g_tr.data()(_, minus_r[r.data_index()], _, _);
     }
 
     for (auto t : tmesh) chi0_t[t](a, b, c, d) << g_pr_t(t)(d, a) * g_mr_t(beta - t)(b, c);
@@ -223,7 +228,7 @@ chi_wr_t chi0_w0r_from_grt_PH(g_tr_cvt g_tr) {
     chi0_wr[0, r] = int_chi0;
   }
 
-  chi0_wr = mpi::all_reduce(chi0_wr);
+  mpi_all_reduce_in_place(chi0_wr);
   return chi0_wr;
 }  
 
@@ -272,7 +277,7 @@ chi_wr_t chi_w0r_from_chi_tr(chi_tr_cvt chi_tr) {
     chi_wr[0, r] = I;
   }
 
-  chi_wr = mpi::all_reduce(chi_wr);
+  mpi_all_reduce_in_place(chi_wr);
   return chi_wr;
 }
 
@@ -296,6 +301,16 @@ chi_wr_t chi_wr_from_chi_wk(chi_wk_cvt chi_wk) {
   return chi_wr;
 }
 
+chi_tr_t chi_tr_from_chi_wk(chi_wk_cvt chi_wk, int ntau) {
+  auto chi_tr = fourier_wk_to_tr_general_target(chi_wk, ntau);
+  return chi_tr;
+}
+
+chi_wk_t chi_wk_from_chi_tr(chi_tr_cvt chi_tr, int nw) {
+  auto chi_wk = fourier_tr_to_wk_general_target(chi_tr, nw);
+  return chi_wk;
+}
+
 // DLR
   
 chi_Dwr_t chi_wr_from_chi_tr(chi_Dtr_cvt chi_tr, int nw) {
@@ -317,6 +332,16 @@ chi_Dwr_t chi_wr_from_chi_wk(chi_Dwk_cvt chi_wk) {
   auto chi_wr = fourier_wk_to_wr_general_target(chi_wk);  
   return chi_wr;
 }
+
+// Distributed
+
+chi_wr_dist_t chi_wr_from_chi_tr(chi_tr_dist_t const &chi_tr, int nw) { return fourier_tr_to_wr_distributed<chi_wr_t>(chi_tr, nw); }
+
+chi_tr_dist_t chi_tr_from_chi_wr(chi_wr_dist_t const &chi_wr, int ntau) { return fourier_wr_to_tr_distributed<chi_tr_t>(chi_wr, ntau); }
+
+chi_wk_dist_t chi_wk_from_chi_wr(chi_wr_dist_t const &chi_wr) { return fourier_lattice_distributed<chi_wk_t>(chi_wr); }
+
+chi_wr_dist_t chi_wr_from_chi_wk(chi_wk_dist_t const &chi_wk) { return fourier_lattice_distributed<chi_wr_t>(chi_wk); }
   
 /*
 chi_wk_t chi_wk_from_chi_wr(chi_wr_cvt chi_wr) {
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "../types.hpp"
+#include "../distributed_gf.hpp"
 
 namespace triqs_tprf {
 
@@ -141,6 +142,42 @@ chi_Dwk_t chi_wk_from_chi_wr(chi_Dwr_cvt chi_wr);
 chi_wr_t chi_wr_from_chi_wk(chi_wk_cvt chi_wk);
 chi_Dwr_t chi_wr_from_chi_wk(chi_Dwk_cvt chi_wk);
 
+/** Fused Fourier transform from :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})` to :math:`\chi_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})`
+
+  Equivalent to chi_tr_from_chi_wr(chi_wr_from_chi_wk(chi_wk), ntau), but the
+  target components are transformed in blocks, so that the
+  :math:`(\omega, \mathbf{r})` intermediate is never allocated in full.
+
+  @param chi_wk Generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})` 
+                in Matsubara frequency and momentum space.
+  @param ntau Number of imaginary time points, -1 for the default of the adjoint mesh.
+  @return Generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})` 
+          in imaginary time and real space.
+ */
+chi_tr_t chi_tr_from_chi_wk(chi_wk_cvt chi_wk, int ntau=-1);
+
+/** Fused Fourier transform from :math:`\chi_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})` to :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`
+
+  The reverse of chi_tr_from_chi_wk.
+
+  @param chi_tr Generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})` 
+                in imaginary time and real space.
+  @param nw Number of Matsubara frequencies, -1 for the default of the adjoint mesh.
+  @return Generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})` 
+          in Matsubara frequency and momentum space.
+ */
+chi_wk_t chi_wk_from_chi_tr(chi_tr_cvt chi_tr, int nw=-1);
+
+/** Fourier transforms of generalized susceptibilities distributed over MPI ranks
+
+  The k <-> r transforms are local to each rank, while the frequency <-> time
+  transforms redistribute the data over the lattice points and back.
+ */
+chi_wr_dist_t chi_wr_from_chi_tr(chi_tr_dist_t const &chi_tr, int nw);
+chi_tr_dist_t chi_tr_from_chi_wr(chi_wr_dist_t const &chi_wr, int ntau=-1);
+chi_wk_dist_t chi_wk_from_chi_wr(chi_wr_dist_t const &chi_wr);
+chi_wr_dist_t chi_wr_from_chi_wk(chi_wk_dist_t const &chi_wk);
+
 chi_t_t::target_t::value_t chi_trapz_tau(chi_t_cvt chi_t);
 
 } // namespace triqs_tprf
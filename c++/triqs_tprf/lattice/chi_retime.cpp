@@ -24,6 +24,8 @@
 #include "common.hpp"
 #include "../mpi.hpp"
 #include "chi_retime.hpp"
+#include "band_structure.hpp"
+#include "mesh_index_tables.hpp"
 
 #include "../fourier/fourier.hpp"
 #include "fourier.hpp"
@@ -34,20 +36,6 @@ namespace triqs_tprf {
     using namespace fourier;
   }
 
-// ----------------------------------------------------
-// helper functions
-  
-double fermi_scalar(double e) {
-  if( e < 0 ) {
-    return 1. / (exp(e) + 1.);
-  } else {
-    double exp_me = exp(-e);
-    return exp_me / (1 + exp_me);
-  }
-}
-
-auto fermi_nda = nda::map([](double e) { return fermi_scalar(e); });
-  
 // ----------------------------------------------------
 // g0_Tk_les, g0_Tk_gtr in real time
 
@@ -59,16 +47,17 @@ std::tuple<g_Tk_t, g_Tk_t> g0_Tk_les_gtr_from_e_k(e_k_cvt e_k, mesh::retime Tmes
   g_Tk_t g0_Tk_les({Tmesh, kmesh}, e_k.target_shape());
   g_Tk_t g0_Tk_gtr({Tmesh, kmesh}, e_k.target_shape());
 
+  band_structure bands(e_k, 0., beta);
+
   auto arr = mpi_view(kmesh);
 
 #pragma omp parallel for
   for (unsigned int idx = 0; idx < arr.size(); idx++) {
     auto &k = arr[idx];
 
-    matrix<std::complex<double>> e_k_mat(e_k[k]);
-    auto [ek, Uk] = linalg::eigenelements(e_k_mat);
-
-    auto occ = fermi_nda(beta*ek);
+    auto ek  = bands.eps(k.data_index());
+    auto &Uk = bands.U(k.data_index());
+    auto occ = bands.occ(k.data_index());
 
     for (auto T : Tmesh) {
       auto exp_T = exp(-I * ek * double(T));
@@ -83,8 +72,8 @@ std::tuple<g_Tk_t, g_Tk_t> g0_Tk_les_gtr_from_e_k(e_k_cvt e_k, mesh::retime Tmes
     }
   }
 
-  g0_Tk_les = mpi::all_reduce(g0_Tk_les);
-  g0_Tk_gtr = mpi::all_reduce(g0_Tk_gtr);
+  mpi_all_reduce_in_place(g0_Tk_les);
+  mpi_all_reduce_in_place(g0_Tk_gtr);
   
   return {g0_Tk_les, g0_Tk_gtr};
 }
@@ -105,18 +94,28 @@ chi_Tr_t chi0_Tr_from_g_Tr_PH(g_Tr_cvt g_Tr_les, g_Tr_cvt g_Tr_gtr) {
 
   //for (auto r : rmesh) {
 
-  auto arr = mpi_view(Tmesh);
+  auto arr     = mpi_view(Tmesh);
+  auto minus_r = minus_x_index_table(rmesh);
+
+  auto _       = all_t{};
+  auto les_dat = g_Tr_les.data();
+  auto gtr_dat = g_Tr_gtr.data();
+  auto chi_dat = chi0_Tr.data();
 
 #pragma omp parallel for 
   for (unsigned int idx = 0; idx < arr.size(); idx++) {
-    auto &T = arr[idx];
+    long Tidx = arr[idx].data_index();
 
-    for (auto r : rmesh)
+    for (auto r : rmesh) {
+      long ridx = r.data_index(), mridx = minus_r[ridx];
+      auto les_p = les_dat(Tidx, ridx, _, _), les_m = les_dat(Tidx, mridx, _, _);
+      auto gtr_p = gtr_dat(Tidx, ridx, _, _), gtr_m = gtr_dat(Tidx, mridx, _, _);
       for (auto [a, b, c, d] : chi0_Tr.target_indices())
-        chi0_Tr[T, r](a, b, c, d) = +I * g_Tr_les[T, r](d, a) * conj(g_Tr_gtr(T.index(), -r)(b, c)) - I * g_Tr_gtr[T, r](d, a) * conj(g_Tr_les(T.index(), -r)(b, c));
+        chi_dat(Tidx, ridx, a, b, c, d) = +I * les_p(d, a) * conj(gtr_m(b, c)) - I * gtr_p(d, a) * conj(les_m(b, c));
+    }
   }
 
-  chi0_Tr = mpi::all_reduce(chi0_Tr);
+  mpi_all_reduce_in_place(chi0_Tr);
 
   return chi0_Tr;
 }
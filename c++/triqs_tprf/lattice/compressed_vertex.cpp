@@ -0,0 +1,109 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <nda/lapack.hpp>
+#include <triqs/utility/exceptions.hpp>
+
+#include "../channel_grouping.hpp"
+#include "compressed_vertex.hpp"
+
+namespace triqs_tprf {
+
+  namespace {
+
+    using scalar_t = std::complex<double>;
+
+    // Product with the frequency diagonal bubble, (chi0 R)_{nu x} = sum_y chi0_{nu, x y} R_{nu y}
+    nda::matrix<scalar_t, nda::F_layout> bubble_product(nda::array<scalar_t, 3> const &chi0, nda::matrix<scalar_t, nda::F_layout> const &R) {
+      long nf = chi0.shape()[0], m = chi0.shape()[1], n_rhs = R.shape()[1];
+      nda::matrix<scalar_t, nda::F_layout> res(nf * m, n_rhs);
+      for (long j = 0; j < n_rhs; j++)
+        for (long n = 0; n < nf; n++)
+          for (long x = 0; x < m; x++) {
+            scalar_t v = 0;
+            for (long y = 0; y < m; y++) v += chi0(n, x, y) * R(n * m + y, j);
+            res(n * m + x, j) = v;
+          }
+      return res;
+    }
+
+  } // namespace
+
+  // ----------------------------------------------------
+
+  compressed_vertex_PH::compressed_vertex_PH(chi_wnn_cvt gamma_ph_wnn, double tol)
+     : _wmesh(std::get<0>(gamma_ph_wnn.mesh())), _fmesh(std::get<1>(gamma_ph_wnn.mesh())), _nb(gamma_ph_wnn.target_shape()[0]), _tol(tol) {
+
+    auto _ = all_t{};
+
+    long n_w = _wmesh.size(), N = _fmesh.size() * _nb * _nb;
+    _P.resize(n_w);
+    _Q.resize(n_w);
+
+    using dat_t = array<scalar_t, 6, channel_memory_layout<Channel_t::PH>>;
+
+#pragma omp parallel for
+    for (long w = 0; w < n_w; w++) {
+
+      auto gamma_dat = dat_t{gamma_ph_wnn.data()(w, _, _, _, _, _, _)};
+      nda::matrix<scalar_t, nda::F_layout> A(channel_matrix_view<Channel_t::PH>(gamma_dat));
+
+      nda::vector<double> s(N);
+      nda::matrix<scalar_t, nda::F_layout> U(N, N), VT(N, N);
+      int info = nda::lapack::gesvd(A, s, U, VT);
+      if (info != 0) TRIQS_RUNTIME_ERROR << "compressed_vertex_PH: gesvd failed, info = " << info;
+
+      long r = 0;
+      while (r < N && s(r) > tol * s(0)) r++;
+
+      _P[w] = U(_, range(r));
+      for (long i = 0; i < r; i++) _P[w](_, i) *= s(i);
+      _Q[w] = dagger(VT(range(r), _));
+    }
+  }
+
+  // ----------------------------------------------------
+
+  nda::matrix<scalar_t, nda::F_layout> compressed_vertex_PH::bse_solve(long w, nda::array<scalar_t, 3> const &chi0,
+                                                                       nda::matrix<scalar_t, nda::F_layout> const &R) const {
+
+    auto Z = bubble_product(chi0, R);
+
+    long r = rank(w);
+    if (r == 0) return Z;
+
+    // K = 1 - Q^dagger chi0 P and the r x n_rhs right hand side Q^dagger chi0 R
+    auto W = bubble_product(chi0, _P[w]);
+    nda::matrix<scalar_t, nda::F_layout> K = -(dagger(_Q[w]) * W);
+    for (long i = 0; i < r; i++) K(i, i) += 1.;
+    nda::matrix<scalar_t, nda::F_layout> T = dagger(_Q[w]) * Z;
+
+    nda::vector<int> ipiv(r);
+    int info = nda::lapack::getrf(K, ipiv);
+    if (info != 0) TRIQS_RUNTIME_ERROR << "compressed_vertex_PH: singular BSE kernel, getrf info = " << info;
+    nda::lapack::getrs(K, T, ipiv);
+
+    Z += W * T;
+    return Z;
+  }
+
+} // namespace triqs_tprf
@@ -0,0 +1,96 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <vector>
+
+#include "../types.hpp"
+
+namespace triqs_tprf {
+
+  /** Low rank particle-hole vertex for the lattice Bethe-Salpeter equation
+
+   At every bosonic frequency the vertex is cast to the PH grouped matrix
+   :math:`\Gamma_{\{\nu\alpha\beta\},\{\nu'\delta\gamma\}}(\omega)` of
+   channel_matrix_view<Channel_t::PH> and factorized with a singular value
+   decomposition, truncated to the singular values above tol times the largest one
+
+   .. math::
+       \Gamma(\omega) \approx P(\omega) Q^\dagger(\omega)
+
+   with :math:`P = U \Sigma` and :math:`Q = V` of shape (nf nb^2, r).
+
+   The lattice BSE kernel :math:`1 - \chi^{(0)} \Gamma` is then a rank r update of
+   the identity and is inverted with the Woodbury identity
+
+   .. math::
+       [1 - \chi^{(0)} P Q^\dagger]^{-1} =
+       1 + \chi^{(0)} P [1 - Q^\dagger \chi^{(0)} P]^{-1} Q^\dagger
+
+   which only requires the factorization of an r x r matrix per (w, k) point.
+   The factorization is k independent and is computed once.
+  */
+  class compressed_vertex_PH {
+
+    public:
+    using scalar_t = std::complex<double>;
+
+    /**
+     @param gamma_ph_wnn Local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`
+     @param tol Relative truncation tolerance of the singular values
+     */
+    compressed_vertex_PH(chi_wnn_cvt gamma_ph_wnn, double tol = 1e-8);
+
+    mesh::imfreq const &wmesh() const { return _wmesh; }
+    mesh::imfreq const &fmesh() const { return _fmesh; }
+    long n_bands() const { return _nb; }
+    double tol() const { return _tol; }
+
+    /// Rank of the truncated factorization at bosonic frequency index w
+    long rank(long w) const { return _P[w].shape()[1]; }
+
+    /// Left factor :math:`P(\omega) = U \Sigma` at bosonic frequency index w
+    nda::matrix<scalar_t, nda::F_layout> const &P(long w) const { return _P[w]; }
+
+    /// Right factor :math:`Q(\omega) = V` at bosonic frequency index w
+    nda::matrix<scalar_t, nda::F_layout> const &Q(long w) const { return _Q[w]; }
+
+    /** Woodbury solve of the lattice BSE
+
+     Computes :math:`[1 - \chi^{(0)} \Gamma(\omega)]^{-1} \chi^{(0)} R` where the
+     bubble is diagonal in frequency and given by its PH grouped blocks.
+
+     @param w bosonic frequency index
+     @param chi0 bubble blocks :math:`\chi^{(0)}_{\nu, \{\alpha\beta\}, \{\delta\gamma\}}` with shape (nf, nb^2, nb^2)
+     @param R right hand side with shape (nf nb^2, n_rhs)
+     @return solution with shape (nf nb^2, n_rhs)
+     */
+    nda::matrix<scalar_t, nda::F_layout> bse_solve(long w, nda::array<scalar_t, 3> const &chi0, nda::matrix<scalar_t, nda::F_layout> const &R) const;
+
+    private:
+    mesh::imfreq _wmesh, _fmesh;
+    long _nb;
+    double _tol;
+    std::vector<nda::matrix<scalar_t, nda::F_layout>> _P, _Q;
+  };
+
+} // namespace triqs_tprf
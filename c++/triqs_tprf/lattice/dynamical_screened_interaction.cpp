@@ -26,11 +26,40 @@
 #include "dynamical_screened_interaction.hpp"
 #include "common.hpp"
 #include "../mpi.hpp"
+#include "../batched_linalg.hpp"
 
 namespace triqs_tprf {
 
   enum SusceptibilityType { bubble, generalized };
- 
+
+  namespace {
+
+  using scalar_t = std::complex<double>;
+
+  // W at the points [j0, j1) of the (points, a, b, c, d) arrays chi and W, with the
+  // bare interaction of point j at V(v_idx[j - j0])
+  template <SusceptibilityType susType>
+  void screened_interaction_batch(array_const_view<scalar_t, 5> chi_arr, array_const_view<scalar_t, 5> V_arr, std::vector<long> const &v_idx,
+                                  long j0, long j1, array_view<scalar_t, 5> W_arr) {
+
+    auto V   = pack_PH(V_arr, v_idx);
+    auto chi = pack_PH(chi_arr, j0, j1);
+
+    if constexpr (susType == bubble) {
+      // W = V [1 - chi V]^{-1} = [1 - V chi]^{-1} V
+      batched_rpa_solve(V, chi);
+      unpack_PH(V, W_arr, j0);
+    } else {
+      // W = V chi V + V
+      nda::array<scalar_t, 3> chi_V(chi.shape()), W = V;
+      batched_gemm(1., chi, V, 0., chi_V);
+      batched_gemm(1., V, chi_V, 1., W);
+      unpack_PH(W, W_arr, j0);
+    }
+  }
+
+  } // namespace
+
   template <SusceptibilityType susType, typename chi_t, typename v_t> auto screened_interaction_from_generic_susceptibility(chi_t &chi, v_t &V) {
 
     auto const &[freqmesh, kmesh] = chi.mesh();
@@ -46,95 +75,71 @@ namespace triqs_tprf {
 
     auto W    = make_gf(chi);
     W()       = 0.;
-    size_t nb = chi.target_shape()[0];
 
-    using scalar_t = typename chi_t::scalar_t;
-    auto I         = nda::eye<scalar_t>(nb * nb);
+    // MPI split of the (w, k) points, all local points are solved in one batch
+    mpi::communicator comm;
+    long n_k = kmesh.size(), n_points = freqmesh.size() * n_k;
+    auto [j0, j1] = itertools::chunk_range(0, n_points, comm.size(), comm.rank());
 
-    // MPI and openMP parallell loop
-    auto arr = mpi_view(W.mesh());
-#pragma omp parallel for
-    for (unsigned int idx = 0; idx < arr.size(); idx++) {
-      auto &[w, k] = arr[idx];
+    std::vector<long> v_idx(j1 - j0);
+    for (long j = j0; j < j1; j++) v_idx[j - j0] = (v_t::arity == 1) ? j % n_k : j;
 
-      array<scalar_t, 4> V_arr;
-      if constexpr (v_t::arity == 1)
-        V_arr = V[k];
-      else
-        V_arr = V[w, k];
+    screened_interaction_batch<susType>(ph_batch_view(chi.data()), ph_batch_view(V.data()), v_idx, j0, j1, ph_batch_view(W.data()));
 
-      array<scalar_t, 4> chi_arr{chi[w, k]};
-      array<scalar_t, 4> W_arr{nb, nb, nb, nb};
+    mpi_all_reduce_in_place(W);
+    return W;
+  }
 
-      auto V_mat   = make_matrix_view(group_indices_view(V_arr, idx_group<0, 1>, idx_group<3, 2>));
-      auto chi_mat = make_matrix_view(group_indices_view(chi_arr, idx_group<0, 1>, idx_group<3, 2>));
-      auto W_mat   = make_matrix_view(group_indices_view(W_arr, idx_group<0, 1>, idx_group<3, 2>));
+  chi_wk_t dynamical_screened_interaction_W(chi_wk_cvt PI_wk, chi_k_cvt V_k) {
+    return screened_interaction_from_generic_susceptibility<bubble>(PI_wk, V_k);
+  }
 
-      if constexpr (susType == false)
-        W_mat = V_mat * inverse(I - chi_mat * V_mat);
-      else
-        W_mat = V_mat * chi_mat * V_mat + V_mat;
+  chi_Dwk_t dynamical_screened_interaction_W(chi_Dwk_cvt PI_wk, chi_k_cvt V_k) {
+    return screened_interaction_from_generic_susceptibility<bubble>(PI_wk, V_k);
+  }
 
-      W[w, k] = W_arr;
-    }
+  namespace {
 
-    W = mpi::all_reduce(W);
-    return W;
+  // W = V [1 - PI V]^{-1} at every (row, lattice point) of a (rows, points, a, b, c, d) array,
+  // with the bare interaction of lattice point i at data index v_idx[i] of V_k
+  void dynamical_screened_interaction_W_pointwise(array_const_view<scalar_t, 6> PI_arr, chi_k_cvt V_k,
+                                                  std::vector<long> const &v_idx, array_view<scalar_t, 6> W_out) {
+
+    long n_rows = PI_arr.shape()[0], n_points = PI_arr.shape()[1];
+
+    std::vector<long> v_idx_rows(n_rows * n_points);
+    for (long j = 0; j < n_rows * n_points; j++) v_idx_rows[j] = v_idx[j % n_points];
+
+    screened_interaction_batch<bubble>(ph_batch_view(PI_arr), ph_batch_view(V_k.data()), v_idx_rows, 0, n_rows * n_points,
+                                       ph_batch_view(W_out));
   }
 
-  template <typename chi_t>
-    auto dynamical_screened_interaction_W_opt_bubble(chi_t chi_wk, chi_k_cvt V_k) {
-    
-    auto const &[wmesh, kmesh] = chi_wk.mesh();
-    auto const &v_kmesh = V_k.mesh();
-
-    if (kmesh != v_kmesh) TRIQS_RUNTIME_ERROR << "dynamical_screened_interaction_W: k-space meshes are not the same\n";
-
-    auto W_wk    = make_gf(chi_wk);
-    W_wk()       = 0.;
-    size_t nb = chi_wk.target_shape()[0];
-
-    using scalar_t = typename chi_wk_cvt::scalar_t;
-    auto I         = nda::eye<scalar_t>(nb * nb);
-    
-    // MPI and openMP parallell loop
-    auto arr = mpi_view(W_wk.mesh());
-    
-#pragma omp parallel for 
-    for (unsigned int idx = 0; idx < arr.size(); idx++) {
-      auto &[w, k] = arr[idx];
-
-      array<scalar_t, 4> denom{nb, nb, nb, nb};
-      array<scalar_t, 4> inv_denom{nb, nb, nb, nb};
-      
-      auto denom_mat = make_matrix_view(group_indices_view(denom, idx_group<0, 1>, idx_group<3, 2>));
-      auto inv_denom_mat = make_matrix_view(group_indices_view(inv_denom, idx_group<0, 1>, idx_group<3, 2>));
-
-      denom_mat = I;
-
-      for (auto const &[a, b, c, d] : V_k.target_indices())
-	for( auto e : range(nb) ) 
-	  for( auto f : range(nb) ) 
-	    denom(a,b,c,d) -= chi_wk[w,k](a,b,e,f)*V_k[k](e,f,c,d);
-      
-      inv_denom_mat = inverse(denom_mat);
-
-      for (auto const &[a, b, c, d] : V_k.target_indices())
-	for( auto e : range(nb) ) 
-	  for( auto f : range(nb) ) 
-	    W_wk[w, k](a,b,c,d) += V_k[k](a,b,e,f) * inv_denom(e,f,c,d);      
-    }
+  } // namespace
+
+  chi_wk_dist_t dynamical_screened_interaction_W(chi_wk_dist_t const &PI_wk, chi_k_cvt V_k) {
+
+    if (PI_wk.lattice_mesh() != V_k.mesh()) TRIQS_RUNTIME_ERROR << "dynamical_screened_interaction_W: k-space meshes are not the same\n";
+
+    chi_wk_dist_t W_wk(PI_wk.mesh(), PI_wk.target_shape(), PI_wk.communicator());
+
+    std::vector<long> v_idx(PI_wk.n_cols());
+    for (long k = 0; k < PI_wk.n_cols(); k++) v_idx[k] = k;
 
-    W_wk = mpi::all_reduce(W_wk);
+    dynamical_screened_interaction_W_pointwise(PI_wk.data(), V_k, v_idx, W_wk.data());
     return W_wk;
   }
 
-  chi_wk_t dynamical_screened_interaction_W(chi_wk_cvt PI_wk, chi_k_cvt V_k) {
-    return dynamical_screened_interaction_W_opt_bubble<chi_wk_cvt>(PI_wk, V_k);
-  }
+  chi_wk_ibz_t dynamical_screened_interaction_W(chi_wk_ibz_t const &PI_wk, chi_k_cvt V_k) {
 
-  chi_Dwk_t dynamical_screened_interaction_W(chi_Dwk_cvt PI_wk, chi_k_cvt V_k) {
-    return dynamical_screened_interaction_W_opt_bubble<chi_Dwk_cvt>(PI_wk, V_k);
+    if (PI_wk.ibz().mesh() != V_k.mesh()) TRIQS_RUNTIME_ERROR << "dynamical_screened_interaction_W: k-space meshes are not the same\n";
+
+    chi_wk_ibz_t W_wk(PI_wk.mesh(), PI_wk.ibz_ptr(), PI_wk.target_shape());
+
+    std::vector<long> v_idx(PI_wk.ibz().n_irr());
+    for (long i = 0; i < PI_wk.ibz().n_irr(); i++) v_idx[i] = PI_wk.ibz().irr_k(i);
+
+    dynamical_screened_interaction_W_pointwise(PI_wk.data(), V_k, v_idx, W_wk.data());
+    return W_wk;
   }
   
   chi_fk_t dynamical_screened_interaction_W(chi_fk_cvt PI_fk, chi_k_cvt V_k) {
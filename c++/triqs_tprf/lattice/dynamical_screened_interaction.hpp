@@ -22,6 +22,8 @@
 #pragma once
 
 #include "../types.hpp"
+#include "../distributed_gf.hpp"
+#include "ibz.hpp"
 
 namespace triqs_tprf {
 
@@ -44,6 +46,28 @@ namespace triqs_tprf {
   chi_wk_t dynamical_screened_interaction_W(chi_wk_cvt PI_wk, chi_k_cvt V_k);
   chi_Dwk_t dynamical_screened_interaction_W(chi_Dwk_cvt PI_wk, chi_k_cvt V_k);
 
+  /** Dynamical screened interaction :math:`W(i\omega_n, \mathbf{k})` calculator
+      for a distributed polarization bubble and static momentum-dependent interaction
+
+    Same as dynamical_screened_interaction_W, with the result distributed as the polarization bubble.
+
+    @param PI_wk distributed polarization bubble :math:`\Pi_{abcd}(i\omega_n, \mathbf{k})`
+    @param V_k static bare interaction  :math:`V_{abcd}(\mathbf{k})`
+    @return distributed dynamical screened interaction :math:`W_{abcd}(i\omega_n, \mathbf{k})`
+ */
+  chi_wk_dist_t dynamical_screened_interaction_W(chi_wk_dist_t const &PI_wk, chi_k_cvt V_k);
+
+  /** Dynamical screened interaction :math:`W(i\omega_n, \mathbf{k})` on the irreducible Brillouin zone
+
+    Same as dynamical_screened_interaction_W, computed at the irreducible k-points only.
+    The bare interaction must be symmetric under the point group of the irreducible zone map.
+
+    @param PI_wk polarization bubble at the irreducible k-points
+    @param V_k static bare interaction  :math:`V_{abcd}(\mathbf{k})` on the full k-mesh
+    @return dynamical screened interaction at the irreducible k-points
+ */
+  chi_wk_ibz_t dynamical_screened_interaction_W(chi_wk_ibz_t const &PI_wk, chi_k_cvt V_k);
+
   /** Dynamical screened interaction :math:`W(\omega, \mathbf{k})` calculator for static momentum-dependent bare interactions :math:`V(\mathbf{k})`.
 
     The full screened interaction :math:`W(\omega, \mathbf{k})`
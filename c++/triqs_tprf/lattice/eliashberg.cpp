@@ -22,9 +22,16 @@
 
 #include "common.hpp"
 
+#include <memory>
+#include <mutex>
+#include <random>
+
 #include "eliashberg.hpp"
+#include <nda/blas.hpp>
 #include <omp.h>
+#include <fftw3.h>
 #include "../mpi.hpp"
+#include "mesh_index_tables.hpp"
 
 #include "gf.hpp"
 #include "fourier.hpp"
@@ -49,19 +56,26 @@ F_out_t eliashberg_g_delta_g_product_template(g_t g_wk, g_t delta_wk) {
   auto F_wk = make_gf(delta_wk);
   F_wk *= 0.;
 
+  auto _            = all_t{};
+  auto minus_k      = minus_x_index_table(kmesh);
+  auto const &g_dat = g_wk.data();
+  long g_first_idx  = wmesh_gf.first_index();
+
   auto meshes_mpi = mpi_view(delta_wk.mesh());
 #pragma omp parallel for
   for (unsigned int idx = 0; idx < meshes_mpi.size(); idx++){
     auto &[w, k] = meshes_mpi[idx];
 
+    auto g_m = g_dat(w.index() - g_first_idx, minus_k[k.data_index()], _, _);
+
     for (auto [d, c] : F_wk.target_indices()) {
       for (auto [e, f] : delta_wk.target_indices()) {
-        F_wk[w, k](d, c) += g_wk[w, k](c, f) * nda::conj(g_wk[w, -k](e, d)) * delta_wk[w, k](e, f);
+        F_wk[w, k](d, c) += g_wk[w, k](c, f) * nda::conj(g_m(e, d)) * delta_wk[w, k](e, f);
       }
     }
   }
 
-  F_wk = mpi::all_reduce(F_wk);
+  mpi_all_reduce_in_place(F_wk);
 
   return F_wk;
 }
@@ -70,6 +84,114 @@ g_wk_t eliashberg_g_delta_g_product(g_wk_vt g_wk, g_wk_vt delta_wk) {
   return eliashberg_g_delta_g_product_template<g_wk_t, g_wk_vt>(g_wk, delta_wk);
 }
 
+chi_wk_t eliashberg_gg_kernel(g_wk_vt g_wk) {
+
+  auto _     = all_t{};
+  auto wmesh = std::get<0>(g_wk.mesh());
+  auto kmesh = std::get<1>(g_wk.mesh());
+  long nb    = g_wk.target_shape()[0];
+
+  chi_wk_t gg_wk(g_wk.mesh(), {nb, nb, nb, nb});
+
+  auto minus_k      = minus_x_index_table(kmesh);
+  auto const &g_dat = g_wk.data();
+  auto &gg_dat      = gg_wk.data();
+  long nk           = kmesh.size();
+
+#pragma omp parallel for
+  for (long idx = 0; idx < long(wmesh.size()) * nk; idx++) {
+    long w = idx / nk, k = idx % nk;
+    auto g_p = g_dat(w, k, _, _);
+    auto g_m = g_dat(w, minus_k[k], _, _);
+    for (auto [d, c, e, f] : gg_wk.target_indices()) gg_dat(w, k, d, c, e, f) = g_p(c, f) * nda::conj(g_m(e, d));
+  }
+
+  return gg_wk;
+}
+
+g_wk_t eliashberg_g_delta_g_product(chi_wk_vt gg_wk, g_wk_vt delta_wk) {
+
+  auto wmesh    = std::get<0>(delta_wk.mesh());
+  auto wmesh_gg = std::get<0>(gg_wk.mesh());
+
+  if (wmesh.size() > wmesh_gg.size())
+      TRIQS_RUNTIME_ERROR << "The size of the Matsubara frequency mesh of the GG kernel"
+          " (" << wmesh_gg.size() << ") must be atleast the size of the mesh of Delta (" <<
+          wmesh.size() << ").";
+
+  auto F_wk = make_gf(delta_wk);
+  F_wk *= 0.;
+
+  auto _             = all_t{};
+  long nb            = delta_wk.target_shape()[0], m = nb * nb;
+  auto const &gg_dat = gg_wk.data();
+  auto const &d_dat  = delta_wk.data();
+  auto &F_dat        = F_wk.data();
+  long gg_first_idx  = wmesh_gg.first_index();
+
+  // F_{dc} = sum_{ef} GG_{dc,ef} Delta_{ef}, a (nb^2, nb^2) matrix vector product per (w, k)
+  auto meshes_mpi = mpi_view(delta_wk.mesh());
+#pragma omp parallel for
+  for (unsigned int idx = 0; idx < meshes_mpi.size(); idx++) {
+    auto &[w, k] = meshes_mpi[idx];
+    long widx = w.data_index(), kidx = k.data_index();
+
+    auto gg = gg_dat(w.index() - gg_first_idx, kidx, _, _, _, _);
+    for (long dc = 0; dc < m; dc++) {
+      dcomplex v = 0;
+      for (long ef = 0; ef < m; ef++) v += gg(dc / nb, dc % nb, ef / nb, ef % nb) * d_dat(widx, kidx, ef / nb, ef % nb);
+      F_dat(widx, kidx, dc / nb, dc % nb) = v;
+    }
+  }
+
+  mpi_all_reduce_in_place(F_wk);
+
+  return F_wk;
+}
+
+namespace {
+
+// The DLR convolution is bilinear in the DLR coefficients, the tensor T with
+// f(tau_i) = sum_{l l'} T(i, l r + l') a_c(l) b_c(l') of the convolution f = a * b
+// is tabulated once per DLR mesh from the unit coefficient vectors and cached
+
+std::shared_ptr<nda::matrix<dcomplex> const> dlr_convolution_tensor(dlr_imtime tmesh) {
+
+  static std::mutex mutex;
+  static std::vector<std::pair<dlr_imtime, std::shared_ptr<nda::matrix<dcomplex> const>>> cache;
+
+  std::lock_guard<std::mutex> lock(mutex);
+  for (auto const &[m, T] : cache)
+    if (m == tmesh) return T;
+
+  tmesh.dlr_it().convolve_init(); // NB! Initialization not thread-safe, trigger it manually here.
+
+  auto _         = all_t{};
+  long r         = tmesh.size();
+  auto beta      = tmesh.beta();
+  auto statistic = static_cast<cppdlr::statistic_t>(tmesh.statistic());
+
+  auto T = std::make_shared<nda::matrix<dcomplex>>(r, r * r);
+#pragma omp parallel for
+  for (long l = 0; l < r; l++) {
+    nda::array<dcomplex, 1> e_l(r), e_lp(r);
+    e_l()  = 0;
+    e_l(l) = 1.;
+    for (long lp = 0; lp < r; lp++) {
+      e_lp()   = 0;
+      e_lp(lp) = 1.;
+      (*T)(_, l * r + lp) = tmesh.dlr_it().convolve(beta, statistic, e_l, e_lp);
+    }
+  }
+
+  // A few meshes at most are in use at a time, keep the most recent ones
+  if (cache.size() >= 8) cache.erase(cache.begin());
+  cache.emplace_back(tmesh, T);
+  return T;
+}
+
+} // namespace
+
 g_Dwk_t eliashberg_g_delta_g_product(g_Dwk_vt g_wk, g_Dwk_vt delta_wk) {
 
   // Performing the product of (G*G) * delta in DLR coefficient space
@@ -90,43 +212,58 @@ g_Dwk_t eliashberg_g_delta_g_product(g_Dwk_vt g_wk, g_Dwk_vt delta_wk) {
   F_wk *= 0.;
 
   auto tmesh = dlr_imtime(wmesh);
-  tmesh.dlr_it().convolve_init(); // NB! Initialization not thread-safe, trigger it manually here.
-  
+
+  auto _  = all_t{};
+  long nw = wmesh.size(), r = tmesh.size();
+  long nb = delta_wk.target_shape()[0], m = nb * nb;
+
+  // f(tau_i) = sum_{l l'} T(i, l r + l') gg_c(l) d_c(l'), tabulated once per DLR mesh
+  auto T_ptr    = dlr_convolution_tensor(tmesh);
+  auto const &T = *T_ptr;
+
+  auto minus_k      = minus_x_index_table(kmesh);
+  auto const &g_dat = g_wk.data();
+  auto const &d_dat = delta_wk.data();
+
+  // All orbital components are stacked as columns, so that the DLR fits and evaluations
+  // and the contraction with T are a few matrix products per k
   auto mesh_mpi = mpi_view(kmesh);
 #pragma omp parallel for
   for (unsigned int idx = 0; idx < mesh_mpi.size(); idx++){
-    auto & k = mesh_mpi[idx];
+    long k = mesh_mpi[idx].data_index();
 
-    for (auto [d, c] : g_wk.target_indices()) {
-      for (auto [e, f] : delta_wk.target_indices()) {
+    auto gg_w = gf<dlr_imfreq, tensor_valued<1>>{wmesh, {m * m}};
+    auto d_w  = gf<dlr_imfreq, tensor_valued<1>>{wmesh, {m}};
 
-	auto gg_w = gf(wmesh);
-	auto d_w = gf(wmesh);
-	
-	for( auto w : wmesh ) {
-	  gg_w[w] = g_wk[w, k](c, f) * nda::conj(g_wk[w, -k](e, d));
-	  d_w[w] = delta_wk[w, k](e, f);
-	}
-
-	auto gg_c = make_gf_dlr(gg_w);
-	auto d_c = make_gf_dlr(d_w);
-
-	auto f_t = gf(tmesh);
-	f_t.data() = tmesh.dlr_it().convolve(
-	  tmesh.beta(), static_cast<cppdlr::statistic_t>(tmesh.statistic()),
-	  gg_c.data(), d_c.data());
-
-	auto f_c = make_gf_dlr(f_t);
-	auto f_w = make_gf_dlr_imfreq(f_c);
-	  
-	for( auto w : wmesh ) {
-	  F_wk[w, k](d, c) += f_w[w];
-	}
-      }
+    for (long w = 0; w < nw; w++) {
+      for (auto [d, c, e, f] : itertools::product_range(nb, nb, nb, nb))
+        gg_w.data()(w, (d * nb + c) * m + e * nb + f) = g_dat(w, k, c, f) * nda::conj(g_dat(w, minus_k[k], e, d));
+      for (auto [e, f] : itertools::product_range(nb, nb)) d_w.data()(w, e * nb + f) = d_dat(w, k, e, f);
+    }
+
+    auto gg_c = make_gf_dlr(gg_w);
+    auto d_c  = make_gf_dlr(d_w);
+
+    // M(l r + l', dc) = sum_ef gg_c(l, dc, ef) d_c(l', ef)
+    nda::matrix<dcomplex> d_cm(d_c.data());
+    nda::matrix<dcomplex> M(r * r, m);
+    for (long l = 0; l < r; l++) {
+      auto gg_l = nda::matrix_const_view<dcomplex>(std::array<long, 2>{m, m}, &gg_c.data()(l, 0));
+      M(nda::range(l * r, (l + 1) * r), _) = d_cm * transpose(gg_l);
     }
+
+    nda::matrix<dcomplex> F_t = T * M;
+    auto f_t   = gf<dlr_imtime, tensor_valued<1>>{tmesh, {m}};
+    f_t.data() = make_array_const_view(F_t);
+
+    auto f_c = make_gf_dlr(f_t);
+    auto f_w = make_gf_dlr_imfreq(f_c);
+
+    for (long w = 0; w < nw; w++)
+      for (auto [d, c] : itertools::product_range(nb, nb)) F_wk.data()(w, k, d, c) = f_w.data()(w, d * nb + c);
   }
 
-  F_wk = mpi::all_reduce(F_wk);
+  mpi_all_reduce_in_place(F_wk);
 
   return F_wk;  
 }
@@ -150,30 +287,470 @@ g_wk_t eliashberg_product(chi_wk_vt Gamma_pp, g_wk_vt g_wk,
   auto delta_wk_out = make_gf(delta_wk);
   delta_wk_out *= 0.;
 
+  auto _                = all_t{};
+  auto const &gamma_dat = Gamma_pp.data();
+  auto const &F_dat     = F_wk.data();
+  auto &out_dat         = delta_wk_out.data();
+  long gamma_first_idx  = gamma_wmesh.first_index();
+
   auto arr = mpi_view(kmesh);
 #pragma omp parallel for
   for (int kidx = 0; kidx < arr.size(); kidx++) {
       auto &k = arr[kidx];
+
+      // data indices of k - q for all q
+      auto kmq = mesh_index_table(kmesh, -1, k.data_index(), +1);
+
       for (auto w : wmesh) {
-        for (auto [n, q] : delta_wk.mesh())
+        auto out = out_dat(w.data_index(), k.data_index(), _, _);
+        for (auto [n, q] : delta_wk.mesh()) {
+          auto gamma = gamma_dat(w.index() - n.index() - gamma_first_idx, kmq[q.data_index()], _, _, _, _);
+          auto F     = F_dat(n.data_index(), q.data_index(), _, _);
           for (auto [c, a, d, b] : Gamma_pp.target_indices())
-            delta_wk_out[w, k](a, b) += -0.5 * Gamma_pp(w - n, k - q)(c, a, d, b) * F_wk[n, q](d, c);
+            out(a, b) += -0.5 * gamma(c, a, d, b) * F(d, c);
+        }
       }
   }
 
   delta_wk_out /= (wmesh.beta() * kmesh.size());
 
-  delta_wk_out = mpi::all_reduce(delta_wk_out);
+  mpi_all_reduce_in_place(delta_wk_out);
 
   return delta_wk_out;
 }
 
+// ----------------------------------------------------
+// eliashberg_operator
+
+eliashberg_operator::eliashberg_operator(chi_tr_vt Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r, g_wk_vt g_wk)
+   : eliashberg_operator(Gamma_pp_const_r, g_wk) {
+
+  auto _ = all_t{};
+
+  if (std::get<0>(Gamma_pp_dyn_tr.mesh()).size() != _nt || std::get<1>(Gamma_pp_dyn_tr.mesh()).size() != _rmesh.size())
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: the mesh of the dynamic vertex does not match the adjoint mesh of the Green's function.";
+
+  _has_dyn   = true;
+  _gamma_dyn = nda::array<dcomplex, 4>(_nt, _rmesh.size(), _m, _m);
+
+  auto const &gamma_dat = Gamma_pp_dyn_tr.data();
+#pragma omp parallel for
+  for (long t = 0; t < _nt; t++)
+    for (long r = 0; r < long(_rmesh.size()); r++)
+      for (auto [c, a, d, b] : Gamma_pp_dyn_tr.target_indices()) _gamma_dyn(t, r, a * _nb + b, d * _nb + c) = -0.5 * gamma_dat(t, r, c, a, d, b);
+}
+
+eliashberg_operator::eliashberg_operator(chi_r_vt Gamma_pp_const_r, g_wk_vt g_wk)
+   : _mesh(g_wk.mesh()),
+     _tmesh(make_adjoint_mesh(std::get<0>(g_wk.mesh()))),
+     _rmesh(make_adjoint_mesh(std::get<1>(g_wk.mesh()))),
+     _nw(std::get<0>(g_wk.mesh()).size()),
+     _nk(std::get<1>(g_wk.mesh()).size()),
+     _nt(_tmesh.size()),
+     _nb(g_wk.target_shape()[0]),
+     _m(_nb * _nb),
+     _has_dyn(false),
+     _tail_fit(std::get<0>(g_wk.mesh())),
+     _nw_out(_nw),
+     _minus_k(minus_x_index_table(std::get<1>(g_wk.mesh()))) {
+
+  if (Gamma_pp_const_r.mesh().size() != _rmesh.size())
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: the mesh of the static vertex does not match the adjoint mesh of the Green's function.";
+
+  set_pairs();
+
+  auto gg_wk = eliashberg_gg_kernel(g_wk);
+  _gg        = nda::array<dcomplex, 4>(_nw, _nk, _m, _m);
+  for (auto [w, k, d, c, e, f] : itertools::product_range(_nw, _nk, _nb, _nb, _nb, _nb))
+    _gg(w, k, d * _nb + c, e * _nb + f) = gg_wk.data()(w, k, d, c, e, f);
+
+  _gamma_const = nda::array<dcomplex, 3>(_rmesh.size(), _m, _m);
+  for (long r = 0; r < long(_rmesh.size()); r++)
+    for (auto [c, a, d, b] : Gamma_pp_const_r.target_indices())
+      _gamma_const(r, a * _nb + b, d * _nb + c) = -0.5 * Gamma_pp_const_r.data()(r, c, a, d, b);
+
+  // The derivative fit of the moments is linear in D(t), its coefficients are probed with unit
+  // vectors in chunks of the time points and only the points it depends on are kept
+  auto _ = all_t{};
+  nda::array<dcomplex, 2> coef(2, _nt);
+  for (long t0 = 0; t0 < _nt; t0 += 64) {
+    long n = std::min(_nt - t0, 64l);
+    gf<imtime, tensor_valued<1>> unit{_tmesh, {n}};
+    unit.data() = 0;
+    for (long j = 0; j < n; j++) unit.data()(t0 + j, j) = 1.;
+    coef(_, nda::range(t0, t0 + n)) = fit_derivatives(unit());
+  }
+  for (long t = 0; t < _nt; t++)
+    if (std::abs(coef(0, t)) > 0 || std::abs(coef(1, t)) > 0) _deriv_rows.push_back(t);
+  _deriv_fit = nda::matrix<dcomplex>(2, _deriv_rows.size());
+  for (long i = 0; i < long(_deriv_rows.size()); i++) _deriv_fit(_, i) = coef(_, _deriv_rows[i]);
+}
+
+// Orbital pairs of the reduced gap, all pairs without projection
+void eliashberg_operator::set_pairs() {
+
+  _pairs.clear();
+  _pair_of.assign(_m, -1);
+  _pair_sign.assign(_m, 0);
+
+  for (long a = 0; a < _nb; a++)
+    for (long b = 0; b < _nb; b++) {
+      if (_projected && (b < a || (b == a && _p_o < 0))) continue;
+      _pair_of[a * _nb + b]   = _pairs.size();
+      _pair_sign[a * _nb + b] = 1;
+      _pairs.emplace_back(a, b);
+    }
+
+  if (!_projected) return;
+  for (long a = 0; a < _nb; a++)
+    for (long b = 0; b < a; b++) {
+      _pair_of[a * _nb + b]   = _pair_of[b * _nb + a];
+      _pair_sign[a * _nb + b] = _p_o;
+    }
+}
+
+void eliashberg_operator::set_projection(std::string const &spin, std::string const &frequency, std::string const &orbital) {
+
+  auto parity = [](std::string const &name, std::string const &value) {
+    if (value == "even") return 1;
+    if (value == "odd") return -1;
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: the " << name << " parity must be 'even' or 'odd', not '" << value << "'.";
+  };
+
+  int s = 0;
+  if (spin == "singlet") s = 1;
+  if (spin == "triplet") s = -1;
+  if (s == 0) TRIQS_RUNTIME_ERROR << "eliashberg_operator: the spin must be 'singlet' or 'triplet', not '" << spin << "'.";
+
+  int p_w = parity("frequency", frequency), p_o = parity("orbital", orbital);
+
+  auto const &wmesh = std::get<0>(_mesh);
+  if (wmesh.statistic() != Fermion || wmesh.positive_only())
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: a projection needs a fermionic frequency mesh with positive and negative frequencies.";
+  if (p_o < 0 && _nb < 2) TRIQS_RUNTIME_ERROR << "eliashberg_operator: an orbital odd gap needs at least two orbitals.";
+
+  project(p_w, p_o, s * p_w * p_o);
+
+  // The full operator applied to a probe gap of the sector must stay in the sector. The probe
+  // is pseudo random with a fixed seed, the same on all ranks.
+  std::mt19937 rng(23432);
+  std::uniform_real_distribution<double> u(-1., 1.);
+  nda::array<dcomplex, 1> x(size());
+  for (auto &v : x) v = dcomplex(u(rng), u(rng));
+  auto delta_in = expand_gap(x);
+
+  clear_projection();
+  g_wk_t delta_out(_mesh, {_nb, _nb});
+  apply(delta_in(), delta_out());
+
+  project(p_w, p_o, s * p_w * p_o);
+  auto delta_sec = expand_gap(restrict_gap(delta_out()));
+
+  double norm = 0, norm_out = 0;
+  auto const &d = delta_out.data();
+  auto const &d_sec = delta_sec.data();
+  for (long i = 0; i < d.size(); i++) {
+    norm += std::norm(d.data()[i]);
+    norm_out += std::norm(d.data()[i] - d_sec.data()[i]);
+  }
+
+  double leak = norm > 0 ? std::sqrt(norm_out / norm) : 0.;
+  if (leak > _sector_tol) {
+    clear_projection();
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: the product with a gap of the " << spin << ", " << frequency << " frequency, " << orbital
+                        << " orbital sector has a relative norm " << leak
+                        << " outside of the sector, the operator does not commute with the projection on the sector.";
+  }
+}
+
+void eliashberg_operator::project(int p_w, int p_o, int p_k) {
+  _projected = true;
+  _p_w       = p_w;
+  _p_o       = p_o;
+  _p_k       = p_k;
+  _w_first   = _nw / 2;
+  _nw_out    = _nw / 2;
+  _n_vec     = 0;
+  set_pairs();
+  _x1 = nda::array<dcomplex, 2>(1, size());
+  _y1 = nda::array<dcomplex, 2>(1, size());
+}
+
+void eliashberg_operator::clear_projection() {
+  _projected = false;
+  _p_w = _p_o = _p_k = 1;
+  _w_first           = 0;
+  _nw_out            = _nw;
+  _n_vec             = 0;
+  set_pairs();
+}
+
+// Component ab of the full gap i at (w, k) from the reduced gaps, with the frequency and orbital parities
+// and the projection on the momentum parity
+dcomplex eliashberg_operator::expanded(nda::array_const_view<dcomplex, 2> x, long i, long w, long k, long ab) const {
+
+  long p = _pair_of[ab], m_out = _pairs.size();
+  if (p < 0) return 0;
+
+  bool stored = w >= _w_first;
+  long w_s    = (stored ? w : _nw - 1 - w) - _w_first;
+  double s_w  = stored ? 1. : _p_w;
+  long o_p = (w_s * _nk + k) * m_out, o_m = (w_s * _nk + _minus_k[k]) * m_out;
+  return 0.5 * s_w * _pair_sign[ab] * (x(i, o_p + p) + double(_p_k) * x(i, o_m + p));
+}
+
+// Full gaps from reduced ones
+void eliashberg_operator::expand(nda::array_const_view<dcomplex, 2> x, nda::array_view<dcomplex, 2> X) const {
+
+  long n_vec = x.shape()[0];
+
+#pragma omp parallel for
+  for (long idx = 0; idx < _nw * _nk; idx++) {
+    long w = idx / _nk, k = idx % _nk;
+    for (long i = 0; i < n_vec; i++)
+      for (long ab = 0; ab < _m; ab++) X(i, idx * _m + ab) = expanded(x, i, w, k, ab);
+  }
+}
+
+nda::array<dcomplex, 1> eliashberg_operator::restrict_gap(g_wk_vt delta) const {
+
+  if (delta.mesh() != _mesh || delta.target_shape()[0] != _nb)
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: the gap must be on the mesh and have the target shape of the Green's function.";
+
+  nda::array<dcomplex, 1> x(size());
+  restrict_into(delta, x());
+  return x;
+}
+
+// Reduced gap from a full one, into x
+void eliashberg_operator::restrict_into(g_wk_vt delta, nda::array_view<dcomplex, 1> x) const {
+
+  long m_out     = _pairs.size();
+  auto const &d = delta.data();
+
+  // Average over the images under frequency, orbital and momentum inversion weighted by the parities
+#pragma omp parallel for
+  for (long idx = 0; idx < _nw_out * _nk; idx++) {
+    long w = _w_first + idx / _nk, k = idx % _nk;
+    for (long p = 0; p < m_out; p++) {
+      auto [a, b] = _pairs[p];
+      if (!_projected) {
+        x(idx * m_out + p) = d(w, k, a, b);
+        continue;
+      }
+      dcomplex v = 0;
+      for (auto [fw, fo, fk] : itertools::product_range(2, 2, 2)) {
+        double sign = (fw ? _p_w : 1) * (fo ? _p_o : 1) * (fk ? _p_k : 1);
+        v += sign * d(fw ? _nw - 1 - w : w, fk ? _minus_k[k] : k, fo ? b : a, fo ? a : b);
+      }
+      x(idx * m_out + p) = v / 8.;
+    }
+  }
+}
+
+g_wk_t eliashberg_operator::expand_gap(nda::array_const_view<dcomplex, 1> x) const {
+
+  if (x.size() != size()) TRIQS_RUNTIME_ERROR << "eliashberg_operator: the reduced gap must have size " << size() << ".";
+
+  g_wk_t delta(_mesh, {_nb, _nb});
+  nda::array<dcomplex, 2> x_2(1, size());
+  x_2(0, all_t{}) = x;
+  auto X          = nda::array_view<dcomplex, 2>(std::array<long, 2>{1, _nw * _nk * _m}, delta.data().data());
+  if (_projected)
+    expand(x_2, X);
+  else
+    X = x_2;
+  return delta;
+}
+
+void eliashberg_operator::resize(long n_vec) {
+
+  int n_threads = omp_get_max_threads();
+  if (n_vec == _n_vec && long(_buf.size()) >= n_threads) return;
+  _n_vec = n_vec;
+
+  long n_cols = n_vec * _m, n_out = n_vec * long(_pairs.size()), nr = _rmesh.size();
+  auto wmesh  = std::get<0>(_mesh);
+
+  _F = nda::array<dcomplex, 3>(_nw, nr, n_cols);
+  _D = nda::array<dcomplex, 3>(_nw_out, nr, n_out);
+
+  // The result is only transformed to the stored frequencies, the positive ones in a projected mode
+  auto dmesh = _projected ? mesh::imfreq{wmesh.beta(), Fermion, _nw_out, mesh::imfreq::option::positive_frequencies_only} : wmesh;
+
+  long L = _nt - 1;
+  _buf.resize(n_threads);
+  for (auto &b : _buf) {
+    b.F_w    = gf<imfreq, tensor_valued<1>>{wmesh, {n_cols}};
+    b.F_t    = gf<imtime, tensor_valued<1>>{_tmesh, {n_cols}};
+    b.D_t    = gf<imtime, tensor_valued<1>>{_tmesh, {n_out}};
+    b.D_w    = gf<imfreq, tensor_valued<1>>{dmesh, {n_out}};
+    b.wt_in  = nda::array<dcomplex, 2>(L, n_cols);
+    b.wt_out = nda::array<dcomplex, 2>(L + 1, n_cols);
+    b.tw_in  = nda::array<dcomplex, 2>(L + 1, n_out);
+    b.tw_out = nda::array<dcomplex, 2>(L, n_out);
+
+    // Moments beyond a lowered order of the tail fit stay zero
+    b.F_tail = nda::matrix<dcomplex>(_tail_fit.tail_indices().size(), n_cols);
+    b.F_mom  = nda::matrix<dcomplex>(std::max(_tail_fit.order(), 3) + 1, n_cols);
+    b.F_mom  = 0;
+    b.D_tail = nda::matrix<dcomplex>(_deriv_rows.size(), n_out);
+    b.D_mom  = nda::matrix<dcomplex>(2, n_out);
+  }
+}
+
+// In place lattice transform of the (w, x, c) slices of the frequencies of this rank, the result is complete on all ranks
+void eliashberg_operator::lattice_transform(nda::array<dcomplex, 3> &a, int fftw_backward_forward, double scale) {
+
+  auto _      = all_t{};
+  long nw     = a.shape()[0];
+  long n_cols = a.shape()[2];
+  auto dims   = std::get<1>(_mesh).dims();
+  int dims_int[3] = {int(dims[0]), int(dims[1]), int(dims[2])};
+
+  auto p = (fftw_plan)_fourier_cached_plan(3, dims_int, n_cols, a.data(), n_cols, 1, a.data(), n_cols, 1, fftw_backward_forward, true);
+
+  mpi::communicator c;
+  auto [w0, w1] = itertools::chunk_range(0, nw, c.size(), c.rank());
+
+#pragma omp parallel for
+  for (long w = 0; w < nw; w++) {
+    if (w < w0 || w >= w1) {
+      a(w, _, _) = 0;
+      continue;
+    }
+    fftw_execute_dft(p, (fftw_complex *)&a(w, 0, 0), (fftw_complex *)&a(w, 0, 0)); // NOLINT
+    if (scale != 1.0) a(w, _, _) *= scale;
+  }
+
+  mpi_all_reduce_in_place(a.data(), a.size(), c);
+}
+
+void eliashberg_operator::apply(g_wk_vt delta_in, g_wk_vt delta_out) {
+
+  if (delta_in.mesh() != _mesh || delta_out.mesh() != _mesh)
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: the gap must be on the mesh of the Green's function.";
+  if (!delta_in.data().indexmap().is_contiguous() || !delta_out.data().indexmap().is_contiguous())
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: the data of the gap must be contiguous.";
+
+  auto shape       = std::array<long, 2>{1, _nw * _nk * _m};
+  auto delta_out_x = nda::array_view<dcomplex, 2>(shape, delta_out.data().data());
+
+  if (!_projected) {
+    apply(nda::array_const_view<dcomplex, 2>(shape, delta_in.data().data()), delta_out_x);
+    return;
+  }
+
+  restrict_into(delta_in, _x1(0, all_t{}));
+  apply(_x1, _y1);
+  expand(_y1, delta_out_x);
+}
+
+void eliashberg_operator::apply(nda::array_const_view<dcomplex, 2> x, nda::array_view<dcomplex, 2> y) {
+
+  auto _     = all_t{};
+  long n_vec = x.shape()[0];
+
+  if (x.shape()[1] != size() || y.shape() != x.shape())
+    TRIQS_RUNTIME_ERROR << "eliashberg_operator: the gaps must have shape (n_vec, " << size() << ").";
+
+  resize(n_vec);
+
+  long m_out = _pairs.size(), nr = _rmesh.size(), L = _nt - 1;
+  mpi::communicator c;
+
+  // F = G G Delta, for the frequencies of this rank. In a projected mode the gaps are expanded on the fly.
+  auto [w0, w1] = itertools::chunk_range(0, _nw, c.size(), c.rank());
+#pragma omp parallel
+  {
+    nda::array<dcomplex, 1> X(_m);
+
+#pragma omp for
+    for (long idx = w0 * _nk; idx < w1 * _nk; idx++) {
+      long w = idx / _nk, k = idx % _nk, offset = idx * _m;
+      for (long i = 0; i < n_vec; i++) {
+        for (long ef = 0; ef < _m; ef++) X(ef) = _projected ? expanded(x, i, w, k, ef) : x(i, offset + ef);
+        for (long dc = 0; dc < _m; dc++) {
+          dcomplex v = 0;
+          for (long ef = 0; ef < _m; ef++) v += _gg(w, k, dc, ef) * X(ef);
+          _F(w, k, i * _m + dc) = v;
+        }
+      }
+    }
+  }
+
+  lattice_transform(_F, FFTW_FORWARD, 1. / _nk);
+
+  // Per lattice point: F(w) -> F(t), the dynamic product and D(t) -> D(w), plus the static product with F(t = 0),
+  // for the stored frequencies and orbital pairs of the result only
+  auto [r0, r1] = itertools::chunk_range(0, nr, c.size(), c.rank());
+  _D()          = 0;
+
+#pragma omp parallel
+  {
+    auto &b = _buf[omp_get_thread_num()];
+
+    // The plans are looked up on every call, the cache may have been cleared since the last one
+    int dims[] = {int(L)};
+    auto p_wt  = _fourier_base_plan(b.wt_in, b.wt_out, 1, dims, b.wt_in.shape()[1], FFTW_FORWARD);
+    auto p_tw  = _fourier_base_plan(b.tw_in, b.tw_out, 1, dims, b.tw_in.shape()[1], FFTW_BACKWARD);
+
+    // Product of the vertex with F for the component ab of the result i
+    auto product = [&](auto const &gamma_ab, auto const &F, long i) {
+      dcomplex v = 0;
+      for (long dc = 0; dc < _m; dc++) v += gamma_ab(dc) * F(i * _m + dc);
+      return v;
+    };
+
+#pragma omp for
+    for (long r = r0; r < r1; r++) {
+      b.F_w.data() = _F(_, r, _);
+      _tail_fit.moments(b.F_w.data(), b.F_tail(), b.F_mom(nda::range(0, _tail_fit.order() + 1), _));
+      _fourier_impl(b.F_t(), gf_const_view(b.F_w), p_wt, b.wt_in(), b.wt_out(), make_array_const_view(b.F_mom(nda::range(1, 4), _)));
+      auto const &F = b.F_t.data();
+
+      if (_has_dyn) {
+        auto &D_t = b.D_t.data();
+        for (long t = 0; t < _nt; t++)
+          for (long i = 0; i < n_vec; i++)
+            for (long p = 0; p < m_out; p++) {
+              long ab               = _pairs[p].first * _nb + _pairs[p].second;
+              D_t(t, i * m_out + p) = product(_gamma_dyn(t, r, ab, _), F(t, _), i);
+            }
+
+        for (long i = 0; i < long(_deriv_rows.size()); i++) b.D_tail(i, _) = D_t(_deriv_rows[i], _);
+        nda::blas::gemm(1., _deriv_fit, b.D_tail, 0., b.D_mom);
+        _fourier_impl(b.D_w(), gf_const_view(b.D_t), p_tw, b.tw_in(), b.tw_out(), make_array_const_view(b.D_mom));
+        _D(_, r, _) = b.D_w.data();
+      }
+
+      for (long i = 0; i < n_vec; i++)
+        for (long p = 0; p < m_out; p++) {
+          long ab = _pairs[p].first * _nb + _pairs[p].second;
+          _D(_, r, i * m_out + p) += product(_gamma_const(r, ab, _), F(0, _), i);
+        }
+    }
+  }
+
+  mpi_all_reduce_in_place(_D.data(), _D.size(), c);
+
+  lattice_transform(_D, FFTW_BACKWARD, 1.);
+
+#pragma omp parallel for
+  for (long idx = 0; idx < _nw_out * _nk; idx++) {
+    long w = idx / _nk, k = idx % _nk, offset = idx * m_out;
+    for (long i = 0; i < n_vec; i++)
+      for (long p = 0; p < m_out; p++) y(i, offset + p) = _D(w, k, i * m_out + p);
+  }
+}
+
+// ----------------------------------------------------
+
 std::tuple<chi_tr_t, chi_r_t> dynamic_and_constant_to_tr(chi_wk_vt Gamma_pp_dyn_wk, chi_k_vt Gamma_pp_const_k) {
 
-    auto Gamma_pp_dyn_wr = fourier_wk_to_wr_general_target(Gamma_pp_dyn_wk);
-    auto Gamma_pp_dyn_tr = fourier_wr_to_tr_general_target(Gamma_pp_dyn_wr);
+    auto Gamma_pp_dyn_tr = fourier_wk_to_tr_general_target(Gamma_pp_dyn_wk);
 
-    auto Gamma_pp_const_r = make_gf_from_fourier<0>(Gamma_pp_const_k);
+    auto Gamma_pp_const_r = fourier_k_to_r(Gamma_pp_const_k, is_real_in_r(Gamma_pp_const_k));
 
     return {Gamma_pp_dyn_tr, Gamma_pp_const_r}; 
 }
@@ -183,7 +760,7 @@ std::tuple<chi_Dtr_t, chi_r_t> dynamic_and_constant_to_tr(chi_Dwk_vt Gamma_pp_dy
     auto Gamma_pp_dyn_wr = fourier_wk_to_wr_general_target(Gamma_pp_dyn_wk);
     auto Gamma_pp_dyn_tr = fourier_Dwr_to_Dtr_general_target(Gamma_pp_dyn_wr);
 
-    auto Gamma_pp_const_r = make_gf_from_fourier<0>(Gamma_pp_const_k);
+    auto Gamma_pp_const_r = fourier_k_to_r(Gamma_pp_const_k, is_real_in_r(Gamma_pp_const_k));
 
     return {Gamma_pp_dyn_tr, Gamma_pp_const_r}; 
 }
@@ -250,7 +827,7 @@ delta_t eliashberg_dynamic_gamma_f_product_template(chi_t Gamma_pp_dyn_tr, F_t F
         delta_tr_out[t, r](a, b) += -0.5 * Gamma_pp_dyn_tr[t, r](c, a, d, b) * F_tr[t, r](d, c);
   }
 
-  delta_tr_out = mpi::all_reduce(delta_tr_out);
+  mpi_all_reduce_in_place(delta_tr_out);
 
   return delta_tr_out;
 }
@@ -264,45 +841,151 @@ g_Dtr_t eliashberg_dynamic_gamma_f_product(chi_Dtr_vt Gamma_pp_dyn_tr, g_Dtr_vt
 }
 
 
-template<typename delta_out_t, typename chi_t, typename g_t>  
+template<typename delta_out_t, typename chi_t, typename gg_t, typename g_t>  
 delta_out_t eliashberg_product_fft_template(chi_t Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r,
-                                   g_t g_wk, g_t delta_wk) {
+                                   gg_t g_wk, g_t delta_wk) {
 
   auto F_wk = eliashberg_g_delta_g_product(g_wk, delta_wk);
-  auto F_wr = fourier_wk_to_wr(F_wk);
-  auto F_tr = fourier_wr_to_tr(F_wr);
+  auto F_tr = fourier_wk_to_tr(F_wk);
 
   auto delta_tr_out = eliashberg_dynamic_gamma_f_product(Gamma_pp_dyn_tr, F_tr);
   auto delta_r_out = eliashberg_constant_gamma_f_product(Gamma_pp_const_r, F_tr);
 
   // FIXME
   // This raises warnings when used with random delta input, e.g. eigenvalue finder
-  auto delta_wr_out = fourier_tr_to_wr(delta_tr_out);
-  // Combine dynamic and constant part
+  auto delta_wk_out = fourier_tr_to_wk(delta_tr_out);
+
+  // Combine dynamic and constant part, the constant part is the same at all frequencies
+  auto delta_k_out = make_gf_from_fourier<0>(delta_r_out);
   auto _ = all_t{};
-  for (auto w : std::get<0>(delta_wr_out.mesh())) delta_wr_out[w, _] += delta_r_out;
+  for (auto w : std::get<0>(delta_wk_out.mesh())) delta_wk_out[w, _] += delta_k_out;
 
-  auto delta_wk_out = fourier_wr_to_wk(delta_wr_out);
   return delta_wk_out;
 }
 
 g_wk_t eliashberg_product_fft(chi_tr_vt Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r, g_wk_vt g_wk, g_wk_vt delta_wk) {
-  return eliashberg_product_fft_template<g_wk_t, chi_tr_vt, g_wk_vt>(Gamma_pp_dyn_tr, Gamma_pp_const_r, g_wk, delta_wk);
+  return eliashberg_product_fft_template<g_wk_t, chi_tr_vt, g_wk_vt, g_wk_vt>(Gamma_pp_dyn_tr, Gamma_pp_const_r, g_wk, delta_wk);
+}
+
+g_wk_t eliashberg_product_fft(chi_tr_vt Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r, chi_wk_vt gg_wk, g_wk_vt delta_wk) {
+  return eliashberg_product_fft_template<g_wk_t, chi_tr_vt, chi_wk_vt, g_wk_vt>(Gamma_pp_dyn_tr, Gamma_pp_const_r, gg_wk, delta_wk);
 }
 
 g_Dwk_t eliashberg_product_fft(chi_Dtr_vt Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r, g_Dwk_vt g_wk, g_Dwk_vt delta_wk) {
-  return eliashberg_product_fft_template<g_Dwk_t, chi_Dtr_vt, g_Dwk_vt>(Gamma_pp_dyn_tr, Gamma_pp_const_r, g_wk, delta_wk);
+  return eliashberg_product_fft_template<g_Dwk_t, chi_Dtr_vt, g_Dwk_vt, g_Dwk_vt>(Gamma_pp_dyn_tr, Gamma_pp_const_r, g_wk, delta_wk);
+}
+
+// Distributed versions, the gap and F are only stored for the local frequencies
+
+g_wk_dist_t eliashberg_g_delta_g_product(g_wk_vt g_wk, g_wk_dist_t const &delta_wk) {
+
+  auto wmesh    = std::get<0>(delta_wk.mesh());
+  auto wmesh_gf = std::get<0>(g_wk.mesh());
+
+  if (wmesh.size() > wmesh_gf.size())
+      TRIQS_RUNTIME_ERROR << "The size of the Matsubara frequency mesh of the Green's function"
+          " (" << wmesh_gf.size() << ") must be atleast the size of the mesh of Delta (" <<
+          wmesh.size() << ").";
+
+  g_wk_dist_t F_wk(delta_wk.mesh(), delta_wk.target_shape(), delta_wk.communicator());
+
+  auto w_arr  = delta_wk.local_points();
+  auto &kmesh = delta_wk.lattice_mesh();
+  long nk     = delta_wk.n_cols();
+  long nb     = delta_wk.target_shape()[0];
+
+  auto _           = all_t{};
+  auto minus_k     = minus_x_index_table(kmesh);
+  auto const &g    = g_wk.data();
+  long g_first_idx = wmesh_gf.first_index();
+
+  auto const &delta = delta_wk.data();
+  auto &F           = F_wk.data();
+
+#pragma omp parallel for
+  for (long idx = 0; idx < long(w_arr.size()) * nk; idx++) {
+    long widx = idx / nk, kidx = idx % nk;
+    long g_widx = w_arr[widx].index() - g_first_idx;
+
+    auto g_p = g(g_widx, kidx, _, _);
+    auto g_m = g(g_widx, minus_k[kidx], _, _);
+
+    for (long d = 0; d < nb; d++)
+      for (long c = 0; c < nb; c++)
+        for (long e = 0; e < nb; e++)
+          for (long f = 0; f < nb; f++) F(widx, kidx, d, c) += g_p(c, f) * nda::conj(g_m(e, d)) * delta(widx, kidx, e, f);
+  }
+
+  return F_wk;
+}
+
+g_wk_dist_t eliashberg_product_fft(chi_tr_dist_t const &Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r, g_wk_vt g_wk, g_wk_dist_t const &delta_wk) {
+
+  auto _ = all_t{};
+
+  auto F_wk = eliashberg_g_delta_g_product(g_wk, delta_wk);
+  auto F_tr = fourier_wk_to_tr(F_wk);
+
+  auto tmesh       = std::get<0>(F_tr.mesh());
+  auto tmesh_gamma = std::get<0>(Gamma_pp_dyn_tr.mesh());
+
+  if (tmesh.size() != tmesh_gamma.size())
+      TRIQS_RUNTIME_ERROR << "The size of the imaginary time mesh of Gamma"
+          " (" << tmesh_gamma.size() << ") must be the size of the mesh of Delta (" <<
+          tmesh.size() << ").";
+
+  long nr = F_tr.n_cols();
+  long nb = F_tr.target_shape()[0];
+
+  // Dynamic part, local in tau
+  g_tr_dist_t delta_tr_out(F_tr.mesh(), F_tr.target_shape(), F_tr.communicator());
+  {
+    auto const &Gamma = Gamma_pp_dyn_tr.data();
+    auto const &F     = F_tr.data();
+    auto &delta       = delta_tr_out.data();
+
+#pragma omp parallel for
+    for (long idx = 0; idx < F_tr.n_local_rows() * nr; idx++) {
+      long t = idx / nr, r = idx % nr;
+      for (long c = 0; c < nb; c++)
+        for (long a = 0; a < nb; a++)
+          for (long d = 0; d < nb; d++)
+            for (long b = 0; b < nb; b++) delta(t, r, a, b) += -0.5 * Gamma(t, r, c, a, d, b) * F(t, r, d, c);
+    }
+  }
+
+  // Constant part, needs F at the first tau point which is owned by rank 0
+  auto comm = F_tr.communicator();
+  nda::array<std::complex<double>, 3> F_t0(nr, nb, nb);
+  if (comm.rank() == 0) F_t0 = F_tr.data()(0, _, _, _);
+  mpi::broadcast(F_t0, comm, 0);
+
+  nda::array<std::complex<double>, 3> delta_r_out(nr, nb, nb);
+  delta_r_out() = 0;
+  for (auto r : Gamma_pp_const_r.mesh()) {
+    auto ridx = r.data_index();
+    for (auto [c, a, d, b] : Gamma_pp_const_r.target_indices())
+      delta_r_out(ridx, a, b) += -0.5 * Gamma_pp_const_r[r](c, a, d, b) * F_t0(ridx, d, c);
+  }
+
+  // FIXME
+  // This raises warnings when used with random delta input, e.g. eigenvalue finder
+  auto delta_wr_out = fourier_tr_to_wr(delta_tr_out);
+
+  // Combine dynamic and constant part
+  for (long widx = 0; widx < delta_wr_out.n_local_rows(); widx++) delta_wr_out.data()(widx, _, _, _) += delta_r_out;
+
+  return fourier_wr_to_wk(delta_wr_out);
 }
 
 // optimized version if there is only a constant term
 
-template<typename delta_out_t, typename g_t>  
+template<typename delta_out_t, typename gg_t, typename g_t>  
 delta_out_t eliashberg_product_fft_constant_template(chi_r_vt Gamma_pp_const_r,
-                                        g_t g_wk, g_t delta_wk) {
+                                        gg_t g_wk, g_t delta_wk) {
 
   auto F_wk = eliashberg_g_delta_g_product(g_wk, delta_wk);
-  auto F_wr = fourier_wk_to_wr(F_wk);
-  auto F_tr = fourier_wr_to_tr(F_wr);
+  auto F_tr = fourier_wk_to_tr(F_wk);
 
   auto delta_r_out = eliashberg_constant_gamma_f_product(Gamma_pp_const_r, F_tr);
   auto delta_k_out = make_gf_from_fourier<0>(delta_r_out);
@@ -317,11 +1000,15 @@ delta_out_t eliashberg_product_fft_constant_template(chi_r_vt Gamma_pp_const_r,
 }
 
 g_wk_t eliashberg_product_fft_constant(chi_r_vt Gamma_pp_const_r, g_wk_vt g_wk, g_wk_vt delta_wk) {
-  return eliashberg_product_fft_constant_template<g_wk_t, g_wk_vt>(Gamma_pp_const_r, g_wk, delta_wk);
+  return eliashberg_product_fft_constant_template<g_wk_t, g_wk_vt, g_wk_vt>(Gamma_pp_const_r, g_wk, delta_wk);
+}
+
+g_wk_t eliashberg_product_fft_constant(chi_r_vt Gamma_pp_const_r, chi_wk_vt gg_wk, g_wk_vt delta_wk) {
+  return eliashberg_product_fft_constant_template<g_wk_t, chi_wk_vt, g_wk_vt>(Gamma_pp_const_r, gg_wk, delta_wk);
 }
 
 g_Dwk_t eliashberg_product_fft_constant(chi_r_vt Gamma_pp_const_r, g_Dwk_vt g_wk, g_Dwk_vt delta_wk) {
-  return eliashberg_product_fft_constant_template<g_Dwk_t, g_Dwk_vt>(Gamma_pp_const_r, g_wk, delta_wk);
+  return eliashberg_product_fft_constant_template<g_Dwk_t, g_Dwk_vt, g_Dwk_vt>(Gamma_pp_const_r, g_wk, delta_wk);
 }
 
 
@@ -355,7 +1042,7 @@ chi_wk_t construct_phi_wk(chi_wk_vt chi, array_contiguous_view<std::complex<doub
 
       phi_wk[w, k] = phi_arr;
   }
-  phi_wk = mpi::all_reduce(phi_wk);
+  mpi_all_reduce_in_place(phi_wk);
 
   return phi_wk;
 }
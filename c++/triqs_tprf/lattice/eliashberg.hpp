@@ -21,7 +21,13 @@
  ******************************************************************************/
 #pragma once
 
+#include <string>
+#include <utility>
+#include <vector>
+
 #include "../types.hpp"
+#include "../distributed_gf.hpp"
+#include "../batched_tail_fit.hpp"
 
 namespace triqs_tprf {
 
@@ -150,6 +156,193 @@ namespace triqs_tprf {
   g_wk_t eliashberg_g_delta_g_product(g_wk_vt g_wk, g_wk_vt delta_wk);
   g_Dwk_t eliashberg_g_delta_g_product(g_Dwk_vt g_wk, g_Dwk_vt delta_wk);
 
+  /** Pair propagator kernel of the linearized Eliashberg product
+
+     The product of the two Green's functions entering the anomalous Green's function
+
+     .. math::
+         K_{dc,ef}(i\nu_n,\mathbf{k})
+         =
+         G_{cf}(i\nu_n,\mathbf{k})
+         G^*_{ed}(i\nu_n,-\mathbf{k})\,,
+
+     so that :math:`F_{dc} = K_{dc,ef}\Delta_{ef}`. It only depends on the Green's function
+     and can be computed once per Eliashberg solve, instead of at every product.
+
+     @param g_wk one-particle Green's function :math:`G_{a\bar{b}}(i\nu_n,\mathbf{k})`
+     @return The kernel :math:`K_{dc,ef}(i\nu_n,\mathbf{k})` on the mesh of the Green's function
+  */
+  chi_wk_t eliashberg_gg_kernel(g_wk_vt g_wk);
+
+  g_wk_t eliashberg_g_delta_g_product(chi_wk_vt gg_wk, g_wk_vt delta_wk);
+  g_wk_t eliashberg_product_fft(chi_tr_vt Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r, chi_wk_vt gg_wk, g_wk_vt delta_wk);
+  g_wk_t eliashberg_product_fft_constant(chi_r_vt Gamma_pp_const_r, chi_wk_vt gg_wk, g_wk_vt delta_wk);
+
+  /** Linearized Eliashberg product via FFT, distributed over MPI ranks
+
+     Same as eliashberg_product_fft, for a gap and dynamic vertex distributed over the ranks.
+     The Green's function and the static part of the vertex are kept on all ranks.
+
+     @param Gamma_pp_dyn_tr distributed dynamic part of the particle-particle vertex :math:`\Gamma^{\mathrm{s/t}, \mathrm{dynamic}}_{c\bar{a}d\bar{b}}(\tau, \mathbf{r})`
+     @param Gamma_pp_const_r static part of the particle-particle vertex :math:`\Gamma^{\mathrm{s/t}, \mathrm{static}}_{c\bar{a}d\bar{b}}(\mathbf{r})`
+     @param g_wk one-particle Green's function :math:`G_{a\bar{b}}(i\nu_n,\mathbf{k})`
+     @param delta_wk distributed superconducting gap :math:`\Delta^{\mathrm{s/t}, \mathrm{in}}_{\bar{a}\bar{b}}(i\nu_n,\mathbf{k})`
+     @return distributed result of the product :math:`\Delta^{\mathrm{s/t}, \mathrm{out}}`
+  */
+  g_wk_dist_t eliashberg_product_fft(chi_tr_dist_t const &Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r, g_wk_vt g_wk, g_wk_dist_t const &delta_wk);
+  g_wk_dist_t eliashberg_g_delta_g_product(g_wk_vt g_wk, g_wk_dist_t const &delta_wk);
+
+  /** Linearized Eliashberg product as a reusable operator
+
+     Same product as eliashberg_product_fft (or eliashberg_product_fft_constant), for repeated
+     application by an eigenvalue solver. The pair kernel :math:`G G`, the rearranged vertex and
+     all work arrays are set up once, so that an application of the operator only runs the
+     Fourier transforms and the products, without allocating the intermediate Green's functions.
+     The high frequency moments of the Matsubara transforms are fitted with fits set up once,
+     into per thread buffers.
+
+     The gap lives on the mesh of the Green's function. The operator can also be applied to
+     a block of gaps at once, in which case all Fourier transforms of the block are batched.
+
+     With set_projection the operator is restricted to one pairing symmetry sector, see there.
+  */
+  class eliashberg_operator {
+
+    public:
+    /**
+     @param Gamma_pp_dyn_tr dynamic part of the particle-particle vertex :math:`\Gamma^{\mathrm{s/t}, \mathrm{dynamic}}_{c\bar{a}d\bar{b}}(\tau, \mathbf{r})`
+     @param Gamma_pp_const_r static part of the particle-particle vertex :math:`\Gamma^{\mathrm{s/t}, \mathrm{static}}_{c\bar{a}d\bar{b}}(\mathbf{r})`
+     @param g_wk one-particle Green's function :math:`G_{a\bar{b}}(i\nu_n,\mathbf{k})`
+     */
+    eliashberg_operator(chi_tr_vt Gamma_pp_dyn_tr, chi_r_vt Gamma_pp_const_r, g_wk_vt g_wk);
+
+    /// Operator for a vertex without dynamic part, as eliashberg_product_fft_constant
+    eliashberg_operator(chi_r_vt Gamma_pp_const_r, g_wk_vt g_wk);
+
+    /// Mesh of the gap
+    g_wk_t::mesh_t const &mesh() const { return _mesh; }
+
+    /// Dimension of the flattened gap, the dimension of the reduced gap in a projected mode
+    long size() const { return _nw_out * _nk * long(_pairs.size()); }
+
+    /**
+     Restrict the operator to a pairing symmetry sector
+
+     The sector is given by the parities of the gap under :math:`i\nu_n \rightarrow -i\nu_n`
+     and :math:`\bar{a} \leftrightarrow \bar{b}`, for a spin singlet or triplet gap. The parity under
+     :math:`\mathbf{k} \rightarrow -\mathbf{k}` follows from the Pauli principle, it is even for
+     singlet gaps with the same frequency and orbital parity and for triplet gaps with opposite ones.
+
+     In the projected mode a gap is stored in reduced form, with the positive Matsubara frequencies
+     and the orbital pairs :math:`\bar{a} \le \bar{b}` (even) or :math:`\bar{a} < \bar{b}` (odd) only,
+     see restrict_gap and expand_gap. The block apply works on reduced gaps, which are expanded on
+     the fly for the product with :math:`GG`. The vertex products, the :math:`\tau \rightarrow i\nu_n`
+     and :math:`\mathbf{r} \rightarrow \mathbf{k}` transforms of the result and its work array only
+     run on the stored orbital pairs, and the result is only evaluated at the stored frequencies.
+     :math:`F = GG\Delta` and its transforms are computed at all frequencies and orbital pairs, as
+     without projection, so an apply costs less only by the result side. The eigenvalue solvers
+     further gain from the smaller dimension of the reduced gap.
+
+     This assumes that the operator commutes with the projection on the sector. The Pauli principle
+     only guarantees this for the combination of the three parities, the separate frequency and
+     orbital parities are conserved e.g. for a single orbital or for degenerate orbitals without
+     hybridization. It is checked once, here, by applying the full operator to a pseudo random gap
+     of the sector: if the result has a relative norm above 1e-5 outside of the sector the
+     operator is left without projection and an exception is thrown. This is a collective MPI call.
+
+     @param spin "singlet" or "triplet"
+     @param frequency "even" or "odd"
+     @param orbital "even" or "odd", parity under the exchange of the orbitals
+     */
+    void set_projection(std::string const &spin, std::string const &frequency, std::string const &orbital);
+
+    /// Back to the full space of gaps
+    void clear_projection();
+
+    /// Whether the operator is restricted to a pairing symmetry sector
+    bool is_projected() const { return _projected; }
+
+    /// Project a gap on the symmetry sector and return it in the reduced form of the block apply
+    nda::array<dcomplex, 1> restrict_gap(g_wk_vt delta) const;
+
+    /// Gap on the mesh of the Green's function from its reduced form
+    g_wk_t expand_gap(nda::array_const_view<dcomplex, 1> x) const;
+
+    /**
+     Apply the operator, :math:`\Delta^{\mathrm{out}} = \Lambda \Delta^{\mathrm{in}}`
+
+     In a projected mode the input gap is projected on the symmetry sector first.
+
+     @param delta_in superconducting gap :math:`\Delta^{\mathrm{s/t}, \mathrm{in}}_{\bar{a}\bar{b}}(i\nu_n,\mathbf{k})`
+     @param delta_out result of the product, on the same mesh
+     */
+    void apply(g_wk_vt delta_in, g_wk_vt delta_out);
+
+    /**
+     Apply the operator to a block of flattened gaps
+
+     @param x (n_vec, size()) array of gaps, each row is a gap with the data layout of :math:`\Delta(i\nu_n,\mathbf{k})_{\bar{a}\bar{b}}`,
+              or a reduced gap in a projected mode
+     @param y (n_vec, size()) array of the results
+     */
+    void apply(nda::array_const_view<dcomplex, 2> x, nda::array_view<dcomplex, 2> y);
+
+    private:
+    g_wk_t::mesh_t _mesh;
+    mesh::imtime _tmesh;
+    mesh::cyclat _rmesh;
+    long _nw, _nk, _nt, _nb, _m;
+    bool _has_dyn;
+
+    // High frequency moments of F for the w -> t transform, and the linear fit of the moments of D
+    // for the t -> w transform from the points of D(t) next to 0 and beta, both set up once
+    batched_tail_fitter _tail_fit;
+    std::vector<long> _deriv_rows;
+    nda::matrix<dcomplex> _deriv_fit;
+
+    // Symmetry sector: parities, first stored frequency, orbital pairs (a, b) of the reduced gap,
+    // and for all (a, b) the reduced pair and sign (-1 if the component vanishes)
+    bool _projected = false;
+    int _p_w = 1, _p_o = 1, _p_k = 1;
+    long _w_first = 0, _nw_out;
+    std::vector<std::pair<long, long>> _pairs;
+    std::vector<long> _pair_of, _minus_k;
+    std::vector<int> _pair_sign;
+
+    // Relative norm of the part of the probe result outside of the sector above which set_projection throws
+    static constexpr double _sector_tol = 1e-5;
+
+    // G G kernel (w, k, dc, ef), vertices as -1/2 Gamma (t, r, ab, dc) and (r, ab, dc)
+    nda::array<dcomplex, 4> _gg, _gamma_dyn;
+    nda::array<dcomplex, 3> _gamma_const;
+
+    // Per thread buffers of the w -> t transform of F and the t -> w transform of D, with the
+    // FFT input and output work arrays and the tail points and moments of both transforms
+    struct thread_buffers {
+      gf<imfreq, tensor_valued<1>> F_w, D_w;
+      gf<imtime, tensor_valued<1>> F_t, D_t;
+      nda::array<dcomplex, 2> wt_in, wt_out, tw_in, tw_out;
+      nda::matrix<dcomplex> F_tail, F_mom, D_tail, D_mom;
+    };
+
+    // Work arrays (w, k/r, vec * component), transformed in place, and per thread buffers, sized for the
+    // current block size. The result only holds the stored frequencies and orbital pairs.
+    long _n_vec = 0;
+    nda::array<dcomplex, 3> _F, _D;
+    std::vector<thread_buffers> _buf;
+
+    // Reduced input and result of the apply of a single gap in a projected mode
+    nda::array<dcomplex, 2> _x1, _y1;
+
+    void set_pairs();
+    void project(int p_w, int p_o, int p_k);
+    void resize(long n_vec);
+    dcomplex expanded(nda::array_const_view<dcomplex, 2> x, long i, long w, long k, long ab) const;
+    void expand(nda::array_const_view<dcomplex, 2> x, nda::array_view<dcomplex, 2> X) const;
+    void restrict_into(g_wk_vt delta, nda::array_view<dcomplex, 1> x) const;
+    void lattice_transform(nda::array<dcomplex, 3> &a, int fftw_backward_forward, double scale);
+  };
+
   /** Fourier transform Gamma parts to imaginary time and real-space  
   
   @param Gamma_pp_dyn_wk : The dynamic part of Gamma, which converges to zero for :math:`\omega_n \rightarrow \infty`.
@@ -0,0 +1,285 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <algorithm>
+#include <numeric>
+#include <random>
+
+#include <itertools/itertools.hpp>
+#include <mpi/mpi.hpp>
+#include <triqs/utility/exceptions.hpp>
+
+#include "eliashberg_block_solver.hpp"
+#include "../mpi.hpp"
+
+extern "C" {
+void zgeev_(char const *jobvl, char const *jobvr, int const *n, std::complex<double> *a, int const *lda, std::complex<double> *w,
+            std::complex<double> *vl, int const *ldvl, std::complex<double> *vr, int const *ldvr, std::complex<double> *work, int const *lwork,
+            double *rwork, int *info);
+}
+
+namespace triqs_tprf {
+
+  namespace {
+
+    using scalar_t = std::complex<double>;
+    using block_t  = nda::array<scalar_t, 2>; // (n_vec, dim), one vector per row
+
+    // Eigenvalues and right eigenvectors (columns) of a general matrix, ordered by decreasing real part
+    std::pair<nda::vector<scalar_t>, nda::matrix<scalar_t, nda::F_layout>> eig_by_real_part(nda::matrix<scalar_t, nda::F_layout> H) {
+
+      int n = H.shape()[0], info = 0, lwork = -1, ld_one = 1;
+      nda::vector<scalar_t> w(n);
+      nda::matrix<scalar_t, nda::F_layout> vr(n, n);
+      nda::vector<double> rwork(2 * n);
+      scalar_t work_size;
+
+      zgeev_("N", "V", &n, H.data(), &n, w.data(), nullptr, &ld_one, vr.data(), &n, &work_size, &lwork, rwork.data(), &info);
+      lwork = int(work_size.real());
+      nda::vector<scalar_t> work(lwork);
+      zgeev_("N", "V", &n, H.data(), &n, w.data(), nullptr, &ld_one, vr.data(), &n, work.data(), &lwork, rwork.data(), &info);
+      if (info != 0) TRIQS_RUNTIME_ERROR << "eliashberg_block_solver: zgeev failed, info = " << info;
+
+      std::vector<int> order(n);
+      std::iota(order.begin(), order.end(), 0);
+      std::stable_sort(order.begin(), order.end(), [&w](int i, int j) { return w(i).real() > w(j).real(); });
+
+      nda::vector<scalar_t> w_sorted(n);
+      nda::matrix<scalar_t, nda::F_layout> vr_sorted(n, n);
+      for (int j = 0; j < n; j++) {
+        w_sorted(j)                   = w(order[j]);
+        vr_sorted(nda::range::all, j) = vr(nda::range::all, order[j]);
+      }
+      return {w_sorted, vr_sorted};
+    }
+
+    // Rows of S^T X, the linear combinations of the first S.shape()[0] rows of X given by the columns of S
+    block_t combine(nda::matrix<scalar_t, nda::F_layout> const &S, block_t const &X) {
+      long n = S.shape()[0], m = S.shape()[1], dim = X.shape()[1];
+      block_t Y(m, dim);
+#pragma omp parallel for
+      for (long x = 0; x < dim; x++)
+        for (long j = 0; j < m; j++) {
+          scalar_t v = 0;
+          for (long i = 0; i < n; i++) v += S(i, j) * X(i, x);
+          Y(j, x) = v;
+        }
+      return Y;
+    }
+
+    // Norm of row r of the distributed block X
+    double row_norm(block_t const &X, long r, mpi::communicator c) {
+      double norm2 = 0;
+      for (long x = 0; x < X.shape()[1]; x++) norm2 += std::norm(X(r, x));
+      return std::sqrt(mpi::all_reduce(norm2, c));
+    }
+
+    // H_ij = <v_i, a_j> for the first n rows of the distributed blocks V and A
+    nda::matrix<scalar_t, nda::F_layout> projected_matrix(block_t const &V, block_t const &A, long n, mpi::communicator c) {
+      long dim = V.shape()[1];
+      nda::matrix<scalar_t, nda::F_layout> H(n, n);
+#pragma omp parallel for
+      for (long ij = 0; ij < n * n; ij++) {
+        long i = ij / n, j = ij % n;
+        scalar_t v = 0;
+        for (long x = 0; x < dim; x++) v += std::conj(V(i, x)) * A(j, x);
+        H(i, j) = v;
+      }
+      mpi_all_reduce_in_place(H.data(), H.size(), c);
+      return H;
+    }
+
+    // Orthogonalize row r of X against the first n rows of V, two passes of classical Gram-Schmidt,
+    // applying the same operations to row r of AX with the rows of AV if track is set
+    double orthogonalize_row(block_t const &V, block_t const &AV, long n, block_t &X, block_t &AX, long r, bool track, mpi::communicator c) {
+
+      long dim     = X.shape()[1];
+      double norm0 = row_norm(X, r, c);
+
+      nda::vector<scalar_t> coef(n);
+      for (int pass = 0; pass < 2; pass++) {
+#pragma omp parallel for
+        for (long i = 0; i < n; i++) {
+          scalar_t v = 0;
+          for (long x = 0; x < dim; x++) v += std::conj(V(i, x)) * X(r, x);
+          coef(i) = v;
+        }
+        mpi_all_reduce_in_place(coef.data(), coef.size(), c);
+#pragma omp parallel for
+        for (long x = 0; x < dim; x++)
+          for (long i = 0; i < n; i++) {
+            X(r, x) -= coef(i) * V(i, x);
+            if (track) AX(r, x) -= coef(i) * AV(i, x);
+          }
+      }
+
+      double norm = row_norm(X, r, c);
+      if (norm > 0) {
+        X(r, nda::range::all) /= norm;
+        if (track) AX(r, nda::range::all) /= norm;
+      }
+      return norm0 > 0 ? norm / norm0 : 0.;
+    }
+
+    // Orthonormalize the rows of X against the first n rows of V and among themselves and append them to V.
+    // Rows that are numerically linearly dependent are dropped. With track set, the same linear combinations
+    // of the rows of AX are appended to AV. Returns the new number of rows of V.
+    long append_orthonormal(block_t &V, block_t &AV, long n, block_t &X, block_t &AX, bool track, mpi::communicator c) {
+      for (long r = 0; r < X.shape()[0] && n < V.shape()[0]; r++) {
+        if (orthogonalize_row(V, AV, n, X, AX, r, track, c) < 1e-10) continue;
+        V(n, nda::range::all) = X(r, nda::range::all);
+        if (track) AV(n, nda::range::all) = AX(r, nda::range::all);
+        n++;
+      }
+      return n;
+    }
+
+    // The full rows of a block distributed over the ranks in slices [x0, x0 + X.shape()[1]) of the dimension dim
+    block_t gather_rows(block_t const &X, long x0, long dim, mpi::communicator c) {
+      block_t Xf(X.shape()[0], dim);
+      Xf() = 0;
+      Xf(nda::range::all, nda::range(x0, x0 + X.shape()[1])) = X;
+      mpi_all_reduce_in_place(Xf.data(), Xf.size(), c);
+      return Xf;
+    }
+
+  } // namespace
+
+  // ----------------------------------------------------
+
+  std::tuple<nda::array<dcomplex, 1>, std::vector<g_wk_t>> eliashberg_block_solver(eliashberg_operator &op, g_wk_vt initial_delta, int n_ev,
+                                                                                     int block_size, double tol, int max_iter) {
+
+    auto _   = nda::range::all;
+    long dim = op.size();
+    long b   = block_size > 0 ? block_size : n_ev;
+
+    // Search space of at most 2 (n_ev + b) vectors, restarted with n_ev + b Ritz vectors
+    long n_keep = n_ev + b, n_max = 2 * n_keep;
+    if (n_ev < 1 || n_max > dim) TRIQS_RUNTIME_ERROR << "eliashberg_block_solver: n_ev = " << n_ev << " and block_size = " << b << " are too large for the gap dimension " << dim << ".";
+    if (initial_delta.mesh() != op.mesh()) TRIQS_RUNTIME_ERROR << "eliashberg_block_solver: the initial gap must be on the mesh of the operator.";
+
+    // The vectors of the search space are distributed over the ranks in slices of the gap dimension
+    mpi::communicator comm;
+    auto [x0, x1] = itertools::chunk_range(0, dim, comm.size(), comm.rank());
+    auto local    = nda::range(x0, x1);
+
+    std::mt19937 rng(12345);
+    std::uniform_real_distribution<double> uniform(-1., 1.);
+
+    block_t V(n_max, x1 - x0), AV(n_max, x1 - x0), no_track;
+    long n = 0;
+
+    // Orthonormalize the new block and apply the operator to its full rows
+    auto extend = [&](block_t &X) {
+      long n0 = n;
+      n       = append_orthonormal(V, AV, n, X, no_track, false, comm);
+      auto W  = gather_rows(V(nda::range(n0, n), _), x0, dim, comm);
+      block_t AW(n - n0, dim);
+      if (n > n0) op.apply(W, AW);
+      AV(nda::range(n0, n), _) = AW(_, local);
+    };
+
+    // The same random vectors on all ranks, restricted to the local slice
+    auto random_block = [&](long n_rows) {
+      block_t X(n_rows, dim);
+      for (auto &v : X) v = scalar_t(uniform(rng), uniform(rng));
+      return block_t{X(_, local)};
+    };
+
+    // First block from the initial gap and random vectors
+    {
+      block_t X = random_block(b);
+      auto x    = op.restrict_gap(initial_delta);
+      X(0, _)   = x(local);
+      extend(X);
+    }
+
+    nda::vector<scalar_t> theta;
+    block_t Y;
+    bool converged = false;
+
+    for (int iter = 0; iter < max_iter; iter++) {
+
+      // Rayleigh-Ritz on the search space
+      auto [w, S] = eig_by_real_part(projected_matrix(V, AV, n, comm));
+      long n_ritz = std::min(n, n_keep);
+      nda::matrix<scalar_t, nda::F_layout> S_keep = S(_, nda::range(n_ritz));
+
+      theta  = w(nda::range(n_ritz));
+      Y      = combine(S_keep, V);
+      auto AY = combine(S_keep, AV);
+
+      // Residuals of the Ritz pairs, R = A y - theta y
+      block_t R = AY;
+      nda::vector<double> res(n_ritz);
+      for (long j = 0; j < n_ritz; j++) {
+        R(j, _) -= theta(j) * Y(j, _);
+        res(j) = row_norm(R, j, comm) / std::max(std::abs(theta(j)), 1e-300);
+      }
+
+      long n_conv = 0;
+      while (n_conv < std::min<long>(n_ev, n_ritz) && res(n_conv) < tol) n_conv++;
+      mpi::broadcast(n_conv, comm, 0);
+      if (n_conv >= n_ev) {
+        converged = true;
+        break;
+      }
+
+      // Thick restart with the leading Ritz vectors
+      if (n + b > n_max) {
+        block_t Q = Y, AQ = AY;
+        n         = append_orthonormal(V, AV, 0, Q, AQ, true, comm);
+      }
+
+      // Extend with the residuals of the leading unconverged Ritz pairs
+      long j0 = n_conv, j1 = std::min(n_conv + b, n_ritz);
+      block_t X = R(nda::range(j0, j1), _);
+      long n_before = n;
+      extend(X);
+      if (n == n_before) {
+        block_t X_rand = random_block(b);
+        extend(X_rand);
+      }
+      if (n == n_before) break; // the search space can not be extended
+    }
+
+    if (!converged)
+      TRIQS_RUNTIME_ERROR << "eliashberg_block_solver: the " << n_ev << " leading eigenpairs did not converge to tol = " << tol << " within "
+                          << max_iter << " iterations.";
+
+    // Ritz pairs of the final search space, the gaps are normalized on the full mesh
+    long n_out = n_ev;
+    auto Y_full = gather_rows(Y(nda::range(n_out), _), x0, dim, comm);
+    std::vector<g_wk_t> deltas;
+    for (long j = 0; j < n_out; j++) {
+      auto delta  = op.expand_gap(Y_full(j, _));
+      double norm = 0;
+      for (auto const &v : delta.data()) norm += std::norm(v);
+      if (norm > 0) delta.data() /= std::sqrt(norm);
+      deltas.push_back(std::move(delta));
+    }
+
+    return {nda::array<dcomplex, 1>(theta(nda::range(n_out))), deltas};
+  }
+
+} // namespace triqs_tprf
@@ -0,0 +1,62 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <tuple>
+#include <vector>
+
+#include "../types.hpp"
+#include "eliashberg.hpp"
+
+namespace triqs_tprf {
+
+  /** Leading eigenpairs of the linearized Eliashberg operator with a block Krylov method
+
+   Thick restarted block Krylov (block Arnoldi) iteration for the eigenvalues with the
+   largest real part. Every iteration applies the operator to a whole block of trial gaps,
+   so that their Fourier transforms are batched, and extends the search space with the
+   residuals of the unconverged Ritz pairs. When the search space is full it is
+   restarted with the n_ev + block_size leading Ritz vectors.
+
+   The operator application is distributed over the MPI ranks, and so are the vectors of
+   the search space, in slices of the gap dimension. The inner products and the projected
+   matrix are reduced over the ranks, only the small Rayleigh-Ritz eigenvalue problem is
+   replicated. The convergence decision is taken from rank 0, so all ranks follow the
+   same iteration.
+
+   If the operator is restricted to a pairing symmetry sector, see eliashberg_operator::set_projection,
+   the iteration runs on the reduced gaps and only finds the eigenpairs of that sector.
+
+   @param op Eliashberg operator
+   @param initial_delta initial gap, the other vectors of the first block are random
+   @param n_ev number of leading eigenpairs
+   @param block_size number of vectors per block, n_ev if not positive
+   @param tol convergence criterion on the residual norm relative to the eigenvalue
+   @param max_iter maximal number of block iterations
+   @return The n_ev eigenvalues ordered by decreasing real part and the corresponding normalized gaps.
+           Throws if they have not converged within max_iter iterations, or if the search space can
+           no longer be extended before they have.
+   */
+  std::tuple<nda::array<dcomplex, 1>, std::vector<g_wk_t>> eliashberg_block_solver(eliashberg_operator &op, g_wk_vt initial_delta, int n_ev = 6,
+                                                                                     int block_size = -1, double tol = 1e-10, int max_iter = 1000);
+
+} // namespace triqs_tprf
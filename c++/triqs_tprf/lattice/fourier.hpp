@@ -22,9 +22,11 @@
 #pragma once
 
 #include "../types.hpp"
+#include <itertools/itertools.hpp>
 #include "../fourier/fourier.hpp"
 #include <omp.h>
 #include "../mpi.hpp"
+#include "../distributed_gf.hpp"
 
 namespace triqs_tprf {
 
@@ -33,6 +35,37 @@ namespace triqs_tprf {
     using namespace fourier;
   }
 
+// Choice of work distribution for the (w, k) <-> (w, r) transforms. The frequency
+// parallel path runs one full lattice transform per frequency and leaves workers idle
+// when there are fewer frequencies than MPI ranks times OpenMP threads. In that case,
+// and for lattices large enough to amortize the extra reduction, the lattice
+// transform itself is split in slabs and pencils.
+
+inline long lattice_split_fft_min_size = 4096;
+
+inline bool use_lattice_split_fft(long n_w, long n_k, mpi::communicator c = {}) {
+  long n_workers = c.size() * omp_get_max_threads();
+  return n_w < n_workers && n_k >= lattice_split_fft_min_size;
+}
+
+// (w, k, target...) data viewed as (w, k, flattened target), the data must be contiguous
+template <typename A> auto lattice_batch_view(A &&a) {
+  using value_t = typename std::decay_t<A>::value_type;
+  long n0 = a.shape()[0], n1 = a.shape()[1];
+  return nda::array_view<value_t, 3>(std::array<long, 3>{n0, n1, a.size() / (n0 * n1)}, a.data());
+}
+
+// Same (n0, n1, rest) view of the data a, read only, copied into copy only if a is not contiguous in C order
+template <typename A> nda::array_const_view<dcomplex, 3> lattice_batch_view(A const &a, nda::array<dcomplex, std::decay_t<A>::rank> &copy) {
+  dcomplex const *ptr = a.data();
+  if (!a.indexmap().is_contiguous() || !a.indexmap().is_stride_order_C()) {
+    copy = a;
+    ptr  = copy.data();
+  }
+  long n0 = a.shape()[0], n1 = a.shape()[1];
+  return nda::array_const_view<dcomplex, 3>(std::array<long, 3>{n0, n1, a.size() / (n0 * n1)}, ptr);
+}
+
 template <typename Gf_type>
 auto fourier_Dwr_to_Dtr_general_target(Gf_type g_wr) {
 
@@ -59,7 +92,7 @@ auto fourier_Dwr_to_Dtr_general_target(Gf_type g_wr) {
       
     g_tr[_, r] = g_t;
   }
-  g_tr = mpi::all_reduce(g_tr);
+  mpi_all_reduce_in_place(g_tr);
   
   return g_tr;
 }
@@ -90,7 +123,7 @@ auto fourier_Dtr_to_Dwr_general_target(Gf_type g_tr) {
 
     g_wr[_, r] = g_w;
   }
-  g_wr = mpi::all_reduce(g_wr);
+  mpi_all_reduce_in_place(g_wr);
   
   return g_wr;
 }
@@ -125,7 +158,7 @@ auto fourier_wr_to_tr_general_target(Gf_type g_wr, int n_tau = -1) {
 
     g_tr[_, r] = g_t;
   }
-  g_tr = mpi::all_reduce(g_tr);
+  mpi_all_reduce_in_place(g_tr);
   return g_tr;
 }
 
@@ -158,14 +191,12 @@ auto fourier_tr_to_wr_general_target(Gf_type g_tr, int n_w = -1) {
 
     g_wr[_, r] = g_w;
   }
-  g_wr = mpi::all_reduce(g_wr);
+  mpi_all_reduce_in_place(g_wr);
   return g_wr;
 }
 
 template <typename Gf_type>
 auto fourier_wk_to_wr_general_target(Gf_type g_wk) {
-  
-  auto _ = all_t{};
 
   //auto [wmesh, kmesh] = g_wk.mesh();
   auto wmesh = std::get<0>(g_wk.mesh());
@@ -174,32 +205,17 @@ auto fourier_wk_to_wr_general_target(Gf_type g_wk) {
   auto rmesh = make_adjoint_mesh(kmesh);
   auto g_wr = make_gf<prod<decltype(wmesh), cyclat>>({wmesh, rmesh}, g_wk.target());
 
-  auto w0 = *wmesh.begin();
-  auto p = _fourier_plan<0>(gf_const_view(g_wk[w0, _]), gf_view(g_wr[w0, _]));
-
-  auto w_arr = mpi_view(wmesh);
-
-#pragma omp parallel for 
-  for (unsigned int idx = 0; idx < w_arr.size(); idx++) {
-    auto &w = w_arr[idx];
-
-    auto g_k = make_gf<brzone>(kmesh, g_wk.target());
-    auto g_r = make_gf<cyclat>(rmesh, g_wr.target());
-  
-    g_k = g_wk[w, _];
-
-    _fourier_with_plan<0>(gf_const_view(g_k), gf_view(g_r), p);
-
-    g_wr[w, _] = g_r;
-  }
-  g_wr = mpi::all_reduce(g_wr);
+  nda::array<dcomplex, std::decay_t<decltype(g_wk.data())>::rank> g_wk_copy;
+  auto g_wk_data = lattice_batch_view(g_wk.data(), g_wk_copy);
+  if (use_lattice_split_fft(wmesh.size(), kmesh.size()))
+    _fourier_lattice_split(rmesh, g_wk_data, lattice_batch_view(g_wr.data()));
+  else
+    _fourier_lattice_batched(rmesh, g_wk_data, lattice_batch_view(g_wr.data()));
   return g_wr;
 }
 
 template <typename Gf_type>
 auto fourier_wr_to_wk_general_target(Gf_type g_wr) {
-  
-  auto _ = all_t{};
 
   //auto [wmesh, rmesh] = g_wr.mesh();
   auto wmesh = std::get<0>(g_wr.mesh());
@@ -208,26 +224,292 @@ auto fourier_wr_to_wk_general_target(Gf_type g_wr) {
   auto kmesh = make_adjoint_mesh(rmesh);
   auto g_wk = make_gf<prod<decltype(wmesh), brzone>>({wmesh, kmesh}, g_wr.target());
 
-  auto w0 = *wmesh.begin();
-  auto p = _fourier_plan<0>(gf_const_view(g_wr[w0, _]), gf_view(g_wk[w0, _]));
+  nda::array<dcomplex, std::decay_t<decltype(g_wr.data())>::rank> g_wr_copy;
+  auto g_wr_data = lattice_batch_view(g_wr.data(), g_wr_copy);
+  if (use_lattice_split_fft(wmesh.size(), rmesh.size()))
+    _fourier_lattice_split(kmesh, g_wr_data, lattice_batch_view(g_wk.data()));
+  else
+    _fourier_lattice_batched(kmesh, g_wr_data, lattice_batch_view(g_wk.data()));
+  return g_wk;
+}
 
-  auto w_arr = mpi_view(wmesh);
+// ----------------------------------------------------
+// Fused (w, k) <-> (tau, r) transforms
+//
+// The flattened target is processed in blocks of components. Each block is
+// copied to a contiguous (w, k, block) buffer, transformed through the
+// intermediate (w, r) and written into the (tau, r) output (and the other way
+// round), so that only one block of the intermediate is held at any time.
+
+// Number of target blocks of the fused transforms, the last block may be smaller
+inline long fused_fourier_n_blocks = 8;
+
+// Components per block of the fused transforms for n_c components, values of
+// fused_fourier_n_blocks below one are taken as one block
+inline long fused_fourier_block_size(long n_c) {
+  long n_blocks = std::max(fused_fourier_n_blocks, long(1));
+  return std::max((n_c + n_blocks - 1) / n_blocks, long(1));
+}
 
-#pragma omp parallel for 
-  for (unsigned int idx = 0; idx < w_arr.size(); idx++) {
-    auto &w = w_arr[idx];
+// Contiguous (mesh0, mesh1, target...) data viewed as (mesh0, mesh1, flattened target)
+template <typename A> auto lattice_batch_const_view(A const &a) {
+  if (!a.indexmap().is_contiguous()) TRIQS_RUNTIME_ERROR << "lattice_batch_const_view: the data must be contiguous.";
+  long n0 = a.shape()[0], n1 = a.shape()[1];
+  return nda::array_const_view<dcomplex, 3>(std::array<long, 3>{n0, n1, long(a.size()) / (n0 * n1)}, a.data());
+}
 
-    auto g_r = make_gf<cyclat>(rmesh, g_wr.target());
-    auto g_k = make_gf<brzone>(kmesh, g_wk.target());
-  
-    g_r = g_wr[w, _];
+// Lattice transform of every (x, lattice, c) slice, the result is complete on all ranks
+template <typename Mesh_in, typename Mesh_out>
+void fourier_lattice_stage(Mesh_in const &m_in, Mesh_out const &m_out, nda::array<dcomplex, 3> const &a, nda::array<dcomplex, 3> &b) {
+
+  if (use_lattice_split_fft(a.shape()[0], m_in.size()))
+    _fourier_lattice_split(m_out, a, b);
+  else
+    _fourier_lattice_batched(m_out, a, b);
+}
+
+// Time/frequency transform of every (t, x, c) slice, only the lattice points x of this rank are written
+template <typename Mesh_in, typename Mesh_out>
+void fourier_time_stage(Mesh_in const &m_in, Mesh_out const &m_out, nda::array<dcomplex, 3> const &a,
+                        nda::array_view<dcomplex, 3, nda::C_stride_layout> b) {
+
+  auto _   = all_t{};
+  long n_x = a.shape()[1], n_c = a.shape()[2];
+
+  auto g_i = gf<Mesh_in, tensor_valued<1>>{m_in, {n_c}};
+  auto g_o = gf<Mesh_out, tensor_valued<1>>{m_out, {n_c}};
+  auto p   = _fourier_plan<0>(gf_const_view(g_i), gf_view(g_o));
+
+  mpi::communicator c;
+  auto [x0, x1] = itertools::chunk_range(0, n_x, c.size(), c.rank());
+
+#pragma omp parallel for
+  for (long x = x0; x < x1; x++) {
+    auto g_a = gf<Mesh_in, tensor_valued<1>>{m_in, {n_c}};
+    auto g_b = gf<Mesh_out, tensor_valued<1>>{m_out, {n_c}};
+    g_a.data() = a(_, x, _);
+    _fourier_with_plan<0>(gf_const_view(g_a), gf_view(g_b), p);
+    b(_, x, _) = g_b.data();
+  }
+}
+
+template <typename Gf_type>
+auto fourier_wk_to_tr_general_target(Gf_type g_wk, int n_tau = -1) {
+
+  auto _ = all_t{};
+
+  auto wmesh = std::get<0>(g_wk.mesh());
+  auto kmesh = std::get<1>(g_wk.mesh());
+  auto tmesh = make_adjoint_mesh(wmesh, n_tau);
+  auto rmesh = make_adjoint_mesh(kmesh);
+
+  auto g_tr = make_gf<prod<imtime, cyclat>>({tmesh, rmesh}, g_wk.target());
+  g_tr.data() = 0;
+
+  auto in  = lattice_batch_const_view(g_wk.data());
+  auto out = lattice_batch_view(g_tr.data());
+
+  long n_c = in.shape()[2], n_blk = fused_fourier_block_size(n_c);
+
+  for (long c0 = 0; c0 < n_c; c0 += n_blk) {
+    auto blk = nda::range(c0, std::min(c0 + n_blk, n_c));
+    nda::array<dcomplex, 3> a = in(_, _, blk);
+    nda::array<dcomplex, 3> b(wmesh.size(), rmesh.size(), blk.size());
+    fourier_lattice_stage(kmesh, rmesh, a, b);
+    fourier_time_stage(wmesh, tmesh, b, out(_, _, blk));
+  }
+
+  mpi_all_reduce_in_place(g_tr);
+  return g_tr;
+}
+
+template <typename Gf_type>
+auto fourier_tr_to_wk_general_target(Gf_type g_tr, int n_w = -1) {
+
+  auto _ = all_t{};
+
+  auto tmesh = std::get<0>(g_tr.mesh());
+  auto rmesh = std::get<1>(g_tr.mesh());
+  auto wmesh = make_adjoint_mesh(tmesh, n_w);
+  auto kmesh = make_adjoint_mesh(rmesh);
+
+  auto g_wk = make_gf<prod<imfreq, brzone>>({wmesh, kmesh}, g_tr.target());
 
-    _fourier_with_plan<0>(gf_const_view(g_r), gf_view(g_k), p);
+  auto in  = lattice_batch_const_view(g_tr.data());
+  auto out = lattice_batch_view(g_wk.data());
 
-    g_wk[w, _] = g_k;
+  long n_c = in.shape()[2], n_blk = fused_fourier_block_size(n_c);
+
+  for (long c0 = 0; c0 < n_c; c0 += n_blk) {
+    auto blk = nda::range(c0, std::min(c0 + n_blk, n_c));
+    nda::array<dcomplex, 3> a = in(_, _, blk);
+    nda::array<dcomplex, 3> b(wmesh.size(), rmesh.size(), blk.size()), d(wmesh.size(), kmesh.size(), blk.size());
+    b() = 0;
+    fourier_time_stage(tmesh, wmesh, a, b);
+    mpi_all_reduce_in_place(b.data(), b.size());
+    fourier_lattice_stage(rmesh, kmesh, b, d);
+    out(_, _, blk) = d;
   }
-  g_wk = mpi::all_reduce(g_wk);
+
   return g_wk;
 }
 
+// ----------------------------------------------------
+// Lattice transforms of objects that are real in r-space
+
+// (k, target...) data viewed as (k, flattened target), the data must be contiguous
+template <typename A> auto lattice_flat_view(A &&a) {
+  using value_t = typename std::decay_t<A>::value_type;
+  long n0       = a.shape()[0];
+  return nda::array_view<value_t, 2>(std::array<long, 2>{n0, a.size() / n0}, a.data());
+}
+
+// Same (k, flattened target) view of the data a, read only, copied into copy only if a is not contiguous in C order
+template <typename A> nda::array_const_view<dcomplex, 2> lattice_flat_view(A const &a, nda::array<dcomplex, std::decay_t<A>::rank> &copy) {
+  dcomplex const *ptr = a.data();
+  if (!a.indexmap().is_contiguous() || !a.indexmap().is_stride_order_C()) {
+    copy = a;
+    ptr  = copy.data();
+  }
+  long n0 = a.shape()[0];
+  return nda::array_const_view<dcomplex, 2>(std::array<long, 2>{n0, a.size() / n0}, ptr);
+}
+
+// Element-wise check of g(-k) = conj(g(k)), i.e. g(r) real
+template <typename Gf_type> bool is_real_in_r(Gf_type const &g, double tol = 1e-12) {
+  if constexpr (std::is_same_v<std::decay_t<decltype(g.mesh())>, triqs::mesh::brzone>) {
+    nda::array<dcomplex, std::decay_t<decltype(g.data())>::rank> copy;
+    return _is_real_in_r(g.mesh(), lattice_flat_view(g.data(), copy), tol);
+  } else
+    return max_element(abs(imag(g.data()))) <= tol;
+}
+
+template <typename Gf_type>
+auto fourier_k_to_r_general_target(Gf_type g_k, bool real_r) {
+
+  auto rmesh = make_adjoint_mesh(g_k.mesh());
+  auto g_r   = gf<cyclat, typename Gf_type::target_t>{rmesh, g_k.target_shape()};
+
+  nda::array<dcomplex, std::decay_t<decltype(g_k.data())>::rank> g_k_copy;
+  if (real_r)
+    _fourier_lattice_real(rmesh, lattice_flat_view(g_k.data(), g_k_copy), lattice_flat_view(g_r.data()));
+  else
+    g_r = make_gf_from_fourier(g_k);
+
+  return g_r;
+}
+
+template <typename Gf_type>
+auto fourier_r_to_k_general_target(Gf_type g_r, bool real_r) {
+
+  auto kmesh = make_adjoint_mesh(g_r.mesh());
+  auto g_k   = gf<brzone, typename Gf_type::target_t>{kmesh, g_r.target_shape()};
+
+  nda::array<dcomplex, std::decay_t<decltype(g_r.data())>::rank> g_r_copy;
+  if (real_r)
+    _fourier_lattice_real(kmesh, lattice_flat_view(g_r.data(), g_r_copy), lattice_flat_view(g_k.data()));
+  else
+    g_k = make_gf_from_fourier(g_r);
+
+  return g_k;
+}
+
+// ----------------------------------------------------
+// Distributed Green's functions
+
+// Lattice transform (k <-> r) of every local row, no communication needed.
+
+template <typename Gf_out, typename Gf_in>
+distributed_gf<Gf_out> fourier_lattice_distributed(distributed_gf<Gf_in> const &g_in) {
+
+  using g_in_t  = distributed_gf<Gf_in>;
+  using g_out_t = distributed_gf<Gf_out>;
+
+  auto const &mesh = g_in.mesh();
+  auto lat_mesh    = make_adjoint_mesh(g_in.lattice_mesh());
+
+  auto out_mesh = [&]() {
+    if constexpr (g_in_t::n_meshes == 2)
+      return typename Gf_out::mesh_t{std::get<0>(mesh), lat_mesh};
+    else
+      return typename Gf_out::mesh_t{std::get<0>(mesh), std::get<1>(mesh), lat_mesh};
+  }();
+
+  g_out_t g_out(out_mesh, g_in.target_shape(), g_in.communicator());
+
+  auto g_i = typename g_in_t::lattice_gf_t{g_in.lattice_mesh(), g_in.target_shape()};
+  auto g_o = typename g_out_t::lattice_gf_t{lat_mesh, g_in.target_shape()};
+  auto p   = _fourier_plan<0>(gf_const_view(g_i), gf_view(g_o));
+
+#pragma omp parallel for
+  for (long idx = 0; idx < g_in.n_local_rows(); idx++) {
+    auto g_l = g_in.lattice_slice(idx);
+    auto g_a = typename g_out_t::lattice_gf_t{lat_mesh, g_in.target_shape()};
+    _fourier_with_plan<0>(gf_const_view(g_l), gf_view(g_a), p);
+    g_out.set_lattice_slice(idx, g_a);
+  }
+
+  return g_out;
+}
+
+// Matsubara frequency <-> imaginary time transform of a distributed (w, r) or
+// (t, r) object. The data is redistributed to complete frequency/time slices
+// for a subset of lattice points, transformed and redistributed back.
+
+template <typename Gf_out, typename Gf_in, typename Mesh_out>
+distributed_gf<Gf_out> fourier_time_distributed(distributed_gf<Gf_in> const &g_in, Mesh_out const &out_mesh) {
+
+  static_assert(distributed_gf<Gf_in>::n_meshes == 2, "fourier_time_distributed: only (time/frequency, lattice) meshes are supported.");
+
+  using scalar_t = typename Gf_in::scalar_t;
+  using target_t = typename Gf_in::target_t;
+  using in_mesh_t = std::decay_t<decltype(std::get<0>(g_in.mesh()))>;
+
+  auto _ = all_t{};
+  auto c = g_in.communicator();
+
+  auto const &in_mesh = std::get<0>(g_in.mesh());
+  auto const &rmesh   = g_in.lattice_mesh();
+  auto shape          = g_in.target_shape();
+  long n_target       = g_in.target_size();
+
+  auto in_cols = mpi_rows_to_cols<scalar_t>(g_in.data_3d(), in_mesh.size(), c);
+  long n_local_cols = in_cols.shape()[1];
+
+  nda::array<scalar_t, 3> out_cols(out_mesh.size(), n_local_cols, n_target);
+
+  auto g_i = gf<in_mesh_t, target_t>{in_mesh, shape};
+  auto g_o = gf<Mesh_out, target_t>{out_mesh, shape};
+  auto p   = _fourier_plan<0>(gf_const_view(g_i), gf_view(g_o));
+
+#pragma omp parallel for
+  for (long j = 0; j < n_local_cols; j++) {
+    auto g_a = gf<in_mesh_t, target_t>{in_mesh, shape};
+    auto g_b = gf<Mesh_out, target_t>{out_mesh, shape};
+
+    auto a_dat = nda::array_view<scalar_t, 2>(std::array<long, 2>{long(in_mesh.size()), n_target}, g_a.data().data());
+    auto b_dat = nda::array_view<scalar_t, 2>(std::array<long, 2>{long(out_mesh.size()), n_target}, g_b.data().data());
+
+    a_dat = in_cols(_, j, _);
+    _fourier_with_plan<0>(gf_const_view(g_a), gf_view(g_b), p);
+    out_cols(_, j, _) = b_dat;
+  }
+
+  distributed_gf<Gf_out> g_out({out_mesh, rmesh}, shape, c);
+  auto out_dat = g_out.data_3d();
+  out_dat      = mpi_cols_to_rows<scalar_t>(out_cols, rmesh.size(), c);
+
+  return g_out;
+}
+
+template <typename Gf_out, typename Gf_in>
+distributed_gf<Gf_out> fourier_wr_to_tr_distributed(distributed_gf<Gf_in> const &g_wr, int n_tau = -1) {
+  return fourier_time_distributed<Gf_out>(g_wr, make_adjoint_mesh(std::get<0>(g_wr.mesh()), n_tau));
+}
+
+template <typename Gf_out, typename Gf_in>
+distributed_gf<Gf_out> fourier_tr_to_wr_distributed(distributed_gf<Gf_in> const &g_tr, int n_w = -1) {
+  return fourier_time_distributed<Gf_out>(g_tr, make_adjoint_mesh(std::get<0>(g_tr.mesh()), n_w));
+}
+
 } // namespace triqs_tprf
@@ -19,6 +19,10 @@
  *
  ******************************************************************************/
 
+#include <itertools/itertools.hpp>
+#include <nda/blas.hpp>
+#include <triqs/utility/exceptions.hpp>
+
 #include "fourier_interpolation.hpp"
 
 namespace triqs_tprf {
@@ -26,44 +30,66 @@ namespace triqs_tprf {
 // ----------------------------------------------------
 // fourier interpolation
 
-array<std::complex<double>, 6> cluster_mesh_fourier_interpolation(array<double, 2> k_vecs, chi_wr_cvt chi) {
+array<std::complex<double>, 6> cluster_mesh_fourier_interpolation(array<double, 2> k_vecs, chi_wr_cvt chi, long k_chunk) {
+
+  using scalar_t = std::complex<double>;
 
-  int nk = k_vecs.shape()[0];
-  int nb = chi.target().shape()[0];
-  int nw = std::get<0>(chi.mesh()).size();
+  if (k_vecs.shape()[1] != 3)
+    TRIQS_RUNTIME_ERROR << "cluster_mesh_fourier_interpolation: k_vecs must have shape (nk, 3), got second dimension " << k_vecs.shape()[1];
+  if (k_chunk < 1) TRIQS_RUNTIME_ERROR << "cluster_mesh_fourier_interpolation: k_chunk must be positive, got " << k_chunk;
+
+  long nk = k_vecs.shape()[0];
+  long nb = chi.target().shape()[0];
 
   auto wmesh = std::get<0>(chi.mesh());
   auto rmesh = std::get<1>(chi.mesh());
 
-  array<std::complex<double>, 6> chi_out(nw, nk, nb, nb, nb, nb);
+  long nw = wmesh.size(), nr = rmesh.size(), m = nb * nb * nb * nb;
 
-#pragma omp parallel for
-  for(int kidx = 0; kidx < nk; kidx++) {
-    
-    chi_out(range::all, kidx, range::all, range::all, range::all, range::all) *= 0.;
+  // -- chi as an nr x (nw nb^4) matrix, and the lattice vectors
+
+  auto chi_dat = chi.data();
+  nda::matrix<scalar_t> chi_mat(nr, nw * m);
+  nda::matrix<double> r_vecs(nr, 3);
+
+  for (auto r : rmesh) {
+    long ridx = r.data_index();
+    for (int i = 0; i < 3; i++) r_vecs(ridx, i) = r[i];
+    for (long widx = 0; widx < nw; widx++) {
+      long x = widx * m;
+      for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb)) chi_mat(ridx, x++) = chi_dat(widx, ridx, a, b, c, d);
+    }
+  }
 
-    auto k = k_vecs(kidx, range::all);
+  // -- chi(k) = sum_r exp(-i k.r) chi(r) as one GEMM per chunk of k points
 
-    for (auto r : rmesh) {
+  array<scalar_t, 6> chi_out(nw, nk, nb, nb, nb, nb);
+
+  long n_chunk = std::min(k_chunk, nk);
+  nda::matrix<scalar_t> phase(n_chunk, nr), chi_k(n_chunk, nw * m);
+
+  for (long k0 = 0; k0 < nk; k0 += k_chunk) {
+    long nkc = std::min(k_chunk, nk - k0);
+
+    auto phase_c = phase(range(nkc), range::all);
+    auto chi_k_c = chi_k(range(nkc), range::all);
 
-      /*
 #pragma omp parallel for
-    for (int idx = 0; idx < rmesh.size(); idx++) {
-      auto iter = rmesh.begin(); iter += idx; auto r = *iter;
-    */
-
-      auto dot_prod = k[0]*r[0] + k[1]*r[1] + k[2]*r[2];
-      auto exponent = exp( - std::complex<double>(0., dot_prod) );
-
-      for (auto w : wmesh) {
-        int widx = w.data_index();
-        for (int a : range(nb))
-          for (int b : range(nb))
-            for (int c : range(nb))
-              for (int d : range(nb)) chi_out(widx, kidx, a, b, c, d) += exponent * chi[w, r](a, b, c, d);
+    for (long kidx = 0; kidx < nkc; kidx++)
+      for (long ridx = 0; ridx < nr; ridx++) {
+        double dot_prod = k_vecs(k0 + kidx, 0) * r_vecs(ridx, 0) + k_vecs(k0 + kidx, 1) * r_vecs(ridx, 1) + k_vecs(k0 + kidx, 2) * r_vecs(ridx, 2);
+        phase_c(kidx, ridx) = std::exp(-scalar_t(0., dot_prod));
       }
-    }
+
+    nda::blas::gemm(1.0, phase_c, chi_mat, 0.0, chi_k_c);
+
+    // rows of chi_k are (w, abcd) blocks, each contiguous in chi_out(w, k, a, b, c, d)
+#pragma omp parallel for
+    for (long kidx = 0; kidx < nkc; kidx++)
+      for (long widx = 0; widx < nw; widx++)
+        std::copy_n(&chi_k_c(kidx, widx * m), m, chi_out.data() + (widx * nk + k0 + kidx) * m);
   }
+
   return chi_out;
 }
 
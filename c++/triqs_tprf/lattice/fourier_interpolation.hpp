@@ -24,6 +24,20 @@
 
 namespace triqs_tprf {
 
-array<std::complex<double>, 6> cluster_mesh_fourier_interpolation(array<double, 2> k_vecs, chi_wr_cvt chi);
+/** Fourier interpolation of a real space two-particle response function to arbitrary k-points
+
+  .. math::
+    \chi_{abcd}(i\omega_n, \mathbf{k}) = \sum_{\mathbf{r}} e^{-i \mathbf{k} \cdot \mathbf{r}} \chi_{abcd}(i\omega_n, \mathbf{r})
+
+  evaluated as a matrix product of the (nk, nr) phase factors with :math:`\chi` reshaped to (nr, nw nb^4).
+  The k-points are processed in chunks of k_chunk points, bounding the memory of the phase factors.
+  For paths too large to hold the result, call the function on consecutive slices of k_vecs.
+
+  @param k_vecs k-points, shape (nk, 3)
+  @param chi two-particle response function :math:`\chi_{abcd}(i\omega_n, \mathbf{r})`
+  @param k_chunk number of k-points per matrix product
+  @return :math:`\chi_{abcd}(i\omega_n, \mathbf{k})` with shape (nw, nk, nb, nb, nb, nb)
+ */
+array<std::complex<double>, 6> cluster_mesh_fourier_interpolation(array<double, 2> k_vecs, chi_wr_cvt chi, long k_chunk = 1024);
 
 } // namespace triqs_tprf
@@ -53,7 +53,7 @@ g_t lattice_dyson_g0_Xk(double mu, e_k_cvt e_k, mesh_t mesh) {
     g0_wk[w, k] = inverse((w + mu)*I - e_k[k]);      
   }
 
-  g0_wk = mpi::all_reduce(g0_wk);
+  mpi_all_reduce_in_place(g0_wk);
   return g0_wk;
 }
 
@@ -82,7 +82,7 @@ g_fk_t lattice_dyson_g0_fk(double mu, e_k_cvt e_k, mesh::refreq mesh, double del
     g0_fk[f, k]  = inverse((f + idelta + mu) * I - e_k[k]);
   }
 
-  g0_fk = mpi::all_reduce(g0_fk);
+  mpi_all_reduce_in_place(g0_fk);
   return g0_fk;
 }
 
@@ -118,7 +118,7 @@ g_t lattice_dyson_g_Xk(double mu, e_k_cvt e_k, sigma_t sigma, double delta=0.){
     g_wk[w, k] = inverse((w + idelta + mu)*I - e_k[k] - sigmaterm);
   }
 
-  g_wk = mpi::all_reduce(g_wk);
+  mpi_all_reduce_in_place(g_wk);
   return g_wk;
 }
 
@@ -139,6 +139,31 @@ g_Dwk_t lattice_dyson_g_wk(double mu, e_k_cvt e_k, g_Dw_cvt sigma_w) {
   return lattice_dyson_g_Xk<g_Dwk_t, g_Dw_cvt>(mu, e_k, sigma_w);
 }
 
+g_wk_dist_t lattice_dyson_g_wk(double mu, e_k_cvt e_k, g_wk_dist_t const &sigma_wk) {
+
+  if (e_k.mesh() != sigma_wk.lattice_mesh()) TRIQS_RUNTIME_ERROR << "lattice_dyson_g_wk: k-space meshes are not the same\n";
+
+  using scalar_t = e_k_cvt::scalar_t;
+  auto I = nda::eye<scalar_t>(e_k.target_shape()[0]);
+  auto _ = all_t{};
+
+  g_wk_dist_t g_wk(sigma_wk.mesh(), sigma_wk.target_shape(), sigma_wk.communicator());
+
+  auto w_arr = sigma_wk.local_points();
+  long nk    = sigma_wk.n_cols();
+
+#pragma omp parallel for
+  for (long idx = 0; idx < long(w_arr.size()) * nk; idx++) {
+    long widx = idx / nk, kidx = idx % nk;
+    auto &w = w_arr[widx];
+    auto e     = make_matrix_view(e_k.data()(kidx, _, _));
+    auto sigma = make_matrix_view(sigma_wk.data()(widx, kidx, _, _));
+    g_wk.data()(widx, kidx, _, _) = inverse((w + mu) * I - e - sigma);
+  }
+
+  return g_wk;
+}
+
 g_fk_t lattice_dyson_g_fk(double mu, e_k_cvt e_k, g_fk_cvt sigma_fk, double delta) {
   return lattice_dyson_g_Xk<g_fk_t, g_fk_cvt>(mu, e_k, sigma_fk, delta);
 }
@@ -186,7 +211,7 @@ g_t lattice_dyson_g_X(double mu, e_k_cvt e_k, sigma_t sigma, double delta=0.){
     }
   }
   
-  g_w = mpi::all_reduce(g_w);
+  mpi_all_reduce_in_place(g_w);
   g_w /= e_k.mesh().size();
   return g_w;
 }
@@ -273,6 +298,56 @@ g_Dtr_t fourier_wr_to_tr(g_Dwr_cvt g_wr, int nt) {
   auto g_tr = fourier_Dwr_to_Dtr_general_target(g_wr);
   return g_tr;
 }
+
+// ----------------------------------------------------
+// Fused transformations: (Matsubara frequency, k) <-> (imaginary time, r)
+
+g_tr_t fourier_wk_to_tr(g_wk_cvt g_wk, int nt) {
+  auto g_tr = fourier_wk_to_tr_general_target(g_wk, nt);
+  return g_tr;
+}
+
+g_wk_t fourier_tr_to_wk(g_tr_cvt g_tr, int nw) {
+  auto g_wk = fourier_tr_to_wk_general_target(g_tr, nw);
+  return g_wk;
+}
+
+// DLR meshes are small, the intermediate is kept
+g_Dtr_t fourier_wk_to_tr(g_Dwk_cvt g_wk, int nt) {
+  auto g_tr = fourier_Dwr_to_Dtr_general_target(fourier_wk_to_wr_general_target(g_wk));
+  return g_tr;
+}
+
+g_Dwk_t fourier_tr_to_wk(g_Dtr_cvt g_tr, int nw) {
+  auto g_wk = fourier_wr_to_wk_general_target(fourier_Dtr_to_Dwr_general_target(g_tr));
+  return g_wk;
+}
+
+// ----------------------------------------------------
+// Transformations of distributed Green's functions
+
+g_wr_dist_t fourier_wk_to_wr(g_wk_dist_t const &g_wk) { return fourier_lattice_distributed<g_wr_t>(g_wk); }
+
+g_wk_dist_t fourier_wr_to_wk(g_wr_dist_t const &g_wr) { return fourier_lattice_distributed<g_wk_t>(g_wr); }
+
+g_tr_dist_t fourier_wr_to_tr(g_wr_dist_t const &g_wr, int nt) { return fourier_wr_to_tr_distributed<g_tr_t>(g_wr, nt); }
+
+g_wr_dist_t fourier_tr_to_wr(g_tr_dist_t const &g_tr, int nw) { return fourier_tr_to_wr_distributed<g_wr_t>(g_tr, nw); }
+
+g_tr_dist_t fourier_wk_to_tr(g_wk_dist_t const &g_wk, int nt) { return fourier_wr_to_tr(fourier_wk_to_wr(g_wk), nt); }
+
+g_wk_dist_t fourier_tr_to_wk(g_tr_dist_t const &g_tr, int nw) { return fourier_wr_to_wk(fourier_tr_to_wr(g_tr, nw)); }
+
+// ----------------------------------------------------
+// Transformations of static lattice quantities
+
+e_r_t fourier_k_to_r(e_k_cvt X_k, bool real_r) { return fourier_k_to_r_general_target(X_k, real_r); }
+
+chi_r_t fourier_k_to_r(chi_k_cvt X_k, bool real_r) { return fourier_k_to_r_general_target(X_k, real_r); }
+
+e_k_t fourier_r_to_k(e_r_cvt X_r, bool real_r) { return fourier_r_to_k_general_target(X_r, real_r); }
+
+chi_k_t fourier_r_to_k(chi_r_cvt X_r, bool real_r) { return fourier_r_to_k_general_target(X_r, real_r); }
   
   
 } // namespace triqs_tprf
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "../types.hpp"
+#include "../distributed_gf.hpp"
 
 namespace triqs_tprf {
 
@@ -142,6 +143,18 @@ namespace triqs_tprf {
  */
   g_Dwk_t lattice_dyson_g_wk(double mu, e_k_cvt e_k, g_Dwk_cvt sigma_wk);
 
+  /** Construct an interacting Matsubara frequency lattice Green's function, distributed over MPI ranks
+
+ Same as lattice_dyson_g_wk, but only the frequencies of the local rows of the
+ distributed self energy are computed and stored.
+
+ @param mu chemical potential :math:`\mu`
+ @param e_k discretized lattice dispersion :math:`\epsilon_{\bar{a}b}(\mathbf{k})`
+ @param sigma_wk distributed imaginary frequency self-energy $\Sigma_{\bar{a}b}(i\omega_n, \mathbf{k})$
+ @return distributed Matsubara frequency lattice Green's function $G_{a\bar{b}}(i\omega_n, \mathbf{k})$
+ */
+  g_wk_dist_t lattice_dyson_g_wk(double mu, e_k_cvt e_k, g_wk_dist_t const &sigma_wk);
+
   /** Construct an interacting Matsubara frequency lattice Green's function :math:`G_{a\bar{b}}(i\omega_n, \mathbf{k})`
    
  Computes
@@ -305,6 +318,71 @@ namespace triqs_tprf {
  */
   g_wr_t fourier_tr_to_wr(g_tr_cvt g_tr, int nw = -1);
   g_Dwr_t fourier_tr_to_wr(g_Dtr_cvt g_tr, int nw = -1);
+
+  /** Fused fast fourier transform of Green's function from k-space and Matsubara frequency to real space and imaginary time
+
+    Computes: :math:`G_{a\bar{b}}(\tau, \mathbf{r}) = \mathcal{F} \left\{ G_{a\bar{b}}(i\omega_n, \mathbf{k}) \right\}`
+
+    Equivalent to fourier_wr_to_tr(fourier_wk_to_wr(g_wk), nt), but the target components
+    are transformed in blocks and the :math:`(i\omega_n, \mathbf{r})` intermediate is only
+    allocated for one block at a time.
+
+    @param g_wk k-space imaginary frequency Green's function :math:`G_{a\bar{b}}(i\omega_n, \mathbf{k})`
+    @param nt number of imaginary time points, -1 for the default of the adjoint mesh
+    @return real-space imaginary time Green's function :math:`G_{a\bar{b}}(\tau, \mathbf{r})`
+ */
+  g_tr_t fourier_wk_to_tr(g_wk_cvt g_wk, int nt = -1);
+  g_Dtr_t fourier_wk_to_tr(g_Dwk_cvt g_wk, int nt = -1);
+
+  /** Fused fast fourier transform of Green's function from real space and imaginary time to k-space and Matsubara frequency
+
+    Computes: :math:`G_{a\bar{b}}(i\omega_n, \mathbf{k}) = \mathcal{F} \left\{ G_{a\bar{b}}(\tau, \mathbf{r}) \right\}`
+
+    The reverse of fourier_wk_to_tr, with the same blocking of the target components.
+
+    @param g_tr real-space imaginary time Green's function :math:`G_{a\bar{b}}(\tau, \mathbf{r})`
+    @param nw number of Matsubara frequencies, -1 for the default of the adjoint mesh
+    @return k-space imaginary frequency Green's function :math:`G_{a\bar{b}}(i\omega_n, \mathbf{k})`
+ */
+  g_wk_t fourier_tr_to_wk(g_tr_cvt g_tr, int nw = -1);
+  g_Dwk_t fourier_tr_to_wk(g_Dtr_cvt g_tr, int nw = -1);
+
+  /** Fourier transforms of Green's functions distributed over MPI ranks
+
+    The k <-> r transforms are local to each rank, while the frequency <-> time
+    transforms redistribute the data over the lattice points and back.
+ */
+  g_wr_dist_t fourier_wk_to_wr(g_wk_dist_t const &g_wk);
+  g_wk_dist_t fourier_wr_to_wk(g_wr_dist_t const &g_wr);
+  g_tr_dist_t fourier_wr_to_tr(g_wr_dist_t const &g_wr, int nt = -1);
+  g_wr_dist_t fourier_tr_to_wr(g_tr_dist_t const &g_tr, int nw = -1);
+  g_tr_dist_t fourier_wk_to_tr(g_wk_dist_t const &g_wk, int nt = -1);
+  g_wk_dist_t fourier_tr_to_wk(g_tr_dist_t const &g_tr, int nw = -1);
+
+  /** Fast fourier transform of a static lattice quantity from k-space to real space
+
+    Computes: :math:`X(\mathbf{r}) = \mathcal{F}^{-1} \left\{ X(\mathbf{k}) \right\}`
+
+    When the result is known to be real in real space, i.e. :math:`X(-\mathbf{k}) = X^*(\mathbf{k})`
+    element-wise, the transform can be done with real-to-complex FFTs on half of the k-mesh.
+
+    @param X_k k-space quantity :math:`X(\mathbf{k})`
+    @param real_r use the real-to-complex transform, only valid for data that is real in real space
+    @return real-space quantity :math:`X(\mathbf{r})`
+ */
+  e_r_t fourier_k_to_r(e_k_cvt X_k, bool real_r = false);
+  chi_r_t fourier_k_to_r(chi_k_cvt X_k, bool real_r = false);
+
+  /** Fast fourier transform of a static lattice quantity from real space to k-space
+
+    Computes: :math:`X(\mathbf{k}) = \mathcal{F} \left\{ X(\mathbf{r}) \right\}`
+
+    @param X_r real-space quantity :math:`X(\mathbf{r})`
+    @param real_r use the real-to-complex transform, the imaginary part of the input is discarded
+    @return k-space quantity :math:`X(\mathbf{k})`
+ */
+  e_k_t fourier_r_to_k(e_r_cvt X_r, bool real_r = false);
+  chi_k_t fourier_r_to_k(chi_r_cvt X_r, bool real_r = false);
   
   /** Inverse fast fourier transform of real frequency Green's function from k-space to real space
 
@@ -20,17 +20,21 @@
  *
  ******************************************************************************/
 
+#include <optional>
 #include <nda/nda.hpp>
 #include <nda/linalg/eigenelements.hpp>
 
 #include "gw.hpp"
 #include "common.hpp"
 #include "lattice_utility.hpp"
+#include "band_structure.hpp"
+#include "mesh_index_tables.hpp"
 #include "../mpi.hpp"
 
 // -- For parallell Fourier transform routines
 #include "gf.hpp"
 #include "chi_imtime.hpp"
+#include "fourier.hpp"
 
 namespace triqs_tprf {
 
@@ -50,7 +54,7 @@ namespace triqs_tprf {
       rho_k[k] = density(g_w);
     }
   
-    rho_k = mpi::all_reduce(rho_k);
+    mpi_all_reduce_in_place(rho_k);
     return rho_k;
   }
 
@@ -72,7 +76,7 @@ namespace triqs_tprf {
       rho_k[k] = density(make_gf_dlr(g_w));
     }
   
-    rho_k = mpi::all_reduce(rho_k);
+    mpi_all_reduce_in_place(rho_k);
     return rho_k;
   }
   
@@ -99,7 +103,7 @@ namespace triqs_tprf {
     for (auto [a, b, c, d] : W_tr.target_indices()) { sigma_tr[t, r](a, b) += -W_tr[t, r](a, c, d, b) * g_tr[t, r](c, d); }
   }
 
-  sigma_tr = mpi::all_reduce(sigma_tr);
+  mpi_all_reduce_in_place(sigma_tr);
   return sigma_tr;
   }
 
@@ -110,6 +114,38 @@ namespace triqs_tprf {
   g_Dtr_t gw_dynamic_sigma(chi_Dtr_cvt W_tr, g_Dtr_cvt g_tr) {
     return gw_dynamic_sigma_impl(W_tr, g_tr);
   }
+
+  g_tr_dist_t gw_dynamic_sigma(chi_tr_dist_t const &W_tr, g_tr_dist_t const &g_tr) {
+
+    auto const &Wtm = std::get<0>(W_tr.mesh());
+    auto const &gtm = std::get<0>(g_tr.mesh());
+
+    if (Wtm.size() != gtm.size() || Wtm.beta() != gtm.beta()) TRIQS_RUNTIME_ERROR << "gw_sigma_tr: tau meshes are not the same.\n";
+
+    if (Wtm.statistic() != Boson || gtm.statistic() != Fermion) TRIQS_RUNTIME_ERROR << "gw_sigma_tr: statistics are incorrect.\n";
+
+    if (W_tr.lattice_mesh() != g_tr.lattice_mesh()) TRIQS_RUNTIME_ERROR << "gw_sigma_tr: real-space meshes are not the same.\n";
+
+    g_tr_dist_t sigma_tr(g_tr.mesh(), g_tr.target_shape(), g_tr.communicator());
+
+    long nb = g_tr.target_shape()[0];
+    long nr = g_tr.n_cols();
+
+    auto const &W = W_tr.data();
+    auto const &g = g_tr.data();
+    auto &sigma   = sigma_tr.data();
+
+#pragma omp parallel for
+    for (long idx = 0; idx < g_tr.n_local_rows() * nr; idx++) {
+      long t = idx / nr, r = idx % nr;
+      for (long a = 0; a < nb; a++)
+        for (long b = 0; b < nb; b++)
+          for (long c = 0; c < nb; c++)
+            for (long d = 0; d < nb; d++) sigma(t, r, a, b) += -W(t, r, a, c, d, b) * g(t, r, c, d);
+    }
+
+    return sigma_tr;
+  }
   
 
   e_r_t hartree_sigma(chi_k_cvt v_k, e_r_cvt rho_r) {
@@ -132,20 +168,24 @@ namespace triqs_tprf {
   e_k_t sigma_k(kmesh, g_wk.target_shape());
   sigma_k() = 0.0;
 
+  // The density only depends on k + q and is computed once per k-point
+  auto rho_k          = rho_k_from_g_wk(g_wk);
+  auto const &rho_dat = rho_k.data();
+
   auto arr = mpi_view(kmesh);
 #pragma omp parallel for
   for (unsigned int idx = 0; idx < arr.size(); idx++) {
-    auto &k = arr[idx];
+    auto &k  = arr[idx];
+    auto kpq = x_plus_q_index_table(kmesh, k.data_index());
 
     for (auto q : kmesh) {
 
-      auto g_w  = g_wk[_, k + q];
-      auto dens = density(gf{g_w});
+      auto dens = rho_dat(kpq[q.data_index()], _, _);
 
       for (auto [a, b, c, d] : v_k.target_indices()) { sigma_k[k](a, b) += v_k[q](a, b, c, d) * dens(c, d) / kmesh.size(); }
     }
   }
-  sigma_k = mpi::all_reduce(sigma_k);
+  mpi_all_reduce_in_place(sigma_k);
   return sigma_k;
   }
 
@@ -165,7 +205,7 @@ namespace triqs_tprf {
 
     for (auto [a, b, c, d] : v_r.target_indices()) { sigma_r[r](a, b) += -v_r[r](a, c, d, b) * rho_r[r](d, c); }
   }
-  sigma_r = mpi::all_reduce(sigma_r);
+  mpi_all_reduce_in_place(sigma_r);
   return sigma_r;
   }
 
@@ -179,20 +219,23 @@ namespace triqs_tprf {
   e_k_t sigma_k(kmesh, g_wk.target_shape());
   sigma_k() = 0.0;
 
+  auto rho_k          = rho_k_from_g_wk(g_wk);
+  auto const &rho_dat = rho_k.data();
+
   auto arr = mpi_view(kmesh);
 #pragma omp parallel for
   for (unsigned int idx = 0; idx < arr.size(); idx++) {
-    auto &k = arr[idx];
+    auto &k  = arr[idx];
+    auto kpq = x_plus_q_index_table(kmesh, k.data_index());
 
     for (auto q : kmesh) {
 
-      auto g_w  = g_wk[_, k + q];
-      auto dens = density(g_w);
+      auto dens = rho_dat(kpq[q.data_index()], _, _);
 
       for (auto [a, b, c, d] : v_k.target_indices()) { sigma_k[k](a, b) += -v_k[q](a, c, d, b) * dens(d, c) / kmesh.size(); }
     }
   }
-  sigma_k = mpi::all_reduce(sigma_k);
+  mpi_all_reduce_in_place(sigma_k);
   return sigma_k;
   }
 
@@ -216,13 +259,8 @@ namespace triqs_tprf {
   auto [W_dyn_wk, W_const_k] = split_into_dynamic_wk_and_constant_k(W_wk);
 
   // Dynamic GW self energy
-  //auto g_tr = make_gf_from_fourier<0, 1>(g_wk); // Fixme! Use parallell transform
-  auto g_wr = fourier_wk_to_wr(g_wk);
-  auto g_tr = fourier_wr_to_tr(g_wr);
-  
-  //auto W_dyn_tr = make_gf_from_fourier<0, 1>(W_dyn_wk); // Fixme! Use parallell transform
-  auto W_dyn_wr = chi_wr_from_chi_wk(W_dyn_wk);
-  auto W_dyn_tr = chi_tr_from_chi_wr(W_dyn_wr);
+  auto g_tr     = fourier_wk_to_tr(g_wk);
+  auto W_dyn_tr = chi_tr_from_chi_wk(W_dyn_wk);
   
   auto sigma_dyn_tr = gw_dynamic_sigma(W_dyn_tr, g_tr);
 
@@ -230,15 +268,16 @@ namespace triqs_tprf {
 
   //auto sigma_fock_k = fock_sigma(W_const_k, g_wk); // Has N_k^2 scaling, not fast..
 
-  auto W_const_r = make_gf_from_fourier(W_const_k);
+  // Use the half k-mesh transforms for quantities that are real in real space
+  auto W_const_r = fourier_k_to_r(W_const_k, is_real_in_r(W_const_k));
   auto rho_k = rho_k_from_g_wk(g_wk);
-  auto rho_r = make_gf_from_fourier(rho_k);
+  auto rho_r = fourier_k_to_r(rho_k, is_real_in_r(rho_k));
   auto sigma_fock_r = fock_sigma(W_const_r, rho_r);
-  auto sigma_fock_k = make_gf_from_fourier(sigma_fock_r);
+  auto sigma_fock_k = fourier_r_to_k(sigma_fock_r, is_real_in_r(sigma_fock_r));
 
   // Add dynamic and static parts
   auto _ = all_t{};
-  auto sigma_wk = make_gf_from_fourier<0, 1>(sigma_dyn_tr); // Fixme! Use parallell transform
+  auto sigma_wk = fourier_tr_to_wk(sigma_dyn_tr);
   for (auto w : gwm) sigma_wk[w, _] += sigma_fock_k; // Single loop with no work per w, no need to parallellize over mpi
 
   return sigma_wk;
@@ -258,11 +297,102 @@ namespace triqs_tprf {
   // g0w_sigma via spectral representation
   // dynamic part ...
 
+  namespace {
+
+  // Dynamic G0W self energy at the k-mesh data index k, with the cached band structure of e_k
+  g_f_t g0w_dynamic_sigma_point(band_structure const &bands, chi_fk_cvt W_fk, chi_k_cvt v_k, double delta, long k) {
+
+  auto fmesh = std::get<0>(W_fk.mesh());
+  long n_k   = bands.mesh().size();
+  long nb    = bands.n_bands();
+  double beta = bands.beta();
+
+  std::complex<double> idelta(0.0, delta);
+
+  g_f_t sigma_f(fmesh, {nb, nb});
+  sigma_f() = 0.0;
+
+  nda::array<double, 3> W_spec(fmesh.size(), nb, nb);
+
+  // k + q for all q
+  auto kq_table = x_plus_q_index_table(bands.mesh(), k);
+
+  for (long q = 0; q < n_k; q++) {
+    long kq   = kq_table[q];
+    auto ekq  = bands.eps(kq);
+    auto &Ukq = bands.U(kq);
+
+    for (auto fp : fmesh)
+      for (long a = 0; a < nb; a++)
+        for (long b = 0; b < nb; b++)
+          W_spec(fp.data_index(), a, b) = -1.0 / M_PI * (W_fk.data()(fp.data_index(), q, a, a, b, b) - v_k.data()(q, a, a, b, b)).imag();
+
+    for (int l : range(nb)) {
+      for (auto f : fmesh) {
+        for (auto fp : fmesh) {
+
+          auto num = bose(fp * beta) + bands.occ(kq)(l);
+          auto den = f + idelta + fp - ekq(l);
+
+          for (long a = 0; a < nb; a++)
+            for (long b = 0; b < nb; b++)
+              sigma_f[f](a, b) = sigma_f[f](a, b)
+                 + Ukq(a, l) * std::conj(Ukq(b, l)) * (W_spec(fp.data_index(), a, b) * num / den * fmesh.delta() / n_k);
+        }
+      }
+    }
+  }
+
+  return sigma_f;
+  }
+
+  // Static G0W self energy at the k-mesh data index k, with the cached band structure of e_k
+  array<std::complex<double>, 2> g0w_sigma_point(band_structure const &bands, chi_k_cvt v_k, long k) {
+
+  long n_k = bands.mesh().size();
+  long nb  = bands.n_bands();
+
+  array<std::complex<double>, 2> sigma_k(nb, nb);
+  sigma_k() = 0.0;
+
+  // k + q for all q
+  auto kq_table = x_plus_q_index_table(bands.mesh(), k);
+
+  for (long q = 0; q < n_k; q++) {
+    long kq   = kq_table[q];
+    auto nkq  = bands.occ(kq);
+    auto &Ukq = bands.U(kq);
+
+    for (int l : range(nb))
+      for (int a : range(nb))
+        for (int b : range(nb))
+          sigma_k(a, b) = sigma_k(a, b) - Ukq(a, l) * std::conj(Ukq(b, l)) * v_k.data()(q, a, a, b, b) * nkq(l) / n_k;
+  }
+
+  return sigma_k;
+  }
+
+  // Data index of kpoint if it is a point of kmesh, then all k + q are mesh points
+  std::optional<long> kmesh_data_index(mesh::brzone const &kmesh, mesh::brzone::value_t const &kpoint) {
+  for (auto k : kmesh) {
+    auto kval   = mesh::brzone::value_t{k};
+    double dist = 0.0;
+    for (int i = 0; i < 3; i++) dist += std::abs(kval(i) - kpoint(i));
+    if (dist < 1e-10) return k.data_index();
+  }
+  return {};
+  }
+
+  } // namespace
+
   g_f_t g0w_dynamic_sigma(double mu, double beta, e_k_cvt e_k, chi_fk_cvt W_fk, chi_k_cvt v_k, double delta, mesh::brzone::value_t kpoint) {
 
   if (std::get<1>(W_fk.mesh()) != e_k.mesh()) TRIQS_RUNTIME_ERROR << "g0w_sigma: k-space meshes are not the same.\n";
   if (e_k.mesh() != v_k.mesh()) TRIQS_RUNTIME_ERROR << "g0w_sigma: k-space meshes are not the same.\n";
 
+  // On a point of the mesh of e_k, diagonalize e_k once per k-point in parallel
+  if (auto k = kmesh_data_index(e_k.mesh(), kpoint)) return g0w_dynamic_sigma_point(band_structure(e_k, mu, beta), W_fk, v_k, delta, *k);
+
   auto fmesh = std::get<0>(W_fk.mesh());
   auto kmesh = e_k.mesh();
   int nb     = e_k.target().shape()[0];
@@ -314,16 +444,21 @@ namespace triqs_tprf {
   g_fk_t sigma_fk({fmesh, kmesh}, e_k.target_shape());
   sigma_fk() = 0.0;
 
+  // On the mesh of e_k all k + q are mesh points and the band structure is cached
+  std::optional<band_structure> bands;
+  if (kmesh == e_k.mesh()) bands.emplace(e_k, mu, beta);
+
   auto arr = mpi_view(kmesh);
 #pragma omp parallel for 
   for (unsigned int kidx = 0; kidx < arr.size(); kidx++) {
     auto &k      = arr[kidx];
     auto kpoint  = mesh::brzone::value_t{k};
-    auto sigma_f = g0w_dynamic_sigma(mu, beta, e_k, W_fk, v_k, delta, kpoint);
+    auto sigma_f = bands ? g0w_dynamic_sigma_point(*bands, W_fk, v_k, delta, k.data_index()) :
+                           g0w_dynamic_sigma(mu, beta, e_k, W_fk, v_k, delta, kpoint);
     for (auto f : fmesh) { sigma_fk[f, k] = sigma_f[f]; }
   }
 
-  sigma_fk = mpi::all_reduce(sigma_fk);
+  mpi_all_reduce_in_place(sigma_fk);
   return sigma_fk;
   }
 
@@ -337,6 +472,8 @@ namespace triqs_tprf {
 
   if (e_k.mesh() != v_k.mesh()) TRIQS_RUNTIME_ERROR << "g0w_sigma: k-space meshes are not the same.\n";
 
+  if (auto k = kmesh_data_index(e_k.mesh(), kpoint)) return g0w_sigma_point(band_structure(e_k, mu, beta), v_k, *k);
+
   auto kmesh = e_k.mesh();
   int nb     = e_k.target().shape()[0];
 
@@ -367,18 +504,23 @@ namespace triqs_tprf {
 
   e_k_t g0w_sigma(double mu, double beta, e_k_cvt e_k, chi_k_cvt v_k, mesh::brzone kmesh) {
 
+  if (e_k.mesh() != v_k.mesh()) TRIQS_RUNTIME_ERROR << "g0w_sigma: k-space meshes are not the same.\n";
+
   e_k_t sigma_k(kmesh, e_k.target_shape());
   sigma_k() = 0.0;
 
+  std::optional<band_structure> bands;
+  if (kmesh == e_k.mesh()) bands.emplace(e_k, mu, beta);
+
   auto arr = mpi_view(kmesh);
 #pragma omp parallel for 
   for (unsigned int kidx = 0; kidx < arr.size(); kidx++) {
     auto &k = arr[kidx];
     auto kpoint = mesh::brzone::value_t{k};
-    sigma_k[k] = g0w_sigma(mu, beta, e_k, v_k, kpoint);
+    sigma_k[k] = bands ? g0w_sigma_point(*bands, v_k, k.data_index()) : g0w_sigma(mu, beta, e_k, v_k, kpoint);
   }
 
-  sigma_k = mpi::all_reduce(sigma_k);
+  mpi_all_reduce_in_place(sigma_k);
   return sigma_k;
   }
 
@@ -389,8 +531,22 @@ namespace triqs_tprf {
   // dynamic and static parts ...
 
   g_f_t g0w_sigma(double mu, double beta, e_k_cvt e_k, chi_fk_cvt W_fk, chi_k_cvt v_k, double delta, mesh::brzone::value_t kpoint) {
-  auto sigma_stat_k = g0w_sigma(mu, beta, e_k, v_k, kpoint);
-  auto sigma_dyn_fk = g0w_dynamic_sigma(mu, beta, e_k, W_fk, v_k, delta, kpoint);
+
+  if (std::get<1>(W_fk.mesh()) != e_k.mesh()) TRIQS_RUNTIME_ERROR << "g0w_sigma: k-space meshes are not the same.\n";
+  if (e_k.mesh() != v_k.mesh()) TRIQS_RUNTIME_ERROR << "g0w_sigma: k-space meshes are not the same.\n";
+
+  array<std::complex<double>, 2> sigma_stat_k;
+  g_f_t sigma_dyn_fk;
+
+  // The static and dynamic parts share the band structure on a point of the mesh of e_k
+  if (auto k = kmesh_data_index(e_k.mesh(), kpoint)) {
+    band_structure bands(e_k, mu, beta);
+    sigma_stat_k = g0w_sigma_point(bands, v_k, *k);
+    sigma_dyn_fk = g0w_dynamic_sigma_point(bands, W_fk, v_k, delta, *k);
+  } else {
+    sigma_stat_k = g0w_sigma(mu, beta, e_k, v_k, kpoint);
+    sigma_dyn_fk = g0w_dynamic_sigma(mu, beta, e_k, W_fk, v_k, delta, kpoint);
+  }
 
   auto fmesh = std::get<0>(W_fk.mesh());
   g_f_t sigma_fk(fmesh, e_k.target_shape());
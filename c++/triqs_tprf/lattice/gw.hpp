@@ -22,6 +22,7 @@
 #pragma once
 
 #include "../types.hpp"
+#include "../distributed_gf.hpp"
 
 namespace triqs_tprf {
 
@@ -158,6 +159,16 @@ namespace triqs_tprf {
   g_tr_t gw_dynamic_sigma(chi_tr_cvt W_tr, g_tr_cvt g_tr);
   g_Dtr_t gw_dynamic_sigma(chi_Dtr_cvt W_tr, g_Dtr_cvt g_tr);
 
+  /** Dynamic GW self energy for distributed imaginary time objects
+
+   Same as gw_dynamic_sigma, for W and G distributed over the ranks with the same imaginary time mesh.
+
+   @param W_tr distributed dynamic screened interaction :math:`W^{(dyn)}_{abcd}(\tau, \mathbf{r})`
+   @param g_tr distributed single particle Green's function :math:`G_{ab}(\tau, \mathbf{r})`
+   @return distributed dynamic GW self energy :math:`\Sigma_{ab}(\tau, \mathbf{r})`
+ */
+  g_tr_dist_t gw_dynamic_sigma(chi_tr_dist_t const &W_tr, g_tr_dist_t const &g_tr);
+
   /** some documentation */
 
   g_f_t g0w_dynamic_sigma(double mu, double beta, e_k_cvt e_k, chi_fk_cvt W_fk, chi_k_cvt v_k, double delta, mesh::brzone::value_t kpoint);
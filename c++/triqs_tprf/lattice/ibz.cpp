@@ -0,0 +1,144 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+
+#include <cmath>
+#include <itertools/itertools.hpp>
+
+#include "ibz.hpp"
+
+namespace triqs_tprf {
+
+  ibz_map::ibz_map(mesh::brzone const &kmesh, std::vector<nda::matrix<long>> const &rotations,
+                   std::vector<nda::matrix<std::complex<double>>> const &orbital_reps)
+     : _kmesh(kmesh), _rotations(rotations), _orbital_reps(orbital_reps) {
+
+    long n_ops = _rotations.size();
+    long n_k   = _kmesh.size();
+
+    if (n_ops == 0) TRIQS_RUNTIME_ERROR << "ibz_map: no point group operations given.";
+    if (long(_orbital_reps.size()) != n_ops) TRIQS_RUNTIME_ERROR << "ibz_map: one orbital representation per rotation is required.";
+
+    long n_orb = _orbital_reps[0].shape()[0];
+    for (auto const &R : _rotations)
+      if (R.shape()[0] != 3 || R.shape()[1] != 3) TRIQS_RUNTIME_ERROR << "ibz_map: the rotations must be 3x3 matrices.";
+    for (auto const &U : _orbital_reps)
+      if (U.shape()[0] != n_orb || U.shape()[1] != n_orb) TRIQS_RUNTIME_ERROR << "ibz_map: the orbital representations must have the same shape.";
+
+    // -- Action of the rotations on the k-mesh
+
+    auto dims = _kmesh.dims();
+    auto linear = [&dims](std::array<long, 3> const &m) { return (m[0] * dims[1] + m[1]) * dims[2] + m[2]; };
+
+    _rotated = nda::array<long, 2>(n_ops, n_k);
+
+    for (long k = 0; k < n_k; k++) {
+      std::array<long, 3> m{k / (dims[1] * dims[2]), (k / dims[2]) % dims[1], k % dims[2]};
+
+      for (long s = 0; s < n_ops; s++) {
+        std::array<long, 3> mr;
+        for (int i = 0; i < 3; i++) {
+          double x = 0;
+          for (int j = 0; j < 3; j++) x += double(_rotations[s](i, j) * m[j]) / dims[j];
+          double xi = x * dims[i];
+          long mi   = std::lround(xi);
+          if (std::abs(xi - mi) > 1e-8) TRIQS_RUNTIME_ERROR << "ibz_map: rotation " << s << " does not map the k-mesh onto itself.";
+          mr[i] = ((mi % dims[i]) + dims[i]) % dims[i];
+        }
+        _rotated(s, k) = linear(mr);
+      }
+    }
+
+    // -- The identity is needed to map the irreducible points onto themselves
+
+    long s_id = -1;
+    for (long s = 0; s < n_ops && s_id < 0; s++) {
+      bool is_id = true;
+      for (long k = 0; k < n_k; k++) is_id = is_id && (_rotated(s, k) == k);
+      if (is_id && max_element(abs(_orbital_reps[s] - nda::eye<std::complex<double>>(n_orb))) < 1e-12) s_id = s;
+    }
+    if (s_id < 0) TRIQS_RUNTIME_ERROR << "ibz_map: the point group operations must contain the identity.";
+
+    // -- Stars of the k-points
+
+    _irr_index.assign(n_k, -1);
+    _op_index.assign(n_k, -1);
+
+    for (long k = 0; k < n_k; k++) {
+      if (_irr_index[k] >= 0) continue;
+
+      long i = _irr_k.size();
+      _irr_k.push_back(k);
+      _multiplicity.push_back(0);
+
+      _irr_index[k] = i;
+      _op_index[k]  = s_id;
+
+      for (long s = 0; s < n_ops; s++) {
+        long kr = _rotated(s, k);
+        if (_irr_index[kr] < 0) {
+          _irr_index[kr] = i;
+          _op_index[kr]  = s;
+        }
+      }
+    }
+
+    for (long k = 0; k < n_k; k++) _multiplicity[_irr_index[k]]++;
+  }
+
+  // ----------------------------------------------------
+
+  nda::array<std::complex<double>, 2> ibz_map::rotate_target(long s, nda::array_const_view<std::complex<double>, 2> x) const {
+    auto const &U = _orbital_reps[s];
+    return nda::array<std::complex<double>, 2>(U * make_matrix_view(x) * dagger(U));
+  }
+
+  nda::array<std::complex<double>, 4> ibz_map::rotate_target(long s, nda::array_const_view<std::complex<double>, 4> x) const {
+
+    auto const &U = _orbital_reps[s];
+    long n        = U.shape()[0];
+
+    // One index at a time, barred indices (a, c) with U^*, the others with U
+    nda::array<std::complex<double>, 4> y(x), t(n, n, n, n);
+
+    t() = 0;
+    for (auto [a, b, c, d] : itertools::product_range(n, n, n, n))
+      for (long e = 0; e < n; e++) t(a, b, c, d) += std::conj(U(a, e)) * y(e, b, c, d);
+    y = t;
+
+    t() = 0;
+    for (auto [a, b, c, d] : itertools::product_range(n, n, n, n))
+      for (long e = 0; e < n; e++) t(a, b, c, d) += U(b, e) * y(a, e, c, d);
+    y = t;
+
+    t() = 0;
+    for (auto [a, b, c, d] : itertools::product_range(n, n, n, n))
+      for (long e = 0; e < n; e++) t(a, b, c, d) += std::conj(U(c, e)) * y(a, b, e, d);
+    y = t;
+
+    t() = 0;
+    for (auto [a, b, c, d] : itertools::product_range(n, n, n, n))
+      for (long e = 0; e < n; e++) t(a, b, c, d) += U(d, e) * y(a, b, c, e);
+
+    return t;
+  }
+
+} // namespace triqs_tprf
@@ -0,0 +1,214 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <memory>
+#include <vector>
+
+#include "../types.hpp"
+
+namespace triqs_tprf {
+
+  /** Irreducible Brillouin zone of a k-mesh under a point group
+
+   Each point group operation :math:`S = (R, U)` consists of an integer matrix
+   :math:`R` acting on the reduced coordinates of k-points (in units of the
+   reciprocal lattice vectors) and a unitary orbital representation :math:`U`.
+   The lattice quantities are assumed to transform as
+
+   .. math::
+       X_{a\bar{b}}(R\mathbf{k}) = U_{aa'} X_{a'\bar{b}'}(\mathbf{k}) U^*_{bb'}
+
+   for matrix valued quantities (:math:`\epsilon(\mathbf{k})`, :math:`G(i\omega_n, \mathbf{k})`), and as
+
+   .. math::
+       X_{\bar{a}b\bar{c}d}(R\mathbf{q}) =
+       U^*_{aa'} U_{bb'} U^*_{cc'} U_{dd'} X_{\bar{a}'b'\bar{c}'d'}(\mathbf{q})
+
+   for two-particle quantities (:math:`\chi(i\omega_n, \mathbf{q})`, :math:`W(i\omega_n, \mathbf{q})`).
+
+   The k-points are grouped in stars, with one irreducible representative per
+   star, and every k-point is reached from its representative by one operation.
+  */
+  class ibz_map {
+
+    public:
+    /**
+     @param kmesh Brillouin zone mesh
+     @param rotations Point group rotations in reduced reciprocal coordinates, 3x3 integer matrices
+     @param orbital_reps Orbital representations of the rotations, unitary matrices
+     */
+    ibz_map(mesh::brzone const &kmesh, std::vector<nda::matrix<long>> const &rotations,
+            std::vector<nda::matrix<std::complex<double>>> const &orbital_reps);
+
+    mesh::brzone const &mesh() const { return _kmesh; }
+
+    /// Number of point group operations
+    long n_ops() const { return _rotations.size(); }
+
+    /// Number of irreducible k-points
+    long n_irr() const { return _irr_k.size(); }
+
+    /// Number of orbitals of the orbital representation
+    long n_orb() const { return _orbital_reps[0].shape()[0]; }
+
+    /// k-mesh data index of irreducible point i
+    long irr_k(long i) const { return _irr_k[i]; }
+
+    /// Irreducible point of the star of k-mesh point k
+    long irr_index(long k) const { return _irr_index[k]; }
+
+    /// Operation mapping the irreducible representative to k-mesh point k
+    long op_index(long k) const { return _op_index[k]; }
+
+    /// Number of k-points in the star of irreducible point i
+    long multiplicity(long i) const { return _multiplicity[i]; }
+
+    /// k-mesh data index of R_s k
+    long rotate(long s, long k) const { return _rotated(s, k); }
+
+    /// Orbital representation of operation s
+    nda::matrix<std::complex<double>> const &orbital_rep(long s) const { return _orbital_reps[s]; }
+
+    /// Rotate a matrix valued quantity with operation s, X(R_s k) from X(k)
+    nda::array<std::complex<double>, 2> rotate_target(long s, nda::array_const_view<std::complex<double>, 2> x) const;
+
+    /// Rotate a two-particle quantity with operation s, X(R_s q) from X(q)
+    nda::array<std::complex<double>, 4> rotate_target(long s, nda::array_const_view<std::complex<double>, 4> x) const;
+
+    private:
+    mesh::brzone _kmesh;
+    std::vector<nda::matrix<long>> _rotations;
+    std::vector<nda::matrix<std::complex<double>>> _orbital_reps;
+    nda::array<long, 2> _rotated;
+    std::vector<long> _irr_k, _irr_index, _op_index, _multiplicity;
+  };
+
+  /** Lattice quantity stored on the irreducible Brillouin zone
+
+   Holds the values of a Green's function on a (brzone) or (mesh, brzone) mesh at
+   the irreducible k-points only, with shape (rows, irreducible points, target...)
+   where the rows are the points of the leading mesh. The full Brillouin zone
+   quantity is formed with unfold.
+  */
+  template <typename Gf> class ibz_gf {
+
+    public:
+    using gf_t     = Gf;
+    using mesh_t   = typename Gf::mesh_t;
+    using target_t = typename Gf::target_t;
+    using scalar_t = typename Gf::scalar_t;
+
+    static constexpr int target_rank = target_t::rank;
+    static constexpr int n_meshes    = std::decay_t<decltype(std::declval<Gf>().data())>::rank - target_rank;
+
+    static_assert(n_meshes == 1 or n_meshes == 2, "ibz_gf: only brzone and (mesh, brzone) meshes are supported.");
+    static_assert(target_rank == 2 or target_rank == 4, "ibz_gf: only matrix and two-particle targets are supported.");
+
+    using data_t = nda::array<scalar_t, 2 + target_rank>;
+
+    private:
+    mesh_t _mesh;
+    std::shared_ptr<ibz_map const> _ibz;
+    std::array<long, target_rank> _target_shape;
+    data_t _data;
+
+    static mesh::brzone const &kmesh_of(mesh_t const &m) {
+      if constexpr (n_meshes == 1)
+        return m;
+      else
+        return std::get<1>(m);
+    }
+
+    public:
+    /// Construct a zero initialized irreducible quantity
+    ibz_gf(mesh_t const &mesh, std::shared_ptr<ibz_map const> ibz, std::array<long, target_rank> const &target_shape)
+       : _mesh(mesh), _ibz(std::move(ibz)), _target_shape(target_shape) {
+      if (kmesh_of(_mesh) != _ibz->mesh()) TRIQS_RUNTIME_ERROR << "ibz_gf: the k-mesh does not match the irreducible zone map.";
+      _data   = data_t(nda::stdutil::join(std::array<long, 2>{n_rows(), _ibz->n_irr()}, _target_shape));
+      _data() = 0;
+    }
+
+    /// Keep the irreducible points of a full Brillouin zone quantity
+    ibz_gf(typename Gf::const_view_type g, std::shared_ptr<ibz_map const> ibz) : ibz_gf(g.mesh(), std::move(ibz), target_shape_of(g)) {
+      auto _ = nda::ellipsis{};
+      for (long i = 0; i < _ibz->n_irr(); i++) {
+        if constexpr (n_meshes == 1)
+          _data(0, i, _) = g.data()(_ibz->irr_k(i), _);
+        else
+          for (long r = 0; r < n_rows(); r++) _data(r, i, _) = g.data()(r, _ibz->irr_k(i), _);
+      }
+    }
+
+    mesh_t const &mesh() const { return _mesh; }
+    ibz_map const &ibz() const { return *_ibz; }
+    std::shared_ptr<ibz_map const> ibz_ptr() const { return _ibz; }
+    std::array<long, target_rank> const &target_shape() const { return _target_shape; }
+
+    /// Number of points of the leading mesh (1 for a brzone mesh)
+    long n_rows() const {
+      if constexpr (n_meshes == 1)
+        return 1;
+      else
+        return std::get<0>(_mesh).size();
+    }
+
+    /// Irreducible data, shape (rows, irreducible points, target...)
+    data_t &data() { return _data; }
+    data_t const &data() const { return _data; }
+
+    /// Full Brillouin zone quantity, from the irreducible points by symmetry
+    Gf unfold() const {
+
+      Gf g{_mesh, _target_shape};
+      auto _      = nda::ellipsis{};
+      long n_k    = _ibz->mesh().size();
+      auto &g_dat = g.data();
+
+#pragma omp parallel for
+      for (long k = 0; k < n_k; k++) {
+        long i = _ibz->irr_index(k), s = _ibz->op_index(k);
+        for (long r = 0; r < n_rows(); r++) {
+          auto x = _ibz->rotate_target(s, _data(r, i, _));
+          if constexpr (n_meshes == 1)
+            g_dat(k, _) = x;
+          else
+            g_dat(r, k, _) = x;
+        }
+      }
+      return g;
+    }
+
+    private:
+    static std::array<long, target_rank> target_shape_of(typename Gf::const_view_type g) {
+      std::array<long, target_rank> shape;
+      for (int i = 0; i < target_rank; i++) shape[i] = g.target_shape()[i];
+      return shape;
+    }
+  };
+
+  using e_k_ibz_t    = ibz_gf<e_k_t>;
+  using chi_k_ibz_t  = ibz_gf<chi_k_t>;
+  using g_wk_ibz_t   = ibz_gf<g_wk_t>;
+  using chi_wk_ibz_t = ibz_gf<chi_wk_t>;
+
+} // namespace triqs_tprf
@@ -26,6 +26,7 @@
 #include "gw.hpp"
 #include "common.hpp"
 #include "../mpi.hpp"
+#include "../batched_tail_fit.hpp"
 
 namespace triqs_tprf {
 
@@ -56,31 +57,23 @@ namespace triqs_tprf {
 
   std::tuple<chi_wk_t, chi_k_t> split_into_dynamic_wk_and_constant_k(chi_wk_cvt chi_wk) {
 
-    auto _               = all_t{};
-    auto wmesh = std::get<0>(chi_wk.mesh());
-    auto kmesh = std::get<1>(chi_wk.mesh());
+    auto _            = all_t{};
+    auto const &wmesh = std::get<0>(chi_wk.mesh());
+    auto const &kmesh = std::get<1>(chi_wk.mesh());
+    long nw           = wmesh.size();
+    long n_cols       = chi_wk.data().size() / nw;
 
     chi_wk_t chi_dyn_wk(chi_wk.mesh(), chi_wk.target_shape());
-    chi_dyn_wk() = 0.0;
+    chi_dyn_wk.data() = chi_wk.data();
     chi_k_t chi_const_k(kmesh, chi_wk.target_shape());
-    chi_const_k() = 0.0;
 
-    auto arr = mpi_view(kmesh);
+    // All k-points and components are fitted at once, as the columns of a (w, k abcd) matrix
+    auto dyn = nda::array_view<std::complex<double>, 2>(std::array<long, 2>{nw, n_cols}, chi_dyn_wk.data().data());
+    auto cst = nda::array_view<std::complex<double>, 1>(std::array<long, 1>{n_cols}, chi_const_k.data().data());
 
-#pragma omp parallel for 
-    for (unsigned int idx = 0; idx < arr.size(); idx++) {
-      auto &k = arr[idx];
-      
-      auto chi_w = chi_wk[_, k];
-      auto tail  = std::get<0>(fit_tail(chi_w));
+    cst() = batched_tail_fitter(wmesh).moments(dyn)(0, _);
+    for (long w = 0; w < nw; w++) dyn(w, _) -= cst;
 
-      for (auto [a, b, c, d] : chi_wk.target_indices()) chi_const_k[k](a, b, c, d) = tail(0, a, b, c, d);
-
-      for (auto w : wmesh) chi_dyn_wk[w, k] = chi_wk[w, k] - chi_const_k[k];
-    }
-
-    chi_dyn_wk = mpi::all_reduce(chi_dyn_wk);
-    chi_const_k = mpi::all_reduce(chi_const_k);
     return {chi_dyn_wk, chi_const_k};
   }
 
@@ -98,7 +91,7 @@ namespace triqs_tprf {
       //for (const auto &[a, b] : g_wk.target_indices()) { g_wk[w, k](a, b) = g_dyn_wk[w, k](a, b) + g_stat_k[k](a, b); }
       g_wk[w, k] = g_dyn_wk[w, k] + g_stat_k[k];
   }
-  g_wk = mpi::all_reduce(g_wk);
+  mpi_all_reduce_in_place(g_wk);
   return g_wk;
   }
 
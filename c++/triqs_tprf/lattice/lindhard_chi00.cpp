@@ -24,6 +24,8 @@
 #include "common.hpp"
 #include "lindhard_chi00.hpp"
 #include "lattice_utility.hpp"
+#include "band_structure.hpp"
+#include "mesh_index_tables.hpp"
 #include "../mpi.hpp"
 
 namespace triqs_tprf {
@@ -31,37 +33,41 @@ namespace triqs_tprf {
   // ----------------------------------------------------
   // chi00 bubble in analytic form
 
-  template<typename chi_t, typename mesh_t>
-  chi_t lindhard_chi00_template(e_k_cvt e_k, mesh_t mesh, double beta, double mu, double delta=0.) {
+  // Lindhard bubble for the q-points with data indices q_idx, stored in chi_wq(w, iq, a, b, c, d)
+
+  template<typename mesh_t>
+  void lindhard_chi00_kernel(e_k_cvt e_k, mesh_t const &wmesh, double beta, double mu, double delta, std::vector<long> const &q_idx,
+                             array_view<std::complex<double>, 6> chi_wq) {
 
-    auto wmesh = mesh;
     auto kmesh = e_k.mesh();
     int nb     = e_k.target().shape()[0];
     std::complex<double> idelta(0.0, delta);
 
-    chi_t chi_wk{{wmesh, kmesh}, {nb, nb, nb, nb}};
-    for (auto [w, k] : chi_wk.mesh()) chi_wk[w, k] = 0.;
+    chi_wq() = 0.;
+
+    // Eigenvalues, eigenvectors and occupations of all k-points, computed once
+    band_structure bands(e_k, mu, beta);
 
     auto arr = mpi_view(kmesh);
 
 #pragma omp parallel for
-    for (unsigned int qidx = 0; qidx < kmesh.size(); qidx++) {
-      auto q = *std::next(kmesh.begin(), qidx);
+    for (unsigned int iq = 0; iq < q_idx.size(); iq++) {
+
+      auto kq_table = x_plus_q_index_table(kmesh, q_idx[iq]);
 
       for (auto k : arr) {
 
-        // -- If this is moved out to the k-loop the threading breaks?!?
-        matrix<std::complex<double>> e_k_mat(e_k[k] - mu);
-        auto [ek, Uk] = linalg::eigenelements(e_k_mat);
+        long kidx = k.data_index(), kqidx = kq_table[kidx];
 
-        matrix<std::complex<double>> e_kq_mat(e_k(k + q) - mu);
-        auto [ekq, Ukq] = linalg::eigenelements(e_kq_mat);
+        auto ek = bands.eps(kidx), ekq = bands.eps(kqidx);
+        auto &Uk = bands.U(kidx), &Ukq = bands.U(kqidx);
+        auto nk = bands.occ(kidx), nkq = bands.occ(kqidx);
 
         for (int i : range(nb)) {
           for (int j : range(nb)) {
 
             double de = ekq(j) - ek(i);
-            double dn = fermi(ek(i) * beta) - fermi(ekq(j) * beta);
+            double dn = nk(i) - nkq(j);
 
             for (auto w : wmesh) {
 
@@ -80,15 +86,30 @@ namespace triqs_tprf {
                 total_factor = dn / (w + idelta + de);
               }
 
-              chi_wk[w, q](a, b, c, d) << chi_wk[w, q](a, b, c, d) + Uk(a, i) * dagger(Uk)(i, d) * Ukq(c, j) * dagger(Ukq)(j, b) * total_factor;
+              auto chi = chi_wq(w.data_index(), iq, range::all, range::all, range::all, range::all);
+              chi(a, b, c, d) << chi(a, b, c, d) + Uk(a, i) * dagger(Uk)(i, d) * Ukq(c, j) * dagger(Ukq)(j, b) * total_factor;
             } // w
           }   // j
         }     // i
       }       // q
     }         // k
 
-    chi_wk = mpi::all_reduce(chi_wk);
-    chi_wk /= kmesh.size();
+    mpi_all_reduce_in_place(chi_wq.data(), chi_wq.size());
+    chi_wq /= kmesh.size();
+  }
+
+  template<typename chi_t, typename mesh_t>
+  chi_t lindhard_chi00_template(e_k_cvt e_k, mesh_t mesh, double beta, double mu, double delta=0.) {
+
+    auto kmesh = e_k.mesh();
+    int nb     = e_k.target().shape()[0];
+
+    chi_t chi_wk{{mesh, kmesh}, {nb, nb, nb, nb}};
+
+    std::vector<long> q_idx(kmesh.size());
+    for (long q = 0; q < long(kmesh.size()); q++) q_idx[q] = q;
+
+    lindhard_chi00_kernel(e_k, mesh, beta, mu, delta, q_idx, chi_wk.data());
 
     return chi_wk;
   }
@@ -98,6 +119,21 @@ namespace triqs_tprf {
     return lindhard_chi00_template<chi_wk_t, mesh::imfreq>(e_k, mesh, mesh.beta(), mu);
   }
 
+  chi_wk_ibz_t lindhard_chi00(e_k_cvt e_k, mesh::imfreq mesh, double mu, std::shared_ptr<ibz_map const> ibz) {
+    if (mesh.statistic() != Boson) TRIQS_RUNTIME_ERROR << "lindhard_chi00: statistic is incorrect.\n";
+    if (e_k.mesh() != ibz->mesh()) TRIQS_RUNTIME_ERROR << "lindhard_chi00: the k-mesh does not match the irreducible zone map.\n";
+
+    int nb = e_k.target().shape()[0];
+    chi_wk_ibz_t chi_wk({mesh, e_k.mesh()}, ibz, {nb, nb, nb, nb});
+
+    std::vector<long> q_idx(ibz->n_irr());
+    for (long i = 0; i < ibz->n_irr(); i++) q_idx[i] = ibz->irr_k(i);
+
+    lindhard_chi00_kernel(e_k, mesh, mesh.beta(), mu, 0., q_idx, chi_wk.data());
+
+    return chi_wk;
+  }
+
   chi_Dwk_t lindhard_chi00(e_k_cvt e_k, mesh::dlr_imfreq mesh, double mu) {
     if (mesh.statistic() != Boson) TRIQS_RUNTIME_ERROR << "lindhard_chi00: statistic is incorrect.\n";
     return lindhard_chi00_template<chi_Dwk_t, mesh::dlr_imfreq>(e_k, mesh, mesh.beta(), mu);
@@ -21,6 +21,7 @@
 #pragma once
 
 #include "../types.hpp"
+#include "ibz.hpp"
 
 namespace triqs_tprf {
 
@@ -95,6 +96,19 @@ namespace triqs_tprf {
        contribution (the last term on the last row).
 */
   chi_wk_t lindhard_chi00(e_k_cvt e_k, mesh::imfreq mesh, double mu);
+
+  /** Generalized Lindhard susceptibility on the irreducible Brillouin zone
+
+    Same as lindhard_chi00, but only the irreducible q-points of the point group
+    are computed. The full Brillouin zone result is obtained with unfold.
+
+    @param e_k discretized lattice dispersion :math:`\epsilon_{\bar{a}b}(\mathbf{k})`, symmetric under the point group
+    @param mesh bosonic Matsubara frequency mesh
+    @param mu chemical potential :math:`\mu`
+    @param ibz irreducible Brillouin zone map of the k-mesh
+    @return generalized Lindhard susceptibility at the irreducible q-points
+ */
+  chi_wk_ibz_t lindhard_chi00(e_k_cvt e_k, mesh::imfreq mesh, double mu, std::shared_ptr<ibz_map const> ibz);
   chi_Dwk_t lindhard_chi00(e_k_cvt e_k, mesh::dlr_imfreq mesh, double mu);
 
   /** Generalized Lindhard susceptibility in the particle-hole channel and for real frequencies :math:`\chi^{(00)}_{\bar{a}b\bar{c}d}(\omega, \mathbf{q})`.
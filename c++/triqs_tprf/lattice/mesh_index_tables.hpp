@@ -0,0 +1,74 @@
+/*******************************************************************************
+ *
+ * TRIQS: a Toolbox for Research in Interacting Quantum Systems
+ *
+ * Copyright (C) 2024, The Simons Foundation
+ * Author: H. U.R. Strand
+ *
+ * TRIQS is free software: you can redistribute it and/or modify it under the
+ * terms of the GNU General Public License as published by the Free Software
+ * Foundation, either version 3 of the License, or (at your option) any later
+ * version.
+ *
+ * TRIQS is distributed in the hope that it will be useful, but WITHOUT ANY
+ * WARRANTY; without even the implied warranty of MERCHANTABILITY or FITNESS
+ * FOR A PARTICULAR PURPOSE. See the GNU General Public License for more
+ * details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * TRIQS. If not, see <http://www.gnu.org/licenses/>.
+ *
+ ******************************************************************************/
+#pragma once
+
+#include <array>
+#include <vector>
+
+#include "../types.hpp"
+
+namespace triqs_tprf {
+
+  /** Data index table of a periodic cluster mesh (mesh::cyclat or mesh::brzone)
+
+   For all points x of the mesh, in data index order, the data index of the
+   point sx * x + sy * y, folded back onto the mesh. The point y is given by its
+   data index, and the signs sx and sy are +1 or -1.
+
+   The table is computed with integer arithmetic only, so hot loops can replace
+   the mesh point arithmetic and gf evaluation of g(-r) or g(k - q) by plain
+   array indexing of the gf data.
+  */
+  template <typename M> std::vector<long> mesh_index_table(M const &mesh, int sx, long y, int sy) {
+
+    auto dims = mesh.dims();
+
+    std::array<long, 3> yi;
+    for (int i = 2; i >= 0; i--) {
+      yi[i] = y % dims[i];
+      y /= dims[i];
+    }
+
+    auto fold = [](long v, long n) { return ((v % n) + n) % n; };
+
+    std::vector<long> table(mesh.size());
+    long x = 0;
+    for (long i0 = 0; i0 < dims[0]; i0++) {
+      long j0 = fold(sx * i0 + sy * yi[0], dims[0]);
+      for (long i1 = 0; i1 < dims[1]; i1++) {
+        long j1 = fold(sx * i1 + sy * yi[1], dims[1]);
+        for (long i2 = 0; i2 < dims[2]; i2++) table[x++] = (j0 * dims[1] + j1) * dims[2] + fold(sx * i2 + sy * yi[2], dims[2]);
+      }
+    }
+    return table;
+  }
+
+  /// Data indices of -x for all x of the mesh
+  template <typename M> std::vector<long> minus_x_index_table(M const &mesh) { return mesh_index_table(mesh, -1, 0, +1); }
+
+  /// Data indices of x + q for all x of the mesh, q given by its data index
+  template <typename M> std::vector<long> x_plus_q_index_table(M const &mesh, long q) { return mesh_index_table(mesh, +1, q, +1); }
+
+  /// Data indices of x - q for all x of the mesh, q given by its data index
+  template <typename M> std::vector<long> x_minus_q_index_table(M const &mesh, long q) { return mesh_index_table(mesh, +1, q, -1); }
+
+} // namespace triqs_tprf
@@ -23,44 +23,32 @@
 #include "rpa.hpp"
 #include <omp.h>
 #include "../mpi.hpp"
+#include "../batched_linalg.hpp"
 
 namespace triqs_tprf {
 
   template<typename CHI_T, typename CHI_VT>
   CHI_T solve_rpa_PH(CHI_VT chi0_wk, array_contiguous_view<std::complex<double>, 4> U_arr) {
 
-    using scalar_t = chi_wk_t::scalar_t;
-
-    size_t nb = chi0_wk.target_shape()[0];
+    mpi::communicator comm;
 
     auto chi_wk = make_gf(chi0_wk);
-    chi_wk *= 0;
-
-    // PH grouping of the vertex, from cc+cc+, permuting the last two indices.
-    auto U = make_matrix_view(group_indices_view(U_arr, idx_group<0, 1>, idx_group<3, 2>));
-
-    auto I = nda::eye<scalar_t>(U.shape()[0]);
-
-    auto meshes_mpi = mpi_view(chi0_wk.mesh());
-
-#pragma omp parallel for
-  for (unsigned int idx = 0; idx < meshes_mpi.size(); idx++){
-    auto &[w, k] = meshes_mpi[idx];
+    auto chi_arr = ph_batch_view(chi_wk.data());
 
-    array<scalar_t, 4> chi_arr{nb, nb, nb, nb};
-    array<scalar_t, 4> chi0_arr{chi0_wk[w, k]};
+    // Local (w, k) points, packed to PH grouped matrices (permuting last two indices)
+    long n_points = chi_arr.shape()[0];
+    auto [j0, j1] = itertools::chunk_range(0, n_points, comm.size(), comm.rank());
 
-    // PH grouping (permuting last two indices)
-    auto chi  = make_matrix_view(group_indices_view(chi_arr, idx_group<0, 1>, idx_group<3, 2>));
-    auto chi0 = make_matrix_view(group_indices_view(chi0_arr, idx_group<0, 1>, idx_group<3, 2>));
+    auto chi = pack_PH(chi_arr, j0, j1);
+    auto U   = pack_PH(ph_batch_view(U_arr), 0, 1);
 
-    chi = inverse(I - chi0 * U) * chi0; // Inverted BSE specialized for rpa
+    batched_rpa_solve(chi, U); // Inverted BSE specialized for rpa, chi = [1 - chi0 U]^{-1} chi0
 
-    chi_wk[w, k] = chi_arr;             // assign back using the array_view
-    }
-  chi_wk = mpi::all_reduce(chi_wk);
+    chi_wk.data() = 0;
+    unpack_PH(chi, chi_arr, j0);
 
-  return chi_wk;
+    mpi_all_reduce_in_place(chi_wk);
+    return chi_wk;
   }
 
   chi_wk_t solve_rpa_PH(chi_wk_vt chi0_wk, array_contiguous_view<std::complex<double>, 4> U_arr) {
@@ -71,4 +59,34 @@ namespace triqs_tprf {
     return solve_rpa_PH<chi_fk_t, chi_fk_vt>(chi0_fk, U_arr);
   }
 
+  namespace {
+
+  // RPA at every (row, lattice point) of a (rows, points, a, b, c, d) array
+  void solve_rpa_PH_pointwise(array_const_view<std::complex<double>, 6> chi0_arr, array_contiguous_view<std::complex<double>, 4> U_arr,
+                              array_view<std::complex<double>, 6> chi_out) {
+
+    auto chi0 = ph_batch_view(chi0_arr);
+
+    auto chi = pack_PH(chi0, 0, chi0.shape()[0]);
+    auto U   = pack_PH(ph_batch_view(U_arr), 0, 1);
+
+    batched_rpa_solve(chi, U);
+
+    unpack_PH(chi, ph_batch_view(chi_out), 0);
+  }
+
+  } // namespace
+
+  chi_wk_dist_t solve_rpa_PH(chi_wk_dist_t const &chi0_wk, array_contiguous_view<std::complex<double>, 4> U_arr) {
+    chi_wk_dist_t chi_wk(chi0_wk.mesh(), chi0_wk.target_shape(), chi0_wk.communicator());
+    solve_rpa_PH_pointwise(chi0_wk.data(), U_arr, chi_wk.data());
+    return chi_wk;
+  }
+
+  chi_wk_ibz_t solve_rpa_PH(chi_wk_ibz_t const &chi0_wk, array_contiguous_view<std::complex<double>, 4> U_arr) {
+    chi_wk_ibz_t chi_wk(chi0_wk.mesh(), chi0_wk.ibz_ptr(), chi0_wk.target_shape());
+    solve_rpa_PH_pointwise(chi0_wk.data(), U_arr, chi_wk.data());
+    return chi_wk;
+  }
+
 } // namespace triqs_tprf
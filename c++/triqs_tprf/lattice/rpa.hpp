@@ -22,6 +22,8 @@
 #pragma once
 
 #include "../types.hpp"
+#include "../distributed_gf.hpp"
+#include "ibz.hpp"
 
 namespace triqs_tprf {
 
@@ -58,5 +60,26 @@ namespace triqs_tprf {
   */
 
   chi_fk_t solve_rpa_PH(chi_fk_vt chi0, array_contiguous_view<std::complex<double>, 4> U);
+
+  /** Random Phase Approximation (RPA) in the particle-hole channel, distributed over MPI ranks
+
+     Same as solve_rpa_PH, for a bare bubble distributed over the ranks.
+
+     @param chi0 distributed bare particle-hole bubble :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\mathbf{k}, i\omega_n)`
+     @param U RPA static vertex as obtained from triqs_tprf.rpa_tensor.get_rpa_tensor :math:`U_{a\bar{b}c\bar{d}}`
+     @return distributed RPA suceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\mathbf{k}, i\omega_n)`
+ */
+  chi_wk_dist_t solve_rpa_PH(chi_wk_dist_t const &chi0, array_contiguous_view<std::complex<double>, 4> U);
+
+  /** Random Phase Approximation (RPA) in the particle-hole channel on the irreducible Brillouin zone
+
+     Same as solve_rpa_PH, computed at the irreducible q-points only. The vertex
+     must be invariant under the point group of the irreducible zone map.
+
+     @param chi0 bare particle-hole bubble at the irreducible q-points
+     @param U RPA static vertex as obtained from triqs_tprf.rpa_tensor.get_rpa_tensor :math:`U_{a\bar{b}c\bar{d}}`
+     @return RPA suceptibility at the irreducible q-points
+ */
+  chi_wk_ibz_t solve_rpa_PH(chi_wk_ibz_t const &chi0, array_contiguous_view<std::complex<double>, 4> U);
   
 } // namespace triqs_tprf
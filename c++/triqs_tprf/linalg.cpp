@@ -19,108 +19,189 @@
  *
  ******************************************************************************/
 
+#include <nda/blas.hpp>
+#include <nda/linalg.hpp>
+#include <triqs/utility/exceptions.hpp>
+
+#include <omp.h>
+
 #include "linalg.hpp"
+#include "mpi.hpp"
 
 namespace triqs_tprf {
 
- // ----------------------------------------------------
+ namespace {
 
- template <Channel_t CH> g2_nn_t inverse(g2_nn_cvt g) {
+   /* Apply f(w) to the bosonic frequencies w in arr.
 
-   auto g_inv = make_gf(g);
+    The OpenMP threads are first spread over the frequencies, and the
+    threads left over are handed to the nested (OpenMP threaded) BLAS and
+    LAPACK calls of each frequency. A BLAS library using its own thread
+    pool is not affected by this budget.
+   */
+   template <typename F> void bosonic_parallel_for(std::vector<mesh::imfreq::mesh_point_t> const &arr, F f) {
 
-   using dat_t = array<g2_nn_cvt::scalar_t, g2_nn_cvt::data_rank, channel_memory_layout<CH>>;
+     int n_max     = omp_get_max_threads();
+     int n_threads = std::max(1, std::min(n_max, int(arr.size())));
+     int n_blas    = std::max(1, n_max / n_threads);
 
-   auto g_w_dat     = dat_t{g.data()};
-   auto g_w_inv_dat = dat_t{g.data()};
+     int levels = omp_get_max_active_levels();
+     if (n_blas > 1) omp_set_max_active_levels(std::max(levels, 2));
 
-   auto mat     = channel_matrix_view<CH>(g_w_dat);
-   auto mat_inv = channel_matrix_view<CH>(g_w_inv_dat);
+#pragma omp parallel for num_threads(n_threads) schedule(dynamic)
+     for (long idx = 0; idx < long(arr.size()); idx++) {
+       omp_set_num_threads(n_blas);
+       f(arr[idx]);
+     }
 
-   mat_inv = inverse(mat);
-
-   g_inv.data() = g_w_inv_dat;
+     omp_set_max_active_levels(levels);
+   }
 
-   return g_inv;
- }
-  
- /// Inverse: [G]^{-1}, Two-particle response-function inversion
- template <Channel_t CH> g2_iw_t inverse(g2_iw_cvt g) {
+   // All bosonic frequencies, on this rank only
+   std::vector<mesh::imfreq::mesh_point_t> all_points(mesh::imfreq const &wmesh) {
+     std::vector<mesh::imfreq::mesh_point_t> arr;
+     arr.reserve(wmesh.size());
+     for (auto const &w : wmesh) arr.emplace_back(w);
+     return arr;
+   }
 
-   //channel_grouping<CH> chg;
-   auto g_inv = make_gf(g);
+   template <Channel_t CH> void inverse_impl(g2_iw_cvt g, g2_iw_vt g_inv, std::vector<mesh::imfreq::mesh_point_t> const &arr) {
+     auto _ = all_t{};
+     bosonic_parallel_for(arr, [&](auto const &w) {
+       auto g_ch = g2_nn_channel<CH>{g[w, _, _]};
+       inverse_in_place(g_ch);
+       g_ch.copy_to(g_inv[w, _, _]);
+     });
+   }
 
-   for (auto w : std::get<0>(g.mesh())) {
-     auto _         = all_t{};
-     g_inv[w, _, _] = inverse<CH>(g[w, _, _]);
+   template <Channel_t CH> void product_impl(g2_iw_cvt A, g2_iw_cvt B, g2_iw_vt C, std::vector<mesh::imfreq::mesh_point_t> const &arr) {
+     auto _            = all_t{};
+     auto const &fmesh = std::get<1>(A.mesh());
+     bosonic_parallel_for(arr, [&](auto const &w) {
+       auto A_ch = g2_nn_channel<CH>{A[w, _, _]};
+       auto B_ch = g2_nn_channel<CH>{B[w, _, _]};
+       auto C_ch = g2_nn_channel<CH>{fmesh, A.target_shape()};
+       product(A_ch, B_ch, C_ch);
+       C_ch.copy_to(C[w, _, _]);
+     });
    }
-  return g_inv;
- }
+
+ } // namespace
 
  // ----------------------------------------------------
-  
- template <Channel_t CH> g2_nn_t product(g2_nn_cvt A, g2_nn_cvt B) {
+ // g2_nn_channel operations, in place on the channel matrix
 
-   auto C = make_gf(A);
+ template <Channel_t CH> void inverse_in_place(g2_nn_channel<CH> &g) {
+   auto mat = g.matrix();
+   nda::inverse_in_place(mat);
+ }
 
-   using dat_t = array<g2_nn_cvt::scalar_t, g2_nn_cvt::data_rank, channel_memory_layout<CH>>;
+ template <Channel_t CH>
+ void product(g2_nn_channel<CH> const &A, g2_nn_channel<CH> const &B, g2_nn_channel<CH> &C, g2_nn_t::scalar_t alpha, g2_nn_t::scalar_t beta) {
+   if (A.matrix_size() != B.matrix_size() || A.matrix_size() != C.matrix_size())
+     TRIQS_RUNTIME_ERROR << "product: incompatible channel matrix sizes " << A.matrix_size() << ", " << B.matrix_size() << ", " << C.matrix_size();
+   auto C_mat = C.matrix();
+   nda::blas::gemm(alpha, A.matrix(), B.matrix(), beta, C_mat);
+ }
 
-   auto A_w_dat = dat_t{A.data()};
-   auto B_w_dat = dat_t{B.data()};
-   auto C_w_dat = dat_t{A_w_dat};
+ template <Channel_t CH> void set_identity(g2_nn_channel<CH> &g) {
+   g.matrix() = 1.0; // This sets a nda::matrix to the identity matrix...
+ }
 
-   auto A_mat = channel_matrix_view<CH>(A_w_dat);
-   auto B_mat = channel_matrix_view<CH>(B_w_dat);
-   auto C_mat = channel_matrix_view<CH>(C_w_dat);
+ // ----------------------------------------------------
 
-   C_mat = A_mat * B_mat;
+ template <Channel_t CH> g2_nn_t inverse(g2_nn_cvt g) {
+   auto g_ch = g2_nn_channel<CH>{g};
+   inverse_in_place(g_ch);
+   return g_ch.to_gf();
+ }
+  
+ /// Inverse: [G]^{-1}, Two-particle response-function inversion
+ template <Channel_t CH> g2_iw_t inverse(g2_iw_cvt g) {
+   g2_iw_t g_inv(g.mesh(), g.target_shape());
+   inverse_impl<CH>(g, g_inv(), all_points(std::get<0>(g.mesh())));
+   return g_inv;
+ }
 
-   C.data() = C_w_dat;
+ template <Channel_t CH> g2_iw_t inverse(g2_iw_cvt g, mpi::communicator c) {
+   g2_iw_t g_inv(g.mesh(), g.target_shape());
+   g_inv.data() = 0;
+   inverse_impl<CH>(g, g_inv(), mpi_view(std::get<0>(g.mesh()), c));
+   mpi_all_reduce_in_place(g_inv, c);
+   return g_inv;
+ }
 
-   return C;
+ // ----------------------------------------------------
+  
+ template <Channel_t CH> g2_nn_t product(g2_nn_cvt A, g2_nn_cvt B) {
+   auto A_ch = g2_nn_channel<CH>{A};
+   auto B_ch = g2_nn_channel<CH>{B};
+   auto C_ch = g2_nn_channel<CH>{std::get<0>(A.mesh()), A.target_shape()};
+   product(A_ch, B_ch, C_ch);
+   return C_ch.to_gf();
  }
 
  /// product: C = A * B, two-particle response-function product
  template <Channel_t CH> g2_iw_t product(g2_iw_cvt A, g2_iw_cvt B) {
+   g2_iw_t C(A.mesh(), A.target_shape());
+   product_impl<CH>(A, B, C(), all_points(std::get<0>(A.mesh())));
+   return C;
+ }
 
-   auto C = make_gf(A);
-
-   for (auto w : std::get<0>(A.mesh())) {
-     auto _     = all_t{};
-     C[w, _, _] = product<CH>(A[w, _, _], B[w, _, _]);
-   }
-  return C;
+ template <Channel_t CH> g2_iw_t product(g2_iw_cvt A, g2_iw_cvt B, mpi::communicator c) {
+   g2_iw_t C(A.mesh(), A.target_shape());
+   C.data() = 0;
+   product_impl<CH>(A, B, C(), mpi_view(std::get<0>(A.mesh()), c));
+   mpi_all_reduce_in_place(C, c);
+   return C;
  }
 
  // ----------------------------------------------------
 
  template <Channel_t CH> g2_nn_t identity(g2_nn_cvt g) {
+   auto I_ch = g2_nn_channel<CH>{std::get<0>(g.mesh()), g.target_shape()};
+   set_identity(I_ch);
+   return I_ch.to_gf();
+ }
 
-   using dat_t = array<g2_nn_cvt::scalar_t, g2_nn_cvt::data_rank, channel_memory_layout<CH>>;
+ /// Identity: 1, identity two-particle response-function
+ template <Channel_t CH> g2_iw_t identity(g2_iw_cvt g) {
 
-   auto I = make_gf(g);
+   auto _ = all_t{};
+   g2_iw_t I(g.mesh(), g.target_shape());
 
-   auto I_w_dat = dat_t{I.data()};
-   auto I_mat   = channel_matrix_view<CH>(I_w_dat);
+   auto const &fmesh = std::get<1>(g.mesh());
 
-   I_mat    = 1.0; // This sets a nda::matrix to the identity matrix...
-   I.data() = I_w_dat;
+   bosonic_parallel_for(all_points(std::get<0>(g.mesh())), [&](auto const &w) {
+     auto I_ch = g2_nn_channel<CH>{fmesh, g.target_shape()};
+     set_identity(I_ch);
+     I_ch.copy_to(I[w, _, _]);
+   });
 
    return I;
  }
+  
+ // ----------------------------------------------------
 
- /// Identity: 1, identity two-particle response-function
- template <Channel_t CH> g2_iw_t identity(g2_iw_cvt g) {
+ template class g2_nn_channel<Channel_t::PH>;
+ template class g2_nn_channel<Channel_t::PH_bar>;
+ template class g2_nn_channel<Channel_t::PP>;
 
-   auto I = make_gf(g);
+ template void inverse_in_place(g2_nn_channel<Channel_t::PH> &);
+ template void inverse_in_place(g2_nn_channel<Channel_t::PH_bar> &);
+ template void inverse_in_place(g2_nn_channel<Channel_t::PP> &);
+
+ template void product(g2_nn_channel<Channel_t::PH> const &, g2_nn_channel<Channel_t::PH> const &, g2_nn_channel<Channel_t::PH> &,
+                       g2_nn_t::scalar_t, g2_nn_t::scalar_t);
+ template void product(g2_nn_channel<Channel_t::PH_bar> const &, g2_nn_channel<Channel_t::PH_bar> const &, g2_nn_channel<Channel_t::PH_bar> &,
+                       g2_nn_t::scalar_t, g2_nn_t::scalar_t);
+ template void product(g2_nn_channel<Channel_t::PP> const &, g2_nn_channel<Channel_t::PP> const &, g2_nn_channel<Channel_t::PP> &,
+                       g2_nn_t::scalar_t, g2_nn_t::scalar_t);
+
+ template void set_identity(g2_nn_channel<Channel_t::PH> &);
+ template void set_identity(g2_nn_channel<Channel_t::PH_bar> &);
+ template void set_identity(g2_nn_channel<Channel_t::PP> &);
 
-   for (auto w : std::get<0>(g.mesh())) {
-     auto _     = all_t{};
-     I[w, _, _] = identity<CH>(I[w, _, _]);
-   }
-  return I;
- }
-  
  // ----------------------------------------------------
 
  template g2_nn_t inverse<Channel_t::PH>(g2_nn_cvt);
@@ -135,10 +216,18 @@ namespace triqs_tprf {
  template g2_iw_t inverse<Channel_t::PH_bar>(g2_iw_cvt);
  template g2_iw_t inverse<Channel_t::PP>(g2_iw_cvt);
 
+ template g2_iw_t inverse<Channel_t::PH>(g2_iw_cvt, mpi::communicator);
+ template g2_iw_t inverse<Channel_t::PH_bar>(g2_iw_cvt, mpi::communicator);
+ template g2_iw_t inverse<Channel_t::PP>(g2_iw_cvt, mpi::communicator);
+
  g2_iw_t inverse_PH(g2_iw_vt g) { return inverse<Channel_t::PH>(g); }
  g2_iw_t inverse_PP(g2_iw_vt g) { return inverse<Channel_t::PP>(g); }
  g2_iw_t inverse_PH_bar(g2_iw_vt g) { return inverse<Channel_t::PH_bar>(g); }
 
+ g2_iw_t inverse_PH_mpi(g2_iw_vt g) { return inverse<Channel_t::PH>(g, mpi::communicator{}); }
+ g2_iw_t inverse_PP_mpi(g2_iw_vt g) { return inverse<Channel_t::PP>(g, mpi::communicator{}); }
+ g2_iw_t inverse_PH_bar_mpi(g2_iw_vt g) { return inverse<Channel_t::PH_bar>(g, mpi::communicator{}); }
+
  // ----------------------------------------------------
   
  template g2_nn_t product<Channel_t::PH>(g2_nn_cvt, g2_nn_cvt);
@@ -153,9 +242,17 @@ namespace triqs_tprf {
  template g2_iw_t product<Channel_t::PH_bar>(g2_iw_cvt, g2_iw_cvt);
  template g2_iw_t product<Channel_t::PP>(g2_iw_cvt, g2_iw_cvt);
 
+ template g2_iw_t product<Channel_t::PH>(g2_iw_cvt, g2_iw_cvt, mpi::communicator);
+ template g2_iw_t product<Channel_t::PH_bar>(g2_iw_cvt, g2_iw_cvt, mpi::communicator);
+ template g2_iw_t product<Channel_t::PP>(g2_iw_cvt, g2_iw_cvt, mpi::communicator);
+
  g2_iw_t product_PH(g2_iw_vt A, g2_iw_vt B) { return product<Channel_t::PH>(A, B); }
  g2_iw_t product_PP(g2_iw_vt A, g2_iw_vt B) { return product<Channel_t::PP>(A, B); }
  g2_iw_t product_PH_bar(g2_iw_vt A, g2_iw_vt B) { return product<Channel_t::PH_bar>(A, B); }
+
+ g2_iw_t product_PH_mpi(g2_iw_vt A, g2_iw_vt B) { return product<Channel_t::PH>(A, B, mpi::communicator{}); }
+ g2_iw_t product_PP_mpi(g2_iw_vt A, g2_iw_vt B) { return product<Channel_t::PP>(A, B, mpi::communicator{}); }
+ g2_iw_t product_PH_bar_mpi(g2_iw_vt A, g2_iw_vt B) { return product<Channel_t::PH_bar>(A, B, mpi::communicator{}); }
  
  // ----------------------------------------------------
 
@@ -21,6 +21,7 @@
 #pragma once
 
 #include <nda/nda.hpp>
+#include <mpi/mpi.hpp>
 #include <triqs/gfs.hpp>
 #include <triqs/mesh.hpp>
 
@@ -52,6 +53,8 @@ namespace triqs_tprf {
  where the mapping of target-space indices $\{a, b, c, d \}$ to $\{\alpha, \beta\}, \{\gamma, \delta\}$ is channel dependent.
  
  Storage is allocated and the inverse is returned by value.
+ The bosonic frequencies are split over the OpenMP threads of the calling
+ process, see the overload with a communicator for the MPI distributed version.
  
  @tparam CH selects the two-particle channel
  @param g two-particle response function to invert, :math:`g \equiv g_{abcd}(\omega, \nu, \nu')`
@@ -62,6 +65,13 @@ namespace triqs_tprf {
  */
   template <Channel_t CH> g2_iw_t inverse(g2_iw_cvt g);
 
+  /** Two-particle response-function inversion $[g]^{-1}$, distributed over MPI ranks
+
+   Same as inverse, with the bosonic frequencies split over the ranks of c and
+   the result reduced over all ranks. This is a collective call on c.
+   */
+  template <Channel_t CH> g2_iw_t inverse(g2_iw_cvt g, mpi::communicator c);
+
   /** Two-particle response-function inversion $[g]^{-1}$ in the particle-hole channel (PH).
  
  The two-particle response function $g_{abcd}(\omega, \nu, \nu')$ 
@@ -122,6 +132,16 @@ namespace triqs_tprf {
  */
   g2_iw_t inverse_PH_bar(g2_iw_vt g);
 
+  /** Two-particle response-function inversion $[g]^{-1}$, distributed over the MPI ranks
+
+   Same as inverse_PH, inverse_PP and inverse_PH_bar, with the bosonic frequencies split over
+   the ranks of the world communicator and the result reduced over all ranks.
+   This is a collective call on all ranks.
+   */
+  g2_iw_t inverse_PH_mpi(g2_iw_vt g);
+  g2_iw_t inverse_PP_mpi(g2_iw_vt g);
+  g2_iw_t inverse_PH_bar_mpi(g2_iw_vt g);
+
   template <Channel_t CH> g2_nn_t inverse(g2_nn_cvt g);
 
   g2_nn_t inverse_PH(g2_nn_vt g);
@@ -143,6 +163,7 @@ namespace triqs_tprf {
  where the mapping of target-space indices $\{a, b, c, d \}$ to $\{\alpha, \beta\}, \{\gamma, \delta\}$ is channel dependent.
 
  Storage is allocated and the product is returned by value.
+ As for the inverse, the bosonic frequencies are split over OpenMP threads.
  
  @tparam CH selects the two-particle channel
  @param A two-particle response function :math:`A \equiv A_{abcd}(\omega, \nu, \nu')`
@@ -155,6 +176,13 @@ namespace triqs_tprf {
 
   template <Channel_t CH> g2_iw_t product(g2_iw_cvt A, g2_iw_cvt B);
 
+  /** Two-particle response-function product :math:`A * B`, distributed over MPI ranks
+
+   Same as product, with the bosonic frequencies split over the ranks of c and
+   the result reduced over all ranks. This is a collective call on c.
+   */
+  template <Channel_t CH> g2_iw_t product(g2_iw_cvt A, g2_iw_cvt B, mpi::communicator c);
+
   /** Two-particle response-function product :math:`A * B` in the particle-hole channel (PH).
  
  The two-particle response functions $A \equiv A_{abcd}(\omega, \nu, \nu')$ 
@@ -236,6 +264,16 @@ namespace triqs_tprf {
 
   g2_iw_t product_PH_bar(g2_iw_vt A, g2_iw_vt B);
 
+  /** Two-particle response-function product :math:`A * B`, distributed over the MPI ranks
+
+   Same as product_PH, product_PP and product_PH_bar, with the bosonic frequencies split over
+   the ranks of the world communicator and the result reduced over all ranks.
+   This is a collective call on all ranks.
+   */
+  g2_iw_t product_PH_mpi(g2_iw_vt A, g2_iw_vt B);
+  g2_iw_t product_PP_mpi(g2_iw_vt A, g2_iw_vt B);
+  g2_iw_t product_PH_bar_mpi(g2_iw_vt A, g2_iw_vt B);
+
   template <Channel_t CH> g2_nn_t product(g2_nn_cvt A, g2_nn_cvt B);
 
   g2_nn_t product_PH(g2_nn_vt A, g2_nn_vt B);
@@ -255,6 +293,7 @@ namespace triqs_tprf {
  where the mapping of target-space indices $\{a, b, c, d \}$ to $\{\alpha, \beta\}, \{\gamma, \delta\}$ is channel dependent.
 
  Storage is allocated and the result is returned by value.
+ The bosonic frequencies are split over OpenMP threads.
  
  @tparam CH selects the two-particle channel
  @param A two-particle response function :math:`A \equiv A_{abcd}(\omega, \nu, \nu')` determinig the shape and size of the unity operator
@@ -345,4 +384,68 @@ namespace triqs_tprf {
 
   array<g2_nn_cvt::scalar_t, 4> scalar_product_PH(g2_n_cvt vL, g2_nn_cvt M, g2_n_cvt vR);
 
+  /** Two-particle response function stored in the grouped layout of a channel
+
+ The data :math:`g_{abcd}(\nu, \nu')` is kept permanently in channel_memory_layout<CH>,
+ where it is the row major matrix :math:`g_{\{\nu\alpha\beta\}, \{\nu'\gamma\delta\}}`.
+ The inverse, product and identity below work on this matrix in place, and the
+ data is only reordered when converting from and to g2_nn_t at the API boundaries.
+
+ @tparam CH selects the two-particle channel
+ @include tprf/linalg.hpp
+ */
+  template <Channel_t CH> class g2_nn_channel {
+
+    public:
+    using scalar_t = g2_nn_t::scalar_t;
+    using data_t   = array<scalar_t, 6, channel_memory_layout<CH>>;
+
+    /// Zero response function on the fermionic mesh fmesh
+    g2_nn_channel(mesh::imfreq const &fmesh, std::array<long, 4> const &target_shape)
+       : _fmesh(fmesh), _data(fmesh.size(), fmesh.size(), target_shape[0], target_shape[1], target_shape[2], target_shape[3]) {
+      _data = 0;
+    }
+
+    /// Conversion from the standard layout, reorders the data
+    explicit g2_nn_channel(g2_nn_cvt g) : _fmesh(std::get<0>(g.mesh())), _data(g.data()) {}
+
+    /// Conversion to the standard layout, reorders the data
+    g2_nn_t to_gf() const {
+      g2_nn_t g({_fmesh, _fmesh}, target_shape());
+      g.data() = _data;
+      return g;
+    }
+
+    /// Copy to a standard layout response function, reorders the data
+    void copy_to(g2_nn_vt g) const { g.data() = _data; }
+
+    mesh::imfreq const &fmesh() const { return _fmesh; }
+    std::array<long, 4> target_shape() const { return {_data.shape()[2], _data.shape()[3], _data.shape()[4], _data.shape()[5]}; }
+
+    data_t &data() { return _data; }
+    data_t const &data() const { return _data; }
+
+    /// Dimension of the channel matrix
+    long matrix_size() const { return _data.shape()[0] * _data.shape()[2] * _data.shape()[3]; }
+
+    /// The channel matrix, the same as channel_matrix_view<CH> of the data
+    matrix_view<scalar_t> matrix() { return matrix_view<scalar_t>{std::array<long, 2>{matrix_size(), matrix_size()}, _data.data()}; }
+    matrix_const_view<scalar_t> matrix() const { return matrix_const_view<scalar_t>{std::array<long, 2>{matrix_size(), matrix_size()}, _data.data()}; }
+
+    private:
+    mesh::imfreq _fmesh;
+    data_t _data;
+  };
+
+  /// In place inversion of the channel matrix, :math:`g \leftarrow [g]^{-1}`
+  template <Channel_t CH> void inverse_in_place(g2_nn_channel<CH> &g);
+
+  /// Product of channel matrices, :math:`C \leftarrow \alpha A * B + \beta C`, without temporaries
+  template <Channel_t CH>
+  void product(g2_nn_channel<CH> const &A, g2_nn_channel<CH> const &B, g2_nn_channel<CH> &C, g2_nn_t::scalar_t alpha = 1.0,
+               g2_nn_t::scalar_t beta = 0.0);
+
+  /// Set g to the identity of the channel, :math:`g \leftarrow \mathbf{1}`
+  template <Channel_t CH> void set_identity(g2_nn_channel<CH> &g);
+
 } // namespace triqs_tprf
@@ -25,6 +25,9 @@
 #include <mpi/mpi.hpp>
 
 #include <span>
+#include <vector>
+#include <limits>
+#include <algorithm>
 
 #include "types.hpp"
 
@@ -47,4 +50,48 @@ namespace triqs_tprf {
     return arr;
   }
 
+  /// Upper bound in bytes of a single message in mpi_all_reduce_in_place
+  inline constexpr long mpi_reduce_chunk_bytes = long(1) << 27;
+
+  /** In place MPI sum-reduction of a contiguous buffer.
+
+   The buffer is split into chunks of at most `chunk_bytes` bytes (and at most
+   INT_MAX elements) which are reduced with non-blocking MPI_Iallreduce calls,
+   all chunks are in flight at the same time.
+
+   This avoids the int-count overflow of a single MPI_Allreduce on large
+   two-particle objects, without resorting to one collective per
+   frequency slice.
+  */
+  template <typename T>
+  void mpi_all_reduce_in_place(T *data, long size, mpi::communicator c = {}, long chunk_bytes = mpi_reduce_chunk_bytes) {
+
+    if (c.size() < 2 || size == 0) return;
+
+    long chunk = std::clamp(chunk_bytes / long(sizeof(T)), long(1), long(std::numeric_limits<int>::max()));
+    long n_chunks = (size + chunk - 1) / chunk;
+
+    std::vector<MPI_Request> requests(n_chunks);
+    for (long i = 0; i < n_chunks; i++) {
+      long offset = i * chunk;
+      int count   = int(std::min(chunk, size - offset));
+      MPI_Iallreduce(MPI_IN_PLACE, data + offset, count, mpi::mpi_type<T>::get(), MPI_SUM, c.get(), &requests[i]);
+    }
+    MPI_Waitall(int(n_chunks), requests.data(), MPI_STATUSES_IGNORE);
+  }
+
+  /// In place MPI sum-reduction of the data of a Green's function (or Green's function view)
+  template <typename G> void mpi_all_reduce_in_place(G &&g, mpi::communicator c = {}) {
+
+    auto &&arr = g.data();
+
+    if (arr.indexmap().is_contiguous()) {
+      mpi_all_reduce_in_place(arr.data(), arr.size(), c);
+    } else {
+      auto tmp = make_regular(arr);
+      mpi_all_reduce_in_place(tmp.data(), tmp.size(), c);
+      arr = tmp;
+    }
+  }
+
 } // namespace triqs_tprf
@@ -35,7 +35,7 @@ from triqs.gf import MeshImFreq, MeshProduct, Gf, Idx
 
 from triqs_tprf.logo import tprf_banner
 
-from triqs_tprf.linalg import inverse_PH
+from triqs_tprf.linalg import inverse_PH_mpi
 from triqs_tprf.chi_from_gg2 import chi0_from_gg2_PH, chi_from_gg2_PH
 
 from triqs_tprf.lattice import fourier_wk_to_wr
@@ -45,6 +45,7 @@ from triqs_tprf.lattice import chi0r_from_gr_PH_nompi
 from triqs_tprf.lattice import chi0q_from_chi0r
 from triqs_tprf.lattice import chi0q_sum_nu 
 from triqs_tprf.lattice import chiq_sum_nu_from_chi0q_and_gamma_PH
+from triqs_tprf.lattice import CompressedVertexPH
 from triqs_tprf.lattice_utils import imtime_bubble_chi0_wk, add_fake_bosonic_mesh
 
 
@@ -61,6 +62,8 @@ def impurity_irreducible_vertex_Gamma(g_w, g2_wnn):
     where the inverses are taken in the particle-hole channel pairing
     of fermionic frequencies :math:`\nu` and :math:`\nu'` and orbital
     indices.
+    The inverses are distributed over the bosonic frequencies of the MPI
+    ranks, so this is a collective call on all ranks.
 
     Parameters
     ----------
@@ -80,7 +83,7 @@ def impurity_irreducible_vertex_Gamma(g_w, g2_wnn):
     chi_wnn = chi_from_gg2_PH(g_w, g2_wnn)
     chi0_wnn = chi0_from_gg2_PH(g_w, g2_wnn)
 
-    Gamma_wnn = inverse_PH(chi0_wnn) - inverse_PH(chi_wnn)    
+    Gamma_wnn = inverse_PH_mpi(chi0_wnn) - inverse_PH_mpi(chi_wnn)    
     
     return Gamma_wnn
 
@@ -98,6 +101,8 @@ def solve_local_bse(chi0_wnn, chi_wnn):
     where the inverses are taken in the particle-hole channel pairing
     of fermionic frequencies :math:`\nu` and :math:`\nu'` and orbital
     indices.
+    The inverses are distributed over the bosonic frequencies of the MPI
+    ranks, so this is a collective call on all ranks.
 
     Parameters
     ----------
@@ -114,7 +119,7 @@ def solve_local_bse(chi0_wnn, chi_wnn):
                 :math:`\Gamma_{abcd}(\omega, \nu, \nu')`
     """
 
-    gamma_wnn = inverse_PH(chi0_wnn) - inverse_PH(chi_wnn)    
+    gamma_wnn = inverse_PH_mpi(chi0_wnn) - inverse_PH_mpi(chi_wnn)    
     return gamma_wnn
 
 
@@ -309,7 +314,7 @@ def get_chi0_nk_at_specific_w(g_wk, nw_index=1, nwf=None):
     return chi0_nk    
         
 
-def solve_lattice_bse(g_wk, gamma_wnn):
+def solve_lattice_bse(g_wk, gamma_wnn, vertex_tol=None):
     r""" Compute the generalized lattice susceptibility 
     :math:`\chi_{\bar{a}b\bar{c}d}(\mathbf{k}, \omega_n)` using the Bethe-Salpeter 
     equation (BSE).
@@ -322,6 +327,10 @@ def solve_lattice_bse(g_wk, gamma_wnn):
     gamma_wnn : Gf,
                 Local particle-hole vertex function 
                 :math:`\Gamma_{a\bar{b}c\bar{d}}(i\omega_n, i\nu_n, i\nu_n')`.
+    vertex_tol : float, optional
+                 If given, the vertex is compressed to a low rank factorization with this
+                 relative singular value tolerance, see ``CompressedVertexPH``, and the
+                 lattice BSE is solved with the Woodbury identity.
 
     Returns
     -------
@@ -389,7 +398,10 @@ def solve_lattice_bse(g_wk, gamma_wnn):
     # -- Lattice BSE calc with built in trace
     mpi.report('--> chi_kw from BSE')
     #mpi.report('DEBUG BSE INACTIVE'*72)
-    chi_kw = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, gamma_wnn)
+    if vertex_tol is not None:
+        chi_kw = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, CompressedVertexPH(gamma_wnn, vertex_tol))
+    else:
+        chi_kw = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, gamma_wnn)
     #chi_kw = chi0_kw.copy()
 
     mpi.barrier()
@@ -408,7 +420,7 @@ def solve_lattice_bse(g_wk, gamma_wnn):
     return chi_kw, chi0_kw
 
 
-def solve_lattice_bse_at_specific_w(g_wk, gamma_wnn, nw_index):
+def solve_lattice_bse_at_specific_w(g_wk, gamma_wnn, nw_index, vertex_tol=None):
     r""" Compute the generalized lattice susceptibility 
     :math:`\chi_{\bar{a}b\bar{c}d}(i\omega_{n=\mathrm{nw\_index}}, \mathbf{k})` using the Bethe-Salpeter 
     equation (BSE) for a specific :math:`i\omega_{n=\mathrm{nw\_index}}`.
@@ -425,6 +437,9 @@ def solve_lattice_bse_at_specific_w(g_wk, gamma_wnn, nw_index):
     nw_index : int,
                The bosonic Matsubara frequency index :math:`i\omega_{n=\mathrm{nw\_index}}`
                at which the BSE is solved.
+    vertex_tol : float, optional
+                 If given, the vertex is compressed to a low rank factorization with this
+                 relative singular value tolerance, see ``CompressedVertexPH``.
 
     Returns
     -------
@@ -490,7 +505,10 @@ def solve_lattice_bse_at_specific_w(g_wk, gamma_wnn, nw_index):
     # -- Lattice BSE calc with built in trace
     mpi.report('--> chi_kw from BSE')
     #mpi.report('DEBUG BSE INACTIVE'*72)
-    chi_kw = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, gamma_wnn)
+    if vertex_tol is not None:
+        chi_kw = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, CompressedVertexPH(gamma_wnn, vertex_tol))
+    else:
+        chi_kw = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, gamma_wnn)
     #chi_kw = chi0_kw.copy()
 
     mpi.barrier()
@@ -515,7 +533,7 @@ def solve_lattice_bse_at_specific_w(g_wk, gamma_wnn, nw_index):
     return chi_k, chi0_k
  
 
-def solve_lattice_bse_depr(g_wk, gamma_wnn, tail_corr_nwf=-1):
+def solve_lattice_bse_depr(g_wk, gamma_wnn, tail_corr_nwf=-1, checkpoint=""):
 
     fmesh_huge, kmesh = g_wk.mesh.components
     bmesh = gamma_wnn.mesh.components[0]
@@ -540,12 +558,12 @@ def solve_lattice_bse_depr(g_wk, gamma_wnn, tail_corr_nwf=-1):
     # -- Lattice BSE calc with built in trace using g_wk
     from triqs_tprf.lattice import chiq_sum_nu_from_g_wk_and_gamma_PH
 
-    chi_kw = chiq_sum_nu_from_g_wk_and_gamma_PH(g_wk, gamma_wnn, tail_corr_nwf=tail_corr_nwf)
+    chi_kw = chiq_sum_nu_from_g_wk_and_gamma_PH(g_wk, gamma_wnn, tail_corr_nwf=tail_corr_nwf, checkpoint=checkpoint)
     
     return chi_kw
     
 
-def solve_lattice_bse_e_k_sigma_w(mu, e_k, sigma_w, gamma_wnn, tail_corr_nwf=-1):
+def solve_lattice_bse_e_k_sigma_w(mu, e_k, sigma_w, gamma_wnn, tail_corr_nwf=-1, checkpoint=""):
 
     kmesh = e_k.mesh
     fmesh_huge = sigma_w.mesh
@@ -571,7 +589,7 @@ def solve_lattice_bse_e_k_sigma_w(mu, e_k, sigma_w, gamma_wnn, tail_corr_nwf=-1)
     # -- Lattice BSE calc with built in trace using g_wk
     from triqs_tprf.lattice import chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH
 
-    chi_kw = chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH(mu, e_k, sigma_w, gamma_wnn, tail_corr_nwf=tail_corr_nwf)
+    chi_kw = chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH(mu, e_k, sigma_w, gamma_wnn, tail_corr_nwf=tail_corr_nwf, checkpoint=checkpoint)
     
     return chi_kw
     
@@ -33,6 +33,7 @@ from triqs.gf import Gf
 from triqs.gf.meshes import MeshDLRImFreq
 from .lattice import eliashberg_product
 from .lattice import eliashberg_product_fft, eliashberg_product_fft_constant
+from .lattice import EliashbergOperator, eliashberg_block_solver
 from .lattice import split_into_dynamic_wk_and_constant_k, dynamic_and_constant_to_tr
 from .lattice import construct_phi_wk
 
@@ -47,8 +48,9 @@ def solve_eliashberg(
     tol=1e-10,
     product="FFT",
     solver="IRAM",
-    symmetrize_fct=lambda x: x,
+    symmetrize_fct=None,
     k=6,
+    projection=None,
 ):
     r""" Solve the linearized Eliashberg equation
     
@@ -93,6 +95,10 @@ def solve_eliashberg(
 
                  'PM' : Use the Power Method implemented in :func:`power_method_LR`.
 
+                 'BLOCK' : Use the block Krylov solver :func:`triqs_tprf.lattice.eliashberg_block_solver`,
+                           which runs entirely in C++ and batches the products of a block of gaps.
+                           Only for the 'FFT' product without DLR mesh and without symmetrize_fct.
+
     symmetrize_fct : function, optional
                      A function that takes one parameter: A Green's function 
                      :math:`G(i\nu_n, \mathbf{k})`. The mesh attribute of the
@@ -105,7 +111,16 @@ def solve_eliashberg(
 
     k : int, optional
         The number of leading superconducting gaps that shall be calculated. Does
-        only have an effect, if 'IRAM' is used as a solver.
+        only have an effect, if 'IRAM' or 'BLOCK' is used as a solver.
+
+    projection : tuple of str, optional
+                 Pairing symmetry sector (spin, frequency, orbital), e.g.
+                 ('singlet', 'even', 'even'), see
+                 :meth:`triqs_tprf.lattice.EliashbergOperator.set_projection`.
+                 The eigenvalue solver then only runs on the positive Matsubara
+                 frequencies and the symmetric or antisymmetric orbital part of
+                 the gap of that sector.
+                 Only for the 'FFT' product without DLR mesh and without symmetrize_fct.
 
     Returns
     -------
@@ -132,23 +147,46 @@ def solve_eliashberg(
 
     hasDLRMesh = type(Gamma_pp_wk.mesh.components[0]) == MeshDLRImFreq
 
+    if projection is not None and (product != "FFT" or hasDLRMesh or symmetrize_fct is not None):
+        raise NotImplementedError(
+            "The projection on a pairing symmetry sector is only implemented for the "
+            "FFT product without DLR mesh and without symmetrize_fct."
+        )
+
     if product == "FFT":
 
         Gamma_pp_dyn_tr, Gamma_pp_const_r = preprocess_gamma_for_fft(
             Gamma_pp_wk, Gamma_pp_const_k
         )
 
-        if np.allclose(
-            Gamma_pp_dyn_tr.data, 0
-        ):  # -- If dynamic part is zero reduced calculation
-            eli_prod = functools.partial(
-                eliashberg_product_fft_constant, Gamma_pp_const_r, g_wk
-            )
+        # -- If dynamic part is zero reduced calculation
+        is_constant = np.allclose(Gamma_pp_dyn_tr.data, 0)
+
+        if hasDLRMesh:
+            if is_constant:
+                eli_prod = functools.partial(
+                    eliashberg_product_fft_constant, Gamma_pp_const_r, g_wk
+                )
+            else:
+                eli_prod = functools.partial(
+                    eliashberg_product_fft, Gamma_pp_dyn_tr, Gamma_pp_const_r, g_wk
+                )
 
         else:
-            eli_prod = functools.partial(
-                eliashberg_product_fft, Gamma_pp_dyn_tr, Gamma_pp_const_r, g_wk
-            )
+            # -- The operator sets up the G G kernel and all work arrays once per solve
+            if is_constant:
+                eli_op = EliashbergOperator(Gamma_pp_const_r, g_wk)
+            else:
+                eli_op = EliashbergOperator(Gamma_pp_dyn_tr, Gamma_pp_const_r, g_wk)
+
+            if projection is not None:
+                eli_op.set_projection(*projection)
+
+            delta_out_wk = g_wk.copy()
+
+            def eli_prod(delta_wk):
+                eli_op.apply(delta_wk, delta_out_wk)
+                return delta_out_wk
 
     elif product == "SUM":
         if(hasDLRMesh): 
@@ -168,12 +206,35 @@ def solve_eliashberg(
     def matvec(delta_x):
         delta_wk = from_x_to_wk(delta_x)
         delta_out_wk = eli_prod(delta_wk)
-        delta_out_wk = symmetrize_fct(delta_out_wk)
+        if symmetrize_fct is not None:
+            delta_out_wk = symmetrize_fct(delta_out_wk)
         delta_out_x = from_wk_to_x(delta_out_wk)
         return delta_out_x
 
+    # -- In a projected mode the eigenvalue solvers run on the reduced gaps of the operator
+    if projection is not None:
+        def from_x_to_wk(delta_x):
+            return eli_op.expand_gap(np.ascontiguousarray(delta_x, dtype=complex))
+
+        from_wk_to_x = eli_op.restrict_gap
+
+        def matvec(delta_x):
+            delta_out_x = np.empty((1, eli_op.size), dtype=complex)
+            eli_op.apply(delta_x.reshape(1, -1).astype(complex), delta_out_x)
+            return delta_out_x.reshape(-1)
+
     if not initial_delta:
         initial_delta = semi_random_initial_delta(g_wk)
+
+    if solver == "BLOCK":
+        if product != "FFT" or hasDLRMesh or symmetrize_fct is not None:
+            raise NotImplementedError(
+                "The solver BLOCK is only implemented for the FFT product without "
+                "DLR mesh and without symmetrize_fct."
+            )
+        es, eigen_modes = eliashberg_block_solver(eli_op, initial_delta, n_ev=k, tol=tol)
+        return list(es.real), list(eigen_modes)
+
     initial_delta = from_wk_to_x(initial_delta)
 
     if solver == "PM":
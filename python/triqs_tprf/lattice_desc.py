@@ -14,7 +14,9 @@ module.add_include("triqs_tprf/lattice.hpp")
 # Add here anything to add in the C++ code at the start, e.g. namespace using
 module.add_preamble("""
 #include <cpp2py/converters/complex.hpp>
+#include <cpp2py/converters/string.hpp>
 #include <cpp2py/converters/tuple.hpp>
+#include <cpp2py/converters/vector.hpp>
 #include <nda_py/cpp2py_converters.hpp>
 #include <triqs/cpp2py_converters/gf.hpp>
 #include <triqs/cpp2py_converters/mesh.hpp>
@@ -338,6 +340,91 @@ out
 
 module.add_function ("triqs_tprf::g_Dwr_t triqs_tprf::fourier_tr_to_wr (triqs_tprf::g_Dtr_cvt g_tr, int nw = -1)")
 
+module.add_function ("triqs_tprf::g_tr_t triqs_tprf::fourier_wk_to_tr (triqs_tprf::g_wk_cvt g_wk, int nt = -1)", doc = r"""Fused fast fourier transform of Green's function from k-space and Matsubara frequency to real space and imaginary time
+
+    Computes: :math:`G_{a\bar{b}}(\tau, \mathbf{r}) = \mathcal{F} \left\{ G_{a\bar{b}}(i\omega_n, \mathbf{k}) \right\}`
+
+    Equivalent to fourier_wr_to_tr(fourier_wk_to_wr(g_wk), nt), but the target components
+    are transformed in blocks and the :math:`(i\omega_n, \mathbf{r})` intermediate is only
+    allocated for one block at a time.
+
+Parameters
+----------
+g_wk
+     k-space imaginary frequency Green's function :math:`G_{a\bar{b}}(i\omega_n, \mathbf{k})`
+
+nt
+     number of imaginary time points, -1 for the default of the adjoint mesh
+
+Returns
+-------
+out
+     real-space imaginary time Green's function :math:`G_{a\bar{b}}(\tau, \mathbf{r})`""")
+
+module.add_function ("triqs_tprf::g_Dtr_t triqs_tprf::fourier_wk_to_tr (triqs_tprf::g_Dwk_cvt g_wk, int nt = -1)")
+
+module.add_function ("triqs_tprf::g_wk_t triqs_tprf::fourier_tr_to_wk (triqs_tprf::g_tr_cvt g_tr, int nw = -1)", doc = r"""Fused fast fourier transform of Green's function from real space and imaginary time to k-space and Matsubara frequency
+
+    Computes: :math:`G_{a\bar{b}}(i\omega_n, \mathbf{k}) = \mathcal{F} \left\{ G_{a\bar{b}}(\tau, \mathbf{r}) \right\}`
+
+    The reverse of fourier_wk_to_tr, with the same blocking of the target components.
+
+Parameters
+----------
+g_tr
+     real-space imaginary time Green's function :math:`G_{a\bar{b}}(\tau, \mathbf{r})`
+
+nw
+     number of Matsubara frequencies, -1 for the default of the adjoint mesh
+
+Returns
+-------
+out
+     k-space imaginary frequency Green's function :math:`G_{a\bar{b}}(i\omega_n, \mathbf{k})`""")
+
+module.add_function ("triqs_tprf::g_Dwk_t triqs_tprf::fourier_tr_to_wk (triqs_tprf::g_Dtr_cvt g_tr, int nw = -1)")
+
+module.add_function ("triqs_tprf::e_r_t triqs_tprf::fourier_k_to_r (triqs_tprf::e_k_cvt X_k, bool real_r = false)", doc = r"""Fast fourier transform of a static lattice quantity from k-space to real space
+
+Computes: :math:`X(\mathbf{r}) = \mathcal{F}^{-1} \left\{ X(\mathbf{k}) \right\}`
+
+When the result is known to be real in real space, i.e. :math:`X(-\mathbf{k}) = X^*(\mathbf{k})`
+element-wise, the transform can be done with real-to-complex FFTs on half of the k-mesh.
+
+Parameters
+----------
+X_k
+     k-space quantity :math:`X(\mathbf{k})`
+
+real_r
+     use the real-to-complex transform, only valid for data that is real in real space
+
+Returns
+-------
+out
+     real-space quantity :math:`X(\mathbf{r})`""")
+
+module.add_function ("triqs_tprf::chi_r_t triqs_tprf::fourier_k_to_r (triqs_tprf::chi_k_cvt X_k, bool real_r = false)")
+
+module.add_function ("triqs_tprf::e_k_t triqs_tprf::fourier_r_to_k (triqs_tprf::e_r_cvt X_r, bool real_r = false)", doc = r"""Fast fourier transform of a static lattice quantity from real space to k-space
+
+Computes: :math:`X(\mathbf{k}) = \mathcal{F} \left\{ X(\mathbf{r}) \right\}`
+
+Parameters
+----------
+X_r
+     real-space quantity :math:`X(\mathbf{r})`
+
+real_r
+     use the real-to-complex transform, the imaginary part of the input is discarded
+
+Returns
+-------
+out
+     k-space quantity :math:`X(\mathbf{k})`""")
+
+module.add_function ("triqs_tprf::chi_k_t triqs_tprf::fourier_r_to_k (triqs_tprf::chi_r_cvt X_r, bool real_r = false)")
+
 module.add_function ("triqs_tprf::g_fr_t triqs_tprf::fourier_fk_to_fr (triqs_tprf::g_fk_cvt g_fk)", doc = r"""Inverse fast fourier transform of real frequency Green's function from k-space to real space
 
     Computes: :math:`G_{a\bar{b}}(\omega, \mathbf{r}) = \mathcal{F}^{-1} \left\{G_{a\bar{b}}(\omega, \mathbf{k})\right\}`
@@ -1244,6 +1331,188 @@ module.add_function ("triqs_tprf::g_wk_t triqs_tprf::eliashberg_g_delta_g_produc
 
 module.add_function ("triqs_tprf::g_Dwk_t triqs_tprf::eliashberg_g_delta_g_product (triqs_tprf::g_Dwk_vt g_wk, triqs_tprf::g_Dwk_vt delta_wk)", doc = r"""""")
 
+module.add_function ("triqs_tprf::chi_wk_t triqs_tprf::eliashberg_gg_kernel (triqs_tprf::g_wk_vt g_wk)", doc = r"""Pair propagator kernel of the linearized Eliashberg product
+
+The product of the two Green's functions entering the anomalous Green's function
+
+.. math::
+    K_{dc,ef}(i\nu_n,\mathbf{k})
+    =
+    G_{cf}(i\nu_n,\mathbf{k})
+    G^*_{ed}(i\nu_n,-\mathbf{k})\,,
+
+so that :math:`F_{dc} = K_{dc,ef}\Delta_{ef}`. It only depends on the Green's function
+and can be computed once per Eliashberg solve, instead of at every product.
+
+Parameters
+----------
+g_wk
+     one-particle Green's function :math:`G_{a\bar{b}}(i\nu_n,\mathbf{k})`
+
+Returns
+-------
+out
+     The kernel :math:`K_{dc,ef}(i\nu_n,\mathbf{k})` on the mesh of the Green's function""")
+
+module.add_function ("triqs_tprf::g_wk_t triqs_tprf::eliashberg_g_delta_g_product (triqs_tprf::chi_wk_vt gg_wk, triqs_tprf::g_wk_vt delta_wk)", doc = r"""""")
+
+module.add_function ("triqs_tprf::g_wk_t triqs_tprf::eliashberg_product_fft (triqs_tprf::chi_tr_vt Gamma_pp_dyn_tr, triqs_tprf::chi_r_vt Gamma_pp_const_r, triqs_tprf::chi_wk_vt gg_wk, triqs_tprf::g_wk_vt delta_wk)", doc = r"""""")
+
+module.add_function ("triqs_tprf::g_wk_t triqs_tprf::eliashberg_product_fft_constant (triqs_tprf::chi_r_vt Gamma_pp_const_r, triqs_tprf::chi_wk_vt gg_wk, triqs_tprf::g_wk_vt delta_wk)", doc = r"""""")
+
+# The class eliashberg_operator
+c = class_(
+        py_type = "EliashbergOperator",  # name of the python class
+        c_type = "triqs_tprf::eliashberg_operator",   # name of the C++ class
+        doc = r"""Linearized Eliashberg product as a reusable operator
+
+Same product as eliashberg_product_fft (or eliashberg_product_fft_constant), for repeated
+application by an eigenvalue solver. The pair kernel :math:`G G`, the rearranged vertex and
+all work arrays are set up once, so that an application of the operator only runs the
+Fourier transforms and the products, without allocating the intermediate Green's functions.
+The high frequency moments of the Matsubara transforms are fitted with fits set up once,
+into per thread buffers.
+
+The gap lives on the mesh of the Green's function. The operator can also be applied to
+a block of gaps at once, in which case all Fourier transforms of the block are batched.
+
+With set_projection the operator is restricted to one pairing symmetry sector, see there.""",   # doc of the C++ class
+        hdf5 = False,
+)
+
+c.add_constructor("""(triqs_tprf::chi_tr_vt Gamma_pp_dyn_tr, triqs_tprf::chi_r_vt Gamma_pp_const_r, triqs_tprf::g_wk_vt g_wk)""", doc = r"""
+
+Parameters
+----------
+Gamma_pp_dyn_tr
+     dynamic part of the particle-particle vertex :math:`\Gamma^{\mathrm{s/t}, \mathrm{dynamic}}_{c\bar{a}d\bar{b}}(\tau, \mathbf{r})`
+
+Gamma_pp_const_r
+     static part of the particle-particle vertex :math:`\Gamma^{\mathrm{s/t}, \mathrm{static}}_{c\bar{a}d\bar{b}}(\mathbf{r})`
+
+g_wk
+     one-particle Green's function :math:`G_{a\bar{b}}(i\nu_n,\mathbf{k})`""")
+
+c.add_constructor("""(triqs_tprf::chi_r_vt Gamma_pp_const_r, triqs_tprf::g_wk_vt g_wk)""", doc = r"""Operator for a vertex without dynamic part, as eliashberg_product_fft_constant""")
+
+c.add_method("""void apply (triqs_tprf::g_wk_vt delta_in, triqs_tprf::g_wk_vt delta_out)""", doc = r"""Apply the operator, :math:`\Delta^{\mathrm{out}} = \Lambda \Delta^{\mathrm{in}}`
+
+In a projected mode the input gap is projected on the symmetry sector first.
+
+Parameters
+----------
+delta_in
+     superconducting gap :math:`\Delta^{\mathrm{s/t}, \mathrm{in}}_{\bar{a}\bar{b}}(i\nu_n,\mathbf{k})`
+
+delta_out
+     result of the product, on the same mesh""")
+
+c.add_method("""void apply (nda::array_const_view<std::complex<double>, 2> x, nda::array_view<std::complex<double>, 2> y)""", doc = r"""Apply the operator to a block of flattened gaps
+
+Parameters
+----------
+x
+     (n_vec, size()) array of gaps, each row is a gap with the data layout of :math:`\Delta(i\nu_n,\mathbf{k})_{\bar{a}\bar{b}}`,
+     or a reduced gap in a projected mode
+
+y
+     (n_vec, size()) array of the results""")
+
+c.add_method("""void set_projection (std::string spin, std::string frequency, std::string orbital)""", doc = r"""Restrict the operator to a pairing symmetry sector
+
+The sector is given by the parities of the gap under :math:`i\nu_n \rightarrow -i\nu_n`
+and :math:`\bar{a} \leftrightarrow \bar{b}`, for a spin singlet or triplet gap. The parity under
+:math:`\mathbf{k} \rightarrow -\mathbf{k}` follows from the Pauli principle, it is even for
+singlet gaps with the same frequency and orbital parity and for triplet gaps with opposite ones.
+
+In the projected mode a gap is stored in reduced form, with the positive Matsubara frequencies
+and the orbital pairs :math:`\bar{a} \le \bar{b}` (even) or :math:`\bar{a} < \bar{b}` (odd) only,
+see restrict_gap and expand_gap. The block apply works on reduced gaps, which are expanded on
+the fly for the product with :math:`GG`. The vertex products, the :math:`\tau \rightarrow i\nu_n`
+and :math:`\mathbf{r} \rightarrow \mathbf{k}` transforms of the result and its work array only
+run on the stored orbital pairs, and the result is only evaluated at the stored frequencies.
+:math:`F = GG\Delta` and its transforms are computed at all frequencies and orbital pairs, as
+without projection, so an apply costs less only by the result side. The eigenvalue solvers
+further gain from the smaller dimension of the reduced gap.
+
+This assumes that the operator commutes with the projection on the sector. The Pauli principle
+only guarantees this for the combination of the three parities, the separate frequency and
+orbital parities are conserved e.g. for a single orbital or for degenerate orbitals without
+hybridization. It is checked once, here, by applying the full operator to a pseudo random gap
+of the sector: if the result has a relative norm above 1e-5 outside of the sector the
+operator is left without projection and an exception is thrown. This is a collective MPI call.
+
+Parameters
+----------
+spin
+     "singlet" or "triplet"
+
+frequency
+     "even" or "odd"
+
+orbital
+     "even" or "odd", parity under the exchange of the orbitals""")
+
+c.add_method("""void clear_projection ()""", doc = r"""Back to the full space of gaps""")
+
+c.add_method("""nda::array<std::complex<double>, 1> restrict_gap (triqs_tprf::g_wk_vt delta)""", doc = r"""Project a gap on the symmetry sector and return it in the reduced form of the block apply""")
+
+c.add_method("""triqs_tprf::g_wk_t expand_gap (nda::array_const_view<std::complex<double>, 1> x)""", doc = r"""Gap on the mesh of the Green's function from its reduced form""")
+
+c.add_property(name = "size",
+               getter = cfunction("long size ()"),
+               doc = r"""Dimension of the flattened gap, the dimension of the reduced gap in a projected mode""")
+
+c.add_property(name = "is_projected",
+               getter = cfunction("bool is_projected ()"),
+               doc = r"""Whether the operator is restricted to a pairing symmetry sector""")
+
+module.add_class(c)
+
+module.add_function ("std::tuple<nda::array<std::complex<double>, 1>, std::vector<triqs_tprf::g_wk_t>> triqs_tprf::eliashberg_block_solver (triqs_tprf::eliashberg_operator & op, triqs_tprf::g_wk_vt initial_delta, int n_ev = 6, int block_size = -1, double tol = 1e-10, int max_iter = 1000)", doc = r"""Leading eigenpairs of the linearized Eliashberg operator with a block Krylov method
+
+Thick restarted block Krylov (block Arnoldi) iteration for the eigenvalues with the
+largest real part. Every iteration applies the operator to a whole block of trial gaps,
+so that their Fourier transforms are batched, and extends the search space with the
+residuals of the unconverged Ritz pairs. When the search space is full it is
+restarted with the n_ev + block_size leading Ritz vectors.
+
+The operator application is distributed over the MPI ranks, and so are the vectors of
+the search space, in slices of the gap dimension. The inner products and the projected
+matrix are reduced over the ranks, only the small Rayleigh-Ritz eigenvalue problem is
+replicated. The convergence decision is taken from rank 0, so all ranks follow the
+same iteration.
+
+If the operator is restricted to a pairing symmetry sector, see eliashberg_operator::set_projection,
+the iteration runs on the reduced gaps and only finds the eigenpairs of that sector.
+
+Parameters
+----------
+op
+     Eliashberg operator
+
+initial_delta
+     initial gap, the other vectors of the first block are random
+
+n_ev
+     number of leading eigenpairs
+
+block_size
+     number of vectors per block, n_ev if not positive
+
+tol
+     convergence criterion on the residual norm relative to the eigenvalue
+
+max_iter
+     maximal number of block iterations
+
+Returns
+-------
+out
+     The n_ev eigenvalues ordered by decreasing real part and the corresponding normalized gaps.
+     Throws if they have not converged within max_iter iterations, or if the search space can
+     no longer be extended before they have.""")
+
 module.add_function ("std::tuple<chi_tr_t, chi_r_t> triqs_tprf::dynamic_and_constant_to_tr (triqs_tprf::chi_wk_vt Gamma_pp_dyn_wk, triqs_tprf::chi_k_vt Gamma_pp_const_k)", doc = r"""Fourier transform Gamma parts to imaginary time and real-space
 
 Parameters
@@ -1312,7 +1581,30 @@ Returns
 out
      The reducible ladder vertex in the density/magnetic channel :math:`\Phi^{\mathrm{d/m}}(i\omega_n,\mathbf{q})`""")
 
-module.add_function ("array<std::complex<double>, 6> triqs_tprf::cluster_mesh_fourier_interpolation (array<double, 2> k_vecs, triqs_tprf::chi_wr_cvt chi)", doc = r"""""")
+module.add_function ("array<std::complex<double>, 6> triqs_tprf::cluster_mesh_fourier_interpolation (array<double, 2> k_vecs, triqs_tprf::chi_wr_cvt chi, long k_chunk = 1024)", doc = r"""Fourier interpolation of a real space two-particle response function to arbitrary k-points
+
+.. math::
+    \chi_{abcd}(i\omega_n, \mathbf{k}) = \sum_{\mathbf{r}} e^{-i \mathbf{k} \cdot \mathbf{r}} \chi_{abcd}(i\omega_n, \mathbf{r})
+
+evaluated as a matrix product of the (nk, nr) phase factors with :math:`\chi` reshaped to (nr, nw nb^4).
+The k-points are processed in chunks of k_chunk points, bounding the memory of the phase factors.
+For paths too large to hold the result, call the function on consecutive slices of k_vecs.
+
+Parameters
+----------
+k_vecs
+     k-points, shape (nk, 3)
+
+chi
+     two-particle response function :math:`\chi_{abcd}(i\omega_n, \mathbf{r})`
+
+k_chunk
+     number of k-points per matrix product
+
+Returns
+-------
+out
+     :math:`\chi_{abcd}(i\omega_n, \mathbf{k})` with shape (nw, nk, nb, nb, nb, nb)""")
 
 module.add_function ("triqs_tprf::chi_tr_t triqs_tprf::chi0_tr_from_grt_PH (triqs_tprf::g_tr_cvt g_tr)", doc = r"""Generalized susceptibility imaginary time bubble in the particle-hole channel :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})`
 
@@ -1494,6 +1786,46 @@ out
      in Matsubara frequency and real space.""")
 
 module.add_function ("triqs_tprf::chi_Dwr_t triqs_tprf::chi_wr_from_chi_wk (triqs_tprf::chi_Dwk_cvt chi_wk)")
+
+module.add_function ("triqs_tprf::chi_tr_t triqs_tprf::chi_tr_from_chi_wk (triqs_tprf::chi_wk_cvt chi_wk, int ntau = -1)", doc = r"""Fused Fourier transform from :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})` to :math:`\chi_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})`
+
+     Equivalent to chi_tr_from_chi_wr(chi_wr_from_chi_wk(chi_wk), ntau), but the
+     target components are transformed in blocks, so that the
+     :math:`(\omega, \mathbf{r})` intermediate is never allocated in full.
+
+Parameters
+----------
+chi_wk
+     Generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`
+     in Matsubara frequency and momentum space.
+
+ntau
+     Number of imaginary time points, -1 for the default of the adjoint mesh.
+
+Returns
+-------
+out
+     Generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})`
+     in imaginary time and real space.""")
+
+module.add_function ("triqs_tprf::chi_wk_t triqs_tprf::chi_wk_from_chi_tr (triqs_tprf::chi_tr_cvt chi_tr, int nw = -1)", doc = r"""Fused Fourier transform from :math:`\chi_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})` to :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`
+
+     The reverse of chi_tr_from_chi_wk.
+
+Parameters
+----------
+chi_tr
+     Generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\tau, \mathbf{r})`
+     in imaginary time and real space.
+
+nw
+     Number of Matsubara frequencies, -1 for the default of the adjoint mesh.
+
+Returns
+-------
+out
+     Generalized susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`
+     in Matsubara frequency and momentum space.""")
                      
 module.add_function ("chi_t_t::target_t::value_t triqs_tprf::chi_trapz_tau (triqs_tprf::chi_t_cvt chi_t)", doc = r"""""")
 
@@ -1688,6 +2020,44 @@ Returns
 out
      Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \nu, \nu', \mathbf{k})`.""")
 
+# The class compressed_vertex_PH
+c = class_(
+        py_type = "CompressedVertexPH",  # name of the python class
+        c_type = "triqs_tprf::compressed_vertex_PH",   # name of the C++ class
+        doc = r"""Low rank particle-hole vertex for the lattice Bethe-Salpeter equation
+
+At every bosonic frequency the PH grouped vertex is factorized with a singular value
+decomposition, truncated to the singular values above tol times the largest one,
+:math:`\Gamma(\omega) \approx P(\omega) Q^\dagger(\omega)`.
+
+The lattice BSE kernel :math:`1 - \chi^{(0)} \Gamma` is then a rank r update of the identity,
+inverted with the Woodbury identity, so that only an r x r matrix is factorized per (w, k) point.
+The factorization is k independent and is computed once.""",   # doc of the C++ class
+        hdf5 = False,
+)
+
+c.add_constructor("""(triqs_tprf::chi_wnn_cvt gamma_ph_wnn, double tol = 1e-8)""", doc = r"""
+
+Parameters
+----------
+gamma_ph_wnn
+     Local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`
+
+tol
+     Relative truncation tolerance of the singular values""")
+
+c.add_method("""long rank (long w)""", doc = r"""Rank of the truncated factorization at bosonic frequency index w""")
+
+c.add_property(name = "tol",
+               getter = cfunction("double tol ()"),
+               doc = r"""Relative truncation tolerance of the singular values""")
+
+c.add_property(name = "n_bands",
+               getter = cfunction("long n_bands ()"),
+               doc = r"""Number of orbitals of the vertex""")
+
+module.add_class(c)
+
 module.add_function ("triqs_tprf::chi_kw_t triqs_tprf::chiq_sum_nu_from_chi0q_and_gamma_PH (triqs_tprf::chi_wnk_cvt chi0_wnk, triqs_tprf::chi_wnn_cvt gamma_ph_wnn)", doc = r"""Lattice Bethe-Salpeter equation solver for the generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
 
   Computes
@@ -1709,6 +2079,48 @@ Returns
 out
      Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.""")
 
+module.add_function ("triqs_tprf::chi_kw_t triqs_tprf::chiq_sum_nu_from_chi0q_and_gamma_PH (triqs_tprf::chi_wnk_cvt chi0_wnk, triqs_tprf::chi_wnn_cvt gamma_ph_wnn, std::vector<nda::matrix<long>> rotations, std::vector<nda::matrix<std::complex<double>>> orbital_reps)", doc = r"""Lattice Bethe-Salpeter equation solver using the point group symmetry
+
+  Builds the irreducible Brillouin zone map of the k-mesh, solves the lattice Bethe-Salpeter
+  equation at the irreducible k-points only and returns the unfolded full zone result.
+
+Parameters
+----------
+chi0_wnk
+     Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`.
+
+gamma_ph_wnn
+     Local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+
+rotations
+     Point group rotations in reduced reciprocal coordinates, 3x3 integer matrices.
+
+orbital_reps
+     Orbital representations of the rotations, unitary matrices.
+
+Returns
+-------
+out
+     Lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.""")
+
+module.add_function ("triqs_tprf::chi_kw_t triqs_tprf::chiq_sum_nu_from_chi0q_and_gamma_PH (triqs_tprf::chi_wnk_cvt chi0_wnk, triqs_tprf::compressed_vertex_PH const & gamma)", doc = r"""Lattice Bethe-Salpeter equation solver with a low rank vertex
+
+  The per k-point solve is a rank r Woodbury update, where r is the rank of the
+  truncated singular value decomposition of the vertex, see ``CompressedVertexPH``.
+
+Parameters
+----------
+chi0_wnk
+     Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`.
+
+gamma
+     Compressed local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+
+Returns
+-------
+out
+     Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.""")
+
 module.add_function ("triqs_tprf::chi_kw_t triqs_tprf::chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH (triqs_tprf::chi_wnk_cvt chi0_wnk, triqs_tprf::chi_wnn_cvt gamma_ph_wnn, triqs_tprf::chi_nn_cvt L_wn)", doc = r"""Dual lattice Bethe-Salpeter equation solver for the generalized susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.
 
   Computes
@@ -1733,9 +2145,27 @@ Returns
 out
      Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.""")
 
-module.add_function ("gf<prod<triqs::mesh::brzone, triqs::mesh::imfreq>, tensor_valued<4>> triqs_tprf::chiq_sum_nu_from_g_wk_and_gamma_PH (triqs_tprf::gk_iw_t g_wk, triqs_tprf::g2_iw_vt gamma_ph_wnn, int tail_corr_nwf = -1)", doc = r"""""")
+module.add_function ("triqs_tprf::chi_kw_t triqs_tprf::chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH (triqs_tprf::chi_wnk_cvt chi0_wnk, triqs_tprf::compressed_vertex_PH const & gamma, triqs_tprf::chi_nn_cvt L_wn)", doc = r"""Dual lattice Bethe-Salpeter equation solver with a low rank vertex, see ``CompressedVertexPH``.
 
-module.add_function ("gf<prod<triqs::mesh::brzone, triqs::mesh::imfreq>, tensor_valued<4>> triqs_tprf::chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH (double mu, triqs_tprf::ek_vt e_k, triqs_tprf::g_iw_vt sigma_w, triqs_tprf::g2_iw_vt gamma_ph_wnn, int tail_corr_nwf = -1)", doc = r"""""")
+Parameters
+----------
+chi0_wnk
+     Generalized lattice bubble susceptibility :math:`\chi^{(0)}_{\bar{a}b\bar{c}d}(\omega, \nu, \mathbf{k})`.
+
+gamma
+     Compressed local particle-hole vertex function :math:`\Gamma^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu, \nu')`.
+
+L_wn
+     Local triangular particle-hole vertex function :math:`L^{(PH)}_{\bar{a}b\bar{c}d}(\omega, \nu)`.
+
+Returns
+-------
+out
+     Generalized lattice susceptibility :math:`\chi_{\bar{a}b\bar{c}d}(\omega, \mathbf{k})`.""")
+
+module.add_function ("gf<prod<triqs::mesh::brzone, triqs::mesh::imfreq>, tensor_valued<4>> triqs_tprf::chiq_sum_nu_from_g_wk_and_gamma_PH (triqs_tprf::gk_iw_t g_wk, triqs_tprf::g2_iw_vt gamma_ph_wnn, int tail_corr_nwf = -1, std::string checkpoint = \"\")", doc = r"""""")
+
+module.add_function ("gf<prod<triqs::mesh::brzone, triqs::mesh::imfreq>, tensor_valued<4>> triqs_tprf::chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH (double mu, triqs_tprf::ek_vt e_k, triqs_tprf::g_iw_vt sigma_w, triqs_tprf::g2_iw_vt gamma_ph_wnn, int tail_corr_nwf = -1, std::string checkpoint = \"\")", doc = r"""""")
 
 module.add_function ("gf<prod<triqs::mesh::brzone, triqs::mesh::imfreq>, tensor_valued<4>> triqs_tprf::chiq_sum_nu (triqs_tprf::chiq_t chiq)", doc = r"""""")
 
@@ -1771,4 +2201,90 @@ module.add_function ("triqs_tprf::g_Dw_t inv(triqs_tprf::g_Dw_t g_w, int num_cor
 
 module.add_function ("triqs_tprf::b_g_Dt_t iw_to_tau_p2(triqs_tprf::b_g_Dw_cvt g_w, int num_cores);", doc = r"""""")
 
+module.add_function ("void triqs_tprf::fourier_set_plan_effort (std::string effort)", doc = r"""Set the FFTW planner effort used for new Fourier transform plans
+
+All FFTW plans are cached for the lifetime of the process, so the planning cost
+is only paid once per transform geometry. Higher effort gives faster transforms
+at the price of a longer first call, and is best combined with wisdom files.
+
+Parameters
+----------
+effort
+     planner effort, one of 'estimate' (default), 'measure' or 'patient'""")
+
+module.add_function ("void triqs_tprf::fourier_clear_plan_cache ()", doc = r"""Destroy all cached FFTW plans
+
+Must not be called while a Fourier transform is running.""")
+
+module.add_function ("long triqs_tprf::fourier_plan_cache_size ()", doc = r"""Number of FFTW plans in the process wide plan cache
+
+Returns
+-------
+out
+     number of cached plans""")
+
+module.add_function ("bool triqs_tprf::fourier_import_wisdom (std::string filename)", doc = r"""Load FFTW wisdom from file
+
+Parameters
+----------
+filename
+     path of a wisdom file written by fourier_export_wisdom
+
+Returns
+-------
+out
+     true if the wisdom was read successfully""")
+
+module.add_function ("bool triqs_tprf::fourier_export_wisdom (std::string filename)", doc = r"""Save the accumulated FFTW wisdom to file (written by MPI rank 0 only)
+
+Parameters
+----------
+filename
+     path of the wisdom file
+
+Returns
+-------
+out
+     true if the wisdom was written successfully""")
+
+module.add_function ("void triqs_tprf::set_rpa_solve_precision (std::string precision)", doc = r"""Set the precision of the factorizations in the batched RPA solves
+
+Used by solve_rpa_PH and dynamical_screened_interaction_W. In 'mixed' precision
+the matrices are LU factorized in single precision and the solution is brought
+to double precision accuracy by iterative refinement with double precision
+residuals. Points where the refinement stagnates, close to an RPA instability,
+are solved again with a double precision factorization.
+
+Parameters
+----------
+precision
+     'double' (default) or 'mixed'""")
+
+module.add_function ("std::string triqs_tprf::get_rpa_solve_precision ()", doc = r"""Precision of the factorizations in the batched RPA solves, 'double' or 'mixed'""")
+
+module.add_function ("void triqs_tprf::set_bse_solver (std::string solver, double tol = 1e-10, int restart = 60, int max_iter = 2000)", doc = r"""Set the solver of the lattice Bethe-Salpeter equation
+
+Used by chiq_sum_nu_from_chi0q_and_gamma_PH. With 'dense' the kernel
+:math:`1 - \chi^{(0)} \Gamma` is built and LU factorized at every (w, k) point.
+With 'gmres' the equation is solved iteratively with matrix free products,
+preconditioned by the frequency diagonal part of the kernel and started from
+the solution at the previous k-point. Points where GMRES does not converge
+are solved with the dense solver.
+
+Parameters
+----------
+solver
+     'dense' (default) or 'gmres'
+
+tol
+     relative residual tolerance of the iterative solver
+
+restart
+     Krylov subspace dimension before restart
+
+max_iter
+     maximal number of iterations per right hand side""")
+
+module.add_function ("std::string triqs_tprf::get_bse_solver ()", doc = r"""Solver of the lattice Bethe-Salpeter equation, 'dense' or 'gmres'""")
+
 module.generate_code()
@@ -87,6 +87,21 @@ Returns
 out
      :math:`[g]^{-1}` in the given channel""")
 
+module.add_function ("triqs_tprf::g2_iw_t triqs_tprf::inverse_PH_mpi (triqs_tprf::g2_iw_vt g)", doc = r"""Two-particle response-function inversion :math:`[g]^{-1}` in the particle-hole channel (PH), distributed over the MPI ranks.
+
+ Same as inverse_PH, with the bosonic frequencies split over the MPI ranks and the
+ result reduced over all ranks. This is a collective call on all ranks.""")
+
+module.add_function ("triqs_tprf::g2_iw_t triqs_tprf::inverse_PP_mpi (triqs_tprf::g2_iw_vt g)", doc = r"""Two-particle response-function inversion :math:`[g]^{-1}` in the particle-particle channel (PP), distributed over the MPI ranks.
+
+ Same as inverse_PP, with the bosonic frequencies split over the MPI ranks and the
+ result reduced over all ranks. This is a collective call on all ranks.""")
+
+module.add_function ("triqs_tprf::g2_iw_t triqs_tprf::inverse_PH_bar_mpi (triqs_tprf::g2_iw_vt g)", doc = r"""Two-particle response-function inversion :math:`[g]^{-1}` in the particle-hole-bar channel (PH-bar), distributed over the MPI ranks.
+
+ Same as inverse_PH_bar, with the bosonic frequencies split over the MPI ranks and the
+ result reduced over all ranks. This is a collective call on all ranks.""")
+
 module.add_function ("triqs_tprf::g2_nn_t triqs_tprf::inverse_PH (triqs_tprf::g2_nn_vt g)", doc = r"""""")
 
 module.add_function ("triqs_tprf::g2_nn_t triqs_tprf::inverse_PP (triqs_tprf::g2_nn_vt g)", doc = r"""""")
@@ -180,6 +195,21 @@ Returns
 out
      :math:`(A * B)` in the given channel""")
 
+module.add_function ("triqs_tprf::g2_iw_t triqs_tprf::product_PH_mpi (triqs_tprf::g2_iw_vt A, triqs_tprf::g2_iw_vt B)", doc = r"""Two-particle response-function product :math:`A * B` in the particle-hole channel (PH), distributed over the MPI ranks.
+
+ Same as product_PH, with the bosonic frequencies split over the MPI ranks and the
+ result reduced over all ranks. This is a collective call on all ranks.""")
+
+module.add_function ("triqs_tprf::g2_iw_t triqs_tprf::product_PP_mpi (triqs_tprf::g2_iw_vt A, triqs_tprf::g2_iw_vt B)", doc = r"""Two-particle response-function product :math:`A * B` in the particle-particle channel (PP), distributed over the MPI ranks.
+
+ Same as product_PP, with the bosonic frequencies split over the MPI ranks and the
+ result reduced over all ranks. This is a collective call on all ranks.""")
+
+module.add_function ("triqs_tprf::g2_iw_t triqs_tprf::product_PH_bar_mpi (triqs_tprf::g2_iw_vt A, triqs_tprf::g2_iw_vt B)", doc = r"""Two-particle response-function product :math:`A * B` in the particle-hole-bar channel (PH-bar), distributed over the MPI ranks.
+
+ Same as product_PH_bar, with the bosonic frequencies split over the MPI ranks and the
+ result reduced over all ranks. This is a collective call on all ranks.""")
+
 module.add_function ("triqs_tprf::g2_nn_t triqs_tprf::product_PH (triqs_tprf::g2_nn_vt A, triqs_tprf::g2_nn_vt B)", doc = r"""""")
 
 module.add_function ("triqs_tprf::g2_nn_t triqs_tprf::product_PP (triqs_tprf::g2_nn_vt A, triqs_tprf::g2_nn_vt B)", doc = r"""""")
@@ -0,0 +1,94 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+#include <triqs_tprf/lattice/mesh_index_tables.hpp>
+
+using namespace triqs_tprf;
+
+// ------------------------------------------------------------
+
+TEST(band_structure, eigenelements_and_k_plus_q) {
+
+  auto _  = all_t{};
+  int nk  = 6;
+  auto bz = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+
+  auto e_k = e_k_t{{bz, nk}, {2, 2}};
+  for (auto k : e_k.mesh()) {
+    double kx = k(0), ky = k(1);
+    e_k[k](0, 0) = -2. * cos(kx);
+    e_k[k](1, 1) = -2. * cos(ky);
+    e_k[k](0, 1) = 0.3 * sin(kx);
+    e_k[k](1, 0) = 0.3 * sin(kx);
+  }
+
+  double mu = 0.2, beta = 5.0;
+  band_structure bands(e_k, mu, beta);
+
+  EXPECT_EQ(bands.n_bands(), 2);
+
+  for (auto k : e_k.mesh()) {
+    long kidx = k.data_index();
+    auto const &U = bands.U(kidx);
+
+    matrix<std::complex<double>> eps_diag(2, 2);
+    eps_diag = 0.;
+    for (int n = 0; n < 2; n++) {
+      eps_diag(n, n) = bands.eps(kidx)(n);
+      EXPECT_NEAR(bands.occ(kidx)(n), 1. / (std::exp(beta * bands.eps(kidx)(n)) + 1.), 1e-12);
+    }
+
+    matrix<std::complex<double>> e_ref = e_k[k] - mu;
+    EXPECT_ARRAY_NEAR(U * eps_diag * dagger(U), e_ref, 1e-12);
+
+    auto kq_table = x_plus_q_index_table(bands.mesh(), kidx);
+    for (auto q : e_k.mesh()) EXPECT_ARRAY_NEAR(e_k.data()(kq_table[q.data_index()], _, _), e_k(k + q), 1e-12);
+  }
+}
+
+// ------------------------------------------------------------
+
+TEST(band_structure, g0w_sigma_kpoint) {
+
+  int nk  = 4;
+  auto bz = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+
+  auto e_k = e_k_t{{bz, nk}, {2, 2}};
+  auto v_k = chi_k_t{{bz, nk}, {2, 2, 2, 2}};
+  v_k()    = 0.;
+  for (auto k : e_k.mesh()) {
+    double kx = k(0), ky = k(1);
+    e_k[k](0, 0) = -2. * cos(kx);
+    e_k[k](1, 1) = -2. * cos(ky);
+    e_k[k](0, 1) = 0.3 * sin(kx);
+    e_k[k](1, 0) = 0.3 * sin(kx);
+    for (int a = 0; a < 2; a++)
+      for (int b = 0; b < 2; b++) v_k[k](a, a, b, b) = 1.0 + 0.5 * cos(kx) * (a == b);
+  }
+
+  double mu = 0.2, beta = 5.0;
+
+  // A mesh point uses the cached band structure, a slightly shifted point the direct evaluation
+  auto k      = *std::next(e_k.mesh().begin(), 5);
+  auto kpoint = mesh::brzone::value_t{k};
+  auto kshift = kpoint;
+  kshift(0) += 1e-9;
+
+  auto sigma_mesh = g0w_sigma(mu, beta, e_k, v_k, kpoint);
+  auto sigma_off  = g0w_sigma(mu, beta, e_k, v_k, kshift);
+  EXPECT_ARRAY_NEAR(sigma_mesh, sigma_off, 1e-7);
+
+  auto sigma_k = g0w_sigma(mu, beta, e_k, v_k);
+  EXPECT_ARRAY_NEAR(sigma_mesh, sigma_k[k], 1e-12);
+}
+
+MAKE_MAIN;
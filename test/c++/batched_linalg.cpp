@@ -0,0 +1,136 @@
+
+#include <nda/nda.hpp>
+#include <itertools/itertools.hpp>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/mc_tools/random_generator.hpp>
+
+using namespace nda;
+
+#include <triqs_tprf/batched_linalg.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+nda::array<std::complex<double>, 3> random_batch(long n_batch, long n, double scale, int rng_seed = 23432) {
+  triqs::mc_tools::random_generator RNG("mt19937", rng_seed);
+  nda::array<std::complex<double>, 3> A(n_batch, n, n);
+  for (auto &v : A) v = scale * std::complex<double>(RNG(2.) - 1., RNG(2.) - 1.);
+  return A;
+}
+
+// ----------------------------------------------------
+
+TEST(batched_linalg, getrf_getrs) {
+
+  auto _ = all_t{};
+
+  // Fixed size kernels and the generic one
+  for (long n : {1, 4, 6, 9, 16}) {
+    long n_batch = 7;
+
+    auto A = random_batch(n_batch, n, 1.0, 1);
+    auto B = random_batch(n_batch, n, 1.0, 2);
+
+    auto LU = A;
+    nda::array<int, 2> ipiv;
+    batched_getrf(LU, ipiv);
+
+    auto X = B;
+    batched_getrs(LU, ipiv, X);
+
+    for (long i = 0; i < n_batch; i++) {
+      nda::matrix<std::complex<double>> X_ref = inverse(matrix<std::complex<double>>(A(i, _, _))) * matrix<std::complex<double>>(B(i, _, _));
+      EXPECT_ARRAY_NEAR(X(i, _, _), X_ref, 1e-10);
+    }
+  }
+}
+
+// ----------------------------------------------------
+
+TEST(batched_linalg, rpa_solve) {
+
+  auto _ = all_t{};
+
+  for (long n : {1, 4, 6, 9, 16}) {
+    long n_batch = 5;
+
+    auto X0 = random_batch(n_batch, n, 0.3, 3);
+    auto U  = random_batch(1, n, 0.3, 4);
+
+    auto X = X0;
+    batched_rpa_solve(X, U);
+
+    auto I = nda::eye<std::complex<double>>(n);
+    matrix<std::complex<double>> U_mat(U(0, _, _));
+
+    for (long i = 0; i < n_batch; i++) {
+      matrix<std::complex<double>> chi0(X0(i, _, _));
+      nda::matrix<std::complex<double>> X_ref = inverse(I - chi0 * U_mat) * chi0;
+      EXPECT_ARRAY_NEAR(X(i, _, _), X_ref, 1e-10);
+    }
+  }
+}
+
+// ----------------------------------------------------
+
+TEST(batched_linalg, rpa_solve_mixed_precision) {
+
+  for (long n : {4, 6}) {
+    long n_batch = 5;
+
+    auto X0 = random_batch(n_batch, n, 0.3, 5);
+    auto U  = random_batch(1, n, 0.3, 6);
+
+    // Close to the instability for the last point, 1 - X0 U = Q D Q^{-1} with D = diag(1e-9, 1/2, ...)
+    auto _ = all_t{};
+    matrix<std::complex<double>> Q(random_batch(1, n, 1.0, 7)(0, _, _)), D = nda::eye<std::complex<double>>(n) / 2;
+    D(0, 0) = 1e-9;
+    matrix<std::complex<double>> U_mat(U(0, _, _));
+    X0(n_batch - 1, _, _) = (nda::eye<std::complex<double>>(n) - Q * D * inverse(Q)) * inverse(U_mat);
+
+    auto X_ref = X0;
+    batched_rpa_solve(X_ref, U);
+
+    set_rpa_solve_precision("mixed");
+    EXPECT_EQ(get_rpa_solve_precision(), "mixed");
+
+    auto X = X0;
+    batched_rpa_solve(X, U);
+    set_rpa_solve_precision("double");
+
+    // Both solutions are backward stable, the forward error scales with the condition number
+    for (long i = 0; i < n_batch; i++) {
+      double scale = max_element(abs(X_ref(i, _, _)));
+      double tol   = (i == n_batch - 1) ? 1e-5 : 1e-12;
+      EXPECT_ARRAY_NEAR(X(i, _, _), X_ref(i, _, _), tol * scale);
+    }
+  }
+}
+
+// ----------------------------------------------------
+
+TEST(batched_linalg, pack_PH) {
+
+  auto _  = all_t{};
+  long nb = 3;
+
+  nda::array<std::complex<double>, 5> x(4, nb, nb, nb, nb);
+  for (auto [j, a, b, c, d] : itertools::product_range(4, nb, nb, nb, nb)) x(j, a, b, c, d) = j + 10. * a + 100. * b + 1000. * c + 10000. * d;
+
+  auto m = pack_PH(x, 1, 3);
+  EXPECT_EQ(m.shape()[0], 2);
+
+  for (long j = 1; j < 3; j++) {
+    nda::array<std::complex<double>, 4> x_j(x(j, _, _, _, _));
+    auto x_mat = make_matrix_view(group_indices_view(x_j, idx_group<0, 1>, idx_group<3, 2>));
+    EXPECT_ARRAY_NEAR(m(j - 1, _, _), x_mat);
+  }
+
+  nda::array<std::complex<double>, 5> y(4, nb, nb, nb, nb);
+  y = 0;
+  unpack_PH(m, y, 1);
+  EXPECT_ARRAY_NEAR(y(range(1, 3), _, _, _, _), x(range(1, 3), _, _, _, _));
+}
+
+MAKE_MAIN;
@@ -0,0 +1,89 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+
+#include <triqs_tprf/batched_tail_fit.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+TEST(batched_tail_fit, moments_and_density) {
+
+  double beta = 10.0;
+  auto wmesh  = mesh::imfreq{beta, Fermion, 100};
+  long nw     = wmesh.size();
+
+  // Columns 1/(i nu - e), with known moments e^(k-1) and density n_F(e)
+  std::vector<double> eps = {0.3, -1.2, 0.0, 0.8};
+  long n_cols             = eps.size();
+
+  nda::array<std::complex<double>, 2> data(nw, n_cols);
+  for (auto iw : wmesh) {
+    std::complex<double> z = iw;
+    for (long j = 0; j < n_cols; j++) data(iw.data_index(), j) = 1. / (z - eps[j]);
+  }
+
+  batched_tail_fitter fitter(wmesh);
+  auto m = fitter.moments(data);
+  auto d = fitter.density(data);
+
+  for (long j = 0; j < n_cols; j++) {
+    EXPECT_NEAR(std::abs(m(0, j)), 0., 1e-8);
+    EXPECT_NEAR(std::abs(m(1, j) - 1.), 0., 1e-6);
+    EXPECT_NEAR(std::abs(m(2, j) - eps[j]), 0., 1e-5);
+    EXPECT_NEAR(std::abs(d(j) - 1. / (std::exp(beta * eps[j]) + 1.)), 0., 1e-5);
+  }
+
+  // Same density as the TRIQS density of each column
+  for (long j = 0; j < n_cols; j++) {
+    gf<imfreq, scalar_valued> g{wmesh};
+    g.data() = data(_, j);
+    EXPECT_NEAR(std::abs(d(j) - density(g)), 0., 1e-5);
+  }
+}
+
+// ----------------------------------------------------
+
+TEST(batched_tail_fit, constant_of_bosonic_mesh) {
+
+  double beta = 5.0;
+  auto wmesh  = mesh::imfreq{beta, Boson, 60};
+
+  nda::array<std::complex<double>, 2> data(wmesh.size(), 2);
+  for (auto iw : wmesh) {
+    std::complex<double> z   = iw;
+    data(iw.data_index(), 0) = 2.5 + 1. / (z - 1.0) - 1. / (z + 1.0);
+    data(iw.data_index(), 1) = -0.7 + 3. / (z * z - 4.0);
+  }
+
+  auto m = batched_tail_fitter(wmesh).moments(data);
+  EXPECT_NEAR(std::abs(m(0, 0) - 2.5), 0., 1e-8);
+  EXPECT_NEAR(std::abs(m(0, 1) + 0.7), 0., 1e-8);
+}
+
+// ----------------------------------------------------
+
+TEST(batched_tail_fit, small_mesh_lowers_order) {
+
+  // Two positive frequencies only, too few for the default order
+  double beta = 2.0;
+  auto wmesh  = mesh::imfreq{beta, Fermion, 2};
+
+  nda::array<std::complex<double>, 2> data(wmesh.size(), 1);
+  for (auto iw : wmesh) data(iw.data_index(), 0) = 1. / (std::complex<double>(iw) - 0.4);
+
+  batched_tail_fitter fitter(wmesh);
+  EXPECT_EQ(fitter.order(), 3);
+
+  auto d = fitter.density(data);
+  EXPECT_TRUE(std::isfinite(std::abs(d(0))));
+  EXPECT_NEAR(d(0).real(), 1. / (std::exp(beta * 0.4) + 1.), 0.1);
+}
+
+MAKE_MAIN;
@@ -0,0 +1,65 @@
+
+#include <cstdio>
+#include <filesystem>
+
+#include <nda/nda.hpp>
+#include <itertools/itertools.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace nda;
+
+#include <triqs_tprf/lattice/bse_checkpoint.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+TEST(bse_checkpoint, store_and_resume) {
+
+  long n_points = 6, nb = 2;
+  double beta    = 10.0;
+  std::vector<long> mesh_sizes{3, 2};
+  std::string prefix = "bse_checkpoint_test";
+  std::remove((prefix + ".rank0.h5").c_str());
+  std::remove((prefix + ".rank2.h5").c_str());
+
+  nda::array<std::complex<double>, 4> v1(nb, nb, nb, nb), v4(nb, nb, nb, nb);
+  for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb)) {
+    v1(a, b, c, d) = std::complex<double>(a + 2 * b, c - d);
+    v4(a, b, c, d) = std::complex<double>(d, a * b * c);
+  }
+
+  {
+    bse_checkpoint chk(prefix, n_points, nb, beta, mesh_sizes);
+    EXPECT_TRUE(chk.enabled());
+    EXPECT_EQ(long(chk.remaining().size()), n_points);
+
+    chk.store(1, v1);
+    chk.store(4, v4);
+    chk.flush();
+  }
+
+  // Resume from the file written above, as the file of rank 2 of a previous run without
+  // the file of rank 1
+  std::filesystem::rename(prefix + ".rank0.h5", prefix + ".rank2.h5");
+  bse_checkpoint chk(prefix, n_points, nb, beta, mesh_sizes);
+  EXPECT_TRUE(chk.done(1));
+  EXPECT_TRUE(chk.done(4));
+  EXPECT_FALSE(chk.done(0));
+  EXPECT_EQ(chk.remaining(), (std::vector<long>{0, 2, 3, 5}));
+  EXPECT_ARRAY_NEAR(chk.value(1), v1);
+  EXPECT_ARRAY_NEAR(chk.value(4), v4);
+
+  // The file of a different sweep is rejected
+  EXPECT_THROW(bse_checkpoint(prefix, n_points, nb, 2 * beta, mesh_sizes), triqs::runtime_error);
+  EXPECT_THROW(bse_checkpoint(prefix, n_points, nb, beta, {2, 3}), triqs::runtime_error);
+
+  // A disabled checkpoint has all points remaining
+  bse_checkpoint off("", n_points, nb, beta, mesh_sizes);
+  EXPECT_FALSE(off.enabled());
+  EXPECT_EQ(long(off.remaining().size()), n_points);
+
+  std::remove((prefix + ".rank2.h5").c_str());
+}
+
+MAKE_MAIN;
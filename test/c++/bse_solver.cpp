@@ -0,0 +1,60 @@
+
+#include <nda/nda.hpp>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/mc_tools/random_generator.hpp>
+
+using namespace nda;
+
+#include <triqs_tprf/lattice/bse_solver.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+TEST(bse_solver, gmres_vs_dense) {
+
+  auto _ = all_t{};
+  triqs::mc_tools::random_generator RNG("mt19937", 23432);
+  auto rand = [&RNG](double scale) { return scale * std::complex<double>(RNG(2.) - 1., RNG(2.) - 1.); };
+
+  long nf = 10, m = 4, N = nf * m;
+
+  // Frequency diagonal bubble and a vertex decaying away from the diagonal
+  nda::array<std::complex<double>, 3> C(nf, m, m);
+  for (auto &v : C) v = rand(0.5);
+
+  nda::matrix<std::complex<double>> G(N, N);
+  for (long i = 0; i < N; i++)
+    for (long j = 0; j < N; j++) G(i, j) = rand(0.5 / (1. + std::abs(i / m - j / m)));
+
+  bse_kernel A(C, G);
+
+  nda::matrix<std::complex<double>> A_ref = nda::eye<std::complex<double>>(N);
+  for (long n = 0; n < nf; n++) A_ref(range(n * m, (n + 1) * m), _) -= matrix<std::complex<double>>(C(n, _, _)) * G(range(n * m, (n + 1) * m), _);
+
+  EXPECT_ARRAY_NEAR(matrix<std::complex<double>>(A.dense()), A_ref, 1e-12);
+
+  nda::vector<std::complex<double>> b(N);
+  for (auto &v : b) v = rand(1.);
+
+  EXPECT_ARRAY_NEAR(A.apply(b), A_ref * b, 1e-12);
+
+  nda::vector<std::complex<double>> x_ref = inverse(A_ref) * b;
+
+  set_bse_solver("gmres", 1e-12, 8, 500);
+  EXPECT_EQ(get_bse_solver(), "gmres");
+
+  nda::vector<std::complex<double>> x = b;
+  A.precondition(x);
+  EXPECT_TRUE(bse_gmres(A, b, x));
+  EXPECT_ARRAY_NEAR(x, x_ref, 1e-9);
+
+  // Warm start from the solution
+  EXPECT_TRUE(bse_gmres(A, b, x));
+  EXPECT_ARRAY_NEAR(x, x_ref, 1e-9);
+
+  set_bse_solver("dense");
+  EXPECT_EQ(get_bse_solver(), "dense");
+}
+
+MAKE_MAIN;
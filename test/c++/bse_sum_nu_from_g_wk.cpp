@@ -0,0 +1,171 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/linalg.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+// Two orbital square lattice model with a frequency dependent local self energy
+
+struct bse_model {
+
+  int nb = 2, nk = 4, nw = 2, nn = 3, n_tail = 20;
+  double beta = 2.0, mu = 0.3;
+
+  e_k_t e_k;
+  g_w_t sigma_w;
+  chi_wnn_t gamma_wnn;
+
+  bse_model() {
+
+    auto bz = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+    e_k     = e_k_t{{bz, nk}, {nb, nb}};
+    for (auto k : e_k.mesh()) {
+      double kx = k(0), ky = k(1);
+      e_k[k]       = 0.;
+      e_k[k](0, 0) = -2. * cos(kx) - cos(ky);
+      e_k[k](1, 1) = -cos(kx) - 2. * cos(ky) + 0.5;
+      e_k[k](0, 1) = 0.3 * (cos(kx) - cos(ky));
+      e_k[k](1, 0) = e_k[k](0, 1);
+    }
+
+    // The self energy mesh covers nu + w for all frequencies of the tail mesh
+    sigma_w = g_w_t{{beta, Fermion, n_tail + nw + 2}, {nb, nb}};
+    for (auto n : sigma_w.mesh()) {
+      std::complex<double> z = n;
+      sigma_w[n]             = 0.;
+      sigma_w[n](0, 0)       = 0.8 / (z - 1.0);
+      sigma_w[n](1, 1)       = 0.5 / (z + 0.5);
+      sigma_w[n](0, 1)       = 0.2 / (z - 0.2);
+      sigma_w[n](1, 0)       = sigma_w[n](0, 1);
+    }
+
+    // Local vertex on the meshes of chi0q_from_g_wk_PH(nw, nn, g_wk)
+    auto wmesh = mesh::imfreq{beta, Boson, nw};
+    auto nmesh = mesh::imfreq{beta, Fermion, nn};
+    gamma_wnn  = chi_wnn_t({wmesh, nmesh, nmesh}, {nb, nb, nb, nb});
+    gamma_wnn.data() = 0.;
+    for (long w = 0; w < long(wmesh.size()); w++)
+      for (long n = 0; n < long(nmesh.size()); n++)
+        for (long m = 0; m < long(nmesh.size()); m++)
+          for (auto [a, b, c, d] : itertools::product_range(nb, nb, nb, nb))
+            gamma_wnn.data()(w, n, m, a, b, c, d) = ((a == b && c == d) ? 0.6 : 0.1 * (a + 2 * c - d)) / (1. + w + std::abs(n - m));
+  }
+
+  // The lattice Green's function G = [nu + mu - e_k - sigma(nu)]^{-1}
+  g_wk_t g_wk() const {
+    g_wk_t g({sigma_w.mesh(), e_k.mesh()}, {nb, nb});
+    auto I = nda::eye<std::complex<double>>(nb);
+    for (auto [n, k] : g.mesh()) g[n, k] = inverse((n + mu) * I - e_k[k] - sigma_w[n]);
+    return g;
+  }
+};
+
+// ----------------------------------------------------
+// Reference traced lattice BSE, point by point as the serial implementation: the bubble
+// on the tail mesh (here from real space), the two frequency BSE with the PH channel
+// inverse and product, and the 0th order high frequency correction from the bubble
+
+chi_kw_t reference_chi_kw(g_wk_cvt g_wk, chi_wnn_cvt gamma_wnn, int nw, int nn, int n_tail) {
+
+  auto _ = range::all;
+
+  auto chi0_wnk = chi0q_from_chi0r(chi0r_from_gr_PH(nw, n_tail, fourier_wk_to_wr(g_wk)));
+
+  auto const &bmesh = std::get<0>(gamma_wnn.mesh());
+  auto const &fmesh = std::get<1>(gamma_wnn.mesh());
+  auto const &tmesh = std::get<1>(chi0_wnk.mesh());
+  auto const &kmesh = std::get<2>(chi0_wnk.mesh());
+
+  double beta = fmesh.beta();
+  long nb = gamma_wnn.target_shape()[0], nf = fmesh.size(), nt = tmesh.size(), offset = fmesh.first_index() - tmesh.first_index();
+
+  batched_tail_fitter fitter(tmesh);
+
+  chi_kw_t chi_kw({kmesh, bmesh}, {nb, nb, nb, nb});
+
+  for (long wi = 0; wi < long(bmesh.size()); wi++)
+    for (long ki = 0; ki < long(kmesh.size()); ki++) {
+
+      nda::array<std::complex<double>, 5> chi0_t = chi0_wnk.data()(wi, _, ki, _, _, _, _);
+
+      auto dens = fitter.density(nda::array_const_view<std::complex<double>, 2>(std::array<long, 2>{nt, nb * nb * nb * nb}, chi0_t.data()));
+      nda::array<std::complex<double>, 4> tr_chi0_tail_corr = nda::array_view<std::complex<double>, 4>(std::array<long, 4>{nb, nb, nb, nb}, dens.data());
+      tr_chi0_tail_corr /= beta;
+
+      g2_nn_t chi0_nn({fmesh, fmesh}, {nb, nb, nb, nb}), gamma_nn({fmesh, fmesh}, {nb, nb, nb, nb});
+      chi0_nn.data()  = 0.;
+      gamma_nn.data() = gamma_wnn.data()(wi, _, _, _, _, _, _);
+
+      nda::array<std::complex<double>, 4> tr_chi0(nb, nb, nb, nb);
+      tr_chi0() = 0.;
+      for (long n = 0; n < nf; n++) {
+        chi0_nn.data()(n, n, _, _, _, _) = chi0_t(offset + n, _, _, _, _);
+        tr_chi0 += chi0_t(offset + n, _, _, _, _);
+      }
+      tr_chi0 /= beta * beta;
+
+      auto I     = identity<Channel_t::PH>(chi0_nn);
+      auto denom = g2_nn_t{I - product<Channel_t::PH>(chi0_nn, gamma_nn)};
+      auto chi   = g2_nn_t{product<Channel_t::PH>(triqs_tprf::inverse<Channel_t::PH>(denom), chi0_nn)};
+
+      nda::array<std::complex<double>, 4> tr_chi(nb, nb, nb, nb);
+      tr_chi() = 0.;
+      for (long n1 = 0; n1 < nf; n1++)
+        for (long n2 = 0; n2 < nf; n2++) tr_chi += chi.data()(n1, n2, _, _, _, _);
+      tr_chi /= beta * beta;
+
+      chi_kw.data()(ki, wi, _, _, _, _) = tr_chi + tr_chi0_tail_corr - tr_chi0;
+    }
+
+  return chi_kw;
+}
+
+// ----------------------------------------------------
+
+TEST(bse_sum_nu, from_g_wk_vs_serial) {
+
+  bse_model m;
+  auto g_wk = m.g_wk();
+
+  auto chi_ref = reference_chi_kw(g_wk(), m.gamma_wnn(), m.nw, m.nn, m.n_tail);
+  auto chi_kw  = chiq_sum_nu_from_g_wk_and_gamma_PH(g_wk, m.gamma_wnn(), m.n_tail);
+
+  EXPECT_ARRAY_NEAR(chi_kw.data(), chi_ref.data(), 1e-10);
+
+  // Same result with the iterative solver
+  set_bse_solver("gmres", 1e-12);
+  auto chi_kw_gmres = chiq_sum_nu_from_g_wk_and_gamma_PH(g_wk, m.gamma_wnn(), m.n_tail);
+  set_bse_solver("dense");
+
+  EXPECT_ARRAY_NEAR(chi_kw_gmres.data(), chi_ref.data(), 1e-8);
+}
+
+// ----------------------------------------------------
+
+TEST(bse_sum_nu, from_e_k_sigma_w_finite_w) {
+
+  bse_model m;
+
+  // The bubble combines G(k, nu) with G(k - q, nu + w), both with the self energy at their own frequency
+  auto chi_ref = reference_chi_kw(m.g_wk()(), m.gamma_wnn(), m.nw, m.nn, m.n_tail);
+  auto chi_kw  = chiq_sum_nu_from_e_k_sigma_w_and_gamma_PH(m.mu, m.e_k(), m.sigma_w(), m.gamma_wnn(), m.n_tail);
+
+  // All bosonic frequencies, w != 0 included
+  auto _ = range::all;
+  auto const &bmesh = std::get<1>(chi_kw.mesh());
+  EXPECT_GT(long(bmesh.size()), 1);
+  for (long w = 0; w < long(bmesh.size()); w++) EXPECT_ARRAY_NEAR(chi_kw.data()(_, w, _, _, _, _), chi_ref.data()(_, w, _, _, _, _), 1e-10);
+}
+
+MAKE_MAIN;
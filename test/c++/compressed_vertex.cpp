@@ -0,0 +1,82 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/mc_tools/random_generator.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+TEST(compressed_vertex, woodbury_vs_dense_bse) {
+
+  triqs::mc_tools::random_generator RNG("mt19937", 23432);
+  auto rand = [&RNG](double scale) { return scale * std::complex<double>(RNG(2.) - 1., RNG(2.) - 1.); };
+
+  int nb = 2, nw = 2, nn = 3, nk = 2;
+  double beta = 10.0;
+
+  auto bmesh = mesh::imfreq{beta, Boson, nw};
+  auto fmesh = mesh::imfreq{beta, Fermion, nn};
+  auto kmesh = mesh::brzone{brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}}, nk};
+
+  chi_wnk_t chi0_wnk({bmesh, fmesh, kmesh}, {nb, nb, nb, nb});
+  for (auto &v : chi0_wnk.data()) v = rand(0.3);
+
+  chi_wnn_t gamma_wnn({bmesh, fmesh, fmesh}, {nb, nb, nb, nb});
+  for (auto &v : gamma_wnn.data()) v = rand(0.3);
+
+  chi_nn_t L_wn({bmesh, fmesh}, {nb, nb, nb, nb});
+  for (auto &v : L_wn.data()) v = rand(1.0);
+
+  compressed_vertex_PH gamma(gamma_wnn, 1e-14);
+  for (long w = 0; w < long(bmesh.size()); w++) EXPECT_EQ(gamma.rank(w), long(fmesh.size()) * nb * nb);
+
+  auto chi_ref = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, gamma_wnn);
+  auto chi     = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk, gamma);
+  EXPECT_ARRAY_NEAR(chi.data(), chi_ref.data(), 1e-10);
+
+  auto chi_L_ref = chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH(chi0_wnk, gamma_wnn, L_wn);
+  auto chi_L     = chiq_sum_nu_from_chi0q_and_gamma_and_L_wn_PH(chi0_wnk, gamma, L_wn);
+  EXPECT_ARRAY_NEAR(chi_L.data(), chi_L_ref.data(), 1e-10);
+}
+
+// ----------------------------------------------------
+
+TEST(compressed_vertex, truncation) {
+
+  triqs::mc_tools::random_generator RNG("mt19937", 4321);
+  auto rand = [&RNG]() { return std::complex<double>(RNG(2.) - 1., RNG(2.) - 1.); };
+
+  int nb = 2, nn = 4;
+  double beta = 10.0;
+
+  auto bmesh = mesh::imfreq{beta, Boson, 1};
+  auto fmesh = mesh::imfreq{beta, Fermion, nn};
+
+  // Separable vertex Gamma(nu, nu') = u(nu) v(nu'), of rank one in the PH grouping
+  nda::array<std::complex<double>, 3> u(2 * nn, nb, nb), v(2 * nn, nb, nb);
+  for (auto &x : u) x = rand();
+  for (auto &x : v) x = rand();
+
+  chi_wnn_t gamma_wnn({bmesh, fmesh, fmesh}, {nb, nb, nb, nb});
+  for (auto [n1, n2, a, b, c, d] : itertools::product_range(2 * nn, 2 * nn, nb, nb, nb, nb))
+    gamma_wnn.data()(0, n1, n2, a, b, c, d) = u(n1, a, b) * v(n2, d, c);
+
+  compressed_vertex_PH gamma(gamma_wnn, 1e-10);
+  EXPECT_EQ(gamma.rank(0), 1);
+
+  auto G = nda::matrix<std::complex<double>>(gamma.P(0) * dagger(gamma.Q(0)));
+  for (auto [n1, n2, a, b, c, d] : itertools::product_range(2 * nn, 2 * nn, nb, nb, nb, nb))
+    EXPECT_NEAR(std::abs(G(n1 * nb * nb + a * nb + b, n2 * nb * nb + d * nb + c) - gamma_wnn.data()(0, n1, n2, a, b, c, d)), 0., 1e-12);
+}
+
+MAKE_MAIN;
@@ -0,0 +1,185 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+// ------------------------------------------------------------
+
+g_wk_t make_test_g_wk(double beta, int n_iw, int nk) {
+
+  double t = 1.0;
+  auto bz  = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+
+  nda::clef::placeholder<0> om_;
+  nda::clef::placeholder<1> k_;
+
+  auto e_k = ek_t{{bz, nk}, {1, 1}};
+  e_k(k_) << -2 * t * (cos(k_(0)) + cos(k_(1)));
+
+  auto sigma_w = g_iw_t{{beta, Fermion, n_iw}, {1, 1}};
+  sigma_w(om_) << 1. / om_;
+
+  return lattice_dyson_g_wk(0.1, e_k, sigma_w);
+}
+
+// ------------------------------------------------------------
+
+TEST(distributed_gf, scatter_all_gather) {
+
+  auto g_wk = make_test_g_wk(10.0, 17, 4);
+
+  g_wk_dist_t g_wk_dist(g_wk());
+  EXPECT_EQ(g_wk_dist.n_rows(), std::get<0>(g_wk.mesh()).size());
+
+  auto g_wk_ref = g_wk_dist.all_gather();
+  EXPECT_ARRAY_NEAR(g_wk.data(), g_wk_ref.data());
+}
+
+// ------------------------------------------------------------
+
+TEST(distributed_gf, lattice_dyson_g_wk) {
+
+  double beta = 10.0;
+  int nk      = 4;
+  auto bz     = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+
+  nda::clef::placeholder<0> om_;
+  nda::clef::placeholder<1> k_;
+
+  auto e_k = ek_t{{bz, nk}, {1, 1}};
+  e_k(k_) << -2. * (cos(k_(0)) + cos(k_(1)));
+
+  auto sigma_wk = g_wk_t{{{beta, Fermion, 16}, {bz, nk}}, {1, 1}};
+  sigma_wk(om_, k_) << 0.5 / om_ + 0.1 * cos(k_(0));
+
+  auto g_wk     = lattice_dyson_g_wk(0.2, e_k, sigma_wk());
+  auto g_wk_ref = lattice_dyson_g_wk(0.2, e_k, g_wk_dist_t(sigma_wk())).all_gather();
+
+  EXPECT_ARRAY_NEAR(g_wk.data(), g_wk_ref.data());
+}
+
+// ------------------------------------------------------------
+
+TEST(distributed_gf, fourier_wk_wr_tr) {
+
+  auto g_wk = make_test_g_wk(10.0, 32, 4);
+  auto g_wr = fourier_wk_to_wr(g_wk);
+  auto g_tr = fourier_wr_to_tr(g_wr);
+
+  auto g_wr_dist = fourier_wk_to_wr(g_wk_dist_t(g_wk()));
+  auto g_tr_dist = fourier_wr_to_tr(g_wr_dist);
+
+  EXPECT_ARRAY_NEAR(g_wr.data(), g_wr_dist.all_gather().data());
+  EXPECT_ARRAY_NEAR(g_tr.data(), g_tr_dist.all_gather().data());
+
+  auto g_wr_back = fourier_tr_to_wr(g_tr_dist).all_gather();
+  EXPECT_ARRAY_NEAR(fourier_tr_to_wr(g_tr).data(), g_wr_back.data());
+}
+
+// ------------------------------------------------------------
+
+TEST(distributed_gf, chi0_and_rpa) {
+
+  auto g_wk = make_test_g_wk(10.0, 64, 4);
+  auto g_wr = fourier_wk_to_wr(g_wk);
+
+  int nw = 3, nn = 8;
+
+  auto chi0_wnr = chi0r_from_gr_PH(nw, nn, g_wr);
+  auto chi0_wnk = chi0q_from_chi0r(chi0_wnr);
+  auto chi0_wk  = chi0q_sum_nu(chi0_wnk);
+
+  auto chi0_wnr_dist = chi0r_from_gr_PH_distributed(nw, nn, g_wr);
+  auto chi0_wnk_dist = chi0q_from_chi0r(chi0_wnr_dist);
+  auto chi0_wk_dist  = chi0q_sum_nu(chi0_wnk_dist);
+
+  EXPECT_ARRAY_NEAR(chi0_wnr.data(), chi0_wnr_dist.all_gather().data());
+  EXPECT_ARRAY_NEAR(chi0_wnk.data(), chi0_wnk_dist.all_gather().data());
+  EXPECT_ARRAY_NEAR(chi0_wk.data(), chi0_wk_dist.all_gather().data());
+
+  nda::array<std::complex<double>, 4> U(1, 1, 1, 1);
+  U = 0.5;
+
+  auto chi_wk      = solve_rpa_PH(chi0_wk(), U);
+  auto chi_wk_dist = solve_rpa_PH(chi0_wk_dist, U);
+
+  EXPECT_ARRAY_NEAR(chi_wk.data(), chi_wk_dist.all_gather().data());
+}
+
+// ------------------------------------------------------------
+
+TEST(distributed_gf, screened_interaction_W) {
+
+  auto g_wk = make_test_g_wk(10.0, 64, 4);
+  auto g_wr = fourier_wk_to_wr(g_wk);
+
+  auto chi0_wk = chi0q_sum_nu(chi0q_from_chi0r(chi0r_from_gr_PH(4, 16, g_wr)));
+
+  nda::clef::placeholder<0> k_;
+  chi_k_t V_k(std::get<1>(chi0_wk.mesh()), {1, 1, 1, 1});
+  V_k(k_) << 0.5 + 0.2 * cos(k_(0));
+
+  auto W_wk      = dynamical_screened_interaction_W(chi0_wk(), V_k());
+  auto W_wk_dist = dynamical_screened_interaction_W(chi_wk_dist_t(chi0_wk()), V_k());
+
+  EXPECT_ARRAY_NEAR(W_wk.data(), W_wk_dist.all_gather().data());
+}
+
+// ------------------------------------------------------------
+
+TEST(distributed_gf, gw_dynamic_sigma) {
+
+  auto g_wk = make_test_g_wk(10.0, 32, 4);
+  auto g_tr = fourier_wr_to_tr(fourier_wk_to_wr(g_wk));
+
+  auto tmesh = std::get<0>(g_tr.mesh());
+  auto rmesh = std::get<1>(g_tr.mesh());
+
+  // Smooth bosonic W on the same imaginary time mesh
+  chi_tr_t W_tr({{tmesh.beta(), Boson, long(tmesh.size())}, rmesh}, {1, 1, 1, 1});
+  for (long t = 0; t < long(tmesh.size()); t++)
+    for (long r = 0; r < long(rmesh.size()); r++) W_tr.data()(t, r, 0, 0, 0, 0) = std::cosh(2. * t / tmesh.size() - 1.) / (1. + r);
+
+  auto sigma_tr      = gw_dynamic_sigma(W_tr(), g_tr());
+  auto sigma_tr_dist = gw_dynamic_sigma(chi_tr_dist_t(W_tr()), g_tr_dist_t(g_tr()));
+
+  EXPECT_ARRAY_NEAR(sigma_tr.data(), sigma_tr_dist.all_gather().data());
+}
+
+// ------------------------------------------------------------
+
+TEST(distributed_gf, eliashberg_product_fft) {
+
+  auto g_wk = make_test_g_wk(10.0, 32, 4);
+
+  nda::clef::placeholder<0> w_;
+  nda::clef::placeholder<1> k_;
+
+  chi_wk_t Gamma_pp_dyn_wk(g_wk.mesh(), {1, 1, 1, 1});
+  Gamma_pp_dyn_wk(w_, k_) << (1. + cos(k_(0))) / (w_ * w_ - 2.);
+
+  chi_k_t Gamma_pp_const_k(std::get<1>(g_wk.mesh()), {1, 1, 1, 1});
+  Gamma_pp_const_k(k_) << 0.5 + cos(k_(1));
+
+  auto [Gamma_pp_dyn_tr, Gamma_pp_const_r] = dynamic_and_constant_to_tr(Gamma_pp_dyn_wk(), Gamma_pp_const_k());
+
+  g_wk_t delta_wk(g_wk.mesh(), {1, 1});
+  delta_wk(w_, k_) << (cos(k_(0)) - cos(k_(1))) / (w_ * w_ - 1.);
+
+  auto delta_out      = eliashberg_product_fft(Gamma_pp_dyn_tr(), Gamma_pp_const_r(), g_wk(), delta_wk());
+  auto delta_out_dist = eliashberg_product_fft(chi_tr_dist_t(Gamma_pp_dyn_tr()), Gamma_pp_const_r(), g_wk(), g_wk_dist_t(delta_wk()));
+
+  EXPECT_ARRAY_NEAR(delta_out.data(), delta_out_dist.all_gather().data(), 1e-10);
+}
+
+MAKE_MAIN;
@@ -0,0 +1,100 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+extern "C" {
+void zgeev_(char const *jobvl, char const *jobvr, int const *n, std::complex<double> *a, int const *lda, std::complex<double> *w,
+            std::complex<double> *vl, int const *ldvl, std::complex<double> *vr, int const *ldvr, std::complex<double> *work, int const *lwork,
+            double *rwork, int *info);
+}
+
+// All eigenvalues of a dense matrix, ordered by decreasing real part
+std::vector<dcomplex> dense_eigenvalues(nda::array<dcomplex, 2> A) {
+  int n = A.shape()[0], info = 0, lwork = 4 * n, ld_one = 1;
+  std::vector<dcomplex> w(n), work(lwork);
+  std::vector<double> rwork(2 * n);
+  zgeev_("N", "N", &n, A.data(), &n, w.data(), nullptr, &ld_one, nullptr, &ld_one, work.data(), &lwork, rwork.data(), &info);
+  EXPECT_EQ(info, 0);
+  std::sort(w.begin(), w.end(), [](dcomplex a, dcomplex b) { return a.real() > b.real(); });
+  return w;
+}
+
+// ----------------------------------------------------
+
+TEST(eliashberg, block_solver_eigenpairs) {
+
+  int nb = 1, nk = 4;
+  double beta = 5.0;
+
+  auto kmesh = mesh::brzone{brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}}, nk};
+  auto wmesh = mesh::imfreq{beta, Fermion, 8};
+
+  nda::clef::placeholder<0> w_;
+  nda::clef::placeholder<1> k_;
+
+  auto e_k = ek_t{kmesh, {nb, nb}};
+  e_k(k_) << -2. * (cos(k_(0)) + cos(k_(1))) * nda::eye<double>(nb);
+  auto g_wk = lattice_dyson_g0_wk(0.0, e_k, wmesh);
+
+  // Spin fluctuation like vertex, peaked at (pi, pi)
+  chi_wk_t Gamma_pp_dyn_wk(g_wk.mesh(), {nb, nb, nb, nb});
+  Gamma_pp_dyn_wk(w_, k_) << 4. / (2.5 + cos(k_(0)) + cos(k_(1))) / (1. - w_ * w_);
+
+  chi_k_t Gamma_pp_const_k(kmesh, {nb, nb, nb, nb});
+  Gamma_pp_const_k(k_) << 1.0;
+
+  auto [Gamma_pp_dyn_tr, Gamma_pp_const_r] = dynamic_and_constant_to_tr(Gamma_pp_dyn_wk(), Gamma_pp_const_k());
+  eliashberg_operator op(Gamma_pp_dyn_tr(), Gamma_pp_const_r(), g_wk());
+
+  // Dense matrix of the operator, from one batched application to the identity
+  long dim = op.size();
+  nda::array<dcomplex, 2> eye(dim, dim), M_T(dim, dim);
+  eye() = 0;
+  for (long i = 0; i < dim; i++) eye(i, i) = 1.;
+  op.apply(eye(), M_T());
+
+  g_wk_t initial_delta(g_wk.mesh(), {nb, nb});
+  initial_delta(w_, k_) << cos(k_(0)) - cos(k_(1)) + 1. / (w_ * w_ - 1.);
+
+  int n_ev = 4;
+  auto [es, deltas] = eliashberg_block_solver(op, initial_delta(), n_ev, 2, 1e-10);
+  EXPECT_EQ(long(es.size()), n_ev);
+
+  for (int j = 0; j < n_ev; j++) {
+    if (j > 0) EXPECT_GE(es(j - 1).real(), es(j).real() - 1e-8);
+
+    // Residual of the eigenpair with the dense matrix, (M y)_x = sum_i M_T(i, x) y_i
+    auto y = nda::reshape(deltas[j].data(), std::array<long, 1>{dim});
+    double res = 0;
+    for (long x = 0; x < dim; x++) {
+      dcomplex v = 0;
+      for (long i = 0; i < dim; i++) v += M_T(i, x) * y(i);
+      res += std::norm(v - es(j) * y(x));
+    }
+    EXPECT_NEAR(std::sqrt(res), 0., 1e-7 * std::abs(es(j)));
+  }
+
+  // Leading eigenvalues of the dense matrix, which has the eigenvalues of its transpose M_T
+  auto es_dense = dense_eigenvalues(M_T);
+  for (int j = 0; j < n_ev; j++) EXPECT_NEAR(es(j).real(), es_dense[j].real(), 1e-8);
+
+  // Same leading eigenvalues with a different block size
+  auto [es_4, deltas_4] = eliashberg_block_solver(op, initial_delta(), n_ev, 4, 1e-10);
+  for (int j = 0; j < n_ev; j++) EXPECT_NEAR(es_4(j).real(), es(j).real(), 1e-7);
+
+  // Not converged within the allowed iterations
+  EXPECT_THROW(eliashberg_block_solver(op, initial_delta(), n_ev, 2, 1e-10, 1), triqs::runtime_error);
+}
+
+MAKE_MAIN;
@@ -0,0 +1,77 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+// One DLR fit and convolution per k and orbital index quadruple
+g_Dwk_t g_delta_g_product_reference(g_Dwk_vt g_wk, g_Dwk_vt delta_wk) {
+
+  auto wmesh = std::get<0>(delta_wk.mesh());
+  auto kmesh = std::get<1>(delta_wk.mesh());
+  auto tmesh = dlr_imtime(wmesh);
+
+  auto F_wk = make_gf(delta_wk);
+  F_wk *= 0.;
+
+  for (auto k : kmesh)
+    for (auto [d, c] : g_wk.target_indices())
+      for (auto [e, f] : delta_wk.target_indices()) {
+        auto gg_w = gf(wmesh);
+        auto d_w  = gf(wmesh);
+        for (auto w : wmesh) {
+          gg_w[w] = g_wk[w, k](c, f) * nda::conj(g_wk[w, -k](e, d));
+          d_w[w]  = delta_wk[w, k](e, f);
+        }
+
+        auto f_t   = gf(tmesh);
+        f_t.data() = tmesh.dlr_it().convolve(tmesh.beta(), static_cast<cppdlr::statistic_t>(tmesh.statistic()), make_gf_dlr(gg_w).data(),
+                                             make_gf_dlr(d_w).data());
+
+        auto f_w = make_gf_dlr_imfreq(make_gf_dlr(f_t));
+        for (auto w : wmesh) F_wk[w, k](d, c) += f_w[w];
+      }
+
+  return F_wk;
+}
+
+TEST(eliashberg, dlr_g_delta_g_product_batched) {
+
+  int nb = 2, nk = 3;
+  double beta = 10.0;
+
+  auto kmesh = mesh::brzone{brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}}, nk};
+  auto wmesh = mesh::dlr_imfreq{beta, Fermion, 10., 1e-10};
+
+  g_Dwk_t g_wk({wmesh, kmesh}, {nb, nb});
+  g_Dwk_t delta_wk({wmesh, kmesh}, {nb, nb});
+
+  for (auto [w, k] : g_wk.mesh()) {
+    double e = -2. * (cos(k(0)) + cos(k(1)));
+    for (auto [a, b] : g_wk.target_indices()) {
+      g_wk[w, k](a, b)     = (a == b ? 1. : 0.2) / (dcomplex(w) - e - 0.3 * a + 0.1 * sin(k(0)));
+      delta_wk[w, k](a, b) = (cos(k(0)) - cos(k(1)) + 0.5 * a - 0.2 * b) / (dcomplex(w) - 1.5);
+    }
+  }
+
+  auto F_ref = g_delta_g_product_reference(g_wk(), delta_wk());
+  auto F     = eliashberg_g_delta_g_product(g_wk(), delta_wk());
+  EXPECT_ARRAY_NEAR(F.data(), F_ref.data(), 1e-10);
+
+  // Second product with the convolution tensor of the mesh from the cache
+  auto F_cached = eliashberg_g_delta_g_product(g_wk(), delta_wk());
+  EXPECT_ARRAY_NEAR(F_cached.data(), F_ref.data(), 1e-10);
+}
+
+MAKE_MAIN;
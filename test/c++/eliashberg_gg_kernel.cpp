@@ -0,0 +1,86 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+#include <triqs/mc_tools/random_generator.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+TEST(eliashberg, gg_kernel_vs_g_delta_g_product) {
+
+  triqs::mc_tools::random_generator RNG("mt19937", 2718);
+  auto rand = [&RNG]() { return std::complex<double>(RNG(2.) - 1., RNG(2.) - 1.); };
+
+  int nb = 2, nk = 3;
+  double beta = 10.0;
+
+  auto kmesh = mesh::brzone{brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}}, nk};
+
+  g_wk_t g_wk({{beta, Fermion, 8}, kmesh}, {nb, nb});
+  for (auto &v : g_wk.data()) v = rand();
+
+  // The gap may live on a smaller frequency mesh than the Green's function
+  g_wk_t delta_wk({{beta, Fermion, 5}, kmesh}, {nb, nb});
+  for (auto &v : delta_wk.data()) v = rand();
+
+  auto gg_wk = eliashberg_gg_kernel(g_wk);
+
+  auto F_ref = eliashberg_g_delta_g_product(g_wk(), delta_wk());
+  auto F     = eliashberg_g_delta_g_product(gg_wk(), delta_wk());
+  EXPECT_ARRAY_NEAR(F.data(), F_ref.data(), 1e-12);
+}
+
+// ----------------------------------------------------
+
+TEST(eliashberg, gg_kernel_product_fft) {
+
+  int nb = 2, nk = 3;
+  double beta = 10.0;
+
+  auto kmesh = mesh::brzone{brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}}, nk};
+  auto wmesh = mesh::imfreq{beta, Fermion, 32};
+
+  nda::clef::placeholder<0> w_;
+  nda::clef::placeholder<1> k_;
+  nda::clef::placeholder<2> a_;
+  nda::clef::placeholder<3> b_;
+  nda::clef::placeholder<4> c_;
+  nda::clef::placeholder<5> d_;
+
+  auto e_k = ek_t{kmesh, {nb, nb}};
+  e_k(k_) << -2. * (cos(k_(0)) + cos(k_(1))) * nda::eye<double>(nb);
+  auto g_wk = lattice_dyson_g0_wk(0.1, e_k, wmesh);
+
+  g_wk_t delta_wk(g_wk.mesh(), {nb, nb});
+  delta_wk(w_, k_)(a_, b_) << (cos(k_(0)) - cos(k_(1))) / (w_ * w_ - 1. - a_ - b_);
+
+  chi_wk_t Gamma_pp_dyn_wk(g_wk.mesh(), {nb, nb, nb, nb});
+  Gamma_pp_dyn_wk(w_, k_)(a_, b_, c_, d_) << (1. + cos(k_(0)) + a_ * d_) / (w_ * w_ - 2. - b_ * c_);
+
+  chi_k_t Gamma_pp_const_k(kmesh, {nb, nb, nb, nb});
+  Gamma_pp_const_k(k_)(a_, b_, c_, d_) << 0.5 + cos(k_(1)) * (a_ + b_ - c_ * d_);
+
+  auto [Gamma_pp_dyn_tr, Gamma_pp_const_r] = dynamic_and_constant_to_tr(Gamma_pp_dyn_wk(), Gamma_pp_const_k());
+
+  auto gg_wk = eliashberg_gg_kernel(g_wk());
+
+  auto delta_ref = eliashberg_product_fft(Gamma_pp_dyn_tr(), Gamma_pp_const_r(), g_wk(), delta_wk());
+  auto delta_out = eliashberg_product_fft(Gamma_pp_dyn_tr(), Gamma_pp_const_r(), gg_wk(), delta_wk());
+  EXPECT_ARRAY_NEAR(delta_out.data(), delta_ref.data(), 1e-12);
+
+  auto delta_c_ref = eliashberg_product_fft_constant(Gamma_pp_const_r(), g_wk(), delta_wk());
+  auto delta_c_out = eliashberg_product_fft_constant(Gamma_pp_const_r(), gg_wk(), delta_wk());
+  EXPECT_ARRAY_NEAR(delta_c_out.data(), delta_c_ref.data(), 1e-12);
+}
+
+MAKE_MAIN;
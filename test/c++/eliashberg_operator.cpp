@@ -0,0 +1,87 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+TEST(eliashberg, operator_vs_product_fft) {
+
+  int nb = 2, nk = 4;
+  double beta = 10.0;
+
+  auto kmesh = mesh::brzone{brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}}, nk};
+  auto wmesh = mesh::imfreq{beta, Fermion, 32};
+
+  nda::clef::placeholder<0> w_;
+  nda::clef::placeholder<1> k_;
+  nda::clef::placeholder<2> a_;
+  nda::clef::placeholder<3> b_;
+  nda::clef::placeholder<4> c_;
+  nda::clef::placeholder<5> d_;
+
+  auto e_k = ek_t{kmesh, {nb, nb}};
+  e_k(k_) << -2. * (cos(k_(0)) + cos(k_(1))) * nda::eye<double>(nb);
+  auto g_wk = lattice_dyson_g0_wk(0.1, e_k, wmesh);
+
+  chi_wk_t Gamma_pp_dyn_wk(g_wk.mesh(), {nb, nb, nb, nb});
+  Gamma_pp_dyn_wk(w_, k_)(a_, b_, c_, d_) << (1. + cos(k_(0)) + a_ * d_) / (w_ * w_ - 2. - b_ * c_);
+
+  chi_k_t Gamma_pp_const_k(kmesh, {nb, nb, nb, nb});
+  Gamma_pp_const_k(k_)(a_, b_, c_, d_) << 0.5 + cos(k_(1)) * (a_ + b_ - c_ * d_);
+
+  auto [Gamma_pp_dyn_tr, Gamma_pp_const_r] = dynamic_and_constant_to_tr(Gamma_pp_dyn_wk(), Gamma_pp_const_k());
+
+  // A block of three gaps with different momentum structure
+  long n_vec = 3;
+  std::vector<g_wk_t> deltas;
+  for (long i = 0; i < n_vec; i++) {
+    g_wk_t delta_wk(g_wk.mesh(), {nb, nb});
+    delta_wk(w_, k_)(a_, b_) << (cos(k_(0)) - (i - 1.) * cos(k_(1)) + i * a_ * b_) / (w_ * w_ - 1. - a_ - b_);
+    deltas.push_back(delta_wk);
+  }
+
+  eliashberg_operator op(Gamma_pp_dyn_tr(), Gamma_pp_const_r(), g_wk());
+  eliashberg_operator op_const(Gamma_pp_const_r(), g_wk());
+  EXPECT_EQ(op.size(), long(deltas[0].data().size()));
+
+  // The operator fits the high frequency moments of F with the batched fit instead of fit_tail,
+  // the moments of this F vanish and both fits agree to the accuracy of the tail fit
+  double tol = 1e-6;
+
+  auto delta_out = make_gf(deltas[0]);
+  for (int rep = 0; rep < 2; rep++) { // the second application reuses the work arrays
+    if (rep == 1) fourier_clear_plan_cache(); // and plans anew
+    for (auto &delta_wk : deltas) {
+      auto delta_ref = eliashberg_product_fft(Gamma_pp_dyn_tr(), Gamma_pp_const_r(), g_wk(), delta_wk());
+      op.apply(delta_wk(), delta_out());
+      EXPECT_ARRAY_NEAR(delta_out.data(), delta_ref.data(), tol);
+
+      auto delta_c_ref = eliashberg_product_fft_constant(Gamma_pp_const_r(), g_wk(), delta_wk());
+      op_const.apply(delta_wk(), delta_out());
+      EXPECT_ARRAY_NEAR(delta_out.data(), delta_c_ref.data(), tol);
+    }
+  }
+
+  // Batched application to the whole block
+  nda::array<dcomplex, 2> x(n_vec, op.size()), y(n_vec, op.size());
+  for (long i = 0; i < n_vec; i++) x(i, range::all) = nda::reshape(deltas[i].data(), std::array<long, 1>{op.size()});
+  op.apply(x(), y());
+
+  for (long i = 0; i < n_vec; i++) {
+    op.apply(deltas[i](), delta_out());
+    EXPECT_ARRAY_NEAR(y(i, range::all), nda::reshape(delta_out.data(), std::array<long, 1>{op.size()}), 1e-10);
+  }
+}
+
+MAKE_MAIN;
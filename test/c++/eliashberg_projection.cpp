@@ -0,0 +1,189 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+#include <chrono>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+// Two degenerate orbitals without hybridization, so that the frequency and orbital parities
+// of the gap are conserved separately
+struct projection_model {
+
+  int nb = 2, nk = 4;
+  double beta = 5.0;
+
+  mesh::brzone kmesh = {brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}}, nk};
+  mesh::imfreq wmesh = {beta, Fermion, 8};
+
+  nda::clef::placeholder<0> w_;
+  nda::clef::placeholder<1> k_;
+
+  g_wk_t g_wk;
+  chi_tr_t Gamma_pp_dyn_tr;
+  chi_r_t Gamma_pp_const_r;
+
+  projection_model() {
+    auto _ = nda::range::all;
+
+    auto e_k = ek_t{kmesh, {nb, nb}};
+    e_k(k_) << -2. * (cos(k_(0)) + cos(k_(1))) * nda::eye<double>(nb);
+    g_wk = lattice_dyson_g0_wk(0.0, e_k, wmesh);
+
+    // Intra orbital vertex with an exchange part, peaked at (pi, pi)
+    gf<g_wk_t::mesh_t, scalar_valued> V_wk(g_wk.mesh());
+    V_wk(w_, k_) << 4. / (2.5 + cos(k_(0)) + cos(k_(1))) / (1. - w_ * w_);
+
+    chi_wk_t Gamma_pp_dyn_wk(g_wk.mesh(), {nb, nb, nb, nb});
+    chi_k_t Gamma_pp_const_k(kmesh, {nb, nb, nb, nb});
+    Gamma_pp_dyn_wk.data()  = 0;
+    Gamma_pp_const_k.data() = 0;
+    for (auto [c, a, d, b] : Gamma_pp_dyn_wk.target_indices()) {
+      if (c == a && d == b) {
+        Gamma_pp_dyn_wk.data()(_, _, c, a, d, b) += V_wk.data();
+        Gamma_pp_const_k.data()(_, c, a, d, b) += 1.0;
+      }
+      if (c == b && d == a) Gamma_pp_dyn_wk.data()(_, _, c, a, d, b) += 0.3 * V_wk.data();
+    }
+
+    std::tie(Gamma_pp_dyn_tr, Gamma_pp_const_r) = dynamic_and_constant_to_tr(Gamma_pp_dyn_wk(), Gamma_pp_const_k());
+  }
+
+  // Gap f(k) S_ab / (1 + nu^2), even in frequency
+  template <typename F> g_wk_t gap(F f, nda::matrix<double> const &S) {
+    auto _ = nda::range::all;
+    gf<g_wk_t::mesh_t, scalar_valued> s_wk(g_wk.mesh());
+    s_wk(w_, k_) << f(k_) / (1. - w_ * w_);
+    g_wk_t delta(g_wk.mesh(), {nb, nb});
+    for (auto [a, b] : delta.target_indices()) delta.data()(_, _, a, b) = S(a, b) * s_wk.data();
+    return delta;
+  }
+};
+
+// ----------------------------------------------------
+
+TEST(eliashberg, projected_apply) {
+
+  projection_model m;
+  eliashberg_operator op(m.Gamma_pp_dyn_tr(), m.Gamma_pp_const_r(), m.g_wk());
+  long nw = m.wmesh.size(), nk = m.kmesh.size();
+
+  // Singlet, even frequency and orbital: even in k
+  auto delta_s = m.gap([](auto k) { return cos(k(0)) - cos(k(1)); }, nda::matrix<double>{{1.0, 0.5}, {0.5, -0.3}});
+  // Triplet, even frequency and orbital: odd in k
+  auto delta_t = m.gap([](auto k) { return sin(k(0)); }, nda::matrix<double>{{0.2, 1.0}, {1.0, 0.7}});
+
+  for (auto [spin, delta] : std::vector<std::pair<std::string, g_wk_t>>{{"singlet", delta_s}, {"triplet", delta_t}}) {
+
+    op.clear_projection();
+    EXPECT_EQ(op.size(), nw * nk * 4);
+    g_wk_t delta_full(m.g_wk.mesh(), {m.nb, m.nb});
+    op.apply(delta(), delta_full());
+
+    op.set_projection(spin, "even", "even");
+    EXPECT_TRUE(op.is_projected());
+    EXPECT_EQ(op.size(), nw / 2 * nk * 3);
+
+    // A gap of the sector is recovered from its reduced form
+    auto x = op.restrict_gap(delta());
+    EXPECT_ARRAY_NEAR(op.expand_gap(x).data(), delta.data(), 1e-12);
+
+    // Same product from the reduced gaps
+    nda::array<dcomplex, 2> x_2(1, op.size()), y_2(1, op.size());
+    x_2(0, nda::range::all) = x;
+    op.apply(x_2(), y_2());
+    EXPECT_ARRAY_NEAR(op.expand_gap(y_2(0, nda::range::all)).data(), delta_full.data(), 1e-6);
+
+    g_wk_t delta_proj(m.g_wk.mesh(), {m.nb, m.nb});
+    op.apply(delta(), delta_proj());
+    EXPECT_ARRAY_NEAR(delta_proj.data(), delta_full.data(), 1e-6);
+  }
+
+  // The orbital odd sector keeps the off diagonal pair only
+  op.set_projection("singlet", "odd", "odd");
+  EXPECT_EQ(op.size(), nw / 2 * nk);
+}
+
+// ----------------------------------------------------
+
+TEST(eliashberg, projected_apply_out_of_sector) {
+
+  projection_model m;
+  auto _ = nda::range::all;
+
+  // A static vertex that couples the orbital pair (0, 1) to (1, 0) only breaks the orbital exchange parity
+  chi_r_t Gamma_pp_const_r = m.Gamma_pp_const_r;
+  Gamma_pp_const_r.data()(_, 0, 0, 1, 1) += 0.5;
+  eliashberg_operator op(m.Gamma_pp_dyn_tr(), Gamma_pp_const_r(), m.g_wk());
+
+  EXPECT_THROW(op.set_projection("singlet", "even", "even"), triqs::runtime_error);
+  EXPECT_FALSE(op.is_projected());
+  EXPECT_EQ(op.size(), m.wmesh.size() * m.kmesh.size() * m.nb * m.nb);
+}
+
+// ----------------------------------------------------
+
+TEST(eliashberg, projected_apply_cost) {
+
+  projection_model m;
+  eliashberg_operator op(m.Gamma_pp_dyn_tr(), m.Gamma_pp_const_r(), m.g_wk());
+
+  // Shortest of a few block applies, after a first one that sets up the buffers and plans
+  auto timing = [&op](long n_vec) {
+    nda::array<dcomplex, 2> x(n_vec, op.size()), y(n_vec, op.size());
+    x = 1.0;
+    op.apply(x(), y());
+    double t_min = 1e300;
+    for (int n = 0; n < 5; n++) {
+      auto t0 = std::chrono::steady_clock::now();
+      op.apply(x(), y());
+      t_min = std::min(t_min, std::chrono::duration<double>(std::chrono::steady_clock::now() - t0).count());
+    }
+    return t_min;
+  };
+
+  double t_full = timing(8);
+
+  // One of the four orbital pairs and half of the frequencies of the result
+  op.set_projection("singlet", "odd", "odd");
+  double t_projected = timing(8);
+
+  std::cout << "full apply " << t_full << " s, projected apply " << t_projected << " s\n";
+  EXPECT_LT(t_projected, t_full);
+}
+
+// ----------------------------------------------------
+
+TEST(eliashberg, projected_block_solver) {
+
+  projection_model m;
+  eliashberg_operator op(m.Gamma_pp_dyn_tr(), m.Gamma_pp_const_r(), m.g_wk());
+
+  auto initial_delta = m.gap([](auto k) { return cos(k(0)) - cos(k(1)) + 0.5; }, nda::matrix<double>{{1.0, 0.2}, {0.2, 1.0}});
+
+  op.set_projection("singlet", "even", "even");
+  int n_ev = 2;
+  auto [es, deltas] = eliashberg_block_solver(op, initial_delta(), n_ev, 2, 1e-10);
+  EXPECT_EQ(long(es.size()), n_ev);
+
+  // The eigenpairs of the sector are eigenpairs of the full operator
+  op.clear_projection();
+  for (int j = 0; j < n_ev; j++) {
+    g_wk_t delta_out(m.g_wk.mesh(), {m.nb, m.nb});
+    op.apply(deltas[j](), delta_out());
+    nda::array<dcomplex, 4> lambda_delta = es(j) * deltas[j].data();
+    EXPECT_ARRAY_NEAR(delta_out.data(), lambda_delta, 1e-6 * std::abs(es(j)));
+  }
+}
+
+MAKE_MAIN;
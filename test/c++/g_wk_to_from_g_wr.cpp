@@ -84,4 +84,122 @@ TEST(lattice, g_wk_to_from_g_wr) {
  EXPECT_ARRAY_NEAR(g_wk.data(), g_wk_ref.data()); 
 }
 
+TEST(lattice, g_wk_to_from_g_wr_split) {
+ double beta = 10.0;
+ int n_iw = 3;
+
+ auto bz = brillouin_zone{bravais_lattice{{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}}};
+
+ nda::clef::placeholder<0> om_;
+ nda::clef::placeholder<1> k_;
+
+ auto g_wk = g_wk_t{{{beta, Fermion, n_iw}, {bz, {4, 6, 2}}}, {2, 2}};
+ g_wk(om_, k_) << 1. / (om_ + 2. * cos(k_(0)) + cos(k_(1)) - 0.5 * cos(k_(2)));
+
+ auto [wmesh, kmesh] = g_wk.mesh();
+
+ // Reference from the frequency parallel path
+ lattice_split_fft_min_size = std::numeric_limits<long>::max();
+ auto g_wr = fourier_wk_to_wr(g_wk);
+
+ auto g_wr_split = make_gf(g_wr);
+ fourier::_fourier_lattice_split(std::get<1>(g_wr.mesh()), lattice_batch_view(g_wk.data()), lattice_batch_view(g_wr_split.data()));
+ EXPECT_ARRAY_NEAR(g_wr.data(), g_wr_split.data());
+
+ auto g_wk_split = make_gf(g_wk);
+ fourier::_fourier_lattice_split(kmesh, lattice_batch_view(g_wr.data()), lattice_batch_view(g_wk_split.data()));
+ EXPECT_ARRAY_NEAR(g_wk.data(), g_wk_split.data());
+
+ // Force the split path through the heuristic
+ lattice_split_fft_min_size = 0;
+ if (use_lattice_split_fft(wmesh.size(), kmesh.size())) EXPECT_ARRAY_NEAR(g_wr.data(), fourier_wk_to_wr(g_wk).data());
+ lattice_split_fft_min_size = 4096;
+}
+
+TEST(lattice, g_wk_to_from_g_tr_fused) {
+ double beta = 10.0;
+ int n_iw = 64;
+
+ auto bz = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+
+ nda::clef::placeholder<0> om_;
+ nda::clef::placeholder<1> k_;
+
+ auto g_wk = g_wk_t{{{beta, Fermion, n_iw}, {bz, 4}}, {2, 2}};
+ g_wk(om_, k_) << 1. / (om_ + 2. * cos(k_(0)) + cos(k_(1)));
+
+ // Reference through the full (w, r) intermediate
+ auto g_tr_ref = fourier_wr_to_tr(fourier_wk_to_wr(g_wk));
+ auto g_wk_ref = fourier_wr_to_wk(fourier_tr_to_wr(g_tr_ref));
+
+ // One block, uneven blocks and one block per target component, zero is taken as one block
+ for (long n_blocks : {0, 1, 3, 8}) {
+   fused_fourier_n_blocks = n_blocks;
+   auto g_tr = fourier_wk_to_tr(g_wk);
+   EXPECT_ARRAY_NEAR(g_tr.data(), g_tr_ref.data());
+   EXPECT_ARRAY_NEAR(fourier_tr_to_wk(g_tr).data(), g_wk_ref.data());
+ }
+ fused_fourier_n_blocks = 8;
+}
+
+TEST(lattice, e_k_to_from_e_r_real) {
+
+ auto bz = brillouin_zone{bravais_lattice{{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}}};
+ nda::clef::placeholder<0> k_;
+ auto I  = std::complex<double>{0., 1.};
+
+ // Real in r-space, X(-k) = conj(X(k)), with odd and even mesh sizes
+ auto e_k = ek_t{{bz, {4, 3, 5}}, {2, 2}};
+ e_k(k_) << -2. * cos(k_(0)) - cos(k_(1)) + 0.5 * cos(k_(2)) + I * sin(k_(0));
+
+ EXPECT_TRUE(is_real_in_r(e_k));
+
+ auto e_r      = fourier_k_to_r(e_k);
+ auto e_r_real = fourier_k_to_r(e_k, true);
+ EXPECT_ARRAY_NEAR(e_r.data(), e_r_real.data());
+ EXPECT_TRUE(is_real_in_r(e_r));
+
+ auto e_k_real = fourier_r_to_k(e_r_real, true);
+ EXPECT_ARRAY_NEAR(e_k.data(), e_k_real.data());
+
+ // Not real in r-space
+ e_k(k_) << I * cos(k_(0));
+ EXPECT_FALSE(is_real_in_r(e_k));
+ EXPECT_FALSE(is_real_in_r(fourier_k_to_r(e_k)));
+}
+
+TEST(lattice, fourier_plan_cache) {
+ double beta = 10.0;
+ int nk = 8;
+ auto bz = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+
+ nda::clef::placeholder<0> om_;
+ nda::clef::placeholder<1> k_;
+
+ auto g_wk = g_wk_t{{{beta, Fermion, 16}, {bz, nk}}, {2, 2}};
+ g_wk(om_, k_) << 1. / (om_ + 2. * cos(k_(0)) + cos(k_(1)));
+
+ fourier_clear_plan_cache();
+ auto g_wr = fourier_wk_to_wr(g_wk);
+ long n_plans = fourier_plan_cache_size();
+ EXPECT_GT(n_plans, 0);
+
+ // Same geometry, the cached plans are reused
+ auto g_wr_2 = fourier_wk_to_wr(g_wk);
+ EXPECT_EQ(n_plans, fourier_plan_cache_size());
+ EXPECT_ARRAY_NEAR(g_wr.data(), g_wr_2.data());
+
+ // Measured plans give the same transform, and their wisdom can be stored
+ fourier_set_plan_effort("measure");
+ auto g_wr_3 = fourier_wk_to_wr(g_wk);
+ EXPECT_ARRAY_NEAR(g_wr.data(), g_wr_3.data());
+
+ EXPECT_TRUE(fourier_export_wisdom("fourier_plan_cache.wisdom"));
+ mpi::communicator{}.barrier();
+ EXPECT_TRUE(fourier_import_wisdom("fourier_plan_cache.wisdom"));
+
+ fourier_set_plan_effort("estimate");
+ EXPECT_THROW(fourier_set_plan_effort("exhaustive_search"), triqs::runtime_error);
+}
+
 MAKE_MAIN;
@@ -0,0 +1,154 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace nda;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/types.hpp>
+#include <triqs_tprf/lattice.hpp>
+
+using namespace triqs_tprf;
+
+// ------------------------------------------------------------
+// Two orbital square lattice model with orbitals swapped by the diagonal mirrors
+
+auto make_c4v_ibz(brzone const &kmesh) {
+
+  std::vector<nda::matrix<long>> rotations;
+  std::vector<nda::matrix<std::complex<double>>> orbital_reps;
+
+  nda::matrix<std::complex<double>> id{{1, 0}, {0, 1}}, swap{{0, 1}, {1, 0}};
+
+  for (long sx : {1, -1})
+    for (long sy : {1, -1}) {
+      rotations.push_back(nda::matrix<long>{{sx, 0, 0}, {0, sy, 0}, {0, 0, 1}});
+      orbital_reps.push_back(id);
+      rotations.push_back(nda::matrix<long>{{0, sx, 0}, {sy, 0, 0}, {0, 0, 1}});
+      orbital_reps.push_back(swap);
+    }
+
+  return std::make_shared<ibz_map const>(kmesh, rotations, orbital_reps);
+}
+
+e_k_t make_e_k(int nk) {
+
+  auto bz = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+  auto e_k = e_k_t{{bz, nk}, {2, 2}};
+
+  for (auto k : e_k.mesh()) {
+    double kx = k(0), ky = k(1);
+    e_k[k]    = 0.;
+    e_k[k](0, 0) = -2. * cos(kx) - cos(ky);
+    e_k[k](1, 1) = -cos(kx) - 2. * cos(ky);
+  }
+  return e_k;
+}
+
+// ------------------------------------------------------------
+
+TEST(ibz, stars) {
+
+  int nk   = 8;
+  auto e_k = make_e_k(nk);
+  auto ibz = make_c4v_ibz(e_k.mesh());
+
+  EXPECT_EQ(ibz->n_irr(), 15);
+
+  long n_k = 0;
+  for (long i = 0; i < ibz->n_irr(); i++) n_k += ibz->multiplicity(i);
+  EXPECT_EQ(n_k, e_k.mesh().size());
+
+  for (long k = 0; k < e_k.mesh().size(); k++) EXPECT_EQ(ibz->rotate(ibz->op_index(k), ibz->irr_k(ibz->irr_index(k))), k);
+
+  auto e_k_ref = e_k_ibz_t(e_k(), ibz).unfold();
+  EXPECT_ARRAY_NEAR(e_k.data(), e_k_ref.data());
+}
+
+// ------------------------------------------------------------
+
+TEST(ibz, lindhard_chi00_and_rpa) {
+
+  int nk   = 8;
+  auto e_k = make_e_k(nk);
+  auto ibz = make_c4v_ibz(e_k.mesh());
+
+  auto wmesh = mesh::imfreq{5.0, Boson, 4};
+  double mu  = 0.3;
+
+  auto chi0_wk     = lindhard_chi00(e_k(), wmesh, mu);
+  auto chi0_wk_ibz = lindhard_chi00(e_k(), wmesh, mu, ibz);
+
+  EXPECT_ARRAY_NEAR(chi0_wk.data(), chi0_wk_ibz.unfold().data());
+
+  // Density-density interaction, invariant under the orbital swap
+  nda::array<std::complex<double>, 4> U(2, 2, 2, 2);
+  U = 0.;
+  for (int a = 0; a < 2; a++)
+    for (int b = 0; b < 2; b++) U(a, a, b, b) = (a == b) ? 0.5 : 0.2;
+
+  auto chi_wk     = solve_rpa_PH(chi0_wk(), U);
+  auto chi_wk_ibz = solve_rpa_PH(chi0_wk_ibz, U);
+
+  EXPECT_ARRAY_NEAR(chi_wk.data(), chi_wk_ibz.unfold().data());
+}
+
+// ------------------------------------------------------------
+
+TEST(ibz, screened_interaction_W) {
+
+  int nk   = 8;
+  auto e_k = make_e_k(nk);
+  auto ibz = make_c4v_ibz(e_k.mesh());
+
+  auto chi0_wk     = lindhard_chi00(e_k(), mesh::imfreq{5.0, Boson, 4}, 0.3);
+  auto chi0_wk_ibz = lindhard_chi00(e_k(), mesh::imfreq{5.0, Boson, 4}, 0.3, ibz);
+
+  // Density-density interaction with a C4v invariant momentum dependence
+  chi_k_t V_k(e_k.mesh(), {2, 2, 2, 2});
+  for (auto k : V_k.mesh()) {
+    V_k[k] = 0.;
+    for (int a = 0; a < 2; a++)
+      for (int b = 0; b < 2; b++) V_k[k](a, a, b, b) = ((a == b) ? 0.5 : 0.2) * (1. + 0.1 * (cos(k(0)) + cos(k(1))));
+  }
+
+  auto W_wk     = dynamical_screened_interaction_W(chi0_wk(), V_k());
+  auto W_wk_ibz = dynamical_screened_interaction_W(chi0_wk_ibz, V_k());
+
+  EXPECT_ARRAY_NEAR(W_wk.data(), W_wk_ibz.unfold().data());
+}
+
+// ------------------------------------------------------------
+
+TEST(ibz, lattice_bse) {
+
+  int nk      = 4, nw = 2, nn = 4;
+  double beta = 5.0;
+  auto e_k    = make_e_k(nk);
+  auto ibz    = make_c4v_ibz(e_k.mesh());
+
+  auto g_wk     = lattice_dyson_g0_wk(0.3, e_k(), mesh::imfreq{beta, Fermion, 16});
+  auto chi0_wnk = chi0q_from_chi0r(chi0r_from_gr_PH(nw, nn, fourier_wk_to_wr(g_wk)));
+
+  // Local density-density vertex, invariant under the orbital swap
+  auto wmesh = std::get<0>(chi0_wnk.mesh());
+  auto nmesh = std::get<1>(chi0_wnk.mesh());
+  chi_wnn_t gamma_wnn({wmesh, nmesh, nmesh}, {2, 2, 2, 2});
+  gamma_wnn.data() = 0.;
+  for (long w = 0; w < long(wmesh.size()); w++)
+    for (long n = 0; n < long(nmesh.size()); n++)
+      for (long m = 0; m < long(nmesh.size()); m++)
+        for (int a = 0; a < 2; a++)
+          for (int b = 0; b < 2; b++) gamma_wnn.data()(w, n, m, a, a, b, b) = ((a == b) ? 0.5 : 0.2) / (1. + w + std::abs(n - m));
+
+  auto chi_kw     = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk(), gamma_wnn());
+  auto chi_wk_ibz = chiq_sum_nu_from_chi0q_and_gamma_PH(chi0_wnk(), gamma_wnn(), ibz).unfold();
+
+  auto _ = range::all;
+  for (long w = 0; w < long(wmesh.size()); w++) EXPECT_ARRAY_NEAR(chi_kw.data()(_, w, _, _, _, _), chi_wk_ibz.data()(w, _, _, _, _, _));
+}
+
+MAKE_MAIN;
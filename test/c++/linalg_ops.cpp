@@ -129,5 +129,70 @@ TEST(CtHyb, ph_bar_inverse_product) {
   inverse_product_impl<Channel_t::PH_bar>();
 }
 
+// ----------------------------------------------------
+// Test the persistent channel layout storage against the channel matrix view
+
+template <Channel_t CH> void channel_storage_impl() {
+
+  double beta = 1.2345;
+  int nwf = 3, norb = 2;
+
+  mesh::imfreq fmesh{beta, Fermion, nwf};
+  g2_iw_t A_w{{mesh::imfreq{beta, Boson, 1}, fmesh, fmesh}, {norb, norb, norb, norb}};
+  random_fill(A_w);
+
+  auto _ = all_t{};
+  g2_nn_t A = A_w[0, _, _];
+
+  auto A_ch = g2_nn_channel<CH>{A};
+  EXPECT_GF_NEAR(A_ch.to_gf(), A);
+
+  using dat_t = array<g2_nn_t::scalar_t, 6, channel_memory_layout<CH>>;
+  auto A_dat  = dat_t{A.data()};
+  EXPECT_ARRAY_NEAR(A_ch.matrix(), channel_matrix_view<CH>(A_dat));
+
+  auto A_inv = g2_nn_channel<CH>{A};
+  inverse_in_place(A_inv);
+  EXPECT_ARRAY_NEAR(A_inv.matrix(), inverse(matrix<g2_nn_t::scalar_t>(channel_matrix_view<CH>(A_dat))));
+
+  // A * A^{-1} - 1 = 0 accumulated in place
+  g2_nn_channel<CH> R(fmesh, A.target_shape());
+  set_identity(R);
+  product(A_ch, A_inv, R, 1.0, -1.0);
+  EXPECT_NEAR(max_element(abs(R.matrix())), 0.0, 1e-10);
+}
+
+TEST(CtHyb, ph_channel_storage) { channel_storage_impl<Channel_t::PH>(); }
+TEST(CtHyb, pp_channel_storage) { channel_storage_impl<Channel_t::PP>(); }
+TEST(CtHyb, ph_bar_channel_storage) { channel_storage_impl<Channel_t::PH_bar>(); }
+
+// ----------------------------------------------------
+// Test the MPI distributed inverse and product against the local ones
+
+template <Channel_t CH> void distributed_impl() {
+
+  double beta = 1.2345;
+  int nwb = 4, nwf = 3, norb = 2;
+
+  mesh::imfreq bmesh{beta, Boson, nwb};
+  mesh::imfreq fmesh{beta, Fermion, nwf};
+  g2_iw_t A{{bmesh, fmesh, fmesh}, {norb, norb, norb, norb}};
+  g2_iw_t B{{bmesh, fmesh, fmesh}, {norb, norb, norb, norb}};
+  random_fill(A, 23432);
+  random_fill(B, 4711);
+
+  mpi::communicator c;
+  EXPECT_GF_NEAR(inverse<CH>(A, c), inverse<CH>(A));
+  EXPECT_GF_NEAR(product<CH>(A, B, c), product<CH>(A, B));
+
+  // The local overloads are not collective, a single rank may call them
+  if (c.rank() == 0) EXPECT_GF_NEAR(product<CH>(inverse<CH>(A), A), identity<CH>(A));
+  c.barrier();
+}
+
+TEST(CtHyb, ph_distributed) { distributed_impl<Channel_t::PH>(); }
+TEST(CtHyb, pp_distributed) { distributed_impl<Channel_t::PP>(); }
+TEST(CtHyb, ph_bar_distributed) { distributed_impl<Channel_t::PH_bar>(); }
+
 // ----------------------------------------------------
 MAKE_MAIN;
@@ -0,0 +1,48 @@
+
+#include <triqs/gfs.hpp>
+#include <triqs/mesh.hpp>
+#include <triqs/test_tools/gfs.hpp>
+
+using namespace triqs::gfs;
+using namespace triqs::mesh;
+using namespace triqs::lattice;
+
+#include <triqs_tprf/lattice/mesh_index_tables.hpp>
+
+using namespace triqs_tprf;
+
+// ----------------------------------------------------
+
+TEST(mesh_index_tables, brzone) {
+
+  auto kmesh = mesh::brzone{brillouin_zone{bravais_lattice{{{1, 0, 0}, {0, 1, 0}, {0, 0, 1}}}}, {4, 3, 2}};
+
+  auto mk = minus_x_index_table(kmesh);
+  for (auto k : kmesh) EXPECT_EQ(mk[k.data_index()], (-k).data_index());
+
+  for (auto q : kmesh) {
+    auto kpq = x_plus_q_index_table(kmesh, q.data_index());
+    auto kmq = x_minus_q_index_table(kmesh, q.data_index());
+    for (auto k : kmesh) {
+      EXPECT_EQ(kpq[k.data_index()], (k + q).data_index());
+      EXPECT_EQ(kmq[k.data_index()], (k - q).data_index());
+    }
+  }
+}
+
+// ----------------------------------------------------
+
+TEST(mesh_index_tables, cyclat) {
+
+  auto rmesh = mesh::cyclat{bravais_lattice{{{1, 0}, {0, 1}}}, {5, 3, 1}};
+
+  auto mr = minus_x_index_table(rmesh);
+  for (auto r : rmesh) EXPECT_EQ(mr[r.data_index()], (-r).data_index());
+
+  for (auto q : rmesh) {
+    auto rmq = x_minus_q_index_table(rmesh, q.data_index());
+    for (auto r : rmesh) EXPECT_EQ(rmq[r.data_index()], (r - q).data_index());
+  }
+}
+
+MAKE_MAIN;
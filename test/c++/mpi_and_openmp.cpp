@@ -113,4 +113,38 @@ TEST(mpi, mpi_view_openmp) {
   c.barrier();
 }
 
+// ------------------------------------------------------------
+
+TEST(mpi, mpi_all_reduce_in_place) {
+
+  mpi::communicator c;
+
+  double beta = 20;
+  int n_k = 4;
+  int nw = 5;
+
+  auto bz = brillouin_zone{bravais_lattice{{{1, 0}, {0, 1}}}};
+  auto g_wk = gf<prod<imfreq, brzone>>{
+      {{beta, Fermion, nw}, {bz, n_k}}, {2, 2}};
+
+  g_wk() = 0.0;
+  for (auto [w, k] : mpi_view(g_wk.mesh())) g_wk[w, k] = w.data_index() + 10. * k.data_index();
+
+  auto g_ref = g_wk;
+  g_ref = mpi::all_reduce(g_ref);
+
+  mpi_all_reduce_in_place(g_wk);
+  EXPECT_ARRAY_NEAR(g_wk.data(), g_ref.data());
+
+  // Force many small chunks
+  
+  auto arr = nda::array<std::complex<double>, 1>(1001);
+  for (auto i : range(arr.size())) arr(i) = c.rank() + i;
+
+  auto arr_ref = mpi::all_reduce(arr);
+  
+  mpi_all_reduce_in_place(arr.data(), arr.size(), c, 10 * sizeof(std::complex<double>));
+  EXPECT_ARRAY_NEAR(arr, arr_ref);
+}
+
 MAKE_MAIN;
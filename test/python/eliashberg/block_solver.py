@@ -0,0 +1,97 @@
+# ----------------------------------------------------------------------
+
+""" Compare the block Krylov solver to the Implicitly Restarted Arnoldi Method
+and test the block apply, restrict_gap and expand_gap of the EliashbergOperator. """
+
+# ----------------------------------------------------------------------
+
+import numpy as np
+
+# ----------------------------------------------------------------------
+
+from triqs_tprf.ParameterCollection import ParameterCollection
+from triqs_tprf.utilities import create_eliashberg_ingredients
+from triqs_tprf.lattice import EliashbergOperator
+from triqs_tprf.eliashberg import solve_eliashberg, semi_random_initial_delta
+from triqs_tprf.eliashberg import preprocess_gamma_for_fft
+
+# ----------------------------------------------------------------------
+
+
+def test_block_solver_vs_iram(g0_wk, gamma):
+    initial_delta = semi_random_initial_delta(g0_wk, seed=1337)
+
+    Es_IRAM, eigen_modes_IRAM = solve_eliashberg(
+        gamma, g0_wk, product="FFT", solver="IRAM", initial_delta=initial_delta, k=3
+    )
+    Es_BLOCK, eigen_modes_BLOCK = solve_eliashberg(
+        gamma, g0_wk, product="FFT", solver="BLOCK", initial_delta=initial_delta, k=3
+    )
+
+    np.testing.assert_allclose(np.sort(Es_BLOCK), np.sort(Es_IRAM), rtol=1e-7)
+
+    # The modes of the block solver are eigenvectors of the operator
+    Gamma_pp_dyn_tr, Gamma_pp_const_r = preprocess_gamma_for_fft(gamma)
+    op = EliashbergOperator(Gamma_pp_dyn_tr, Gamma_pp_const_r, g0_wk)
+    delta_out = g0_wk.copy()
+    for E, delta in zip(Es_BLOCK, eigen_modes_BLOCK):
+        op.apply(delta, delta_out)
+        residual = np.linalg.norm(delta_out.data - E * delta.data)
+        assert residual < 1e-6 * np.linalg.norm(E * delta.data)
+
+    print("The block solver and IRAM yield the same eigenvalues.")
+
+
+def test_operator_bindings(g0_wk, gamma):
+    Gamma_pp_dyn_tr, Gamma_pp_const_r = preprocess_gamma_for_fft(gamma)
+    op = EliashbergOperator(Gamma_pp_dyn_tr, Gamma_pp_const_r, g0_wk)
+
+    assert not op.is_projected
+    assert op.size == g0_wk.data.size
+
+    deltas = [semi_random_initial_delta(g0_wk, seed=seed) for seed in [1, 2, 3]]
+
+    # Without projection the reduced gap is the flattened data
+    for delta in deltas:
+        x = op.restrict_gap(delta)
+        np.testing.assert_array_equal(x, delta.data.flatten())
+        np.testing.assert_array_equal(op.expand_gap(x).data, delta.data)
+
+    # The block apply on a (n_vec, size) numpy array matches the gap by gap apply
+    x = np.array([op.restrict_gap(delta) for delta in deltas])
+    y = np.empty_like(x)
+    op.apply(x, y)
+
+    delta_out = g0_wk.copy()
+    for i, delta in enumerate(deltas):
+        op.apply(delta, delta_out)
+        np.testing.assert_allclose(y[i], delta_out.data.flatten(), atol=1e-12)
+        np.testing.assert_allclose(op.expand_gap(y[i]).data, delta_out.data, atol=1e-12)
+
+    print("The block apply, restrict_gap and expand_gap of the EliashbergOperator work.")
+
+
+# ================================================================================
+
+if __name__ == "__main__":
+
+    p = ParameterCollection(
+        dim=2,
+        norb=1,
+        t=1.0,
+        mu=0.0,
+        beta=5,
+        U=1.0,
+        Up=0.0,
+        J=0.0,
+        Jp=0.0,
+        nk=4,
+        nw=100,
+    )
+
+    eliashberg_ingredients = create_eliashberg_ingredients(p)
+    g0_wk = eliashberg_ingredients.g0_wk
+    gamma = eliashberg_ingredients.gamma
+
+    test_block_solver_vs_iram(g0_wk, gamma)
+    test_operator_bindings(g0_wk, gamma)
@@ -0,0 +1,101 @@
+# ----------------------------------------------------------------------
+
+""" Solve the linearized Eliashberg equation in the pairing symmetry sectors of a one band
+model and compare to the solution without projection.
+
+For one band the sectors of the singlet and triplet gaps with even and odd frequency
+parity cover all gaps, so the largest of their leading eigenvalues is the leading
+eigenvalue without projection. """
+
+# ----------------------------------------------------------------------
+
+import numpy as np
+
+# ----------------------------------------------------------------------
+
+from triqs_tprf.ParameterCollection import ParameterCollection
+from triqs_tprf.utilities import create_eliashberg_ingredients
+from triqs_tprf.lattice import EliashbergOperator
+from triqs_tprf.eliashberg import solve_eliashberg, semi_random_initial_delta
+from triqs_tprf.eliashberg import preprocess_gamma_for_fft
+
+# ----------------------------------------------------------------------
+
+sectors = [
+    ("singlet", "even", "even"),
+    ("singlet", "odd", "even"),
+    ("triplet", "even", "even"),
+    ("triplet", "odd", "even"),
+]
+
+
+def test_projected_vs_full(g0_wk, gamma):
+    initial_delta = semi_random_initial_delta(g0_wk, seed=1337)
+
+    Es_full, _ = solve_eliashberg(
+        gamma, g0_wk, product="FFT", solver="IRAM", initial_delta=initial_delta, k=1
+    )
+
+    Gamma_pp_dyn_tr, Gamma_pp_const_r = preprocess_gamma_for_fft(gamma)
+    op = EliashbergOperator(Gamma_pp_dyn_tr, Gamma_pp_const_r, g0_wk)
+    delta_out = g0_wk.copy()
+
+    Es_sectors = []
+    for projection in sectors:
+
+        # IRAM on the reduced gaps, through from_x_to_wk and matvec of the projected mode
+        Es_IRAM, eigen_modes_IRAM = solve_eliashberg(
+            gamma, g0_wk, product="FFT", solver="IRAM",
+            initial_delta=initial_delta, k=1, projection=projection,
+        )
+        Es_BLOCK, _ = solve_eliashberg(
+            gamma, g0_wk, product="FFT", solver="BLOCK",
+            initial_delta=initial_delta, k=1, projection=projection,
+        )
+        np.testing.assert_allclose(Es_BLOCK[0], Es_IRAM[0], rtol=1e-7)
+
+        # The mode is in the sector and an eigenvector of the operator without projection
+        E, delta = Es_IRAM[0], eigen_modes_IRAM[0]
+
+        op.set_projection(*projection)
+        assert op.size == g0_wk.data.size // 2
+        np.testing.assert_allclose(
+            op.expand_gap(op.restrict_gap(delta)).data, delta.data, atol=1e-12
+        )
+        op.clear_projection()
+
+        op.apply(delta, delta_out)
+        residual = np.linalg.norm(delta_out.data - E * delta.data)
+        assert residual < 1e-6 * np.linalg.norm(E * delta.data)
+
+        Es_sectors.append(E)
+        print(projection, E)
+
+    np.testing.assert_allclose(max(Es_sectors), Es_full[0], rtol=1e-7)
+
+    print("The leading eigenvalues of the sectors match the one without projection.")
+
+
+# ================================================================================
+
+if __name__ == "__main__":
+
+    p = ParameterCollection(
+        dim=2,
+        norb=1,
+        t=1.0,
+        mu=0.0,
+        beta=5,
+        U=1.0,
+        Up=0.0,
+        J=0.0,
+        Jp=0.0,
+        nk=4,
+        nw=100,
+    )
+
+    eliashberg_ingredients = create_eliashberg_ingredients(p)
+    g0_wk = eliashberg_ingredients.g0_wk
+    gamma = eliashberg_ingredients.gamma
+
+    test_projected_vs_full(g0_wk, gamma)
@@ -58,23 +58,23 @@ def test_tol_used_in_PM(g0_wk, gamma):
 
 
 def test_call_eliashberg_product_fft(g0_wk, gamma):
-    with patch("triqs_tprf.eliashberg.eliashberg_product_fft") as patched:
-        patched.return_value = g0_wk
-
+    with patch("triqs_tprf.eliashberg.EliashbergOperator") as patched:
         solve_eliashberg(gamma, g0_wk, product="FFT")
 
     patched.assert_called()
+    assert len(patched.call_args[0]) == 3  # dynamic and constant part of Gamma
+    patched.return_value.apply.assert_called()
 
 
 def test_call_eliashberg_product_fft_constant(g0_wk, gamma):
-    with patch("triqs_tprf.eliashberg.eliashberg_product_fft_constant") as patched:
-        patched.return_value = g0_wk
-
+    with patch("triqs_tprf.eliashberg.EliashbergOperator") as patched:
         non_dynamic_gamma = 0 * gamma
 
         solve_eliashberg(non_dynamic_gamma, g0_wk, product="FFT")
 
     patched.assert_called()
+    assert len(patched.call_args[0]) == 2  # constant part of Gamma only
+    patched.return_value.apply.assert_called()
 
 
 def test_call_eliashberg_product(g0_wk, gamma):
@@ -127,10 +127,8 @@ def test_wrong_input_for_solver(g0_wk, gamma):
         assert str(e) == expected_message
 
 
-@patch("triqs_tprf.eliashberg.eliashberg_product_fft")
-def test_call_symmetrize_function(patched_product, g0_wk, gamma):
-    patched_product.return_value = g0_wk
-
+@patch("triqs_tprf.eliashberg.EliashbergOperator")
+def test_call_symmetrize_function(patched_operator, g0_wk, gamma):
     symmetrize_fct = MagicMock()
     symmetrize_fct.return_value = g0_wk
 
@@ -148,10 +146,8 @@ def test_invalid_symmetrize_function(g0_wk, gamma):
         assert str(e) == "'int' object has no attribute 'data'"
 
 
-@patch("triqs_tprf.eliashberg.eliashberg_product_fft")
-def test_k_input(patched_product, g0_wk, gamma):
-    patched_product.return_value = g0_wk
-
+@patch("triqs_tprf.eliashberg.EliashbergOperator")
+def test_k_input(patched_operator, g0_wk, gamma):
     for k_input in [1, 3]:
         Es, evs = solve_eliashberg(gamma, g0_wk, k=k_input)
         assert len(Es) == k_input
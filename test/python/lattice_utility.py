@@ -13,7 +13,7 @@ from triqs_tprf.lattice import split_into_dynamic_wk_and_constant_k, add_dynamic
 from triqs_tprf.gw import bubble_PI_wk
 from triqs_tprf.gw import dynamical_screened_interaction_W
 
-from triqs.gf import Gf, MeshImFreq, Idx, MeshImTime, MeshBrZone
+from triqs.gf import Gf, MeshImFreq, Idx, MeshImTime, MeshBrZone, MeshCycLat
 from triqs.gf.meshes import MeshDLRImFreq, MeshReFreq
 from triqs.gf.mesh_product import MeshProduct
 from triqs.lattice.lattice_tools import BrillouinZone, BravaisLattice
@@ -125,6 +125,31 @@ def test_add_dynamic_and_static():
     check_add_dynamic_static(DLRwmesh, kmesh, nb, 2, "DLR Matsubara G")
     check_add_dynamic_static(DLRnumesh, kmesh, nb, 4, "DLR Matsubara Chi")
 
+def test_cluster_mesh_fourier_interpolation():
+    print("== Cluster mesh Fourier interpolation ==")
+
+    from triqs_tprf.lattice import cluster_mesh_fourier_interpolation
+    from triqs_tprf.lattice_utils import cluster_mesh_fourier_interpolation as cluster_mesh_fourier_interpolation_np
+
+    nb = 2
+    bl = BravaisLattice(units=[(1,0,0), (0,1,0)], orbital_positions=[(0,0,0)])
+    rmesh = MeshCycLat(lattice=bl, dims=[4, 4, 1])
+    wmesh = MeshImFreq(5.0, 'Boson', 3)
+
+    chi_wr = Gf(mesh=MeshProduct(wmesh, rmesh), target_shape=[nb]*4)
+    chi_wr.data[:] = np.random.rand(*chi_wr.data.shape) + 1.j * np.random.rand(*chi_wr.data.shape)
+
+    k_vecs = 2 * np.pi * np.random.rand(11, 3)
+    k_vecs[:, 2] = 0.
+
+    chi_ref = cluster_mesh_fourier_interpolation_np(k_vecs, chi_wr)
+
+    # -- Several chunk sizes, including chunks not dividing the number of k-points
+    for k_chunk in [1, 4, 11, 1024]:
+        chi_wk = cluster_mesh_fourier_interpolation(k_vecs, chi_wr, k_chunk)
+        np.testing.assert_array_almost_equal(chi_wk, chi_ref)
+
 if __name__ == "__main__":
     test_split_into_dynamic_and_constant()
     test_add_dynamic_and_static()
+    test_cluster_mesh_fourier_interpolation()
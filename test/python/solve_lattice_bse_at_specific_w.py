@@ -63,6 +63,16 @@ def test_lattice_bse_at_specific_w_mesh_types(g0_wk, gamma_wnn, nw_index):
     assert isinstance(chi0_k_at_specific_w.mesh, MeshBrZone)
 
 
+def test_solve_lattice_bse_at_specific_w_compressed_vertex(g0_wk, gamma_wnn, nw_index):
+    chi_k, chi0_k = solve_lattice_bse_at_specific_w(g0_wk, gamma_wnn, nw_index=nw_index)
+    chi_k_lr, chi0_k_lr = solve_lattice_bse_at_specific_w(
+        g0_wk, gamma_wnn, nw_index=nw_index, vertex_tol=1e-14
+    )
+
+    np.testing.assert_allclose(chi0_k.data, chi0_k_lr.data, atol=10e-16)
+    np.testing.assert_allclose(chi_k.data, chi_k_lr.data, atol=1e-8)
+
+
 if __name__ == "__main__":
     p = ParameterCollection(
         dim=2,
@@ -86,4 +96,5 @@ if __name__ == "__main__":
 
     test_solve_lattice_bse_at_specific_w_against_full(g0_wk, gamma_wnn, p.nw_index)
     test_lattice_bse_at_specific_w_mesh_types(g0_wk, gamma_wnn, p.nw_index)
+    test_solve_lattice_bse_at_specific_w_compressed_vertex(g0_wk, gamma_wnn, p.nw_index)
     